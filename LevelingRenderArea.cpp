@@ -27,7 +27,6 @@ using std::endl;
 LevelingRenderArea::LevelingRenderArea(QWidget *parent)
     : QWidget(parent)
 {
-    interpolator = NULL;
     //this->setSizePolicy(QSizePolicy::Expanding);
     drawAxis = false;
     setCursor(Qt::CrossCursor);
@@ -51,7 +50,7 @@ void LevelingRenderArea::resizeEvent(QResizeEvent *)
     this->update();
 }
 
-void LevelingRenderArea::setInterpolator(const Interpolator *interpolator)
+void LevelingRenderArea::setInterpolator(InterpolatorPtr interpolator)
 {
     this->interpolator = interpolator;
     pixmap = QPixmap();
@@ -97,7 +96,7 @@ void LevelingRenderArea::paintEvent(QPaintEvent * /* event */)
 
     painter.fillRect(viewport, Qt::lightGray);
 
-    if (this->interpolator == NULL){
+    if (this->interpolator.isNull()){
         return;
     }
 
@@ -225,9 +224,9 @@ RenderThread::~RenderThread()
     wait();
 }
 
-void RenderThread::render(const Interpolator *interpolator, QSize size)
+void RenderThread::render(InterpolatorPtr interpolator, QSize size)
 {
-    if (interpolator == NULL || interpolator->getType() == Interpolator::SINGLE)
+    if (interpolator.isNull() || interpolator->getType() == Interpolator::SINGLE)
     {
         return;
     }
@@ -249,7 +248,8 @@ void RenderThread::run()
     forever{
         mutex.lock();
         QSize size = this->size;
-        const Interpolator *interpolator = this->interpolator;
+        //Our own reference, the map stays valid even if it is replaced while rendering.
+        InterpolatorPtr interpolator = this->interpolator;
         mutex.unlock();
 
         QImage finalImage(size, QImage::Format_RGB32);
@@ -25,7 +25,7 @@ public:
     RenderThread(QObject *parent = 0);
     ~RenderThread();
 
-    void render(const Interpolator *interpolator, QSize size);
+    void render(InterpolatorPtr interpolator, QSize size);
 
     /**
      * @brief remap Remaps a value in the range from low1 to high1 to a range from low2 to high2
@@ -54,7 +54,7 @@ protected:
 private:
     QMutex mutex;
     QWaitCondition condition;
-    const Interpolator *interpolator;
+    InterpolatorPtr interpolator;
     QSize size;
     QImage gradientImage;
     bool abort;
@@ -73,7 +73,7 @@ public:
     QSize sizeHint() const;
 
 public slots:
-    void setInterpolator(const Interpolator *interpolator);
+    void setInterpolator(InterpolatorPtr interpolator);
 
 protected:
     void enterEvent(QEvent *event);
@@ -83,7 +83,7 @@ protected:
     void resizeEvent(QResizeEvent *);
 
 //    void mousePressEvent(QMouseEvent * mouseEvent);
-    const Interpolator * interpolator;
+    InterpolatorPtr interpolator;
 
 private slots:
     void updatePixmap(const QImage &image);
@@ -1,6 +1,5 @@
 #include "LinearInterpolate3D.h"
 #include <iostream>
-#include <string.h>
 
 /*
  * Linear interpolator class that that supports a minimum of two probing points per axis.
@@ -13,77 +12,13 @@ using std::cout;
 using std::endl;
 
 LinearInterpolate3D::LinearInterpolate3D(const double * xValues, unsigned int xCount, const double * yValues, unsigned int yCount, const double * xyValues, double offset)
+    : Interpolator(HeightMapPtr(new HeightMap(xValues, xCount, yValues, yCount, xyValues, offset)))
 {
-
-    nValuesX = xCount;
-    nValuesY = yCount;
-    initialOffset = offset;
-
-    this->xValues = new double[nValuesX];
-    this->yValues = new double[nValuesY];
-    this->xyValues = new double[nValuesX * nValuesY];
-
-    memcpy(this->xValues, xValues, nValuesX*sizeof(double));
-    memcpy(this->yValues, yValues, nValuesY*sizeof(double));
-    memcpy(this->xyValues, xyValues, nValuesX*nValuesY*sizeof(double));
-
-    zMin = xyValues[0];
-    zMax = xyValues[0];
-    median = 0;
-
-    for (unsigned int i = 0; i<(nValuesX * nValuesY); i++)
-    {
-        if (xyValues[i] < zMin) zMin = xyValues[i];
-        if (xyValues[i] > zMax) zMax = xyValues[i];
-        median += xyValues[i];
-    }
-
-    median /= nValuesX*nValuesY;
 }
 
-LinearInterpolate3D::LinearInterpolate3D(const Interpolator *interpolator)
+LinearInterpolate3D::LinearInterpolate3D(HeightMapPtr map)
+    : Interpolator(map)
 {
-    if (interpolator == NULL)
-    {
-        return;
-    }
-
-    nValuesX = interpolator->getXSteps();
-    nValuesY = interpolator->getYSteps();
-    initialOffset = interpolator->getInitialOffset();
-
-    this->xValues = new double[nValuesX];
-    this->yValues = new double[nValuesY];
-    this->xyValues = new double[nValuesX * nValuesY];
-
-    memcpy(this->xValues, interpolator->getXValues(), nValuesX*sizeof(double));
-    memcpy(this->yValues, interpolator->getYValues(), nValuesY*sizeof(double));
-    memcpy(this->xyValues, interpolator->getXYValues(), nValuesX*nValuesY*sizeof(double));
-
-    zMin = interpolator->getMinZValue();
-    zMax = interpolator->getMaxZValue();
-    median = interpolator->getMedian();
-}
-
-LinearInterpolate3D::~LinearInterpolate3D()
-{
-    if (this->xValues != NULL)
-    {
-        delete [] this->xValues;
-        this->xValues = NULL;
-    }
-
-    if (this->yValues != NULL)
-    {
-        delete [] this->yValues;
-        this->yValues = NULL;
-    }
-
-    if (this->xyValues != NULL)
-    {
-        delete [] this->xyValues;
-        this->xyValues = NULL;
-    }
 }
 
 bool LinearInterpolate3D::findCoeficents(const double * values, unsigned int nValues, double x, unsigned int & a, unsigned int & b) const
@@ -14,11 +14,10 @@ class SingleInterpolate : public Interpolator
 {
 public:
     SingleInterpolate(const double xValue, const double yValue, const double xyValue, double offset);
+    SingleInterpolate(HeightMapPtr map);
 
     bool interpolate(double x, double y, double & res) const;
 
-    virtual ~SingleInterpolate();
-
     interpolator_t getType() const { return SINGLE; }
 
 };
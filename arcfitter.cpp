@@ -0,0 +1,243 @@
+/****************************************************************
+ * arcfitter.cpp
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#include "arcfitter.h"
+#include "modalwalker.h"
+#include "definitions.h"
+#include "trace.h"
+
+#include <math.h>
+
+ArcFitter::ArcFitter()
+{
+}
+
+void ArcFitter::fitProgram(ParsedProgramPtr program, double tolerance, int generation)
+{
+    TRACE_SCOPE("ArcFitter::fitProgram");
+    if (program.isNull())
+        return;
+
+    int moves = 0;
+    int arcs = 0;
+    QByteArray source = fit(*program, tolerance, moves, arcs);
+
+    QString report;
+    if (source.isEmpty())
+    {
+        report = tr("No arcs found in the file within %1 mm").arg(tolerance);
+    }
+    else
+    {
+        report = tr("%1 moves replaced with %2 arcs, %3 lines and %4 bytes less")
+                .arg(moves).arg(arcs).arg(program->lineCount() - source.count('\n'))
+                .arg(program->sourceSize() - source.size());
+    }
+
+    emit fitEnded(source, report, generation);
+}
+
+QByteArray ArcFitter::fit(const ParsedProgram& program, double tolerance, int& moves, int& arcs)
+{
+    moves = 0;
+    arcs = 0;
+
+    QByteArray out;
+    out.reserve(program.sourceSize());
+    Writer writer(program, out);
+
+    ModalWalker walker;
+    ModalWalker::Line line;
+
+    QVector<Point> run;
+    double runFeed = -1;
+
+    int lines = program.lineCount();
+    for (int n = 0; n < lines; n++)
+    {
+        double scale = walker.mm ? 1.0 : 1.0 / MM_IN_AN_INCH;
+
+        if (!program.hasWords(n))
+        {
+            fitRun(run, runFeed, tolerance * scale, ARC_FIT_MAX_RADIUS * scale, writer, moves, arcs);
+            run.clear();
+            writer.writeLine(n, walker.motion, false, false);
+            continue;
+        }
+
+        double x = walker.position[0];
+        double y = walker.position[1];
+        double z = walker.position[2];
+        double feed = walker.feed;
+        walker.read(program.wordsRef(n), line);
+
+        QString text = program.text(n);
+        bool fittable = line.onlyCode(10) && line.onlyLetters("GXYZFN")
+                && walker.absolute && !walker.inverseTime && walker.plane == 170 && walker.motion == 1
+                && (line.hasAxis[0] || line.hasAxis[1]) && walker.position[2] == z
+                && !text.contains('(') && !text.contains(';');
+
+        // A new feed starts a new run, so the arc taking the line can carry it
+        if (!fittable || (line.feed >= 0 && line.feed != feed && !run.isEmpty()))
+        {
+            fitRun(run, runFeed, tolerance * scale, ARC_FIT_MAX_RADIUS * scale, writer, moves, arcs);
+            run.clear();
+        }
+
+        if (fittable)
+        {
+            if (run.isEmpty())
+            {
+                Point start = { x, y, -1, false };
+                run.append(start);
+                runFeed = line.feed;
+            }
+            Point point = { walker.position[0], walker.position[1], n, line.setsMotion };
+            run.append(point);
+        }
+        else
+        {
+            writer.writeLine(n, walker.motion, line.setsMotion, line.hasAxes());
+        }
+    }
+
+    double scale = walker.mm ? 1.0 : 1.0 / MM_IN_AN_INCH;
+    fitRun(run, runFeed, tolerance * scale, ARC_FIT_MAX_RADIUS * scale, writer, moves, arcs);
+
+    if (arcs == 0)
+        return QByteArray();
+    return out;
+}
+
+// Greedy: from the start of the run the longest arc that fits is taken, a move
+// that starts no arc is written as it was
+void ArcFitter::fitRun(const QVector<Point>& points, double runFeed, double tolerance, double maxRadius,
+                       Writer& writer, int& moves, int& arcs)
+{
+    int last = points.size() - 1;
+    int first = 0;
+    while (first < last)
+    {
+        int best = -1;
+        Arc bestArc;
+        for (int end = first + ARC_FIT_MIN_SEGMENTS; end <= last && end - first <= ARC_FIT_MAX_SEGMENTS; end++)
+        {
+            Arc arc;
+            if (!fitArc(points, first, end, tolerance, maxRadius, arc))
+                break;
+            best = end;
+            bestArc = arc;
+        }
+
+        if (best >= 0)
+        {
+            writer.writeArc(points.at(first), points.at(best), bestArc, first == 0 ? runFeed : -1);
+            moves += best - first;
+            arcs++;
+            first = best;
+        }
+        else
+        {
+            const Point& point = points.at(first + 1);
+            writer.writeLine(point.line, 1, point.setsMotion, true);
+            first++;
+        }
+    }
+}
+
+// The circle goes through the first, middle and last points, every point
+// has to be on it and every segment close to it, all turning the same way
+bool ArcFitter::fitArc(const QVector<Point>& points, int first, int last, double tolerance, double maxRadius, Arc& arc)
+{
+    // Relative to the first point, for precision far from the origin
+    const Point& a = points.at(first);
+    double bx = points.at((first + last) / 2).x - a.x;
+    double by = points.at((first + last) / 2).y - a.y;
+    double cx = points.at(last).x - a.x;
+    double cy = points.at(last).y - a.y;
+
+    double d = 2 * (bx * cy - by * cx);
+    if (fabs(d) < 1e-12)
+        return false;
+
+    double b2 = bx * bx + by * by;
+    double c2 = cx * cx + cy * cy;
+    double ux = (cy * b2 - by * c2) / d;
+    double uy = (bx * c2 - cx * b2) / d;
+    double radius = sqrt(ux * ux + uy * uy);
+    if (radius > maxRadius)
+        return false;
+
+    double centerX = a.x + ux;
+    double centerY = a.y + uy;
+
+    double swept = 0;
+    double direction = 0;
+    for (int i = first; i < last; i++)
+    {
+        double x0 = points.at(i).x - centerX;
+        double y0 = points.at(i).y - centerY;
+        double x1 = points.at(i + 1).x - centerX;
+        double y1 = points.at(i + 1).y - centerY;
+
+        double off = fabs(sqrt(x1 * x1 + y1 * y1) - radius);
+        double angle = atan2(x0 * y1 - y0 * x1, x0 * x1 + y0 * y1);
+        if (i == first)
+            direction = angle;
+
+        if (angle * direction <= 0 || fabs(angle) > ARC_FIT_MAX_SEGMENT_ANGLE)
+            return false;
+
+        double chord2 = (x1 - x0) * (x1 - x0) + (y1 - y0) * (y1 - y0);
+        double sagitta = radius - sqrt(qMax(radius * radius - chord2 / 4, 0.0));
+        if (off + sagitta > tolerance)
+            return false;
+
+        swept += fabs(angle);
+    }
+
+    // A full circle is left to the moves, its end is ambiguous
+    if (swept >= 2 * M_PI - ARC_FIT_MAX_SEGMENT_ANGLE)
+        return false;
+
+    arc.centerX = centerX;
+    arc.centerY = centerY;
+    arc.clockwise = direction < 0;
+    return true;
+}
+
+ArcFitter::Writer::Writer(const ParsedProgram& program, QByteArray& out)
+    : program(program), out(out), motion(0)
+{
+}
+
+// A line that moves on the modal G word gets it back if an arc changed it
+void ArcFitter::Writer::writeLine(int line, int lineMotion, bool setsMotion, bool hasAxis)
+{
+    bool restore = hasAxis && !setsMotion && lineMotion >= 0 && motion != lineMotion;
+    if (restore)
+        out += "G" + QByteArray::number(lineMotion) + " ";
+    if (restore || setsMotion)
+        motion = lineMotion;
+
+    out += program.text(line).toLocal8Bit() + '\n';
+}
+
+void ArcFitter::Writer::writeArc(const Point& start, const Point& end, const Arc& arc, double feed)
+{
+    motion = arc.clockwise ? 2 : 3;
+
+    out += arc.clockwise ? "G2" : "G3";
+    out += " X" + ParsedProgram::formatValue(end.x);
+    out += " Y" + ParsedProgram::formatValue(end.y);
+    out += " I" + ParsedProgram::formatValue(arc.centerX - start.x);
+    out += " J" + ParsedProgram::formatValue(arc.centerY - start.y);
+    if (feed >= 0)
+        out += " F" + ParsedProgram::formatValue(feed);
+    out += '\n';
+}
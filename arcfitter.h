@@ -0,0 +1,90 @@
+/****************************************************************
+ * arcfitter.h
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#ifndef ARCFITTER_H
+#define ARCFITTER_H
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include "parsedprogram.h"
+
+#define ARC_FIT_MIN_SEGMENTS    3       // shorter runs are not worth an arc
+#define ARC_FIT_MAX_SEGMENTS    256     // longest run checked for a single arc
+#define ARC_FIT_MAX_RADIUS      1000.0  // mm, flatter than that is a line
+#define ARC_FIT_MAX_SEGMENT_ANGLE 0.5   // rad, a segment spanning more is a corner, not a curve
+
+/**
+ * @brief Replaces runs of short G1 moves that lie on a circle with G2/G3.
+ *
+ * The program is read line by line. Consecutive G1 moves in the XY plane, at
+ * the same Z, in absolute mode and with no comments, form a run. Only the
+ * first move of a run can set the feed, so the feed of every move is kept.
+ * Each run is covered from its start with the longest arcs that keep every
+ * point and every segment within the tolerance of the circle, the moves
+ * left over are written as they were. Lines after an arc get back the G1
+ * they relied on.
+ */
+class ArcFitter : public QObject
+{
+    Q_OBJECT
+public:
+    ArcFitter();
+
+    /**
+     * @brief Builds the program with the arcs.
+     * @param tolerance Largest distance of the moves from the arcs, mm.
+     * @param moves, arcs Number of moves replaced and arcs written.
+     * @return The new source, or an empty array if no arc was found.
+     */
+    static QByteArray fit(const ParsedProgram& program, double tolerance, int& moves, int& arcs);
+
+signals:
+    void fitEnded(QByteArray source, QString report, int generation);
+
+public slots:
+    void fitProgram(ParsedProgramPtr program, double tolerance, int generation);
+
+private:
+    // End of a move of the run, the first one is where the run starts
+    struct Point
+    {
+        double x;
+        double y;
+        int line;
+        bool setsMotion;    // the line has its G1
+    };
+
+    struct Arc
+    {
+        double centerX;
+        double centerY;
+        bool clockwise;
+    };
+
+    class Writer
+    {
+    public:
+        Writer(const ParsedProgram& program, QByteArray& out);
+
+        void writeLine(int line, int motion, bool setsMotion, bool hasAxis);
+        void writeArc(const Point& start, const Point& end, const Arc& arc, double feed);
+
+    private:
+        const ParsedProgram& program;
+        QByteArray& out;
+        int motion;
+    };
+
+    static void fitRun(const QVector<Point>& points, double runFeed, double tolerance, double maxRadius,
+                       Writer& writer, int& moves, int& arcs);
+    static bool fitArc(const QVector<Point>& points, int first, int last, double tolerance, double maxRadius, Arc& arc);
+};
+
+#endif // ARCFITTER_H
@@ -118,3 +118,28 @@ double ArcItem::toDegrees(double rad)
 {
     return 360 * rad / TWO_PI;
 }
+
+double ArcItem::distanceTo(double x, double y, double fromX, double fromY)
+{
+    Q_UNUSED(fromX);
+    Q_UNUSED(fromY);
+
+    // Same sampling as computeExtents, the distance to the polyline is close enough to pick a line
+    double angleEnd = angleStart + angleDelta;
+    double lastx = qCos(angleStart) * radius + centx;
+    double lasty = qSin(angleStart) * radius + centy;
+    double best = segmentDistance(x, y, lastx, lasty, lastx, lasty);
+    for (double angle = angleStart;
+         (angleDelta < 0 ? angle > angleEnd : angle < angleEnd);
+         angle += (angleDelta < 0 ? -0.1 : 0.1))
+    {
+        double px = qCos(angle) * radius + centx;
+        double py = qSin(angle) * radius + centy;
+        best = qMin(best, segmentDistance(x, y, lastx, lasty, px, py));
+        lastx = px;
+        lasty = py;
+    }
+    double ex1 = qCos(angleEnd) * radius + centx;
+    double ey1 = qSin(angleEnd) * radius + centy;
+    return qMin(best, segmentDistance(x, y, lastx, lasty, ex1, ey1));
+}
@@ -18,6 +18,7 @@ public:
     double getYScr();
     double getXRaw();
     double getYRaw();
+    double distanceTo(double x, double y, double fromX, double fromY);
 
     double toDegrees(double rad);
 
@@ -0,0 +1,21 @@
+#-------------------------------------------------
+#
+# Microbenchmarks of the controller core, run corebench --help
+#
+#-------------------------------------------------
+
+QT       -= gui
+
+TARGET = corebench
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+include(../core/core.pri)
+
+
+SOURCES += main.cpp \
+    corebenchmark.cpp
+
+
+HEADERS  += corebenchmark.h
@@ -0,0 +1,440 @@
+/****************************************************************
+ * corebenchmark.cpp
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#include "corebenchmark.h"
+#include "gcodegrbl.h"
+#include "gcodemarlin.h"
+#include "linesteps.h"
+#include "fileparser.h"
+#include "gcommands.h"
+#include "heightmap.h"
+#include "SpilineInterpolate3D.h"
+#include "LinearInterpolate3D.h"
+#include "SingleInterpolate.h"
+
+#include <QElapsedTimer>
+#include <math.h>
+
+const CoreBenchmark::Case CoreBenchmark::cases[] =
+{
+    { "trimAndFilter",      &CoreBenchmark::trimAndFilter },
+    { "reducePrecision",    &CoreBenchmark::reducePrecision },
+    { "zRateLimit",         &CoreBenchmark::zRateLimit },
+    { "parseCoordinates",   &CoreBenchmark::parseCoordinates },
+    { "gcodeCommand",       &CoreBenchmark::gcodeCommand },
+    { "marlinFriendly",     &CoreBenchmark::marlinFriendly },
+    { "levelLine",          &CoreBenchmark::levelLine },
+    { "levelArc",           &CoreBenchmark::levelArc },
+    { "interpolateSpline",  &CoreBenchmark::interpolateSpline },
+    { "interpolateLinear",  &CoreBenchmark::interpolateLinear },
+    { "interpolateSingle",  &CoreBenchmark::interpolateSingle },
+    { "parseSource",        &CoreBenchmark::parseSource },
+    { NULL, NULL }
+};
+
+// Same sequence on every machine and every run
+class BenchRandom
+{
+public:
+    BenchRandom() : state(12345) {}
+
+    quint32 next()
+    {
+        state = state * 1664525 + 1013904223;
+        return state >> 8;
+    }
+
+    double uniform(double low, double high)
+    {
+        return low + (high - low) * (next() % 1000000) / 1000000.0;
+    }
+
+private:
+    quint32 state;
+};
+
+QJsonObject CoreBenchmark::Result::toJson() const
+{
+    QJsonObject object;
+    object["name"] = name;
+    object["lines"] = lines;
+    object["runs"] = runs;
+    object["best_ms"] = bestMs;
+    object["mean_ms"] = meanMs;
+    object["ns_per_line"] = nsPerLine();
+    object["lines_per_sec"] = bestMs > 0 ? lines * 1000.0 / bestMs : 0;
+    return object;
+}
+
+CoreBenchmark::CoreBenchmark()
+    : parser(new FileParser()), sourceLines(0)
+{
+    generatePools();
+
+    grbl = new GCodeGrbl();
+    marlin = new GCodeMarlin();
+
+    // A warped board, 1 mm between the corners
+    QVector<double> xValues, yValues, zValues;
+    for (int i = 0; i < BENCH_GRID_STEPS; i++)
+    {
+        xValues.append(i * BENCH_GRID_SIZE / (BENCH_GRID_STEPS - 1));
+        yValues.append(i * BENCH_GRID_SIZE / (BENCH_GRID_STEPS - 1));
+    }
+    for (int j = 0; j < BENCH_GRID_STEPS; j++)
+    {
+        for (int i = 0; i < BENCH_GRID_STEPS; i++)
+            zValues.append(sin(xValues.at(i) / 50) * cos(yValues.at(j) / 70) * 0.5);
+    }
+
+    HeightMapPtr map(new HeightMap(xValues.constData(), BENCH_GRID_STEPS, yValues.constData(), BENCH_GRID_STEPS,
+                                   zValues.constData(), 0));
+    spline = InterpolatorPtr(new SpilineInterpolate3D(map));
+    linear = InterpolatorPtr(new LinearInterpolate3D(map));
+    single = InterpolatorPtr(new SingleInterpolate(map));
+
+    ControlParams params;
+    params.zRateLimit = true;
+    params.reducePrecision = true;
+    grblSteps()->prepareLineSteps(params, spline);
+    marlinSteps()->prepareLineSteps(params, spline);
+}
+
+CoreBenchmark::~CoreBenchmark()
+{
+    delete grbl;
+    delete marlin;
+    delete parser;
+}
+
+QStringList CoreBenchmark::caseNames() const
+{
+    QStringList names;
+    for (int i = 0; cases[i].name != NULL; i++)
+        names.append(cases[i].name);
+    return names;
+}
+
+CoreBenchmark::Result CoreBenchmark::run(const QString& name, int lines, int minMs)
+{
+    Result result;
+    result.name = name;
+    result.lines = lines;
+    result.runs = 0;
+    result.bestMs = 0;
+    result.meanMs = 0;
+    result.checksum = 0;
+
+    CaseFunction function = NULL;
+    for (int i = 0; cases[i].name != NULL; i++)
+    {
+        if (name == cases[i].name)
+            function = cases[i].function;
+    }
+    if (function == NULL)
+        return result;
+
+    QElapsedTimer total;
+    total.start();
+    double sumMs = 0;
+    do
+    {
+        QElapsedTimer timer;
+        timer.start();
+        result.checksum += (this->*function)(lines);
+        double ms = timer.nsecsElapsed() / 1e6;
+
+        if (result.runs == 0 || ms < result.bestMs)
+            result.bestMs = ms;
+        sumMs += ms;
+        result.runs++;
+    } while (total.elapsed() < minMs && result.runs < BENCH_MAX_REPEAT);
+
+    result.meanMs = sumMs / result.runs;
+    return result;
+}
+
+// Moves wander over the height map area, arcs are real arcs so leveling
+// splits them as it would split a CAM file
+void CoreBenchmark::generatePools()
+{
+    BenchRandom random;
+    double x = 0, y = 0, z = 5;
+    int n = 10;
+
+    for (int i = 0; i < BENCH_POOL_LINES; i++)
+    {
+        int kind = random.next() % 100;
+        QString line;
+        QString words;
+        int code = -1;
+        QString params;
+
+        if (kind < 10)
+        {
+            x = random.uniform(0, BENCH_GRID_SIZE);
+            y = random.uniform(0, BENCH_GRID_SIZE);
+            z = 5;
+            code = 0;
+            params = QString("X%1 Y%2 Z%3").arg(x, 0, 'f', 4).arg(y, 0, 'f', 4).arg(z, 0, 'f', 4);
+            line = "G0 " + params;
+        }
+        else if (kind < 15)
+        {
+            z = random.uniform(-2, 0);
+            code = 1;
+            params = QString("Z%1 F100").arg(z, 0, 'f', 4);
+            line = "G1 " + params;
+        }
+        else if (kind < 60)
+        {
+            x = qBound(0.0, x + random.uniform(-20, 20), BENCH_GRID_SIZE);
+            y = qBound(0.0, y + random.uniform(-20, 20), BENCH_GRID_SIZE);
+            code = 1;
+            params = QString("X%1 Y%2 Z%3 F%4").arg(x, 0, 'f', 4).arg(y, 0, 'f', 4).arg(z, 0, 'f', 4)
+                    .arg(400 + random.next() % 8 * 100);
+            line = "G1 " + params;
+        }
+        else if (kind < 80)
+        {
+            // Around a center at radius r, up to a quarter turn, staying on the map
+            double r = random.uniform(2, 20);
+            double start = random.uniform(0, 2 * M_PI);
+            double cx = x - r * cos(start);
+            double cy = y - r * sin(start);
+            bool clockwise = random.next() % 2;
+            double sweep = random.uniform(0.2, M_PI / 2) * (clockwise ? -1 : 1);
+            double ex = cx + r * cos(start + sweep);
+            double ey = cy + r * sin(start + sweep);
+            if (ex < 0 || ex > BENCH_GRID_SIZE || ey < 0 || ey > BENCH_GRID_SIZE)
+            {
+                ex = x;
+                ey = y;
+                sweep = 0;
+            }
+
+            if (sweep != 0)
+            {
+                code = clockwise ? 2 : 3;
+                params = QString("X%1 Y%2 I%3 J%4").arg(ex, 0, 'f', 4).arg(ey, 0, 'f', 4)
+                        .arg(cx - x, 0, 'f', 4).arg(cy - y, 0, 'f', 4);
+                line = QString("G%1 ").arg(code) + params;
+                arcCodes.append(code);
+                arcParams.append(params);
+                x = ex;
+                y = ey;
+                code = -1;
+            }
+            else
+            {
+                line = QString("X%1 Y%2").arg(x, 0, 'f', 4).arg(y, 0, 'f', 4);
+            }
+        }
+        else if (kind < 85)
+        {
+            line = random.next() % 2 ? QString("(pass %1 of 7)").arg(random.next() % 7 + 1) : QString("; profile");
+        }
+        else if (kind < 90)
+        {
+            const char *misc[] = { "M3 S12000", "M5", "M8", "M9", "G90", "G21", "G17" };
+            line = misc[random.next() % 7];
+        }
+        else if (kind < 95)
+        {
+            x = qBound(0.0, x + random.uniform(-5, 5), BENCH_GRID_SIZE);
+            y = qBound(0.0, y + random.uniform(-5, 5), BENCH_GRID_SIZE);
+            code = 1;
+            params = QString("X%1 Y%2").arg(x, 0, 'f', 4).arg(y, 0, 'f', 4);
+            line = QString("g1 x%1 y%2 ; finishing").arg(x, 0, 'f', 4).arg(y, 0, 'f', 4);
+        }
+        else
+        {
+            x = qBound(0.0, x + random.uniform(-20, 20), BENCH_GRID_SIZE);
+            code = 1;
+            params = QString("X%1 F800").arg(x, 0, 'f', 4);
+            line = QString("N%1 G1 ").arg(n) + params;
+            n += 10;
+        }
+
+        if (code >= 0)
+        {
+            lineCodes.append(code);
+            lineParams.append(params);
+        }
+        fileLines.append(line);
+
+        // What the parser hands to the senders: no comments, no line numbers, upper case
+        words = line;
+        GCodeController::trimToEnd(words, '(');
+        GCodeController::trimToEnd(words, ';');
+        words = words.toUpper().trimmed();
+        if (words.startsWith('N'))
+            words = words.section(' ', 1);
+        if (!words.isEmpty())
+            wordLines.append(words);
+
+        statusReports.append(QString("<%1,MPos:%2,%3,%4,WPos:%5,%6,%7>")
+                             .arg(kind < 95 ? "Run" : "Idle")
+                             .arg(x + 10, 0, 'f', 3).arg(y + 10, 0, 'f', 3).arg(z - 20, 0, 'f', 3)
+                             .arg(x, 0, 'f', 3).arg(y, 0, 'f', 3).arg(z, 0, 'f', 3));
+
+        samplePoints.append(random.uniform(0, BENCH_GRID_SIZE));
+        samplePoints.append(random.uniform(0, BENCH_GRID_SIZE));
+    }
+}
+
+// The legacy path for unfiltered file lines: comments cut, then the words Grbl doesn't know
+qint64 CoreBenchmark::trimAndFilter(int lines)
+{
+    qint64 sum = 0;
+    int pool = fileLines.size();
+    for (int i = 0; i < lines; i++)
+    {
+        QString line = fileLines.at(i % pool);
+        GCodeController::trimToEnd(line, '(');
+        GCodeController::trimToEnd(line, ';');
+        line = line.toUpper();
+        if (line.trimmed().size() > 0)
+            line = grblSteps()->filterLine(line);
+        sum += line.size();
+    }
+    return sum;
+}
+
+qint64 CoreBenchmark::reducePrecision(int lines)
+{
+    qint64 sum = 0;
+    int pool = wordLines.size();
+    for (int i = 0; i < lines; i++)
+        sum += grblSteps()->reduceLinePrecision(wordLines.at(i % pool)).size();
+    return sum;
+}
+
+qint64 CoreBenchmark::zRateLimit(int lines)
+{
+    qint64 sum = 0;
+    int pool = wordLines.size();
+    for (int i = 0; i < lines; i++)
+        sum += grblSteps()->limitLineZRate(wordLines.at(i % pool)).size();
+    return sum;
+}
+
+qint64 CoreBenchmark::parseCoordinates(int lines)
+{
+    int pool = statusReports.size();
+    Coord3D workCoord;
+    for (int i = 0; i < lines; i++)
+        workCoord = grblSteps()->readStatusReport(statusReports.at(i % pool));
+    return (qint64)workCoord.x;
+}
+
+qint64 CoreBenchmark::gcodeCommand(int lines)
+{
+    qint64 sum = 0;
+    int pool = lineCodes.size();
+    for (int i = 0; i < lines; i++)
+    {
+        GCodeCommand command(lineCodes.at(i % pool), lineParams.at(i % pool), FOURTH_AXIS_A);
+        sum += command.toString().size();
+    }
+    return sum;
+}
+
+qint64 CoreBenchmark::marlinFriendly(int lines)
+{
+    qint64 sum = 0;
+    int pool = wordLines.size();
+    for (int i = 0; i < lines; i++)
+        sum += marlinSteps()->filterLine(wordLines.at(i % pool)).size();
+    return sum;
+}
+
+qint64 CoreBenchmark::levelLine(int lines)
+{
+    return level(lines, lineCodes, lineParams);
+}
+
+qint64 CoreBenchmark::levelArc(int lines)
+{
+    return level(lines, arcCodes, arcParams);
+}
+
+// As levelGcodeLine does it, the segments are written out
+qint64 CoreBenchmark::level(int lines, const QVector<int>& codes, const QStringList& params)
+{
+    qint64 sum = 0;
+    int pool = codes.size();
+    for (int i = 0; i < lines; i++)
+    {
+        GCodeCommand *command = new GCodeCommand(codes.at(i % pool), params.at(i % pool), FOURTH_AXIS_A);
+        QList<CodeCommand *> segments = grblSteps()->levelCommand(command);
+        foreach (CodeCommand *segment, segments)
+        {
+            sum += segment->toString().size();
+            delete segment;
+        }
+    }
+    return sum;
+}
+
+qint64 CoreBenchmark::interpolateSpline(int lines)
+{
+    return interpolate(lines, spline);
+}
+
+qint64 CoreBenchmark::interpolateLinear(int lines)
+{
+    return interpolate(lines, linear);
+}
+
+qint64 CoreBenchmark::interpolateSingle(int lines)
+{
+    return interpolate(lines, single);
+}
+
+qint64 CoreBenchmark::interpolate(int lines, const InterpolatorPtr& interpolator)
+{
+    double sum = 0;
+    int pool = samplePoints.size() / 2;
+    for (int i = 0; i < lines; i++)
+    {
+        double z = 0;
+        interpolator->interpolate(samplePoints.at(2 * (i % pool)), samplePoints.at(2 * (i % pool) + 1), z);
+        sum += z;
+    }
+    return (qint64)(sum * 1000);
+}
+
+qint64 CoreBenchmark::parseSource(int lines)
+{
+    // Built once per line count, outside of the timed runs that follow
+    if (sourceLines != lines)
+    {
+        source.clear();
+        int pool = fileLines.size();
+        for (int i = 0; i < lines; i++)
+        {
+            source.append(fileLines.at(i % pool).toLocal8Bit());
+            source.append('\n');
+        }
+        sourceLines = lines;
+    }
+
+    parser->parseSource("bench.nc", source, parser->nextGeneration());
+    return source.size();
+}
+
+LineSteps *CoreBenchmark::grblSteps() const
+{
+    return grbl;
+}
+
+LineSteps *CoreBenchmark::marlinSteps() const
+{
+    return marlin;
+}
@@ -0,0 +1,117 @@
+/****************************************************************
+ * corebenchmark.h
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#ifndef COREBENCHMARK_H
+#define COREBENCHMARK_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QList>
+#include <QByteArray>
+#include <QJsonObject>
+#include "interpolator.h"
+
+#define BENCH_POOL_LINES        10000   // distinct synthetic lines, longer workloads cycle over them
+#define BENCH_DEFAULT_MIN_MS    300     // a case is repeated until it ran this long
+#define BENCH_MAX_REPEAT        1000
+#define BENCH_GRID_SIZE         200.0   // mm, area covered by the moves and the height map
+#define BENCH_GRID_STEPS        10
+
+class GCodeGrbl;
+class GCodeMarlin;
+class LineSteps;
+class FileParser;
+
+/**
+ * @brief Times the per-line steps of the file send on synthetic workloads.
+ *
+ * Each case runs one step over a given number of lines, taken in turn
+ * from a pool of generated CAM-like lines: rapids, feed moves, arcs,
+ * comments, spindle and coolant words. A case is repeated until it ran
+ * for a minimum time and the fastest run is kept, the result is the
+ * time per line.
+ *
+ * The controller steps are reached through their LineSteps interface,
+ * the parser through the same entry point the GUI uses.
+ */
+class CoreBenchmark
+{
+public:
+    struct Result
+    {
+        QString name;
+        int lines;
+        int runs;
+        double bestMs;
+        double meanMs;
+        qint64 checksum;    // keeps the work from being optimized away
+
+        double nsPerLine() const { return lines > 0 ? bestMs * 1e6 / lines : 0; }
+        QJsonObject toJson() const;
+    };
+
+    CoreBenchmark();
+    ~CoreBenchmark();
+
+    QStringList caseNames() const;
+    Result run(const QString& name, int lines, int minMs);
+
+private:
+    typedef qint64 (CoreBenchmark::*CaseFunction)(int lines);
+
+    struct Case
+    {
+        const char *name;
+        CaseFunction function;
+    };
+
+    static const Case cases[];
+
+    void generatePools();
+
+    qint64 trimAndFilter(int lines);
+    qint64 reducePrecision(int lines);
+    qint64 zRateLimit(int lines);
+    qint64 parseCoordinates(int lines);
+    qint64 gcodeCommand(int lines);
+    qint64 marlinFriendly(int lines);
+    qint64 levelLine(int lines);
+    qint64 levelArc(int lines);
+    qint64 interpolateSpline(int lines);
+    qint64 interpolateLinear(int lines);
+    qint64 interpolateSingle(int lines);
+    qint64 parseSource(int lines);
+
+    qint64 level(int lines, const QVector<int>& codes, const QStringList& params);
+    qint64 interpolate(int lines, const InterpolatorPtr& interpolator);
+
+    LineSteps *grblSteps() const;
+    LineSteps *marlinSteps() const;
+
+private:
+    GCodeGrbl *grbl;
+    GCodeMarlin *marlin;
+    FileParser *parser;
+    InterpolatorPtr spline;
+    InterpolatorPtr linear;
+    InterpolatorPtr single;
+
+    QStringList fileLines;      // as written in a file, with comments and mixed case
+    QStringList wordLines;      // as the parser leaves them, upper case words split by spaces
+    QStringList statusReports;
+    QVector<int> lineCodes;     // G0/G1 moves split in motion code and parameters
+    QStringList lineParams;
+    QVector<int> arcCodes;      // G2/G3 moves
+    QStringList arcParams;
+    QVector<double> samplePoints;
+    QByteArray source;          // fileLines cycled to sourceLines lines
+    int sourceLines;
+};
+
+#endif // COREBENCHMARK_H
@@ -0,0 +1,216 @@
+/****************************************************************
+ * main.cpp
+ * GrblHoming - zapmaker fork on github
+ *
+ * Microbenchmarks of the per-line steps of the file send
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QDateTime>
+#include <QFile>
+#include <QTextStream>
+#include <QRegExp>
+#include <QMap>
+#include <stdio.h>
+
+#include "corebenchmark.h"
+#include "version.h"
+#include "definitions.h"
+
+#if defined(Q_CC_GNU) && !defined(Q_CC_CLANG)
+#define BENCH_COMPILER QString("gcc %1.%2.%3").arg(__GNUC__).arg(__GNUC_MINOR__).arg(__GNUC_PATCHLEVEL__)
+#elif defined(Q_CC_CLANG)
+#define BENCH_COMPILER QString("clang %1.%2.%3").arg(__clang_major__).arg(__clang_minor__).arg(__clang_patchlevel__)
+#elif defined(Q_CC_MSVC)
+#define BENCH_COMPILER QString("msvc %1").arg(_MSC_VER)
+#else
+#define BENCH_COMPILER QString("unknown")
+#endif
+
+#ifdef QT_NO_DEBUG
+#define BENCH_BUILD "release"
+#else
+#define BENCH_BUILD "debug"
+#endif
+
+enum BenchExitCode
+{
+    BENCH_OK = 0,
+    BENCH_USAGE,
+    BENCH_REGRESSION,   // slower than the baseline by more than the threshold
+};
+
+static QString resultKey(const QJsonObject& result)
+{
+    return QString("%1/%2").arg(result["name"].toString()).arg((qint64)result["lines"].toDouble());
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("corebench");
+    QCoreApplication::setApplicationVersion(GRBL_CONTROLLER_NAME_AND_VERSION);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Times the per-line steps of the file send on synthetic G-code.\n"
+                                     "One row per case and size on stdout, JSON results with --output.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+
+    QCommandLineOption sizesOption("sizes", "Comma separated line counts.", "list", "10000,1000000,10000000");
+    QCommandLineOption filterOption(QStringList() << "f" << "filter", "Only the cases matching this regular expression.", "regexp");
+    QCommandLineOption minTimeOption("min-time", "Repeat each case until it ran this long, ms.", "ms",
+                                     QString::number(BENCH_DEFAULT_MIN_MS));
+    QCommandLineOption outputOption(QStringList() << "o" << "output", "Write the results to this JSON file.", "file");
+    QCommandLineOption baselineOption("baseline", "Compare with the results of an earlier run.", "file");
+    QCommandLineOption thresholdOption("threshold", "Slowdown over the baseline that fails the run, percent.", "pct", "10");
+    QCommandLineOption listOption("list", "List the cases and exit.");
+    parser.addOption(sizesOption);
+    parser.addOption(filterOption);
+    parser.addOption(minTimeOption);
+    parser.addOption(outputOption);
+    parser.addOption(baselineOption);
+    parser.addOption(thresholdOption);
+    parser.addOption(listOption);
+    parser.process(a);
+
+    QTextStream out(stdout);
+    QTextStream errOut(stderr);
+
+    QList<int> sizes;
+    foreach (QString item, parser.value(sizesOption).split(',', QString::SkipEmptyParts))
+    {
+        bool ok;
+        int size = item.trimmed().toInt(&ok);
+        if (!ok || size <= 0)
+        {
+            errOut << "Bad size " << item << endl;
+            return BENCH_USAGE;
+        }
+        sizes.append(size);
+    }
+
+    bool ok;
+    int minMs = parser.value(minTimeOption).toInt(&ok);
+    if (!ok || minMs < 0)
+    {
+        errOut << "Bad minimum time " << parser.value(minTimeOption) << endl;
+        return BENCH_USAGE;
+    }
+    double threshold = parser.value(thresholdOption).toDouble(&ok);
+    if (!ok || threshold < 0)
+    {
+        errOut << "Bad threshold " << parser.value(thresholdOption) << endl;
+        return BENCH_USAGE;
+    }
+
+    QRegExp filter(parser.value(filterOption));
+    if (!filter.isValid())
+    {
+        errOut << "Bad filter " << parser.value(filterOption) << endl;
+        return BENCH_USAGE;
+    }
+
+    QMap<QString, double> baseline;
+    if (parser.isSet(baselineOption))
+    {
+        QFile file(parser.value(baselineOption));
+        if (!file.open(QIODevice::ReadOnly))
+        {
+            errOut << "Can't read baseline " << file.fileName() << endl;
+            return BENCH_USAGE;
+        }
+        QJsonArray results = QJsonDocument::fromJson(file.readAll()).object()["results"].toArray();
+        foreach (QJsonValue value, results)
+        {
+            QJsonObject result = value.toObject();
+            baseline.insert(resultKey(result), result["ns_per_line"].toDouble());
+        }
+    }
+
+    // The steps log through log4qt, only the warnings are wanted here
+    setupToolLogging(QString());
+
+    CoreBenchmark bench;
+
+    if (parser.isSet(listOption))
+    {
+        foreach (QString name, bench.caseNames())
+            out << name << endl;
+        return BENCH_OK;
+    }
+
+    QJsonArray results;
+    int regressions = 0;
+
+    out << QString("%1 %2 %3 %4 %5")
+           .arg("case", -20).arg("lines", 10).arg("runs", 6).arg("ns/line", 10).arg("baseline", 10) << endl;
+
+    foreach (QString name, bench.caseNames())
+    {
+        if (!filter.isEmpty() && filter.indexIn(name) < 0)
+            continue;
+
+        foreach (int size, sizes)
+        {
+            CoreBenchmark::Result result = bench.run(name, size, minMs);
+            QJsonObject json = result.toJson();
+
+            QString compare;
+            QString key = resultKey(json);
+            if (baseline.contains(key) && baseline.value(key) > 0)
+            {
+                double change = (result.nsPerLine() / baseline.value(key) - 1) * 100;
+                json["baseline_ns_per_line"] = baseline.value(key);
+                json["change_pct"] = change;
+                compare = QString("%1%2%").arg(change >= 0 ? "+" : "").arg(change, 0, 'f', 1);
+                if (change > threshold)
+                {
+                    json["regression"] = true;
+                    compare += " REGRESSION";
+                    regressions++;
+                }
+            }
+
+            out << QString("%1 %2 %3 %4 %5")
+                   .arg(name, -20).arg(size, 10).arg(result.runs, 6)
+                   .arg(result.nsPerLine(), 10, 'f', 1).arg(compare, 10) << endl;
+            results.append(json);
+        }
+    }
+
+    if (parser.isSet(outputOption))
+    {
+        QJsonObject root;
+        root["version"] = QString(GRBL_CONTROLLER_NAME_AND_VERSION);
+        root["qt"] = QString(qVersion());
+        root["compiler"] = BENCH_COMPILER;
+        root["build"] = QString(BENCH_BUILD);
+        root["date"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+        root["min_time_ms"] = minMs;
+        root["results"] = results;
+
+        QFile file(parser.value(outputOption));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        {
+            errOut << "Can't write " << file.fileName() << endl;
+            return BENCH_USAGE;
+        }
+        file.write(QJsonDocument(root).toJson());
+    }
+
+    if (regressions > 0)
+    {
+        errOut << regressions << " result(s) slower than the baseline by more than " << threshold << "%" << endl;
+        return BENCH_REGRESSION;
+    }
+
+    return BENCH_OK;
+}
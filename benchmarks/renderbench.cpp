@@ -0,0 +1,167 @@
+/****************************************************************
+ * renderbench.cpp
+ * GrblHoming - zapmaker fork on github
+ *
+ * Offscreen benchmark of the visualizer and the height map view
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#include <QGuiApplication>
+#include <QCommandLineParser>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QDateTime>
+#include <QFile>
+#include <QTextStream>
+#include <stdio.h>
+
+#include "renderbenchmark.h"
+#include "version.h"
+
+static bool parseSizes(const QString& text, QList<QSize>& sizes)
+{
+    foreach (QString item, text.split(',', QString::SkipEmptyParts))
+    {
+        QStringList parts = item.trimmed().toLower().split('x');
+        bool okw = false, okh = false;
+        int w = parts.size() == 2 ? parts.at(0).toInt(&okw) : 0;
+        int h = parts.size() == 2 ? parts.at(1).toInt(&okh) : 0;
+        if (!okw || !okh || w <= 0 || h <= 0)
+            return false;
+        sizes.append(QSize(w, h));
+    }
+    return !sizes.isEmpty();
+}
+
+static bool parseCounts(const QString& text, int minimum, QList<int>& counts)
+{
+    foreach (QString item, text.split(',', QString::SkipEmptyParts))
+    {
+        bool ok;
+        int count = item.trimmed().toInt(&ok);
+        if (!ok || count < minimum)
+            return false;
+        counts.append(count);
+    }
+    return !counts.isEmpty();
+}
+
+int main(int argc, char *argv[])
+{
+    // Runs without a display unless another platform is asked for
+    if (qgetenv("QT_QPA_PLATFORM").isEmpty())
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QGuiApplication a(argc, argv);
+    QCoreApplication::setApplicationName("renderbench");
+    QCoreApplication::setApplicationVersion(GRBL_CONTROLLER_NAME_AND_VERSION);
+
+    qRegisterMetaType<ParsedProgramPtr>("ParsedProgramPtr");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Draws the visualizer and the height map view into offscreen images.\n"
+                                     "One row per case on stdout, JSON results with --output.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+
+    QCommandLineOption windowsOption(QStringList() << "w" << "windows", "Comma separated window sizes.", "list",
+                                     "640x480,1280x800,1920x1080");
+    QCommandLineOption linesOption(QStringList() << "l" << "lines", "Comma separated file sizes, moves.", "list",
+                                   "10000,100000,1000000");
+    QCommandLineOption gridsOption(QStringList() << "g" << "grids", "Comma separated height map sizes, points per side.",
+                                   "list", "5,20");
+    QCommandLineOption framesOption("frames", "Frames drawn per case after the first one.", "count", "10");
+    QCommandLineOption outputOption(QStringList() << "o" << "output", "Write the results to this JSON file.", "file");
+    parser.addOption(windowsOption);
+    parser.addOption(linesOption);
+    parser.addOption(gridsOption);
+    parser.addOption(framesOption);
+    parser.addOption(outputOption);
+    parser.process(a);
+
+    QTextStream out(stdout);
+    QTextStream errOut(stderr);
+
+    QList<QSize> windows;
+    QList<int> lines;
+    QList<int> grids;
+    QList<int> frameCount;
+    if (!parseSizes(parser.value(windowsOption), windows))
+    {
+        errOut << "Bad window sizes " << parser.value(windowsOption) << endl;
+        return 1;
+    }
+    if (!parseCounts(parser.value(linesOption), 1, lines))
+    {
+        errOut << "Bad file sizes " << parser.value(linesOption) << endl;
+        return 1;
+    }
+    // The heat map needs at least two points per side
+    if (!parseCounts(parser.value(gridsOption), 2, grids))
+    {
+        errOut << "Bad height map sizes " << parser.value(gridsOption) << endl;
+        return 1;
+    }
+    if (!parseCounts(parser.value(framesOption), 1, frameCount) || frameCount.size() != 1)
+    {
+        errOut << "Bad frame count " << parser.value(framesOption) << endl;
+        return 1;
+    }
+    int frames = frameCount.first();
+
+    RenderBenchmark bench;
+    QJsonArray results;
+
+    out << QString("%1 %2 %3 %4 %5 %6 %7")
+           .arg("case", -10).arg("lines", 9).arg("window", 11).arg("first ms", 10)
+           .arg("frame ms", 10).arg("worst ms", 10).arg("peak KB", 10) << endl;
+
+    QList<RenderBenchmark::Result> all;
+    foreach (int count, lines)
+    {
+        foreach (QSize window, windows)
+            all.append(bench.fileView(count, window, frames));
+    }
+    foreach (int steps, grids)
+    {
+        foreach (QSize window, windows)
+            all.append(bench.heatMap(steps, window, frames));
+    }
+
+    foreach (RenderBenchmark::Result result, all)
+    {
+        out << QString("%1 %2 %3 %4 %5 %6 %7")
+               .arg(result.name, -10).arg(result.lines, 9)
+               .arg(QString("%1x%2").arg(result.window.width()).arg(result.window.height()), 11)
+               .arg(result.firstFrameMs >= 0 ? QString::number(result.firstFrameMs, 'f', 1) : QString("-"), 10)
+               .arg(result.meanMs, 10, 'f', 2).arg(result.worstMs, 10, 'f', 2).arg(result.peakKb, 10) << endl;
+        results.append(result.toJson());
+    }
+
+    if (!RenderBenchmark::peakMemoryPerCase())
+        out << "Peak memory is the peak of the whole run so far" << endl;
+
+    if (parser.isSet(outputOption))
+    {
+        QJsonObject root;
+        root["version"] = QString(GRBL_CONTROLLER_NAME_AND_VERSION);
+        root["qt"] = QString(qVersion());
+        root["platform"] = QGuiApplication::platformName();
+        root["date"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+        root["frames"] = frames;
+        root["results"] = results;
+
+        QFile file(parser.value(outputOption));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        {
+            errOut << "Can't write " << file.fileName() << endl;
+            return 1;
+        }
+        file.write(QJsonDocument(root).toJson());
+    }
+
+    return 0;
+}
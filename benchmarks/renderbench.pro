@@ -0,0 +1,37 @@
+#-------------------------------------------------
+#
+# Offscreen benchmark of the visualizer drawing, run renderbench --help
+#
+#-------------------------------------------------
+
+QT       += core gui widgets
+
+TARGET = renderbench
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+include(../core/core.pri)
+
+
+SOURCES += renderbench.cpp \
+    renderbenchmark.cpp \
+    ../LevelingRenderArea.cpp \
+    ../renderitemlist.cpp \
+    ../pathlayers.cpp \
+    ../segmentindex.cpp \
+    ../lineitem.cpp \
+    ../itemtobase.cpp \
+    ../arcitem.cpp \
+    ../pointitem.cpp
+
+
+HEADERS  += renderbenchmark.h \
+    ../LevelingRenderArea.h \
+    ../renderitemlist.h \
+    ../pathlayers.h \
+    ../segmentindex.h \
+    ../lineitem.h \
+    ../itemtobase.h \
+    ../arcitem.h \
+    ../pointitem.h
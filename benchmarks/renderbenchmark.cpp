@@ -0,0 +1,284 @@
+/****************************************************************
+ * renderbenchmark.cpp
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#include "renderbenchmark.h"
+#include "renderitemlist.h"
+#include "pathlayers.h"
+#include "LevelingRenderArea.h"
+#include "heightmap.h"
+#include "SpilineInterpolate3D.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <math.h>
+
+#if defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
+
+QJsonObject RenderBenchmark::Result::toJson() const
+{
+    QJsonObject object;
+    object["name"] = name;
+    object["lines"] = lines;
+    object["window"] = QString("%1x%2").arg(window.width()).arg(window.height());
+    object["frames"] = frames;
+    if (firstFrameMs >= 0)
+    {
+        object["first_frame_ms"] = firstFrameMs;
+        object["parse_ms"] = parseMs;
+        object["convert_ms"] = convertMs;
+    }
+    object["best_ms"] = bestMs;
+    object["mean_ms"] = meanMs;
+    object["worst_ms"] = worstMs;
+    object["peak_kb"] = peakKb;
+    return object;
+}
+
+RenderBenchmark::RenderBenchmark()
+{
+    // Both emitted on this thread for the parser, queued from the render thread
+    connect(&fileParser, SIGNAL(parseEnded(ParsedProgramPtr,int)), this, SLOT(parseEnded(ParsedProgramPtr,int)));
+}
+
+void RenderBenchmark::parseEnded(ParsedProgramPtr parsed, int /* generation */)
+{
+    program = parsed;
+}
+
+void RenderBenchmark::renderedImage(const QImage& rendered)
+{
+    image = rendered;
+    loop.quit();
+}
+
+RenderBenchmark::Result RenderBenchmark::fileView(int lines, const QSize& window, int frames)
+{
+    Result result;
+    result.name = "fileView";
+    result.lines = lines;
+    result.window = window;
+    result.frames = 0;
+    result.firstFrameMs = result.parseMs = result.convertMs = 0;
+    result.bestMs = result.meanMs = result.worstMs = 0;
+
+    QByteArray source = generateProgram(lines);
+
+    resetPeakMemory();
+    program.clear();
+
+    QElapsedTimer total;
+    total.start();
+    QElapsedTimer timer;
+    timer.start();
+
+    fileParser.parseSource("bench.nc", source, fileParser.nextGeneration());
+    result.parseMs = timer.nsecsElapsed() / 1e6;
+    if (program.isNull())
+        return result;
+
+    timer.restart();
+    RenderItemList list;
+    list.setCurrFileLine(0);
+    list.convertList(program->toolpath());
+    list.updateLivePoint();
+    result.convertMs = timer.nsecsElapsed() / 1e6;
+
+    PathLayers layers;
+    layers.build(list, window);
+    result.firstFrameMs = total.nsecsElapsed() / 1e6;
+
+    // Half of the file sent, the covered layer has something to draw
+    ToolpathModelPtr model = program->toolpath();
+    if (!model->isEmpty())
+        list.setCurrFileLine(model->line(model->count() / 2));
+
+    double sumMs = 0;
+    for (int i = 0; i < frames; i++)
+    {
+        timer.restart();
+        layers.build(list, window);
+        double ms = timer.nsecsElapsed() / 1e6;
+
+        if (i == 0 || ms < result.bestMs)
+            result.bestMs = ms;
+        result.worstMs = qMax(result.worstMs, ms);
+        sumMs += ms;
+        result.frames++;
+    }
+    if (result.frames > 0)
+        result.meanMs = sumMs / result.frames;
+
+    result.peakKb = peakMemoryKb();
+    return result;
+}
+
+RenderBenchmark::Result RenderBenchmark::heatMap(int gridSteps, const QSize& window, int frames)
+{
+    Result result;
+    result.name = "heatMap";
+    result.lines = gridSteps;
+    result.window = window;
+    result.frames = 0;
+    result.firstFrameMs = -1;
+    result.parseMs = result.convertMs = 0;
+    result.bestMs = result.meanMs = result.worstMs = 0;
+
+    InterpolatorPtr interpolator = generateMap(gridSteps);
+
+    resetPeakMemory();
+
+    RenderThread thread;
+    connect(&thread, SIGNAL(renderedImage(QImage)), this, SLOT(renderedImage(QImage)));
+
+    double sumMs = 0;
+    for (int i = 0; i < frames; i++)
+    {
+        image = QImage();
+        QElapsedTimer timer;
+        timer.start();
+        thread.render(interpolator, window);
+        loop.exec();
+        double ms = timer.nsecsElapsed() / 1e6;
+
+        if (i == 0 || ms < result.bestMs)
+            result.bestMs = ms;
+        result.worstMs = qMax(result.worstMs, ms);
+        sumMs += ms;
+        result.frames++;
+    }
+    if (result.frames > 0)
+        result.meanMs = sumMs / result.frames;
+
+    result.peakKb = peakMemoryKb();
+    return result;
+}
+
+// Same sequence every run: passes of feed moves and arcs between rapids, with comments
+QByteArray RenderBenchmark::generateProgram(int lines)
+{
+    QByteArray source;
+    source.reserve(lines * 32);
+    source.append("G21\nG90\nG17\nM3 S12000\n");
+
+    quint32 state = 12345;
+    double x = 0, y = 0;
+    for (int n = 0; n < lines; n++)
+    {
+        state = state * 1664525 + 1013904223;
+        int kind = (state >> 8) % 100;
+        state = state * 1664525 + 1013904223;
+        double a = ((state >> 8) % 10000) / 10000.0;
+        state = state * 1664525 + 1013904223;
+        double b = ((state >> 8) % 10000) / 10000.0;
+
+        QString line;
+        if (kind < 3)
+        {
+            x = a * RENDER_BENCH_AREA;
+            y = b * RENDER_BENCH_AREA;
+            line = QString("G0 Z5\nG0 X%1 Y%2\nG1 Z-1 F100\n").arg(x, 0, 'f', 3).arg(y, 0, 'f', 3);
+        }
+        else if (kind < 6)
+        {
+            line = QString("(pass %1)\n").arg(n);
+        }
+        else if (kind < 30)
+        {
+            // Quarter turn around a center at radius r, skipped if it leaves the area
+            double r = 1 + a * 10;
+            bool cw = b < 0.5;
+            double cx = x - r;
+            double ex = cx;
+            double ey = y + (cw ? r : -r);
+            if (ex >= 0 && ey >= 0 && ey <= RENDER_BENCH_AREA)
+            {
+                line = QString("G%1 X%2 Y%3 I%4 J0\n").arg(cw ? 2 : 3)
+                        .arg(ex, 0, 'f', 3).arg(ey, 0, 'f', 3).arg(-r, 0, 'f', 3);
+                x = ex;
+                y = ey;
+            }
+        }
+        if (line.isEmpty())
+        {
+            x = qBound(0.0, x + (a - 0.5) * 4, RENDER_BENCH_AREA);
+            y = qBound(0.0, y + (b - 0.5) * 4, RENDER_BENCH_AREA);
+            line = QString("G1 X%1 Y%2 F800\n").arg(x, 0, 'f', 3).arg(y, 0, 'f', 3);
+        }
+        source.append(line.toLatin1());
+    }
+    source.append("M5\n");
+    return source;
+}
+
+// A warped board, about 1 mm between the corners
+InterpolatorPtr RenderBenchmark::generateMap(int steps)
+{
+    QVector<double> xValues, yValues, zValues;
+    for (int i = 0; i < steps; i++)
+    {
+        xValues.append(i * RENDER_BENCH_AREA / (steps - 1));
+        yValues.append(i * RENDER_BENCH_AREA / (steps - 1));
+    }
+    for (int j = 0; j < steps; j++)
+    {
+        for (int i = 0; i < steps; i++)
+            zValues.append(sin(xValues.at(i) / 50) * cos(yValues.at(j) / 70) * 0.5);
+    }
+
+    HeightMapPtr map(new HeightMap(xValues.constData(), steps, yValues.constData(), steps, zValues.constData(), 0));
+    return InterpolatorPtr(new SpilineInterpolate3D(map));
+}
+
+bool RenderBenchmark::peakMemoryPerCase()
+{
+#if defined(Q_OS_LINUX)
+    return QFile::exists("/proc/self/clear_refs");
+#else
+    return false;
+#endif
+}
+
+// Linux can lower the high water mark to the current size, each case then has its own peak
+void RenderBenchmark::resetPeakMemory()
+{
+#if defined(Q_OS_LINUX)
+    QFile file("/proc/self/clear_refs");
+    if (file.open(QIODevice::WriteOnly))
+        file.write("5");
+#endif
+}
+
+qint64 RenderBenchmark::peakMemoryKb()
+{
+#if defined(Q_OS_LINUX)
+    QFile file("/proc/self/status");
+    if (file.open(QIODevice::ReadOnly))
+    {
+        foreach (QByteArray line, file.readAll().split('\n'))
+        {
+            if (line.startsWith("VmHWM:"))
+                return line.mid(6).trimmed().split(' ').first().toLongLong();
+        }
+    }
+#endif
+#if defined(Q_OS_UNIX)
+    // Peak of the whole process, in bytes on OS X
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+    {
+#if defined(Q_OS_MAC)
+        return usage.ru_maxrss / 1024;
+#else
+        return usage.ru_maxrss;
+#endif
+    }
+#endif
+    return 0;
+}
@@ -0,0 +1,79 @@
+/****************************************************************
+ * renderbenchmark.h
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#ifndef RENDERBENCHMARK_H
+#define RENDERBENCHMARK_H
+
+#include <QObject>
+#include <QSize>
+#include <QImage>
+#include <QEventLoop>
+#include <QJsonObject>
+#include "fileparser.h"
+#include "parsedprogram.h"
+#include "interpolator.h"
+
+#define RENDER_BENCH_AREA       200.0   // mm, area covered by the moves and the height map
+
+/**
+ * @brief Times the visualizer drawing into offscreen images.
+ *
+ * The file view is drawn by the PathLayers of RenderArea: the proposed
+ * path, axes and measurements, then the covered path up to the middle of
+ * the file. The first frame is timed from the start of the parse of a
+ * generated file, the later ones are redraws as after a resize or zoom.
+ *
+ * The height map is rendered by the RenderThread of LevelingRenderArea,
+ * from the render request to the image received on this thread.
+ */
+class RenderBenchmark : public QObject
+{
+    Q_OBJECT
+public:
+    struct Result
+    {
+        QString name;
+        int lines;          // file moves, or height map points per side
+        QSize window;
+        int frames;
+        double firstFrameMs;
+        double parseMs;
+        double convertMs;
+        double bestMs;
+        double meanMs;
+        double worstMs;
+        qint64 peakKb;      // resident memory high water mark during the case, 0 if unknown
+
+        QJsonObject toJson() const;
+    };
+
+    RenderBenchmark();
+
+    Result fileView(int lines, const QSize& window, int frames);
+    Result heatMap(int gridSteps, const QSize& window, int frames);
+
+    static bool peakMemoryPerCase();
+
+private slots:
+    void parseEnded(ParsedProgramPtr program, int generation);
+    void renderedImage(const QImage& image);
+
+private:
+    static QByteArray generateProgram(int lines);
+    static InterpolatorPtr generateMap(int steps);
+    static void resetPeakMemory();
+    static qint64 peakMemoryKb();
+
+private:
+    FileParser fileParser;
+    ParsedProgramPtr program;
+    QImage image;
+    QEventLoop loop;
+};
+
+#endif // RENDERBENCHMARK_H
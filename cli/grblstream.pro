@@ -0,0 +1,22 @@
+#-------------------------------------------------
+#
+# Command line streamer, the controller classes of GrblController
+# without the GUI
+#
+#-------------------------------------------------
+
+QT       -= gui
+
+TARGET = grblstream
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+include(../core/core.pri)
+
+
+SOURCES += main.cpp \
+    streamer.cpp
+
+
+HEADERS  += streamer.h
@@ -0,0 +1,253 @@
+/****************************************************************
+ * main.cpp
+ * GrblHoming - zapmaker fork on github
+ *
+ * Command line streamer, sends one file to one port without a GUI
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QSettings>
+#include <QTemporaryFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QTimer>
+#include <QTextStream>
+#include <signal.h>
+#include <stdio.h>
+
+#include "streamer.h"
+#include "settingskeys.h"
+#include "heightmapstore.h"
+#include "version.h"
+#include "definitions.h"
+#include "trace.h"
+#include "wirereplay.h"
+
+static Streamer *streamer = NULL;
+
+static void interrupted(int)
+{
+    if (streamer != NULL)
+        streamer->requestAbort();
+}
+
+static bool toDouble(const QString& text, double& value)
+{
+    bool ok;
+    value = text.toDouble(&ok);
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setOrganizationName(COMPANY_NAME);
+    QCoreApplication::setOrganizationDomain(DOMAIN_NAME);
+    QCoreApplication::setApplicationName(APPLICATION_NAME);
+    QCoreApplication::setApplicationVersion(GRBL_CONTROLLER_NAME_AND_VERSION);
+
+    qRegisterMetaType<Coord3D>("Coord3D");
+    qRegisterMetaType<ControlParams>("ControlParams");
+    qRegisterMetaType<InterpolatorPtr>("InterpolatorPtr");
+    qRegisterMetaType<ToolpathModelPtr>("ToolpathModelPtr");
+    qRegisterMetaType<ParsedProgramPtr>("ParsedProgramPtr");
+    qRegisterMetaType<MachineLimits>("MachineLimits");
+    qRegisterMetaType<StreamStats>("StreamStats");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Streams a G-code file to Grbl or Marlin, with the options of Grbl Controller.\n"
+                                     "Progress goes to stdout, one record per line.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument("file", "G-code file to send.");
+
+    QCommandLineOption portOption(QStringList() << "p" << "port", "Serial port, the last one used by the GUI if not given.", "port");
+    QCommandLineOption baudOption(QStringList() << "b" << "baud", "Baud rate.", "baud");
+    QCommandLineOption controllerOption(QStringList() << "c" << "controller", "grbl or marlin.", "name");
+    QCommandLineOption levelingOption(QStringList() << "l" << "leveling", "Height map file, or the name of a saved fixture.", "map");
+    QCommandLineOption offsetOption("leveling-offset", "Z offset added to the height map, mm.", "mm", "0");
+    QCommandLineOption settingsOption("settings", "Read the options from this INI file instead of the GUI ones.", "file");
+    QCommandLineOption setOption(QStringList() << "s" << "set", "Override one option, as named in the settings. Repeatable.", "key=value");
+    QCommandLineOption rapidsOption("optimize-rapids", "Reorder the cuts to shorten the rapid moves.");
+    QCommandLineOption arcsOption("fit-arcs", "Replace runs of short moves with arcs.");
+    QCommandLineOption simplifyOption("simplify", "Drop the moves within the simplify tolerances.");
+    QCommandLineOption quietOption(QStringList() << "q" << "quiet", "Don't print the controller messages.");
+    QCommandLineOption metricsOption("metrics-port", "Serve Prometheus metrics on this local port, 0 for none.", "port");
+    parser.addOption(portOption);
+    parser.addOption(baudOption);
+    parser.addOption(controllerOption);
+    parser.addOption(levelingOption);
+    parser.addOption(offsetOption);
+    parser.addOption(settingsOption);
+    parser.addOption(setOption);
+    parser.addOption(rapidsOption);
+    parser.addOption(arcsOption);
+    parser.addOption(simplifyOption);
+    parser.addOption(quietOption);
+    QCommandLineOption replayOption("replay", "Answer from a serial trace instead of a port.", "trace");
+    QCommandLineOption replayScaleOption("replay-scale", "Time scale of the replay, 0 to answer at once.", "factor", "1");
+    parser.addOption(metricsOption);
+    parser.addOption(replayOption);
+    parser.addOption(replayScaleOption);
+#ifdef GRBL_TRACE
+    QCommandLineOption traceOption("trace", "Write a Chrome trace of the run to this file.", "file");
+    parser.addOption(traceOption);
+#endif
+    parser.process(a);
+
+    QTextStream errOut(stderr);
+    QStringList args = parser.positionalArguments();
+    if (args.size() != 1)
+    {
+        errOut << parser.helpText();
+        return EXIT_USAGE;
+    }
+
+    // The options are those of the GUI, or of the INI file, copied so the overrides stay here
+    QSettings *source = NULL;
+    if (parser.isSet(settingsOption))
+    {
+        if (!QFileInfo(parser.value(settingsOption)).isReadable())
+        {
+            errOut << "Can't read settings file " << parser.value(settingsOption) << endl;
+            return EXIT_USAGE;
+        }
+        source = new QSettings(parser.value(settingsOption), QSettings::IniFormat);
+    }
+    else
+    {
+        source = new QSettings();
+    }
+
+    QTemporaryFile settingsFile;
+    if (!settingsFile.open())
+    {
+        errOut << "Can't create temporary settings file" << endl;
+        return EXIT_USAGE;
+    }
+    settingsFile.close();
+
+    QSettings settings(settingsFile.fileName(), QSettings::IniFormat);
+    foreach (QString key, source->allKeys())
+    {
+        settings.setValue(key, source->value(key));
+    }
+    delete source;
+
+    foreach (QString item, parser.values(setOption))
+    {
+        int equal = item.indexOf('=');
+        if (equal <= 0)
+        {
+            errOut << "Expecting key=value, got " << item << endl;
+            return EXIT_USAGE;
+        }
+        settings.setValue(item.left(equal).trimmed(), item.mid(equal + 1).trimmed());
+    }
+
+    QString sdbgLog = settings.value(SETTINGS_ENABLE_DEBUG_LOG, "true").value<QString>();
+    g_enableDebugLog.set(sdbgLog == "true");
+    setupToolLogging(g_enableDebugLog.get() ? QDir::homePath() + "/grblstream.log" : QString());
+
+    Streamer::Options options;
+    options.file = args.at(0);
+    options.params.readSettings(settings);
+    options.port = parser.isSet(portOption) ? parser.value(portOption) : settings.value(SETTINGS_PORT).value<QString>();
+    options.baud = parser.isSet(baudOption) ? parser.value(baudOption)
+                                            : settings.value(SETTINGS_BAUD, QString::number(BAUD9600)).value<QString>();
+    options.controller = settings.value(SETTINGS_CONTROLLER, SETTINGS_CONTROLLER_GRBL).value<int>();
+    if (parser.isSet(controllerOption))
+    {
+        QString name = parser.value(controllerOption).toLower();
+        if (name == "grbl")
+            options.controller = SETTINGS_CONTROLLER_GRBL;
+        else if (name == "marlin")
+            options.controller = SETTINGS_CONTROLLER_MARLIN;
+        else
+        {
+            errOut << "Unknown controller " << name << endl;
+            return EXIT_USAGE;
+        }
+    }
+
+    options.levelingPath = parser.value(levelingOption);
+    if (!options.levelingPath.isEmpty() && !QFileInfo(options.levelingPath).exists()
+            && HeightMapStore::fixtures().contains(options.levelingPath))
+    {
+        options.levelingPath = HeightMapStore::fixturePath(options.levelingPath);
+    }
+    if (!toDouble(parser.value(offsetOption), options.levelingOffset))
+    {
+        errOut << "Bad leveling offset " << parser.value(offsetOption) << endl;
+        return EXIT_USAGE;
+    }
+
+    options.optimizeRapids = parser.isSet(rapidsOption);
+    options.fitArcs = parser.isSet(arcsOption);
+    options.simplify = parser.isSet(simplifyOption);
+    options.quiet = parser.isSet(quietOption);
+    bool metricsPortOk = true;
+    options.metricsPort = parser.isSet(metricsOption) ? parser.value(metricsOption).toInt(&metricsPortOk)
+                                                      : settings.value(SETTINGS_METRICS_PORT, 0).value<int>();
+    if (!metricsPortOk || options.metricsPort < 0 || options.metricsPort > 65535)
+    {
+        errOut << "Bad metrics port " << parser.value(metricsOption) << endl;
+        return EXIT_USAGE;
+    }
+
+    if (parser.isSet(replayOption))
+    {
+        double scale;
+        if (!toDouble(parser.value(replayScaleOption), scale) || scale < 0)
+        {
+            errOut << "Bad replay scale " << parser.value(replayScaleOption) << endl;
+            return EXIT_USAGE;
+        }
+        if (!QFileInfo(parser.value(replayOption)).isReadable())
+        {
+            errOut << "Can't read serial trace " << parser.value(replayOption) << endl;
+            return EXIT_USAGE;
+        }
+        options.port = WireReplayDevice::portName(parser.value(replayOption), scale);
+    }
+
+    if (options.port.isEmpty())
+    {
+        errOut << "No port given and none saved by the GUI" << endl;
+        return EXIT_USAGE;
+    }
+
+    info("%s stream started", GRBL_CONTROLLER_NAME_AND_VERSION);
+
+    streamer = new Streamer(options);
+    signal(SIGINT, interrupted);
+    signal(SIGTERM, interrupted);
+
+#ifdef GRBL_TRACE
+    QString traceFile = parser.value(traceOption);
+    if (!traceFile.isEmpty())
+        Trace::start();
+#endif
+
+    QTimer::singleShot(0, streamer, SLOT(start()));
+    int result = a.exec();
+
+#ifdef GRBL_TRACE
+    if (!traceFile.isEmpty())
+    {
+        Trace::stop();
+        Trace::save(traceFile);
+    }
+#endif
+
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    delete streamer;
+    streamer = NULL;
+
+    return result;
+}
@@ -0,0 +1,348 @@
+/****************************************************************
+ * streamer.cpp
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#include "streamer.h"
+#include "settingskeys.h"
+#include "gcodegrbl.h"
+#include "gcodemarlin.h"
+#include "rapidoptimizer.h"
+#include "arcfitter.h"
+#include "pathsimplifier.h"
+#include "machinelimits.h"
+
+#include <QCoreApplication>
+#include <stdio.h>
+
+Streamer::Streamer(const Options& options)
+    : options(options), state(PARSING), exitCode(EXIT_OK), portLost(false), levelingLoaded(false),
+      gcode(NULL), metricsBoard(options.port), parseGeneration(0), nextTransform(0), currLine(0), lastPercent(-1), queued(0),
+      sendStartMs(-1), out(stdout), errOut(stderr)
+{
+    if (options.controller == SETTINGS_CONTROLLER_MARLIN)
+        gcode = new GCodeMarlin();
+    else
+        gcode = new GCodeGrbl();
+    gcode->setMetricsBoard(&metricsBoard);
+    gcodeThread.setObjectName("gcode");
+    fileParserThread.setObjectName("fileParser");
+    gcode->moveToThread(&gcodeThread);
+    metricsServer.addBoard(&metricsBoard);
+    fileParser.moveToThread(&fileParserThread);
+
+    connect(this, SIGNAL(parseFile(QString,int)), &fileParser, SLOT(parseFile(QString,int)));
+    connect(this, SIGNAL(parseSource(QString,QByteArray,int)), &fileParser, SLOT(parseSource(QString,QByteArray,int)));
+    connect(&fileParser, SIGNAL(parseEnded(ParsedProgramPtr,int)), this, SLOT(parseEnded(ParsedProgramPtr,int)));
+
+    connect(this, SIGNAL(setResponseWait(ControlParams)), gcode, SLOT(setResponseWait(ControlParams)));
+    connect(this, SIGNAL(loadLevelingData(QString)), gcode, SLOT(loadLevelingData(QString)));
+    connect(this, SIGNAL(openPort(QString,QString)), gcode, SLOT(openPort(QString,QString)));
+    connect(this, SIGNAL(closePort(bool)), gcode, SLOT(closePort(bool)));
+    connect(this, SIGNAL(sendGcode(QString)), gcode, SLOT(sendGcode(QString)));
+    connect(this, SIGNAL(sendFile(ParsedProgramPtr)), gcode, SLOT(sendFile(ParsedProgramPtr)));
+
+    connect(gcode, SIGNAL(interpolatorChanged(InterpolatorPtr)), this, SLOT(interpolatorChanged(InterpolatorPtr)));
+    connect(gcode, SIGNAL(portIsOpen(bool)), this, SLOT(portIsOpen(bool)));
+    connect(gcode, SIGNAL(portIsClosed(bool)), this, SLOT(portIsClosed(bool)));
+    connect(gcode, SIGNAL(setProgress(int)), this, SLOT(setProgress(int)));
+    connect(gcode, SIGNAL(setVisCurrLine(int)), this, SLOT(setCurrLine(int)));
+    connect(gcode, SIGNAL(setQueuedCommands(int,bool)), this, SLOT(setQueuedCommands(int,bool)));
+    connect(gcode, SIGNAL(sendFileEnded(bool,int)), this, SLOT(sendFileEnded(bool,int)));
+    connect(gcode, SIGNAL(streamStatsReady(StreamStats)), this, SLOT(streamStatsReady(StreamStats)));
+    connect(gcode, SIGNAL(addList(QString)), this, SLOT(receiveList(QString)));
+    connect(gcode, SIGNAL(addListOut(QString)), this, SLOT(receiveList(QString)));
+    connect(gcode, SIGNAL(addListFull(QStringList)), this, SLOT(receiveListFull(QStringList)));
+
+    gcodeThread.start();
+    fileParserThread.start(QThread::LowPriority);
+}
+
+Streamer::~Streamer()
+{
+    gcode->setShutdown();
+    gcodeThread.quit();
+    gcodeThread.wait();
+    delete gcode;
+
+    fileParser.cancel();
+    fileParserThread.quit();
+    fileParserThread.wait();
+}
+
+void Streamer::requestAbort()
+{
+    abortRequested.set(true);
+    gcode->setAbort();
+}
+
+void Streamer::start()
+{
+    jobTimer.start();
+    stageTimer.start();
+
+    // A dashboard is nice to have, the file is sent without it
+    if (options.metricsPort > 0)
+    {
+        if (metricsServer.listen(options.metricsPort))
+            record(QString("metrics port=%1").arg(options.metricsPort));
+        else
+            record(QString("warning stage=metrics port=%1").arg(options.metricsPort));
+    }
+
+    state = PARSING;
+    parseGeneration = fileParser.nextGeneration();
+    emit parseFile(options.file, parseGeneration);
+}
+
+void Streamer::parseEnded(ParsedProgramPtr parsed, int generation)
+{
+    if (generation != parseGeneration || state != PARSING)
+        return;
+
+    if (parsed.isNull())
+    {
+        record(QString("error stage=file file=\"%1\"").arg(options.file));
+        finish(EXIT_FILE);
+        return;
+    }
+
+    if (abortRequested.get())
+    {
+        finish(EXIT_ABORTED);
+        return;
+    }
+
+    // The transforms run one after the other, each on the program the previous one left
+    if (transform(parsed))
+        return;
+
+    program = parsed;
+    record(QString("parsed lines=%1 bytes=%2 moves=%3 ms=%4")
+           .arg(program->lineCount()).arg(program->sourceSize())
+           .arg(program->toolpath().isNull() ? 0 : program->toolpath()->count())
+           .arg(stageTimer.elapsed()));
+
+    state = OPENING;
+    stageTimer.restart();
+
+    ControlParams params = options.params;
+    if (!options.levelingPath.isEmpty())
+    {
+        params.useZLevelingData = true;
+        params.zLevelingOffset = options.levelingOffset;
+    }
+    emit setResponseWait(params);
+
+    // Queued before the port is opened, so portIsOpen finds the map already loaded
+    if (!options.levelingPath.isEmpty())
+        emit loadLevelingData(options.levelingPath);
+
+    emit openPort(options.port, options.baud);
+}
+
+bool Streamer::transform(ParsedProgramPtr parsed)
+{
+    while (nextTransform < TRANSFORM_COUNT)
+    {
+        int transformIndex = nextTransform++;
+        QByteArray source;
+        switch (transformIndex)
+        {
+        case TRANSFORM_RAPIDS:
+            if (options.optimizeRapids)
+            {
+                int groups = 0;
+                double before = 0, after = 0, secsSaved = 0;
+                source = RapidOptimizer::optimize(*parsed, MachineLimits(), groups, before, after, secsSaved);
+                record(QString("transform name=rapids groups=%1 travel_before=%2 travel_after=%3 secs_saved=%4")
+                       .arg(groups).arg(before, 0, 'f', 1).arg(after, 0, 'f', 1).arg(secsSaved, 0, 'f', 1));
+            }
+            break;
+        case TRANSFORM_ARCS:
+            if (options.fitArcs)
+            {
+                int moves = 0, arcs = 0;
+                source = ArcFitter::fit(*parsed, options.params.arcFitTolerance, moves, arcs);
+                record(QString("transform name=arcs moves=%1 arcs=%2").arg(moves).arg(arcs));
+            }
+            break;
+        case TRANSFORM_SIMPLIFY:
+            if (options.simplify)
+            {
+                int moves = 0, dropped = 0;
+                source = PathSimplifier::simplify(*parsed, options.params.simplifyXYTolerance,
+                                                  options.params.simplifyZTolerance, moves, dropped);
+                record(QString("transform name=simplify moves=%1 dropped=%2").arg(moves).arg(dropped));
+            }
+            break;
+        }
+
+        if (!source.isEmpty())
+        {
+            parseGeneration = fileParser.nextGeneration();
+            emit parseSource(parsed->path(), source, parseGeneration);
+            return true;
+        }
+    }
+    return false;
+}
+
+void Streamer::interpolatorChanged(InterpolatorPtr interpolator)
+{
+    levelingLoaded = !interpolator.isNull();
+}
+
+void Streamer::portIsOpen(bool sendCode)
+{
+    if (state != OPENING)
+        return;
+
+    record(QString("open port=%1 baud=%2 ms=%3").arg(options.port).arg(options.baud).arg(stageTimer.elapsed()));
+
+    if (!options.levelingPath.isEmpty() && !levelingLoaded)
+    {
+        record(QString("error stage=leveling file=\"%1\"").arg(options.levelingPath));
+        finish(EXIT_LEVELING);
+        return;
+    }
+
+    if (abortRequested.get())
+    {
+        finish(EXIT_ABORTED);
+        return;
+    }
+
+    state = SENDING;
+    stageTimer.restart();
+
+    // As the GUI does: wait for the startup banner, then the file
+    if (sendCode)
+        emit sendGcode("");
+    emit sendFile(program);
+}
+
+void Streamer::portIsClosed(bool)
+{
+    switch (state)
+    {
+    case OPENING:
+        record(QString("error stage=port port=%1").arg(options.port));
+        exitCode = EXIT_PORT;
+        QCoreApplication::exit(exitCode);
+        break;
+    case SENDING:
+        portLost = true;
+        break;
+    case CLOSING:
+        QCoreApplication::exit(exitCode);
+        break;
+    default:
+        break;
+    }
+}
+
+void Streamer::setProgress(int percent)
+{
+    if (state != SENDING || percent == lastPercent)
+        return;
+
+    lastPercent = percent;
+    record(QString("progress percent=%1 line=%2 lines=%3 queued=%4 ms=%5")
+           .arg(percent).arg(currLine).arg(program->lineCount()).arg(queued)
+           .arg(sendStartMs < 0 ? 0 : jobTimer.elapsed() - sendStartMs));
+}
+
+void Streamer::setCurrLine(int line)
+{
+    if (sendStartMs < 0)
+    {
+        sendStartMs = jobTimer.elapsed();
+        record(QString("start banner_ms=%1").arg(stageTimer.elapsed()));
+    }
+    currLine = line;
+
+    // The controller clears its abort flag when the file starts, ask again
+    if (abortRequested.get())
+        gcode->setAbort();
+}
+
+void Streamer::setQueuedCommands(int count, bool)
+{
+    queued = count;
+}
+
+// Comes just before sendFileEnded, the histograms are printed before the done record
+void Streamer::streamStatsReady(StreamStats stats)
+{
+    foreach (QString line, stats.summary())
+        record("stats " + line);
+}
+
+void Streamer::sendFileEnded(bool completed, int errors)
+{
+    if (state != SENDING)
+        return;
+
+    qint64 sendMs = sendStartMs < 0 ? 0 : jobTimer.elapsed() - sendStartMs;
+    double secs = sendMs > 0 ? sendMs / 1000.0 : 0;
+
+    int code = EXIT_OK;
+    QString result = "ok";
+    if (portLost)
+    {
+        code = EXIT_PORT;
+        result = "port";
+    }
+    else if (!completed)
+    {
+        code = EXIT_ABORTED;
+        result = "aborted";
+    }
+    else if (errors > 0)
+    {
+        code = EXIT_ERRORS;
+        result = "errors";
+    }
+
+    record(QString("done result=%1 lines=%2 errors=%3 send_ms=%4 total_ms=%5 lines_per_sec=%6 bytes_per_sec=%7")
+           .arg(result).arg(currLine).arg(errors).arg(sendMs).arg(jobTimer.elapsed())
+           .arg(secs > 0 ? currLine / secs : 0, 0, 'f', 1)
+           .arg(secs > 0 ? program->sourceSize() / secs : 0, 0, 'f', 1));
+
+    finish(code);
+}
+
+void Streamer::receiveList(QString msg)
+{
+    if (options.quiet)
+        return;
+
+    msg = msg.trimmed();
+    if (!msg.isEmpty())
+        errOut << msg << endl;
+}
+
+void Streamer::receiveListFull(QStringList list)
+{
+    foreach (QString msg, list)
+    {
+        receiveList(msg);
+    }
+}
+
+void Streamer::record(const QString& line)
+{
+    out << line << endl;
+}
+
+// Closes the port, the application leaves when the controller says it is closed
+void Streamer::finish(int code)
+{
+    exitCode = code;
+    state = CLOSING;
+    emit closePort(false);
+}
@@ -0,0 +1,139 @@
+/****************************************************************
+ * streamer.h
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#ifndef STREAMER_H
+#define STREAMER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include "atomicintbool.h"
+#include "controlparams.h"
+#include "gcodecontroller.h"
+#include "fileparser.h"
+#include "parsedprogram.h"
+#include "metricsboard.h"
+#include "metricsserver.h"
+
+// Exit codes of grblstream
+enum StreamExitCode
+{
+    EXIT_OK = 0,
+    EXIT_USAGE,         // bad command line
+    EXIT_FILE,          // the file can't be read
+    EXIT_PORT,          // the port can't be opened, or was lost while sending
+    EXIT_LEVELING,      // the height map can't be loaded
+    EXIT_ERRORS,        // sent to the end, the controller refused some lines
+    EXIT_ABORTED,       // interrupted, or the controller stopped answering
+};
+
+/**
+ * @brief Streams one file to one port without a GUI.
+ *
+ * Drives the same controller classes as MainWindow, through the same
+ * signals: the file is parsed with FileParser, optionally rewritten with
+ * the Tools menu transforms, and sent with the options of the GUI. The
+ * controller runs in its own thread, as it does in the GUI.
+ *
+ * Progress and timing go to stdout as one record per line, a keyword
+ * followed by key=value fields, the controller messages go to stderr.
+ */
+class Streamer : public QObject
+{
+    Q_OBJECT
+public:
+    struct Options
+    {
+        QString file;
+        QString port;
+        QString baud;
+        int controller;         // SETTINGS_CONTROLLER_GRBL or SETTINGS_CONTROLLER_MARLIN
+        ControlParams params;
+        QString levelingPath;   // empty for no leveling
+        double levelingOffset;
+        bool optimizeRapids;
+        bool fitArcs;
+        bool simplify;
+        bool quiet;
+        int metricsPort;        // 0 for no metrics server
+    };
+
+    Streamer(const Options& options);
+    ~Streamer();
+
+    // From the signal handler, only sets atomics
+    void requestAbort();
+
+signals:
+    void parseFile(QString path, int generation);
+    void parseSource(QString path, QByteArray source, int generation);
+    void setResponseWait(ControlParams controlParams);
+    void loadLevelingData(QString path);
+    void openPort(QString commPortStr, QString baudRate);
+    void closePort(bool reopen);
+    void sendGcode(QString line);
+    void sendFile(ParsedProgramPtr program);
+
+public slots:
+    void start();
+
+private slots:
+    void parseEnded(ParsedProgramPtr program, int generation);
+    void interpolatorChanged(InterpolatorPtr interpolator);
+    void portIsOpen(bool sendCode);
+    void portIsClosed(bool reopen);
+    void setProgress(int percent);
+    void setCurrLine(int line);
+    void setQueuedCommands(int count, bool);
+    void sendFileEnded(bool completed, int errors);
+    void streamStatsReady(StreamStats stats);
+    void receiveList(QString msg);
+    void receiveListFull(QStringList list);
+
+private:
+    enum State { PARSING, OPENING, SENDING, CLOSING };
+    enum Transform { TRANSFORM_RAPIDS, TRANSFORM_ARCS, TRANSFORM_SIMPLIFY, TRANSFORM_COUNT };
+
+    bool transform(ParsedProgramPtr parsed);
+    void record(const QString& line);
+    void finish(int code);
+
+private:
+    Options options;
+    State state;
+    int exitCode;
+    bool portLost;
+    bool levelingLoaded;
+    AtomicIntBool abortRequested;
+
+    GCodeController *gcode;
+    QThread gcodeThread;
+    MetricsBoard metricsBoard;
+    MetricsServer metricsServer;
+    FileParser fileParser;
+    QThread fileParserThread;
+    int parseGeneration;
+    int nextTransform;
+
+    ParsedProgramPtr program;
+    int currLine;
+    int lastPercent;
+    int queued;
+
+    QElapsedTimer jobTimer;
+    QElapsedTimer stageTimer;
+    qint64 sendStartMs;
+
+    QTextStream out;
+    QTextStream errOut;
+};
+
+#endif // STREAMER_H
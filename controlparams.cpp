@@ -1,4 +1,14 @@
 #include "controlparams.h"
+#include "settingskeys.h"
+#include "wiretrace.h"
+
+#include <QSettings>
+#include <QDir>
+
+static QString defaultWireTraceDir()
+{
+    return QDir::homePath() + "/GrblController-traces";
+}
 
 ControlParams::ControlParams()
     :    waitTime(LONG_WAIT_SEC), zJogRate(DEFAULT_Z_JOG_RATE),
@@ -6,9 +16,70 @@ ControlParams::ControlParams()
             xyRateAmount(DEFAULT_XY_RATE),
             useAggressivePreload(false), filterFileCommands(false),
             reducePrecision(false), grblLineBufferLen(DEFAULT_GRBL_LINE_BUFFER_LEN),
+            compactLines(false),
             useFourAxis(false), charSendDelayMs(DEFAULT_CHAR_SEND_DELAY_MS),
             fourthAxisType(FOURTH_AXIS_A), usePositionRequest(true),
             positionRequestType(PREQ_ALWAYS_NO_IDLE_CHK), postionRequestTimeMilliSec(DEFAULT_POS_REQ_FREQ_MSEC),
-            waitForJogToComplete(true), useZLevelingData(false), zLevelingOffset(0)
+            waitForJogToComplete(true), useZLevelingData(false), zLevelingOffset(0),
+            probeSeekFeed(DEFAULT_PROBE_SEEK_FEED), probeTouchFeed(DEFAULT_PROBE_TOUCH_FEED),
+            probeBackoff(DEFAULT_PROBE_BACKOFF), probeClearance(DEFAULT_PROBE_CLEARANCE),
+            probeMaxTravel(DEFAULT_PROBE_MAX_TRAVEL), probeShortLift(false), arcFitTolerance(DEFAULT_ARC_FIT_TOLERANCE),
+            simplifyXYTolerance(DEFAULT_SIMPLIFY_XY_TOLERANCE), simplifyZTolerance(DEFAULT_SIMPLIFY_Z_TOLERANCE),
+            wireTraceMode(WIRE_TRACE_OFF), wireTraceDir(defaultWireTraceDir())
+{
+}
+
+void ControlParams::readSettings(QSettings& settings)
 {
+    waitTime = settings.value(SETTINGS_RESPONSE_WAIT_TIME, DEFAULT_WAIT_TIME_SEC).value<int>();
+    zJogRate = settings.value(SETTINGS_Z_JOG_RATE, DEFAULT_Z_JOG_RATE).value<double>();
+    QString useMmManualCmds = settings.value(SETTINGS_USE_MM_FOR_MANUAL_CMDS, "true").value<QString>();
+    useMm = useMmManualCmds == "true";
+    QString useAggrPreload = settings.value(SETTINGS_USE_AGGRESSIVE_PRELOAD, "true").value<QString>();
+    useAggressivePreload = useAggrPreload == "true";
+    QString waitForJog = settings.value(SETTINGS_WAIT_FOR_JOG_TO_COMPLETE, "true").value<QString>();
+    waitForJogToComplete = waitForJog == "true";
+
+    QString fourAxis = settings.value(SETTINGS_FOUR_AXIS_USE, "false").value<QString>();
+    useFourAxis = fourAxis == "true";
+    if (useFourAxis)
+    {
+        char type = settings.value(SETTINGS_FOUR_AXIS_TYPE, FOURTH_AXIS_A).value<char>();
+        fourthAxisType = type;
+    }
+
+    QString zRateLimitStr = settings.value(SETTINGS_Z_RATE_LIMIT, "false").value<QString>();
+    zRateLimit = zRateLimitStr == "true";
+
+    QString ffCommands = settings.value(SETTINGS_FILTER_FILE_COMMANDS, "false").value<QString>();
+    filterFileCommands = ffCommands == "true";
+    QString rPrecision = settings.value(SETTINGS_REDUCE_PREC_FOR_LONG_LINES, "false").value<QString>();
+    reducePrecision = rPrecision == "true";
+    QString compact = settings.value(SETTINGS_COMPACT_LINES, "false").value<QString>();
+    compactLines = compact == "true";
+    grblLineBufferLen = settings.value(SETTINGS_GRBL_LINE_BUFFER_LEN, DEFAULT_GRBL_LINE_BUFFER_LEN).value<int>();
+    charSendDelayMs = settings.value(SETTINGS_CHAR_SEND_DELAY_MS, DEFAULT_CHAR_SEND_DELAY_MS).value<int>();
+
+    zRateLimitAmount = settings.value(SETTINGS_Z_RATE_LIMIT_AMOUNT, DEFAULT_Z_LIMIT_RATE).value<double>();
+    xyRateAmount = settings.value(SETTINGS_XY_RATE_AMOUNT, DEFAULT_XY_RATE).value<double>();
+
+    probeSeekFeed = settings.value(SETTINGS_PROBE_SEEK_FEED, DEFAULT_PROBE_SEEK_FEED).value<double>();
+    probeTouchFeed = settings.value(SETTINGS_PROBE_TOUCH_FEED, DEFAULT_PROBE_TOUCH_FEED).value<double>();
+    probeBackoff = settings.value(SETTINGS_PROBE_BACKOFF, DEFAULT_PROBE_BACKOFF).value<double>();
+    probeClearance = settings.value(SETTINGS_PROBE_CLEARANCE, DEFAULT_PROBE_CLEARANCE).value<double>();
+    probeMaxTravel = settings.value(SETTINGS_PROBE_MAX_TRAVEL, DEFAULT_PROBE_MAX_TRAVEL).value<double>();
+    QString shortLift = settings.value(SETTINGS_PROBE_SHORT_LIFT, "false").value<QString>();
+    probeShortLift = shortLift == "true";
+    arcFitTolerance = settings.value(SETTINGS_ARC_FIT_TOLERANCE, DEFAULT_ARC_FIT_TOLERANCE).value<double>();
+    simplifyXYTolerance = settings.value(SETTINGS_SIMPLIFY_XY_TOLERANCE, DEFAULT_SIMPLIFY_XY_TOLERANCE).value<double>();
+    simplifyZTolerance = settings.value(SETTINGS_SIMPLIFY_Z_TOLERANCE, DEFAULT_SIMPLIFY_Z_TOLERANCE).value<double>();
+
+    wireTraceMode = settings.value(SETTINGS_WIRE_TRACE, WIRE_TRACE_OFF).value<int>();
+    wireTraceDir = settings.value(SETTINGS_WIRE_TRACE_DIR, defaultWireTraceDir()).value<QString>();
+
+    QString enPosReq = settings.value(SETTINGS_ENABLE_POS_REQ, "true").value<QString>();
+    usePositionRequest = enPosReq == "true";
+    positionRequestType = settings.value(SETTINGS_TYPE_POS_REQ, PREQ_ALWAYS_NO_IDLE_CHK).value<QString>();
+    double posReqFreq = settings.value(SETTINGS_POS_REQ_FREQ_SEC, DEFAULT_POS_REQ_FREQ_SEC).value<double>();
+    postionRequestTimeMilliSec = static_cast<int>(posReqFreq) * 1000;
 }
@@ -3,6 +3,8 @@
 
 #include "definitions.h"
 
+class QSettings;
+
 #define SHORT_WAIT_SEC 2
 #define LONG_WAIT_SEC  100
 
@@ -11,6 +13,9 @@ class ControlParams
 public:
     ControlParams();
 
+    // The file sending, preprocessing and probing options, as saved by the options dialog
+    void readSettings(QSettings& settings);
+
 public:
     int waitTime;
     double zJogRate;
@@ -22,6 +27,7 @@ public:
     bool filterFileCommands;
     bool reducePrecision;
     int grblLineBufferLen;
+    bool compactLines;
     bool useFourAxis;
     int charSendDelayMs;
     char fourthAxisType;
@@ -31,6 +37,17 @@ public:
     bool waitForJogToComplete;
     bool useZLevelingData;
     double zLevelingOffset;
+    double probeSeekFeed;
+    double probeTouchFeed;
+    double probeBackoff;
+    double probeClearance;
+    double probeMaxTravel;
+    bool probeShortLift;        // lift only the clearance between grid points, not zSafe
+    double arcFitTolerance;
+    double simplifyXYTolerance;
+    double simplifyZTolerance;
+    int wireTraceMode;          // WIRE_TRACE_OFF, WIRE_TRACE_FILE or WIRE_TRACE_FLIGHT
+    QString wireTraceDir;
 };
 
 #endif // CONTROLPARAMS_H
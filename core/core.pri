@@ -0,0 +1,26 @@
+# Links the controller core library, include from the targets that use it
+
+QT += core concurrent network
+
+INCLUDEPATH += $$PWD/.. $$PWD/../QextSerialPort
+DEPENDPATH += $$PWD/..
+
+# Same as the library, the trace points in the headers and GUI need it too
+trace: DEFINES += GRBL_TRACE
+
+CORE_BUILD_DIR = $$OUT_PWD/../core
+win32:CONFIG(debug, debug|release): CORE_BUILD_DIR = $$CORE_BUILD_DIR/debug
+win32:CONFIG(release, debug|release): CORE_BUILD_DIR = $$CORE_BUILD_DIR/release
+
+LIBS += -L$$CORE_BUILD_DIR -lgrblcore
+win32-msvc*: PRE_TARGETDEPS += $$CORE_BUILD_DIR/grblcore.lib
+else: PRE_TARGETDEPS += $$CORE_BUILD_DIR/libgrblcore.a
+
+# Same platform flags and libraries as the serial port sources built into the library
+linux*{
+    !qesp_linux_udev:DEFINES += QESP_NO_UDEV
+    qesp_linux_udev: LIBS += -ludev
+    DEFINES += __linux__
+}
+macx:LIBS += -framework IOKit -framework CoreFoundation
+win32:LIBS += -lsetupapi -ladvapi32 -luser32
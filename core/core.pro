@@ -0,0 +1,103 @@
+#-------------------------------------------------
+#
+# Controller core: the protocol, serial, parsing and leveling code
+# shared by the GUI, the command line streamer and the benchmarks.
+# QtCore, plus QtNetwork for the metrics server.
+#
+#-------------------------------------------------
+
+QT       += core concurrent network
+QT       -= gui
+
+TARGET = grblcore
+TEMPLATE = lib
+CONFIG += staticlib
+
+include(../QextSerialPort/qextserialport.pri)
+include(../log4qt/log4qt.pri)
+
+INCLUDEPATH += $$PWD/..
+DEPENDPATH += $$PWD/..
+
+# qmake CONFIG+=trace builds the trace points in, see trace.h
+trace: DEFINES += GRBL_TRACE
+
+
+SOURCES += ../logging.cpp \
+    ../rs232.cpp \
+    ../wiretrace.cpp \
+    ../wirereplay.cpp \
+    ../atomicintbool.cpp \
+    ../coord3d.cpp \
+    ../positem.cpp \
+    ../toolpathmodel.cpp \
+    ../fileparser.cpp \
+    ../parsedprogram.cpp \
+    ../modalwalker.cpp \
+    ../machinelimits.cpp \
+    ../jobestimator.cpp \
+    ../rapidoptimizer.cpp \
+    ../arcfitter.cpp \
+    ../pathsimplifier.cpp \
+    ../lineencoder.cpp \
+    ../streamstats.cpp \
+    ../trace.cpp \
+    ../metricsboard.cpp \
+    ../metricsserver.cpp \
+    ../controlparams.cpp \
+    ../gcodecontroller.cpp \
+    ../gcodegrbl.cpp \
+    ../gcodemarlin.cpp \
+    ../machinesession.cpp \
+    ../jobscheduler.cpp \
+    ../SpilineInterpolate3D.cpp \
+    ../LinearInterpolate3D.cpp \
+    ../SingleInterpolate.cpp \
+    ../interpolator.cpp \
+    ../gcommands.cpp \
+    ../zprobe.cpp \
+    ../heightmapstore.cpp \
+    ../heightmap.cpp
+
+
+HEADERS  += ../rs232.h \
+    ../wiretrace.h \
+    ../wirereplay.h \
+    ../definitions.h \
+    ../settingskeys.h \
+    ../atomicintbool.h \
+    ../coord3d.h \
+    ../log4qtdef.h \
+    ../positem.h \
+    ../toolpathmodel.h \
+    ../fileparser.h \
+    ../parsedprogram.h \
+    ../modalwalker.h \
+    ../machinelimits.h \
+    ../jobestimator.h \
+    ../rapidoptimizer.h \
+    ../arcfitter.h \
+    ../pathsimplifier.h \
+    ../lineencoder.h \
+    ../streamstats.h \
+    ../trace.h \
+    ../metricsboard.h \
+    ../metricsserver.h \
+    ../termiosext.h \
+    ../controlparams.h \
+    ../version.h \
+    ../gcodecontroller.h \
+    ../gcodegrbl.h \
+    ../gcodemarlin.h \
+    ../machinesession.h \
+    ../jobscheduler.h \
+    ../SpilineInterpolate3D.h \
+    ../interpolator.h \
+    ../LinearInterpolate3D.h \
+    ../SingleInterpolate.h \
+    ../basicgeometry.h \
+    ../gcommands.h \
+    ../linesteps.h \
+    ../zprobe.h \
+    ../heightmapstore.h \
+    ../heightmap.h
@@ -24,6 +24,16 @@
 #define DEFAULT_GRBL_LINE_BUFFER_LEN    50
 #define DEFAULT_CHAR_SEND_DELAY_MS      0
 
+#define DEFAULT_PROBE_SEEK_FEED     300.0
+#define DEFAULT_PROBE_TOUCH_FEED    25.0
+#define DEFAULT_PROBE_BACKOFF       0.5
+#define DEFAULT_PROBE_CLEARANCE     1.0
+#define DEFAULT_PROBE_MAX_TRAVEL    30.0
+
+#define DEFAULT_ARC_FIT_TOLERANCE   0.01
+#define DEFAULT_SIMPLIFY_XY_TOLERANCE   0.01
+#define DEFAULT_SIMPLIFY_Z_TOLERANCE    0.005
+
 #define MM_IN_AN_INCH           25.4
 #define PRE_HOME_Z_ADJ_MM       5.0
 
@@ -33,6 +43,7 @@
 #define SET_UNLOCK_STATE_V08c           "$X"
 
 #define REGEXP_SETTINGS_LINE    "(\\d+)\\s*=\\s*([\\w\\.]+)\\s*\\(([^\\)]*)\\)"
+#define REGEXP_SETTINGS_VALUE   "^(\\d+)\\s*=\\s*([\\d\\.]+)"
 
 #define OPEN_BUTTON_TEXT                "Open"
 #define CLOSE_BUTTON_TEXT               "Close / Reset"
@@ -64,4 +75,6 @@ void err(const char *str, ...);
 void warn(const char *str, ...);
 void info(const char *str, ...);
 
+void setupToolLogging(const QString& logFile, bool threadNames = false);
+
 #endif // DEFINITIONS_H
@@ -0,0 +1,474 @@
+/****************************************************************
+ * fileparser.cpp
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#include "fileparser.h"
+#include "gcodecontroller.h"
+#include "trace.h"
+
+#include <QFile>
+#include <QStringList>
+#include <QThread>
+#include <QtConcurrent>
+#include <limits.h>
+#include <string.h>
+
+FileParser::FileParser()
+{
+}
+
+// Called from the GUI thread, stops whatever is being parsed
+int FileParser::nextGeneration()
+{
+    int generation = wantedGeneration.get() + 1;
+    wantedGeneration.set(generation);
+    return generation;
+}
+
+void FileParser::cancel()
+{
+    nextGeneration();
+}
+
+void FileParser::parseFile(QString path, int generation)
+{
+    TRACE_SCOPE("FileParser::parseFile");
+    QFile file(path);
+    if (!file.open(QFile::ReadOnly))
+    {
+        err("Can't open file %s", path.toLocal8Bit().constData());
+        emit parseEnded(ParsedProgramPtr(), generation);
+        return;
+    }
+
+    // The program keeps the contents, the senders take the lines from there
+    QByteArray source = file.readAll();
+    file.close();
+
+    parseSource(path, source, generation);
+}
+
+void FileParser::parseSource(QString path, QByteArray source, int generation)
+{
+    TRACE_SCOPE("FileParser::parseSource");
+    ParsedProgram *program = new ParsedProgram(path, source);
+
+    if (source.size() >= PARSE_PARALLEL_MIN_SIZE && QThread::idealThreadCount() > 1)
+        parseParallel(program, source, generation);
+    else
+        parseSequential(program, source, generation);
+}
+
+void FileParser::parseSequential(ParsedProgram *program, const QByteArray& source, int generation)
+{
+    qint64 totalSize = source.size();
+    if (totalSize == 0)
+        totalSize = 1;
+
+    ToolpathModel *model = new ToolpathModel();
+    model->reserve(totalSize / 16);
+    program->reserve(totalSize / 16);
+
+    const char *text = source.constData();
+    const char *p = text;
+    const char *dataEnd = text + source.size();
+
+    ParseState state;
+    bool arc = false;
+    QString words;
+    int index = 0;
+    int lastPercent = 0;
+    int lastChunk = 0;
+
+    while (p < dataEnd)
+    {
+        if (wantedGeneration.get() != generation)
+        {
+            delete model;
+            delete program;
+            return;
+        }
+
+        // Same lines QFile::readLine() gives, newline included
+        const char *nl = (const char *)memchr(p, '\n', dataEnd - p);
+        const char *lineEnd = nl != NULL ? nl + 1 : dataEnd;
+        QString strline = QString::fromLocal8Bit(QByteArray::fromRawData(p, lineEnd - p));
+        qint64 offset = p - text;
+        p = lineEnd;
+
+        index++;
+
+        if (parseLine(strline, state, arc, words))
+        {
+            if (model->isEmpty())
+            {
+                // insert 0,0 position
+                model->append(0, 0, 0, 0, false, false, state.mm, 0);
+            }
+            model->append(state.x, state.y, state.i, state.j, arc, state.cw, state.mm, index);
+        }
+        program->appendLine(offset, words);
+
+        reportProgress(model, p - text, totalSize, lastPercent, lastChunk, generation);
+    }
+
+    model->squeeze();
+    program->squeeze();
+    program->setToolpath(ToolpathModelPtr(model));
+    emit parseEnded(ParsedProgramPtr(program), generation);
+}
+
+void FileParser::parseParallel(ParsedProgram *program, const QByteArray& source, int generation)
+{
+    qint64 totalSize = source.size();
+    const char *text = source.constData();
+
+    // Enough chunks to keep every core busy while the first ones are merged
+    qint64 chunkSize = qMax((qint64)PARSE_MIN_CHUNK_SIZE, totalSize / (QThread::idealThreadCount() * 8));
+    QList<Chunk> chunks;
+    qint64 start = 0;
+    while (start < totalSize)
+    {
+        qint64 end = qMin(start + chunkSize, totalSize);
+        if (end < totalSize)
+        {
+            const char *nl = (const char *)memchr(text + end - 1, '\n', totalSize - end + 1);
+            end = nl != NULL ? nl - text + 1 : totalSize;
+        }
+
+        Chunk chunk;
+        chunk.data = text + start;
+        chunk.start = start;
+        chunk.size = end - start;
+        chunk.end = end;
+        chunks.append(chunk);
+        start = end;
+    }
+
+    QFuture<ChunkResult> future = QtConcurrent::mapped(chunks, ChunkParser(&wantedGeneration, generation));
+
+    ToolpathModel *model = new ToolpathModel();
+    model->reserve(totalSize / 16);
+    program->reserve(totalSize / 16);
+
+    ParseState state;
+    int lineOffset = 0;
+    int lastPercent = 0;
+    int lastChunk = 0;
+
+    // Chunks come in file order, each one is fixed up with the state the previous one left
+    for (int k = 0; k < chunks.size(); k++)
+    {
+        ChunkResult result;
+        if (wantedGeneration.get() == generation)
+            result = future.resultAt(k);
+
+        if (wantedGeneration.get() != generation || !result.complete)
+        {
+            future.cancel();
+            future.waitForFinished();
+            delete model;
+            delete program;
+            return;
+        }
+
+        const ChunkParse& parse = result.parse[result.gSensitive && (state.g == 2 || state.g == 3) ? 1 : 0];
+        const ToolpathModel& moves = parse.moves;
+        const int *from = parse.knownFrom;
+
+        for (int n = 0; n < moves.count(); n++)
+        {
+            bool mm = n < from[FIELD_MM] ? state.mm : moves.isMm(n);
+            if (model->isEmpty())
+            {
+                // insert 0,0 position
+                model->append(0, 0, 0, 0, false, false, mm, 0);
+            }
+            model->append(n < from[FIELD_X] ? state.x : moves.x(n),
+                          n < from[FIELD_Y] ? state.y : moves.y(n),
+                          n < from[FIELD_I] ? state.i : moves.i(n),
+                          n < from[FIELD_J] ? state.j : moves.j(n),
+                          moves.isArc(n),
+                          n < from[FIELD_CW] ? state.cw : moves.isCw(n),
+                          mm, moves.line(n) + lineOffset);
+        }
+        program->append(parse.program);
+
+        const ParseState& end = parse.end;
+        if (end.known & (1 << FIELD_X))
+            state.x = end.x;
+        if (end.known & (1 << FIELD_Y))
+            state.y = end.y;
+        if (end.known & (1 << FIELD_I))
+            state.i = end.i;
+        if (end.known & (1 << FIELD_J))
+            state.j = end.j;
+        if (end.known & (1 << FIELD_CW))
+            state.cw = end.cw;
+        if (end.known & (1 << FIELD_MM))
+            state.mm = end.mm;
+        if (end.g >= 0)
+            state.g = end.g;
+        lineOffset += parse.program.lineCount();
+
+        reportProgress(model, chunks.at(k).end, totalSize, lastPercent, lastChunk, generation);
+    }
+
+    model->squeeze();
+    program->squeeze();
+    program->setToolpath(ToolpathModelPtr(model));
+    emit parseEnded(ParsedProgramPtr(program), generation);
+}
+
+void FileParser::reportProgress(ToolpathModel *model, qint64 pos, qint64 totalSize, int& lastPercent, int& lastChunk, int generation)
+{
+    int percent = (pos * 100) / totalSize;
+    if (percent == lastPercent)
+        return;
+
+    lastPercent = percent;
+    emit parseProgress(percent, generation);
+
+    // The copy shares the arrays until the next append, so each chunk costs one copy here
+    if (percent - lastChunk >= PARSE_CHUNK_PERCENT && !model->isEmpty())
+    {
+        lastChunk = percent;
+        emit parsedChunk(ToolpathModelPtr(new ToolpathModel(*model)), generation);
+    }
+}
+
+FileParser::ChunkParser::ChunkParser(AtomicIntBool *wanted, int gen)
+    : wantedGeneration(wanted), generation(gen)
+{
+}
+
+// Runs in the pool threads
+FileParser::ChunkResult FileParser::ChunkParser::operator()(const Chunk& chunk) const
+{
+    ChunkResult result;
+    result.complete = parseChunk(chunk, G_INCOMING, result.parse[0]);
+    result.gSensitive = result.parse[0].end.usedIncomingG;
+    if (result.complete && result.gSensitive)
+        result.complete = parseChunk(chunk, G_INCOMING_ARC, result.parse[1]);
+    return result;
+}
+
+bool FileParser::ChunkParser::parseChunk(const Chunk& chunk, int g, ChunkParse& out) const
+{
+    out.end = ParseState(g);
+    for (int f = 0; f < FIELD_COUNT; f++)
+        out.knownFrom[f] = INT_MAX;
+    out.moves.reserve((int)(chunk.size / 16));
+    out.program.reserve((int)(chunk.size / 16));
+
+    const char *p = chunk.data;
+    const char *dataEnd = chunk.data + chunk.size;
+    int recorded = 0;
+    bool arc = false;
+    QString words;
+
+    while (p < dataEnd)
+    {
+        if (wantedGeneration->get() != generation)
+            return false;
+
+        // Same lines QFile::readLine() gives, newline included
+        const char *nl = (const char *)memchr(p, '\n', dataEnd - p);
+        const char *lineEnd = nl != NULL ? nl + 1 : dataEnd;
+        QString strline = QString::fromLocal8Bit(QByteArray::fromRawData(p, lineEnd - p));
+        qint64 offset = chunk.start + (p - chunk.data);
+        p = lineEnd;
+
+        ParseState& state = out.end;
+        int next = out.moves.count();
+        bool valid = parseLine(strline, state, arc, words);
+        out.program.appendLine(offset, words);
+        if (valid)
+            out.moves.append(state.x, state.y, state.i, state.j, arc, state.cw, state.mm, out.program.lineCount());
+
+        int fresh = state.known & ~recorded;
+        if (fresh)
+        {
+            for (int f = 0; f < FIELD_COUNT; f++)
+            {
+                if (fresh & (1 << f))
+                    out.knownFrom[f] = next;
+            }
+            recorded = state.known;
+        }
+    }
+
+    out.moves.squeeze();
+    out.program.squeeze();
+    return true;
+}
+
+bool FileParser::parseLine(QString strline, ParseState& state, bool& arc, QString& words)
+{
+    GCodeController::trimToEnd(strline, '(');
+    GCodeController::trimToEnd(strline, ';');
+    GCodeController::trimToEnd(strline, '%');
+
+    strline = strline.trimmed();
+
+    if (strline.size() == 0)
+    {
+        words.clear();
+        return false;//ignore comments
+    }
+
+    words = spaceWords(strline.toUpper());
+    return processGCode(words, state, arc);
+}
+
+// Same as replacing "([A-Z])" with " \\1" and then "\\s+" with " ", without QRegExp,
+// which would make the pool threads wait on each other for its shared cache.
+QString FileParser::spaceWords(const QString& line)
+{
+    QString words;
+    words.reserve(line.size() * 2);
+    bool space = false;
+    for (int n = 0; n < line.size(); n++)
+    {
+        QChar c = line.at(n);
+        if (c.isSpace())
+        {
+            if (!space)
+                words.append(' ');
+            space = true;
+        }
+        else
+        {
+            if (c >= QChar('A') && c <= QChar('Z') && !space)
+                words.append(' ');
+            words.append(c);
+            space = false;
+        }
+    }
+    return words;
+}
+
+bool FileParser::processGCode(const QString& line, ParseState& state, bool& arc)
+{
+    QStringList components = line.split(" ", QString::SkipEmptyParts);
+    QString s;
+    arc = false;
+    bool valid = false;
+    int nextIsValue = NO_ITEM;
+    foreach (s, components)
+    {
+        // While a chunk has not set g, what I and J do depends on the guess
+        if (state.g < 0 && (s.at(0) == 'I' || s.at(0) == 'J'))
+            state.usedIncomingG = true;
+
+        bool arcMode = state.g == 2 || state.g == 3 || state.g == G_INCOMING_ARC;
+
+        if (s.at(0) == 'G')
+        {
+            int value = s.mid(1,-1).toInt();
+            if (value >= 0 && value <= 3)
+            {
+                state.g = value;
+                if (value == 2)
+                {
+                    state.cw = true;
+                    state.known |= 1 << FIELD_CW;
+                }
+                else if (value == 3)
+                {
+                    state.cw = false;
+                    state.known |= 1 << FIELD_CW;
+                }
+            }
+            else if (value == 20)
+            {
+                state.mm = false;
+                state.known |= 1 << FIELD_MM;
+            }
+            else if (value == 21)
+            {
+                state.mm = true;
+                state.known |= 1 << FIELD_MM;
+            }
+        }
+        // g is always one of G0 to G3, or not known yet
+        else if (s.at(0) == 'X')
+        {
+            state.x = decodeLineItem(s, X_ITEM, valid, nextIsValue);
+            state.known |= 1 << FIELD_X;
+        }
+        else if (s.at(0) == 'Y')
+        {
+            state.y = decodeLineItem(s, Y_ITEM, valid, nextIsValue);
+            state.known |= 1 << FIELD_Y;
+        }
+        else if (arcMode && s.at(0) == 'I')
+        {
+            state.i = decodeLineItem(s, I_ITEM, arc, nextIsValue);
+            state.known |= 1 << FIELD_I;
+        }
+        else if (arcMode && s.at(0) == 'J')
+        {
+            state.j = decodeLineItem(s, J_ITEM, arc, nextIsValue);
+            state.known |= 1 << FIELD_J;
+        }
+        else if (nextIsValue != NO_ITEM)
+        {
+            switch (nextIsValue)
+            {
+            case X_ITEM:
+                state.x = decodeDouble(s, valid);
+                break;
+            case Y_ITEM:
+                state.y = decodeDouble(s, valid);
+                break;
+            case I_ITEM:
+                state.i = decodeDouble(s, arc);
+                break;
+            case J_ITEM:
+                state.j = decodeDouble(s, arc);
+                break;
+            };
+            nextIsValue = NO_ITEM;
+        }
+    }
+
+    return valid;
+}
+
+double FileParser::decodeLineItem(const QString& item, const int next, bool& valid, int& nextIsValue)
+{
+    if (item.size() == 1)
+    {
+        nextIsValue = next;
+        return 0;
+    }
+    else
+    {
+        nextIsValue = NO_ITEM;
+        return decodeDouble(item.mid(1,-1), valid);
+    }
+}
+
+double FileParser::decodeDouble(const QString& value, bool& valid)
+{
+    // Matches "^[+-]?[0-9]*\\.?[0-9]*$", without QRegExp for the same reason as spaceWords()
+    int n = 0;
+    int size = value.size();
+    if (n < size && (value.at(n) == '+' || value.at(n) == '-'))
+        n++;
+    while (n < size && value.at(n) >= QChar('0') && value.at(n) <= QChar('9'))
+        n++;
+    if (n < size && value.at(n) == '.')
+        n++;
+    while (n < size && value.at(n) >= QChar('0') && value.at(n) <= QChar('9'))
+        n++;
+    if (n != size)
+        return 0;
+    valid = true;
+    return value.toDouble();
+}
@@ -0,0 +1,146 @@
+/****************************************************************
+ * fileparser.h
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#ifndef FILEPARSER_H
+#define FILEPARSER_H
+
+#include <QObject>
+#include <QString>
+#include "atomicintbool.h"
+#include "toolpathmodel.h"
+#include "parsedprogram.h"
+
+#define PARSE_CHUNK_PERCENT     10      // partial toolpath sent to the visualizer every 10% of the file
+#define PARSE_PARALLEL_MIN_SIZE (1024 * 1024)   // smaller files are parsed on a single core
+#define PARSE_MIN_CHUNK_SIZE    (256 * 1024)
+
+/**
+ * @brief Reads a G-code file into a ParsedProgram, with the ToolpathModel for
+ * the visualizer and the words for the senders.
+ *
+ * Lives in its own thread. Every request carries a generation number, a new
+ * request or cancel() bumps the wanted generation from the GUI thread and
+ * the parse in progress stops at the next line.
+ *
+ * Big files are split at line boundaries and the chunks are parsed on all
+ * the cores, each one starting from an unknown modal state. A sequential
+ * pass then walks the chunks in order, fills in whatever each chunk took
+ * from the one before and appends the moves, so the result is the same as
+ * parsing the file line by line.
+ */
+class FileParser : public QObject
+{
+    Q_OBJECT
+public:
+    FileParser();
+
+    int nextGeneration();
+    void cancel();
+
+signals:
+    void parseProgress(int percent, int generation);
+    void parsedChunk(ToolpathModelPtr model, int generation);
+    void parseEnded(ParsedProgramPtr program, int generation);
+
+public slots:
+    void parseFile(QString path, int generation);
+    // Parses a program built in memory, path is only kept for the messages
+    void parseSource(QString path, QByteArray source, int generation);
+
+private:
+    enum
+    {
+        NO_ITEM = 0,
+        X_ITEM,
+        Y_ITEM,
+        I_ITEM,
+        J_ITEM,
+    };
+
+    // Modal fields, as bits of ParseState::known
+    enum Field { FIELD_X = 0, FIELD_Y, FIELD_I, FIELD_J, FIELD_CW, FIELD_MM, FIELD_COUNT };
+
+    // Values of ParseState::g while a chunk has not set it, the incoming g is
+    // only guessed to be a line (G0/G1) or an arc (G2/G3)
+    enum { G_INCOMING = -1, G_INCOMING_ARC = -2 };
+
+    /**
+     * @brief Modal state carried from line to line. known has the bits of the
+     * fields set since the start of the chunk, the others still hold the value
+     * of the previous chunk.
+     */
+    struct ParseState
+    {
+        double x;
+        double y;
+        double i;
+        double j;
+        bool cw;
+        bool mm;
+        int g;
+        int known;
+        bool usedIncomingG; // an I or J word was read, or skipped, on the guessed g
+
+        ParseState(int gIn = 0)
+            : x(0), y(0), i(0), j(0), cw(false), mm(true), g(gIn), known(0), usedIncomingG(false) {}
+    };
+
+    struct Chunk
+    {
+        const char *data;
+        qint64 start;
+        qint64 size;
+        qint64 end;         // file position after the chunk, for the progress
+    };
+
+    struct ChunkParse
+    {
+        ToolpathModel moves;
+        ParsedProgram program;
+        ParseState end;
+        int knownFrom[FIELD_COUNT]; // first move with the field set by the chunk itself
+    };
+
+    // The chunk is parsed again guessing an arc only when the guess made a difference
+    struct ChunkResult
+    {
+        ChunkParse parse[2];
+        bool gSensitive;
+        bool complete;
+    };
+
+    class ChunkParser
+    {
+    public:
+        typedef ChunkResult result_type;
+
+        ChunkParser(AtomicIntBool *wanted, int generation);
+        ChunkResult operator()(const Chunk& chunk) const;
+
+    private:
+        bool parseChunk(const Chunk& chunk, int g, ChunkParse& out) const;
+
+        AtomicIntBool *wantedGeneration;
+        int generation;
+    };
+
+    void parseSequential(ParsedProgram *program, const QByteArray& source, int generation);
+    void parseParallel(ParsedProgram *program, const QByteArray& source, int generation);
+    void reportProgress(ToolpathModel *model, qint64 pos, qint64 totalSize, int& lastPercent, int& lastChunk, int generation);
+
+    static bool parseLine(QString strline, ParseState& state, bool& arc, QString& words);
+    static QString spaceWords(const QString& line);
+    static bool processGCode(const QString& line, ParseState& state, bool& arc);
+    static double decodeLineItem(const QString& item, const int next, bool& valid, int& nextIsValue);
+    static double decodeDouble(const QString& value, bool& valid);
+
+private:
+    AtomicIntBool wantedGeneration;
+};
+
+#endif // FILEPARSER_H
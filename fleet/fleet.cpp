@@ -0,0 +1,159 @@
+/****************************************************************
+ * fleet.cpp
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#include "fleet.h"
+
+#include <QCoreApplication>
+#include <stdio.h>
+
+#define FLEET_ABORT_POLL_MS     100
+
+Fleet::Fleet(const Options& options)
+    : options(options), exitCode(FLEET_OK), finishing(false), jobsDone(0), out(stdout), errOut(stderr)
+{
+    foreach (const MachineConfig& config, options.machines)
+        scheduler.addMachine(config);
+    foreach (MachineSession *session, scheduler.machines())
+        metricsServer.addBoard(session->board());
+
+    connect(&scheduler, SIGNAL(jobStarted(int,QString,QString)), this, SLOT(jobStarted(int,QString,QString)));
+    connect(&scheduler, SIGNAL(jobEnded(int,QString,QString,bool,int)), this, SLOT(jobEnded(int,QString,QString,bool,int)));
+    connect(&scheduler, SIGNAL(jobRejected(int,QString,QString)), this, SLOT(jobRejected(int,QString,QString)));
+    connect(&scheduler, SIGNAL(machineMessage(QString,QString)), this, SLOT(machineMessage(QString,QString)));
+    connect(&scheduler, SIGNAL(allJobsEnded()), this, SLOT(allJobsEnded()));
+    connect(&scheduler, SIGNAL(stopped()), this, SLOT(stopped()));
+
+    connect(&overviewTimer, SIGNAL(timeout()), this, SLOT(printOverview()));
+    connect(&abortTimer, SIGNAL(timeout()), this, SLOT(checkAbort()));
+}
+
+void Fleet::requestAbort()
+{
+    abortRequested.set(true);
+    foreach (MachineSession *session, scheduler.machines())
+        session->abort();
+}
+
+void Fleet::start()
+{
+    runTimer.start();
+
+    // A dashboard is nice to have, the jobs run without it
+    if (options.metricsPort > 0)
+    {
+        if (metricsServer.listen(options.metricsPort))
+            record(QString("metrics port=%1").arg(options.metricsPort));
+        else
+            record(QString("warning stage=metrics port=%1").arg(options.metricsPort));
+    }
+
+    foreach (MachineSession *session, scheduler.machines())
+    {
+        const MachineConfig& config = session->config();
+        record(QString("machine name=%1 port=%2 baud=%3 tags=%4 travel=%5x%6")
+               .arg(config.name).arg(config.port).arg(config.baud).arg(config.tags.join(","))
+               .arg(config.travelX).arg(config.travelY));
+    }
+
+    foreach (QString file, options.files)
+    {
+        int id = scheduler.enqueue(file, options.needs);
+        record(QString("queued id=%1 file=\"%2\"").arg(id).arg(file));
+    }
+
+    scheduler.start();
+
+    if (options.overviewSec > 0)
+        overviewTimer.start(options.overviewSec * 1000);
+    abortTimer.start(FLEET_ABORT_POLL_MS);
+}
+
+void Fleet::jobStarted(int id, QString path, QString machine)
+{
+    record(QString("start id=%1 file=\"%2\" machine=%3 ms=%4").arg(id).arg(path).arg(machine).arg(runTimer.elapsed()));
+
+    // A session clears the abort flag of its controller when the file starts, ask again
+    if (abortRequested.get())
+        requestAbort();
+}
+
+void Fleet::jobEnded(int id, QString path, QString machine, bool completed, int errors)
+{
+    QString result = "ok";
+    if (!completed)
+    {
+        result = "aborted";
+        exitCode = qMax(exitCode, int(FLEET_FAILED));
+    }
+    else if (errors > 0)
+    {
+        result = "errors";
+        exitCode = qMax(exitCode, int(FLEET_FAILED));
+    }
+
+    jobsDone++;
+    record(QString("done id=%1 file=\"%2\" machine=%3 result=%4 errors=%5 ms=%6")
+           .arg(id).arg(path).arg(machine).arg(result).arg(errors).arg(runTimer.elapsed()));
+}
+
+void Fleet::jobRejected(int id, QString path, QString reason)
+{
+    exitCode = qMax(exitCode, int(FLEET_REJECTED));
+    record(QString("rejected id=%1 file=\"%2\" reason=\"%3\"").arg(id).arg(path).arg(reason));
+}
+
+void Fleet::machineMessage(QString machine, QString text)
+{
+    if (!options.quiet)
+        errOut << machine << ": " << text << endl;
+}
+
+void Fleet::allJobsEnded()
+{
+    if (finishing)
+        return;
+
+    record(QString("finished jobs=%1 ms=%2").arg(jobsDone).arg(runTimer.elapsed()));
+    finish(exitCode);
+}
+
+void Fleet::stopped()
+{
+    QCoreApplication::exit(exitCode);
+}
+
+void Fleet::printOverview()
+{
+    foreach (QString line, scheduler.overview())
+        record("overview " + line);
+}
+
+void Fleet::checkAbort()
+{
+    if (!abortRequested.get() || finishing)
+        return;
+
+    record(QString("aborted waiting=%1 running=%2").arg(scheduler.waitingJobs()).arg(scheduler.runningJobs()));
+    finish(FLEET_ABORTED);
+}
+
+void Fleet::record(const QString& line)
+{
+    out << line << endl;
+}
+
+// Closes every port, the application leaves when the scheduler says they are closed
+void Fleet::finish(int code)
+{
+    finishing = true;
+    exitCode = qMax(exitCode, code);
+    overviewTimer.stop();
+    abortTimer.stop();
+    printOverview();
+    scheduler.stop();
+}
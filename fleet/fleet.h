@@ -0,0 +1,95 @@
+/****************************************************************
+ * fleet.h
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#ifndef FLEET_H
+#define FLEET_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include "atomicintbool.h"
+#include "machinesession.h"
+#include "jobscheduler.h"
+#include "metricsserver.h"
+
+// Exit codes of grblfleet
+enum FleetExitCode
+{
+    FLEET_OK = 0,
+    FLEET_USAGE,        // bad command line or fleet file
+    FLEET_REJECTED,     // some files can't be read or no machine can run them
+    FLEET_FAILED,       // some jobs were cut short or refused lines
+    FLEET_ABORTED,      // interrupted
+};
+
+/**
+ * @brief Sends a queue of files to a fleet of machines without a GUI.
+ *
+ * The machines come from an INI file, one group each, and the files are
+ * given on the command line. JobScheduler runs them; this only prints
+ * what happens as records on stdout, the same way as grblstream, and an
+ * overview of every machine now and then.
+ */
+class Fleet : public QObject
+{
+    Q_OBJECT
+public:
+    struct Options
+    {
+        QList<MachineConfig> machines;
+        QStringList files;
+        QStringList needs;      // tags every file needs
+        int metricsPort;        // 0 for no metrics server
+        int overviewSec;        // 0 for no overview
+        bool quiet;
+    };
+
+    Fleet(const Options& options);
+
+    // From the signal handler, only sets atomics
+    void requestAbort();
+
+public slots:
+    void start();
+
+private slots:
+    void jobStarted(int id, QString path, QString machine);
+    void jobEnded(int id, QString path, QString machine, bool completed, int errors);
+    void jobRejected(int id, QString path, QString reason);
+    void machineMessage(QString machine, QString text);
+    void allJobsEnded();
+    void stopped();
+    void printOverview();
+    void checkAbort();
+
+private:
+    void record(const QString& line);
+    void finish(int code);
+
+private:
+    Options options;
+    JobScheduler scheduler;
+    MetricsServer metricsServer;
+    int exitCode;
+    bool finishing;
+    AtomicIntBool abortRequested;
+
+    QTimer overviewTimer;
+    QTimer abortTimer;
+    QElapsedTimer runTimer;
+    int jobsDone;
+
+    QTextStream out;
+    QTextStream errOut;
+};
+
+#endif // FLEET_H
@@ -0,0 +1,22 @@
+#-------------------------------------------------
+#
+# Fleet runner, sends a queue of files to several machines at once
+# with the controller classes of GrblController
+#
+#-------------------------------------------------
+
+QT       -= gui
+
+TARGET = grblfleet
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+include(../core/core.pri)
+
+
+SOURCES += main.cpp \
+    fleet.cpp
+
+
+HEADERS  += fleet.h
@@ -0,0 +1,154 @@
+/****************************************************************
+ * main.cpp
+ * GrblHoming - zapmaker fork on github
+ *
+ * Fleet runner, sends a queue of files to several machines without a GUI
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QSettings>
+#include <QFileInfo>
+#include <QTimer>
+#include <QTextStream>
+#include <signal.h>
+#include <stdio.h>
+
+#include "fleet.h"
+#include "gcodecontroller.h"
+#include "version.h"
+#include "definitions.h"
+#include "trace.h"
+
+static Fleet *fleet = NULL;
+
+static void interrupted(int)
+{
+    if (fleet != NULL)
+        fleet->requestAbort();
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setOrganizationName(COMPANY_NAME);
+    QCoreApplication::setOrganizationDomain(DOMAIN_NAME);
+    QCoreApplication::setApplicationName(APPLICATION_NAME);
+    QCoreApplication::setApplicationVersion(GRBL_CONTROLLER_NAME_AND_VERSION);
+
+    qRegisterMetaType<Coord3D>("Coord3D");
+    qRegisterMetaType<ControlParams>("ControlParams");
+    qRegisterMetaType<InterpolatorPtr>("InterpolatorPtr");
+    qRegisterMetaType<ToolpathModelPtr>("ToolpathModelPtr");
+    qRegisterMetaType<ParsedProgramPtr>("ParsedProgramPtr");
+    qRegisterMetaType<MachineLimits>("MachineLimits");
+    qRegisterMetaType<StreamStats>("StreamStats");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Sends G-code files to a fleet of Grbl or Marlin machines, each file to the\n"
+                                     "first free machine that can run it. Records go to stdout, one per line.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument("files", "G-code files to send, in this order.", "files...");
+
+    QCommandLineOption fleetOption(QStringList() << "f" << "fleet", "INI file with one group per machine.", "file");
+    QCommandLineOption needsOption(QStringList() << "n" << "needs", "Tags a machine must have to run the files, comma separated.", "tags");
+    QCommandLineOption metricsOption("metrics-port", "Serve Prometheus metrics of every machine on this local port.", "port", "0");
+    QCommandLineOption overviewOption("overview-sec", "Print an overview of the machines this often, 0 for never.", "secs", "10");
+    QCommandLineOption quietOption(QStringList() << "q" << "quiet", "Don't print the controller messages.");
+    QCommandLineOption logOption("log", "Write a debug log of every machine to this file.", "file");
+    parser.addOption(fleetOption);
+    parser.addOption(needsOption);
+    parser.addOption(metricsOption);
+    parser.addOption(overviewOption);
+    parser.addOption(quietOption);
+    parser.addOption(logOption);
+#ifdef GRBL_TRACE
+    QCommandLineOption traceOption("trace", "Write a Chrome trace of the run to this file.", "file");
+    parser.addOption(traceOption);
+#endif
+    parser.process(a);
+
+    QTextStream errOut(stderr);
+    QStringList args = parser.positionalArguments();
+    if (args.isEmpty() || !parser.isSet(fleetOption))
+    {
+        errOut << parser.helpText();
+        return FLEET_USAGE;
+    }
+
+    QString fleetPath = parser.value(fleetOption);
+    if (!QFileInfo(fleetPath).isReadable())
+    {
+        errOut << "Can't read fleet file " << fleetPath << endl;
+        return FLEET_USAGE;
+    }
+
+    // Every machine writes the debug log, at full speed that is a lot of lines, so
+    // it is off unless asked for. The lines carry the thread, named after the machine
+    QString logFile = parser.value(logOption);
+    g_enableDebugLog.set(!logFile.isEmpty());
+    setupToolLogging(logFile, true);
+
+    Fleet::Options options;
+    QString errorMsg;
+    QSettings fleetSettings(fleetPath, QSettings::IniFormat);
+    options.machines = MachineConfig::readFleet(fleetSettings, errorMsg);
+    if (options.machines.isEmpty())
+    {
+        errOut << fleetPath << ": " << errorMsg << endl;
+        return FLEET_USAGE;
+    }
+
+    options.files = args;
+    if (parser.isSet(needsOption))
+        options.needs = parser.value(needsOption).split(',', QString::SkipEmptyParts);
+    options.quiet = parser.isSet(quietOption);
+
+    bool ok;
+    options.metricsPort = parser.value(metricsOption).toInt(&ok);
+    if (!ok || options.metricsPort < 0 || options.metricsPort > 65535)
+    {
+        errOut << "Bad metrics port " << parser.value(metricsOption) << endl;
+        return FLEET_USAGE;
+    }
+    options.overviewSec = parser.value(overviewOption).toInt(&ok);
+    if (!ok || options.overviewSec < 0)
+    {
+        errOut << "Bad overview period " << parser.value(overviewOption) << endl;
+        return FLEET_USAGE;
+    }
+
+    info("%s fleet started with %d machines", GRBL_CONTROLLER_NAME_AND_VERSION, options.machines.size());
+
+    fleet = new Fleet(options);
+    signal(SIGINT, interrupted);
+    signal(SIGTERM, interrupted);
+
+#ifdef GRBL_TRACE
+    QString traceFile = parser.value(traceOption);
+    if (!traceFile.isEmpty())
+        Trace::start();
+#endif
+
+    QTimer::singleShot(0, fleet, SLOT(start()));
+    int result = a.exec();
+
+#ifdef GRBL_TRACE
+    if (!traceFile.isEmpty())
+    {
+        Trace::stop();
+        Trace::save(traceFile);
+    }
+#endif
+
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    delete fleet;
+    fleet = NULL;
+
+    return result;
+}
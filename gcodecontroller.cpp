@@ -1,9 +1,17 @@
 #include "gcodecontroller.h"
+#include "SpilineInterpolate3D.h"
+#include "LinearInterpolate3D.h"
+#include "SingleInterpolate.h"
+#include "basicgeometry.h"
+#include "heightmapstore.h"
+#include "trace.h"
 
 #include <QObject>
 
+#define debug(format, ...) diag("%s - " format, __FUNCTION__, ##__VA_ARGS__)
 
 GCodeController::GCodeController()
+    : lastLevelingPoint(0, 0, 0), metricsBoard(NULL), jobProgress(0)
 {
 
 }
@@ -11,6 +19,7 @@ GCodeController::GCodeController()
 void GCodeController::closePort(bool reopen)
 {
     port.CloseComport();
+    publishMetrics(true);
     emit portIsClosed(reopen);
 }
 
@@ -46,3 +55,685 @@ void GCodeController::trimToEnd(QString& strline, QChar ch)
     if (pos != -1)
         strline = strline.left(pos);
 }
+
+void GCodeController::clearLevelingData()
+{
+    setInterpolator(InterpolatorPtr());
+}
+
+// The interpolator is only replaced from this thread, everybody else gets its own
+// reference through interpolatorChanged and keeps it alive while sampling it.
+void GCodeController::setInterpolator(InterpolatorPtr newInterpolator)
+{
+    interpolator = newInterpolator;
+    emit interpolatorChanged(interpolator);
+}
+
+void GCodeController::changeInterpolator(int index)
+{
+    if (interpolator.isNull()) {
+        return;
+    }
+
+    if (interpolator->getType() == index)
+    {
+        return;
+    }
+
+    // A new view over the same height map, the probed data is not copied.
+    if ((index == Interpolator::SPILINE || index == Interpolator::LINEAR) && interpolator->getType() != Interpolator::SINGLE)
+    {
+        createInterpolator(index, interpolator->getHeightMap());
+    } else {
+        debug("Interpolator change not supported. Leaving the original intact");
+    }
+
+    emit levelingEnded();
+}
+
+void GCodeController::createInterpolator(int levelingAlgorithm, HeightMapPtr map)
+{
+    if (levelingAlgorithm == Interpolator::SPILINE){
+        debug("Creating spiline interpolator");
+        setInterpolator(InterpolatorPtr(new SpilineInterpolate3D(map)));
+    }  else if (levelingAlgorithm == Interpolator::LINEAR){
+        debug("Creating linear interpolator");
+        setInterpolator(InterpolatorPtr(new LinearInterpolate3D(map)));
+    } else if (levelingAlgorithm == Interpolator::SINGLE){
+        debug("Creating single touch interpolator");
+        setInterpolator(InterpolatorPtr(new SingleInterpolate(map)));
+    } else {
+        //TODO, Wrong interpolator selected.
+    }
+}
+
+// Travel to (x,y) at zCurrent and probe down from there. On Grbl this is the fast seek, back
+// off and slow touch, Marlin's G30 does the touch by itself. Only probe moves go down, the
+// surface may be anywhere below.
+bool GCodeController::probePoint(const ZProbe& probe, double x, double y, double speed, double zCurrent, double &zCoord)
+{
+    QString res;
+    if (!sendProbeCommand(probe.travelCommand(x, y, speed), res))
+    {
+        return false;
+    }
+    updateProbePosition(x, y, zCurrent);
+
+    double zApproach = zCurrent;
+    if (probe.isTwoStage())
+    {
+        double zContact = 0;
+        if (!sendProbeCommand(probe.seekCommand(zApproach), res) || !probeResultToValue(res, zContact))
+        {
+            return false;
+        }
+        // Touching from in contact would alarm or read a wrong height
+        if (!sendProbeCommand(probe.moveZCommand(probe.backoffHeight(zContact)), res))
+        {
+            return false;
+        }
+        zApproach = zContact;
+    }
+
+    if (!sendProbeCommand(probe.touchCommand(zApproach), res) || !probeResultToValue(res, zCoord))
+    {
+        return false;
+    }
+    debug("Probe: %.3f-%.3f-%.3f", x, y, zCoord);
+    updateProbePosition(x, y, zCoord);
+    return true;
+}
+
+void GCodeController::performZLeveling(int levelingAlgorithm, QRect extent, int xSteps, int ySteps, double zStarting, double speed, double zSafe, double offset)
+{
+    debug("Starting Z Leveling procedure");
+    abortState.set(false);
+    clearLevelingData();
+
+    if (!prepareProbing(zStarting, speed))
+    {
+        emit levelingEnded();
+        return;
+    }
+
+    double * xValues = new double[xSteps];
+    double * yValues = new double[ySteps];
+    double * zValues = new double[xSteps * ySteps];
+
+    double xLenght = extent.right() - extent.left();
+    double yLenght = extent.top() - extent.bottom();
+
+    double xInterval = xLenght;
+    double yInterval = yLenght;
+    if (xSteps > 1){
+        xInterval = xLenght / (xSteps - 1);
+    }
+    if (ySteps > 1){
+        yInterval = yLenght / (ySteps - 1);
+    }
+
+    debug("xInterval: %.3f yInterval: %.3f", xInterval, yInterval);
+
+    for (int i = 0; i<xSteps; i++)
+    {
+        xValues[i] = i*xInterval;
+    }
+
+    for (int j = 0; j<ySteps; j++)
+    {
+        yValues[j] = j*yInterval;
+    }
+
+    ZProbe probe(probeFirmware(), controlParams, zSafe);
+    probe.setGrid(xValues, xSteps, yValues, ySteps);
+
+    QString res;
+    double zCurrent = zStarting;
+    double zCoord = 0;
+    int progress = 0;
+    bool failed = false;
+
+    for (int n = 0; n < probe.count(); n++)
+    {
+        if (abortState.get())
+        {
+            break;
+        }
+        int i, j;
+        probe.location(n, i, j);
+
+        if (!probePoint(probe, xValues[i], yValues[j], speed, zCurrent, zCoord))
+        {
+            QString msg = QString(tr("Probe failed at X%1 Y%2")).arg(xValues[i]).arg(yValues[j]);
+            emit addList(msg);
+            emit sendMsg(msg);
+            failed = true;
+            break;
+        }
+        zValues[j*xSteps + i] = zCoord;
+        probe.setProbed(i, j, zCoord);
+
+        int nextI = -1, nextJ = -1;
+        if (n + 1 < probe.count())
+        {
+            probe.location(n + 1, nextI, nextJ);
+        }
+        zCurrent = probe.retractHeight(zCoord, nextI, nextJ);
+        sendProbeCommand(probe.moveZCommand(zCurrent), res);
+        progress++;
+        emit levelingProgress(progress);
+    }
+
+    if (!abortState.get() && !failed)
+    {
+        createInterpolator(levelingAlgorithm, HeightMapPtr(new HeightMap(xValues, xSteps, yValues, ySteps, zValues, offset)));
+    }
+
+    delete [] xValues;
+    delete [] yValues;
+    delete [] zValues;
+
+    emit levelingEnded();
+    finishProbing(zStarting, speed, failed);
+}
+
+void GCodeController::recomputeOffset(double speed, double zStarting)
+{
+    debug("Recalculating offset");
+    if (interpolator.isNull())
+    {
+        return;
+    }
+
+    if (!prepareProbing(zStarting, speed))
+    {
+        return;
+    }
+
+    //Get the new Z depth in the 0,0 coordinate. The tool may have changed, so we can't trust the stored map to get closer.
+    ZProbe probe(probeFirmware(), controlParams, 0);
+    double zCoord = 0;
+    bool failed = !probePoint(probe, 0, 0, speed, zStarting, zCoord);
+    if (failed)
+    {
+        QString msg = tr("Probe failed while recomputing the offset");
+        emit addList(msg);
+        emit sendMsg(msg);
+    }
+    else
+    {
+        emit recomputeOffsetEnded(interpolator->calculateOffset(zCoord));
+    }
+
+    finishProbing(zStarting, speed, failed);
+}
+
+// Pick the grid points used to correct a stored map: corners first, then the center
+// and the middle of the edges, then the rest of the grid spread evenly.
+QList<QPoint> GCodeController::referencePoints(int points) const
+{
+    QList<QPoint> list;
+    int xSteps = interpolator->getXSteps();
+    int ySteps = interpolator->getYSteps();
+    int xLast = xSteps - 1;
+    int yLast = ySteps - 1;
+
+    QList<QPoint> candidates;
+    candidates << QPoint(0, 0) << QPoint(xLast, 0) << QPoint(xLast, yLast) << QPoint(0, yLast)
+               << QPoint(xLast / 2, yLast / 2)
+               << QPoint(xLast / 2, 0) << QPoint(xLast, yLast / 2) << QPoint(xLast / 2, yLast) << QPoint(0, yLast / 2);
+
+    for (int step = 2; step > 0; step--)
+    {
+        for (int i = 0; i < xSteps; i += step)
+        {
+            for (int j = 0; j < ySteps; j += step)
+            {
+                candidates << QPoint(i, j);
+            }
+        }
+    }
+
+    foreach (QPoint p, candidates)
+    {
+        if (list.size() >= points)
+        {
+            break;
+        }
+        if (!list.contains(p))
+        {
+            list.append(p);
+        }
+    }
+    return list;
+}
+
+// Re-probe a few points of the stored map and correct it with the plane that best fits
+// the differences, so a fixture put back on the table doesn't need a full probe.
+void GCodeController::reprobeLeveling(int points, double zStarting, double speed, double zSafe)
+{
+    abortState.set(false);
+    if (interpolator.isNull() || points < 1)
+    {
+        emit levelingEnded();
+        return;
+    }
+
+    if (!prepareProbing(zStarting, speed))
+    {
+        emit levelingEnded();
+        return;
+    }
+
+    QList<QPoint> refs = referencePoints(points);
+    // Hold the map, the arrays below point into it.
+    HeightMapPtr map = interpolator->getHeightMap();
+    const double *xValues = map->getXValues();
+    const double *yValues = map->getYValues();
+    const double *zValues = map->getXYValues();
+    int xSteps = map->getXSteps();
+    int ySteps = map->getYSteps();
+
+    ZProbe probe(probeFirmware(), controlParams, zSafe);
+    QString res;
+    bool failed = false;
+    int progress = 0;
+
+    // Least squares fit of dz = a + b*x + c*y, accumulating the normal equations.
+    double n = 0, sx = 0, sy = 0, sxx = 0, syy = 0, sxy = 0;
+    double sd = 0, sxd = 0, syd = 0;
+
+    foreach (QPoint p, refs)
+    {
+        if (abortState.get())
+        {
+            break;
+        }
+        double x = xValues[p.x()];
+        double y = yValues[p.y()];
+        double zOld = zValues[p.y() * xSteps + p.x()];
+
+        // The part may sit higher than it did, the seek starts from the travel height
+        double zCoord = 0;
+        if (!probePoint(probe, x, y, speed, zStarting, zCoord))
+        {
+            QString msg = QString(tr("Probe failed at X%1 Y%2")).arg(x).arg(y);
+            emit addList(msg);
+            emit sendMsg(msg);
+            failed = true;
+            break;
+        }
+        sendProbeCommand(probe.moveZCommand(zStarting), res);
+
+        double d = zCoord - zOld;
+        n++;
+        sx += x; sy += y;
+        sxx += x * x; syy += y * y; sxy += x * y;
+        sd += d; sxd += x * d; syd += y * d;
+
+        progress++;
+        emit levelingProgress(progress);
+    }
+
+    if (!abortState.get() && !failed && n > 0)
+    {
+        double a = sd / n, b = 0, c = 0;
+        double det = n * (sxx * syy - sxy * sxy) - sx * (sx * syy - sxy * sy) + sy * (sx * sxy - sxx * sy);
+        if (n >= 3 && fabs(det) > 1e-9)
+        {
+            a = (sd * (sxx * syy - sxy * sxy) - sx * (sxd * syy - sxy * syd) + sy * (sxd * sxy - sxx * syd)) / det;
+            b = (n * (sxd * syy - sxy * syd) - sd * (sx * syy - sxy * sy) + sy * (sx * syd - sxd * sy)) / det;
+            c = (n * (sxx * syd - sxd * sxy) - sx * (sx * syd - sxd * sy) + sd * (sx * sxy - sxx * sy)) / det;
+        }
+
+        QString msg = QString(tr("Height map corrected by %1 mm, tilt %2 mm/m in X and %3 mm/m in Y"))
+                .arg(a, 0, 'f', 3).arg(b * 1000, 0, 'f', 3).arg(c * 1000, 0, 'f', 3);
+        emit addList(msg);
+        emit sendMsg(msg);
+
+        double *newX = new double[xSteps];
+        double *newY = new double[ySteps];
+        double *newZ = new double[xSteps * ySteps];
+        for (int i = 0; i < xSteps; i++)
+        {
+            newX[i] = xValues[i];
+        }
+        for (int j = 0; j < ySteps; j++)
+        {
+            newY[j] = yValues[j];
+            for (int i = 0; i < xSteps; i++)
+            {
+                newZ[j * xSteps + i] = zValues[j * xSteps + i] + a + b * xValues[i] + c * yValues[j];
+            }
+        }
+
+        createInterpolator(interpolator->getType(),
+                           HeightMapPtr(new HeightMap(newX, xSteps, newY, ySteps, newZ, map->getInitialOffset())));
+
+        delete [] newX;
+        delete [] newY;
+        delete [] newZ;
+    }
+
+    emit levelingEnded();
+    finishProbing(zStarting, speed, failed);
+}
+
+void GCodeController::saveLevelingData(QString path)
+{
+    QString error;
+    if (!HeightMapStore::save(path, interpolator.data(), error))
+    {
+        QString msg = QString(tr("Can't save height map '%1': %2")).arg(path).arg(error);
+        emit addList(msg);
+        emit sendMsg(msg);
+        return;
+    }
+    emit addList(QString(tr("Height map saved to '%1'")).arg(path));
+}
+
+void GCodeController::loadLevelingData(QString path)
+{
+    QString error;
+    QDateTime timestamp;
+    int type = Interpolator::SPILINE;
+    HeightMapPtr loaded = HeightMapStore::load(path, type, timestamp, error);
+    if (loaded.isNull())
+    {
+        QString msg = QString(tr("Can't load height map '%1': %2")).arg(path).arg(error);
+        emit addList(msg);
+        emit sendMsg(msg);
+        return;
+    }
+
+    createInterpolator(type, loaded);
+    emit addList(QString(tr("Height map '%1' probed on %2 loaded")).arg(path).arg(timestamp.toString()));
+    emit levelingEnded();
+    emit recomputeOffsetEnded(interpolator->getInitialOffset());
+}
+
+void GCodeController::prepareLineSteps(const ControlParams& params, InterpolatorPtr interpolatorIn)
+{
+    controlParams = params;
+    interpolator = interpolatorIn;
+    lastLevelingPoint = Point(0, 0, 0);
+}
+
+QList<CodeCommand *> GCodeController::levelCommand(CodeCommand *command)
+{
+    return levelLine(command, 0);
+}
+
+QList<CodeCommand *> GCodeController::levelLine(CodeCommand* command, double zOffset)
+{
+    TRACE_SCOPE("GCodeController::levelLine");
+    QList<CodeCommand*> resultList;
+
+    if (command->getType() == CodeCommand::G_COMMAND && (command->getCommand() == 0 || command->getCommand() == 1))
+    {
+        GCodeCommand* gCommand = static_cast<GCodeCommand*>(command);
+        Point lastPoint(lastLevelingPoint);
+
+        bool hasX, hasY, hasZ;
+        hasX = gCommand->getX(lastLevelingPoint.x);
+        hasY = gCommand->getY(lastLevelingPoint.y);
+        hasZ = gCommand->getZ(lastLevelingPoint.z);
+
+        //TODO think about what to do with the fourth axis.
+        if (!(hasX | hasY | hasZ))
+        {
+            //The command has only F or F and Fourth
+            resultList.append(command);
+            return resultList;
+        }
+
+        Point newPoint(lastLevelingPoint);
+
+        //Clear the Z component to calculate the distance between points in the XY plane only.
+        Point lastPointNoZ = lastPoint;
+        lastPointNoZ.z = 0;
+        Point newPointNoZ = newPoint;
+        newPointNoZ.z = 0;
+        double lenght = Distance(lastPointNoZ, newPointNoZ);
+
+        debug("Old point: (%.2f,%.2f,%.2f) - New Point: (%.2f,%.2f,%.2f)", lastPoint.x, lastPoint.y, lastPoint.z,
+              newPoint.x, newPoint.y, newPoint.z);
+
+        QList<Point> pointList;
+
+        double maxSegmentSize = fmin(interpolator->xGridSize(), interpolator->yGridSize()) * (1.0/SEGMENT_SIZE_DIVIDER);
+        debug("Segment size: %.3f Max segment size: %.3f", lenght, maxSegmentSize);
+        //If the distance between the old point and the new one is bigger than the threshold, split the segment.
+        if (lenght > maxSegmentSize)
+        {
+            int segmentCount = ceil(lenght / maxSegmentSize);
+            debug("Splitting segment in %d", segmentCount);
+            double segmentSize = lenght / segmentCount;
+
+            Vector d = newPoint - lastPoint;
+            d = normalize(d);
+            double delta = 0;
+
+            for(int i = 1; i<segmentCount; i++)
+            {
+                Point dst = lastPoint + d * (segmentSize*i);
+                interpolator->interpolate(dst.x, dst.y, delta);
+                dst.z += delta;
+                dst.z -= zOffset;
+                pointList.append(dst);
+                debug("Segment intermediate point: (%.2f,%.2f,%.2f)", dst.x, dst.y, dst.z);
+            }
+        }
+
+        double delta = 0;
+        interpolator->interpolate(newPoint.x, newPoint.y, delta);
+        newPoint.z += delta;
+        newPoint.z -= zOffset;
+
+        debug("Segment last point: (%.2f,%.2f,%.2f)",newPoint.x, newPoint.y, newPoint.z);
+
+        //Create a new command for every intermediate point.
+        Point tmpPoint;
+        foreach(tmpPoint, pointList){
+            GCodeCommand *c = new GCodeCommand(*gCommand);
+            c->setPoint(tmpPoint);
+            if (g_enableDebugLog.get())
+                debug("Generated intermediate command: %s", qPrintable(c->toString()));
+            resultList.append(c);
+        }
+        //Lastly modify the original command with the Z and add it to the list.
+        gCommand->setPoint(newPoint);
+        if (g_enableDebugLog.get())
+            debug("Generated last command: %s", qPrintable(gCommand->toString()));
+        resultList.append(gCommand);
+
+        debug("Generated: %d new lines", resultList.size());
+
+        return resultList;
+    } else if ((command->getType() == CodeCommand::G_COMMAND && (command->getCommand() == 2 || command->getCommand() == 3)))
+    {
+        //Algorithm extracted from Marlin firmwares
+        bool is_clockwise = false;
+        if (command->getCommand() == 2)
+        {
+            is_clockwise = true;
+        }
+
+        debug("Generating segments for an arc: Clockwise: %d", is_clockwise);
+        //Generate leveled segments for G3 and G4 arc commands.
+        GCodeCommand* gCommand = static_cast<GCodeCommand*>(command);
+        Point originPoint(lastLevelingPoint);
+
+        double origin_z = lastLevelingPoint.z;
+        originPoint.z = 0;
+
+        bool hasX, hasY, hasZ;
+        hasX = gCommand->getX(lastLevelingPoint.x);
+        hasY = gCommand->getY(lastLevelingPoint.y);
+        hasZ = gCommand->getZ(lastLevelingPoint.z);
+
+        //TODO think about what to do with the fourth axis.
+        if (!(hasX | hasY | hasZ))
+        {
+            //The command has only F or F and Fourth
+            resultList.append(command);
+            return resultList;
+        }
+        Point targetPoint(lastLevelingPoint);
+
+        targetPoint.z = 0;
+
+        double linear_travel = targetPoint.z - originPoint.z;
+
+        //Get the I and J parameters.
+        double offsetx,offsety;
+        if (!gCommand->getParameter('I', offsetx))
+            offsetx = 0.0;
+        if (!gCommand->getParameter('J', offsety))
+            offsety = 0.0;
+
+        debug("Offsets: %.3f, %.3f", offsetx, offsety);
+
+        //Calculate the arc radious from origin to center.
+        double radius = hypot(offsetx, offsety);
+        debug("Arc radius: %.3f", radius);
+
+        //We don't need to take into account the z coord.
+        Point center_point(originPoint.x + offsetx, originPoint.y + offsety, 0.0);
+
+        //Vector from center to origin
+        Vector r(-offsetx, -offsety, 0);
+//        //Vector from center to target
+        Vector rt(targetPoint - center_point);
+
+        //Angle between both previous vectors (arctan between cross and dot product(sen/cos))
+        double angular_travel = atan2(r.x*rt.y - r.y*rt.x, r.x*rt.x + r.y*rt.y);
+        if (angular_travel < 0){angular_travel += 2*M_PI;}
+        if (is_clockwise) { angular_travel -= 2*M_PI;}
+
+        debug("Arc angular travel: %.3f", angular_travel);
+
+        double millimeters_of_travel = hypot(angular_travel*radius, fabs(linear_travel));
+        debug("Linear travel: %.3f  -  Millimeters of travel: %.3f", linear_travel, millimeters_of_travel);
+
+        unsigned int segments = floor(millimeters_of_travel/MM_PER_ARC_SEGMENT);
+        debug("Segments: %d", segments);
+
+        double theta_per_segment = angular_travel/segments;
+        double linear_per_segment = linear_travel/segments;
+
+        Point arc_point;
+        double sin_Ti;
+        double cos_Ti;
+        double f;
+        bool hasf = gCommand->getF(f);
+        double delta = 0;
+        unsigned int i;
+        double z = origin_z;
+
+        //Calculate all segments but last one, as we will use the target point directly.
+        for (i = 1; i<segments; i++)
+        {
+            cos_Ti = cos(i*theta_per_segment);
+            sin_Ti = sin(i*theta_per_segment);
+            r.x = -offsetx*cos_Ti + offsety*sin_Ti;
+            r.y = -offsetx*sin_Ti - offsety*cos_Ti;
+
+            arc_point.x = center_point.x + r.x;
+            arc_point.y = center_point.y + r.y;
+            z += linear_per_segment;
+
+            interpolator->interpolate(arc_point.x, arc_point.y, delta);
+            arc_point.z = z;
+            arc_point.z += delta;
+            arc_point.z -= zOffset;
+
+            GCodeCommand *c = new GCodeCommand(1,"");
+            c->setPoint(arc_point);
+            //Set F for the first segment.
+            if (hasf)
+            {
+                c->setF(f);
+                hasf = false;
+            }
+            if (g_enableDebugLog.get())
+                debug("Generated intermediate command: %s", qPrintable(c->toString()));
+            resultList.append(c);
+        }
+
+        delta = 0;
+        targetPoint.z = lastLevelingPoint.z;
+        interpolator->interpolate(targetPoint.x, targetPoint.y, delta);
+        targetPoint.z += delta;
+        targetPoint.z -= zOffset;
+
+        GCodeCommand *lastCommand = new GCodeCommand(1, "");
+        lastCommand->setPoint(targetPoint);
+        gCommand->setPoint(targetPoint);
+        if (hasf)
+        {
+            lastCommand->setF(f);
+        }
+        if (g_enableDebugLog.get())
+            debug("Generated last command: %s", qPrintable(lastCommand->toString()));
+        resultList.append(lastCommand);
+        delete gCommand;
+        debug("Generated: %d new lines", resultList.size());
+        return resultList;
+    }
+
+    resultList.append(command);
+    return resultList;
+}
+
+void GCodeController::requestStreamStats()
+{
+    emit streamStatsReady(streamStats);
+}
+
+// End of a file send, the figures go to the log and to whoever listens
+void GCodeController::dumpStreamStats()
+{
+    streamStats.stop();
+
+    foreach (QString line, streamStats.summary())
+        info("stream %s", qPrintable(line));
+
+    emit streamStatsReady(streamStats);
+}
+
+void GCodeController::publishMetrics(bool force)
+{
+    if (metricsBoard == NULL)
+        return;
+    if (!force && metricsTimer.isValid() && metricsTimer.elapsed() < METRICS_PUBLISH_MS)
+        return;
+    metricsTimer.start();
+
+    MachineMetrics metrics;
+    metrics.portOpen = port.isPortOpen();
+    metrics.mm = controlParams.useMm;
+
+    const StreamHistogram& latency = streamStats.histogram(StreamStats::ACK_LATENCY_US);
+    metrics.jobRunning = streamStats.isRunning();
+    metrics.linesSent = streamStats.counter(StreamStats::LINES_SENT);
+    metrics.linesAcked = streamStats.counter(StreamStats::ACKS);
+    metrics.errors = streamStats.counter(StreamStats::ERRORS);
+    metrics.bytesSent = streamStats.counter(StreamStats::BYTES_SENT);
+    metrics.ackP50Us = latency.percentile(50);
+    metrics.ackP90Us = latency.percentile(90);
+    metrics.ackP99Us = latency.percentile(99);
+    metrics.ackCount = latency.count();
+    metrics.ackSumUs = latency.valueSum();
+    metrics.elapsedMs = streamStats.elapsedMs();
+    if (metrics.elapsedMs > 0)
+        metrics.bytesPerSec = metrics.bytesSent * 1000.0 / metrics.elapsedMs;
+
+    // Straight line from the rate so far, good enough for a dashboard
+    metrics.progress = jobProgress;
+    if (metrics.jobRunning && jobProgress > 0)
+        metrics.etaMs = qint64(metrics.elapsedMs * (1 - jobProgress) / jobProgress);
+
+    fillMetrics(metrics);
+    metricsBoard->publish(metrics);
+}
@@ -5,16 +5,29 @@
 #include <QFile>
 #include <QThread>
 #include <QTextStream>
+#include <QRect>
 #include "definitions.h"
 #include "rs232.h"
 #include "coord3d.h"
 #include "controlparams.h"
 #include "interpolator.h"
+#include "parsedprogram.h"
+#include "machinelimits.h"
+#include "streamstats.h"
+#include "metricsboard.h"
+#include "gcommands.h"
+#include "zprobe.h"
+#include "linesteps.h"
+
+#define MM_PER_ARC_SEGMENT 0.5
+//The minimal grid size will be divided by this number to get the max segment size.
+#define SEGMENT_SIZE_DIVIDER 3
+#define METRICS_PUBLISH_MS 100
 
 class CmdResponse
 {
 public:
-    CmdResponse(const char *buf, int c, int l) : cmd(buf), count(c), line(l)
+    CmdResponse(const char *buf, int c, int l) : cmd(buf), count(c), line(l), sentAt(-1)
     {
         waitForMe = false;
         if (buf[0] == 'M')
@@ -28,6 +41,7 @@ public:
     QString cmd;
     int count;
     int line;
+    qint64 sentAt;  // StreamStats::now() when written to the port
     bool waitForMe;
 };
 
@@ -40,7 +54,7 @@ public:
     int decimals;
 };
 
-class GCodeController : public QObject
+class GCodeController : public QObject, public LineSteps
 {
     Q_OBJECT
 
@@ -51,6 +65,8 @@ public:
     void setShutdown();
     int getSettingsItemCount();
     int getNumaxis();
+    // Before the controller is moved to its thread, which is then the only one publishing
+    void setMetricsBoard(MetricsBoard *board) { metricsBoard = board; }
 
 
     static void trimToEnd(QString& strline, QChar);
@@ -61,6 +77,8 @@ signals:
     void addListOut(QString line);
     void sendMsg(QString msg);
     void stopSending();
+    // End of a file send, with the number of lines the controller refused
+    void sendFileEnded(bool completed, int errors);
     void portIsClosed(bool reopen);
     void portIsOpen(bool sendCode);
     void setCommandText(QString value);
@@ -81,26 +99,32 @@ signals:
     void levelingProgress(int);
     void levelingEnded();
     void recomputeOffsetEnded(double);
+    void interpolatorChanged(InterpolatorPtr interpolator);
+    void machineLimitsChanged(MachineLimits limits);
+    // Answer to requestStreamStats, and at the end of every file send
+    void streamStatsReady(StreamStats stats);
 
 public slots:
     virtual void openPort(QString commPortStr, QString baudRate) = 0;
     virtual void closePort(bool reopen);
     virtual void sendGcode(QString line) = 0;
     virtual void sendGcodeAndGetResult(int id, QString line) = 0;
-    virtual void sendFile(QString path) = 0;
+    virtual void sendFile(ParsedProgramPtr program) = 0;
     virtual void gotoXYZFourth(QString line) = 0;
     virtual void axisAdj(char axis, float coord, bool inv, bool absoluteAfterAxisAdj, int sliderZCount) = 0;
     virtual void setResponseWait(ControlParams controlParams) = 0;
     virtual void controllerSetHome() = 0;
     virtual void sendControllerReset() = 0;
     virtual void sendControllerUnlock() = 0;
-    virtual void performZLeveling(int levelingAlgorithm, QRect rect, int xSteps, int ySteps, double zStarting, double speed, double zSafe, double offset) = 0;
+    virtual void performZLeveling(int levelingAlgorithm, QRect rect, int xSteps, int ySteps, double zStarting, double speed, double zSafe, double offset);
     virtual void goToHome() = 0;
-    virtual bool isZInterpolatorReady() = 0;
-    virtual void clearLevelingData() = 0;
-    virtual const Interpolator * getInterpolator() = 0;
-    virtual void changeInterpolator(int index) = 0;
-    virtual void recomputeOffset(double speed, double zStarting) = 0;
+    virtual void clearLevelingData();
+    virtual void changeInterpolator(int index);
+    virtual void recomputeOffset(double speed, double zStarting);
+    virtual void reprobeLeveling(int points, double zStarting, double speed, double zSafe);
+    virtual void saveLevelingData(QString path);
+    virtual void loadLevelingData(QString path);
+    void requestStreamStats();
 
 protected:
     enum PosReqStatus
@@ -112,6 +136,37 @@ protected:
     };
     virtual QString removeUnsupportedCommands(QString line) = 0;
     bool isPortOpen();
+    void createInterpolator(int levelingAlgorithm, HeightMapPtr map);
+    void setInterpolator(InterpolatorPtr newInterpolator);
+    QList<CodeCommand *> levelLine(CodeCommand *command, double zOffset);
+
+    // LineSteps, the parts all the controllers share
+    void prepareLineSteps(const ControlParams& params, InterpolatorPtr interpolator);
+    QList<CodeCommand *> levelCommand(CodeCommand *command);
+
+    // Probing primitives every controller must provide, the probing procedures are shared.
+    virtual ZProbe::Firmware probeFirmware() const = 0;
+    virtual bool sendProbeCommand(const QString& line, QString& result) = 0;
+    virtual bool probeResultToValue(const QString& result, double &zCoord) = 0;
+    virtual bool prepareProbing(double zStarting, double speed) = 0;
+    virtual void finishProbing(double zStarting, double speed, bool failed) = 0;
+    virtual void updateProbePosition(double x, double y, double z) = 0;
+    bool probePoint(const ZProbe& probe, double x, double y, double speed, double zCurrent, double &zCoord);
+    QList<QPoint> referencePoints(int points) const;
+    void dumpStreamStats();
+    // At most every METRICS_PUBLISH_MS unless forced, nothing without a board
+    void publishMetrics(bool force = false);
+    // The firmware specific part: state, position and queue
+    virtual void fillMetrics(MachineMetrics& metrics) = 0;
+
+    ControlParams controlParams;
+    InterpolatorPtr interpolator;
+    Point lastLevelingPoint;
+    StreamStats streamStats;
+    MetricsBoard *metricsBoard;
+    QElapsedTimer metricsTimer;
+    double jobProgress;     // 0 to 1, of the current or last file
+
     AtomicIntBool abortState;
     AtomicIntBool resetState;
     AtomicIntBool shutdownState;
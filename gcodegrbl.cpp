@@ -8,17 +8,20 @@
  ****************************************************************/
 
 #include "gcodegrbl.h"
+#include "trace.h"
 
 #include <QObject>
 #include <iostream>
 
 GCodeGrbl::GCodeGrbl()
-    : errorCount(0), doubleDollarFormat(false),
+    : errorCount(0), doubleDollarFormat(false), numberedAxisSettings(false),
       incorrectMeasurementUnits(false), incorrectLcdDisplayUnits(false),
       maxZ(0), motionOccurred(false),
       sliderZCount(0),
       positionValid(false),
-      numaxis(DEFAULT_AXIS_COUNT)
+      numaxis(DEFAULT_AXIS_COUNT),
+      lastMotionMode(0), sentMotionMode(MOTION_MODE_UNKNOWN), absoluteMode(true), levelingXYPlane(true),
+      levelingUnknownAxes(0), levelingWarned(false), probeWcoZ(0), lineStepsXyRateSet(false)
 {
     // use base class's timer - use it to capture random text from the controller
     startTimer(1000);
@@ -35,9 +38,11 @@ void GCodeGrbl::openPort(QString commPortStr, QString baudRate)
     currComPort = commPortStr;
 
     port.setCharSendDelayMs(controlParams.charSendDelayMs);
+    port.setWireTrace(controlParams.wireTraceMode, controlParams.wireTraceDir);
 
     if (port.OpenComport(commPortStr, baudRate))
     {
+        publishMetrics(true);
         emit portIsOpen(true);
     }
     else
@@ -282,6 +287,7 @@ bool GCodeGrbl::checkGrbl(const QString& result)
         if (rx.indexIn(result) != -1 && rx.captureCount() > 0)
         {
             doubleDollarFormat = false;
+            numberedAxisSettings = false;
 
             QStringList list = rx.capturedTexts();
             if (list.size() >= 3)
@@ -299,6 +305,9 @@ bool GCodeGrbl::checkGrbl(const QString& result)
                     doubleDollarFormat = true;
                 }
 
+                // 0.51 is older than 0.8
+                numberedAxisSettings = majorVer > 0 || (minorVer >= 9 && minorVer < 51);
+
                 diag(qPrintable(tr("Got Grbl Version (Parsed:) %d.%d%c ($$=%d)\n")),
                             majorVer, minorVer, letter, doubleDollarFormat);
             }
@@ -314,6 +323,7 @@ bool GCodeGrbl::checkGrbl(const QString& result)
 // Wrapped method. Should only be called from above method.
 bool GCodeGrbl::sendGcodeInternal(QString line, QString& result, bool recordResponseOnFail, int waitSec, bool aggressive, int currLine /* = 0 */)
 {
+    TRACE_SCOPE("GCodeGrbl::sendGcodeInternal");
     if (!port.isPortOpen())
     {
         QString msg = tr("Port not available yet")  ;
@@ -338,7 +348,7 @@ bool GCodeGrbl::sendGcodeInternal(QString line, QString& result, bool recordResp
     {
         sentReqForParserState = true;
     }
-    else if (!line.compare(SETTINGS_COMMAND_V08a))
+    else if (!line.compare(SETTINGS_COMMAND_V08a) || !line.compare(SETTINGS_COMMAND_V08c))
     {
         if (doubleDollarFormat)
             line = SETTINGS_COMMAND_V08c;
@@ -397,6 +407,9 @@ bool GCodeGrbl::sendGcodeInternal(QString line, QString& result, bool recordResp
             return false;
     }
 
+    if (sentReqForLocation)
+        streamStats.statusRequested();
+
     if (!port.SendBuf(buf, line.length()))
     {
         QString msg = tr("Sending to port failed")  ;
@@ -408,9 +421,28 @@ bool GCodeGrbl::sendGcodeInternal(QString line, QString& result, bool recordResp
     else
     {
         sentI++;
+
+        // The ok of an aggressive line comes back later, from the waitForOk of another line
+        qint64 sentAt = streamStats.now();
+        if (!sentReqForLocation)
+        {
+            if (aggressive && !sendCount.isEmpty())
+            {
+                sendCount.last().sentAt = sentAt;
+                int total = 0;
+                foreach (CmdResponse cmdResp, sendCount)
+                    total += cmdResp.count;
+                streamStats.lineSent(line.length(), total);
+            }
+            else
+                streamStats.lineSent(line.length(), line.length());
+        }
+
         if (!waitForOk(result, waitSecActual, sentReqForLocation, sentReqForParserState, aggressive, false))
         {
             diag(qPrintable(tr("WAITFOROK FAILED\n")));
+            streamStats.timeout();
+            port.wireError("Wait for ok failed");
             if (shutdownState.get())
                 return false;
 
@@ -425,13 +457,28 @@ bool GCodeGrbl::sendGcodeInternal(QString line, QString& result, bool recordResp
         }
         else
         {
+            if (!aggressive && !sentReqForLocation)
+                streamStats.lineAcked(sentAt, result.contains(RESPONSE_ERROR), 0);
+
             if (sentReqForSettings)
             {
                 QStringList list = result.split("$");
+                MachineLimits limits;
+                bool haveLimits = false;
                 for (int i = 0; i < list.size(); i++)
                 {
                     QString item = list.at(i);
                     const QRegExp rx(REGEXP_SETTINGS_LINE);
+                    const QRegExp rxValue(REGEXP_SETTINGS_VALUE);
+
+                    // Newer versions report the settings without a description
+                    if (rxValue.indexIn(item, 0) != -1)
+                    {
+                        int number = rxValue.cap(1).toInt();
+                        double value = rxValue.cap(2).toDouble();
+                        if (numberedAxisSettings ? limits.setSetting(number, value) : limits.setLegacySetting(number, value))
+                            haveLimits = true;
+                    }
 
                     if (rx.indexIn(item, 0) != -1 && rx.captureCount() == 3)
                     {
@@ -448,12 +495,14 @@ bool GCodeGrbl::sendGcodeInternal(QString line, QString& result, bool recordResp
                                 if (controlParams.useMm)
                                     incorrectLcdDisplayUnits = true;
                             }
-                            break;
                         }
                     }
                 }
 
                 settingsItemCount.set(list.size());
+
+                if (haveLimits)
+                    emit machineLimitsChanged(limits);
             }
         }
     }
@@ -462,6 +511,7 @@ bool GCodeGrbl::sendGcodeInternal(QString line, QString& result, bool recordResp
 
 bool GCodeGrbl::waitForOk(QString& result, int waitSec, bool sentReqForLocation, bool sentReqForParserState, bool aggressive, bool finalize)
 {
+    TRACE_SCOPE("GCodeGrbl::waitForOk");
     int okcount = 0;
 
     if (aggressive)
@@ -512,6 +562,7 @@ bool GCodeGrbl::waitForOk(QString& result, int waitSec, bool sentReqForLocation,
         {
 			QString Mes(tr("Error reading data from COM port\n"))  ;
             err(qPrintable(Mes));
+            streamStats.readRetry();
 
             if (aggressive && sendCount.size() == 0)
                 return false;
@@ -540,6 +591,7 @@ bool GCodeGrbl::waitForOk(QString& result, int waitSec, bool sentReqForLocation,
                         diag(qPrintable(tr("GOT[%d]: '%s' for '%s' (aggressive)\n")), cmdResp.line,
                              tmpTrim.toLocal8Bit().constData(), cmdResp.cmd.trimmed().toLocal8Bit().constData());
 						//diag("DG Buffer %d", sendCount.size());
+                        streamStats.lineAcked(cmdResp.sentAt, false, sendCount.size());
                         
 						emit setQueuedCommands(sendCount.size(), true);
                     }
@@ -558,6 +610,7 @@ bool GCodeGrbl::waitForOk(QString& result, int waitSec, bool sentReqForLocation,
                         diag(qPrintable(tr("GOT[%d]: '%s' for '%s' (aggressive)\n")), cmdResp.line,
                              tmpTrim.toLocal8Bit().constData(), cmdResp.cmd.trimmed().toLocal8Bit().constData());
 						//diag("DG Buffer %d", sendCount.size());
+                        streamStats.lineAcked(cmdResp.sentAt, true, sendCount.size());
                         
                         emit setQueuedCommands(sendCount.size(), true);
                     }
@@ -822,8 +875,32 @@ bool GCodeGrbl::waitForStartupBanner(QString& result, int waitSec, bool failOnNo
     return status;
 }
 
+void GCodeGrbl::fillMetrics(MachineMetrics& metrics)
+{
+    qstrncpy(metrics.state, qPrintable(lastState), METRICS_STATE_SIZE);
+    metrics.axisCount = numaxis;
+    metrics.machinePos[0] = machineCoord.x;
+    metrics.machinePos[1] = machineCoord.y;
+    metrics.machinePos[2] = machineCoord.z;
+    metrics.machinePos[3] = machineCoord.fourth;
+    metrics.workPos[0] = workCoord.x;
+    metrics.workPos[1] = workCoord.y;
+    metrics.workPos[2] = workCoord.z;
+    metrics.workPos[3] = workCoord.fourth;
+    metrics.queueDepth = sendCount.size();
+}
+
 void GCodeGrbl::parseCoordinates(const QString& received, bool aggressive)
 {
+    TRACE_SCOPE("GCodeGrbl::parseCoordinates");
+    // Counted before the aggressive throttle, every report answers a request.
+    // Grbl 0.9 reports its receive buffer use as RX:n when asked to by $10.
+    if (received.contains("MPos:"))
+    {
+        const QRegExp rxFill("RX:(\\d+)");
+        streamStats.statusReceived(rxFill.indexIn(received) != -1 ? rxFill.cap(1).toInt() : -1);
+    }
+
     if (aggressive)
     {
         int ms = parseCoordTimer.elapsed();
@@ -934,7 +1011,9 @@ void GCodeGrbl::parseCoordinates(const QString& received, bool aggressive)
         emit setLivePoint(workCoord.x, workCoord.y, controlParams.useMm, positionValid);
 		emit setLastState(state);
 
+        bool stateChanged = state != lastState;
 		lastState = state;
+        publishMetrics(stateChanged);
 		return;
 	}
     // TODO fix to print
@@ -995,9 +1074,16 @@ void GCodeGrbl::timerEvent(QTimerEvent *event)
     }
 }
 
-void GCodeGrbl::sendFile(QString path)
+void GCodeGrbl::sendFile(ParsedProgramPtr program)
 {
-    addList(QString(tr("Sending file '%1'")).arg(path));
+    TRACE_SCOPE("GCodeGrbl::sendFile");
+    if (program.isNull())
+    {
+        emit stopSending();
+        return;
+    }
+
+    addList(QString(tr("Sending file '%1'")).arg(program->path()));
 
     // send something to be sure the controller is ready
     //sendGcodeLocal("", true, SHORT_WAIT_SEC);
@@ -1008,20 +1094,15 @@ void GCodeGrbl::sendFile(QString path)
     grblFilteredCmds.clear();
     errorCount = 0;
     abortState.set(false);
-    QFile file(path);
-    if (file.open(QFile::ReadOnly))
-    {
-        float totalLineCount = 0;
-        QTextStream code(&file);
-        while ((code.atEnd() == false))
-        {
-            totalLineCount++;
-            code.readLine();
-        }
-        if (totalLineCount == 0)
-            totalLineCount = 1;
+    streamStats.start();
+    jobProgress = 0;
+    publishMetrics(true);
 
-        code.seek(0);
+    // The file was parsed when it was opened, the lines come from there
+    int lineCount = program->lineCount();
+    if (lineCount > 0)
+    {
+        float totalLineCount = lineCount;
 
         // set here once so that it doesn't change in the middle of a file send
         bool aggressive = controlParams.useAggressivePreload;
@@ -1045,51 +1126,78 @@ void GCodeGrbl::sendFile(QString path)
         int currLine = 0;
         bool xyRateSet = false;
 
+        lastLevelingPoint = Point(workCoord.x, workCoord.y, workCoord.z);
+        lastMotionMode = 0;
+        sentMotionMode = MOTION_MODE_UNKNOWN;
+        absoluteMode = true;
+        levelingXYPlane = true;
+        levelingUnknownAxes = 0;
+        levelingWarned = false;
+        lineEncoder.reset();
+
         do
         {
-            QString strline = code.readLine();
+            // Filtered lines are already without comments, in upper case and split in words
+            QString strline = controlParams.filterFileCommands ? program->words(currLine) : program->text(currLine);
 
             emit setVisCurrLine(currLine + 1);
 
-            if (controlParams.filterFileCommands)
-            {
-                trimToEnd(strline, '(');
-                trimToEnd(strline, ';');
-                trimToEnd(strline, '%');
-            }
-
-            strline = strline.trimmed();
-
             if (strline.size() == 0)
             {}//ignore comments
             else
             {
                 if (controlParams.filterFileCommands)
                 {
-                    strline = strline.toUpper();
-                    strline.replace(QRegExp("([A-Z])"), " \\1");
                     strline = removeUnsupportedCommands(strline);
                 }
 
                 if (strline.size() != 0)
                 {
-                    if (controlParams.reducePrecision)
+                    // Leveling may split the line in many segments, all of them go through the aggressive
+                    // stream like any other line, so the planner buffer stays full.
+                    QStringList levelingList;
+                    if (controlParams.useZLevelingData && !interpolator.isNull())
+                    {
+                        levelingList = levelGcodeLine(strline);
+                    }
+                    else
                     {
-                        strline = reducePrecision(strline);
+                        levelingList.append(strline);
                     }
 
                     QString rateLimitMsg;
                     QStringList outputList;
-                    if (controlParams.zRateLimit)
+                    foreach (QString levelLine, levelingList)
                     {
-                        outputList = doZRateLimit(strline, rateLimitMsg, xyRateSet);
+                        if (controlParams.reducePrecision)
+                        {
+                            levelLine = reducePrecision(levelLine);
+                        }
+
+                        if (controlParams.zRateLimit)
+                        {
+                            outputList.append(doZRateLimit(levelLine, rateLimitMsg, xyRateSet));
+                        }
+                        else
+                        {
+                            outputList.append(levelLine);
+                        }
                     }
-                    else
+
+                    if (controlParams.compactLines)
                     {
-                        outputList.append(strline);
+                        QStringList encodedList;
+                        foreach (QString outputLine, outputList)
+                        {
+                            QString encoded = lineEncoder.encode(outputLine);
+                            if (encoded.size() > 0)
+                                encodedList.append(encoded);
+                        }
+                        outputList = encodedList;
                     }
 
-                    bool ret = false;
+                    // Nothing is left to send when the encoder dropped every word
+                    bool ret = true;
                     if (outputList.size() == 1)
                     {
                         ret = sendGcodeLocal(outputList.at(0), false, -1, aggressive, currLine + 1);
@@ -1113,16 +1221,30 @@ void GCodeGrbl::sendFile(QString path)
                         abortState.set(true);
                         break;
                     }
+
+                    // The lines after a refused one were compacted as if it had run, they
+                    // can leave out a mode or a position the controller does not have
+                    if (controlParams.compactLines && errorCount > 0)
+                    {
+                        QString msg = tr("Grbl refused a compacted line, the file is stopped");
+                        err("%s", qPrintable(msg));
+                        emit sendMsg(msg);
+                        emit addList(msg);
+                        lineEncoder.reset();
+                        abortState.set(true);
+                        break;
+                    }
                 }
             }
 
             float percentComplete = (currLine * 100.0) / totalLineCount;
             setProgress((int)percentComplete);
+            jobProgress = percentComplete / 100.0;
+            publishMetrics();
 
             positionUpdate();
             currLine++;
-        } while ((code.atEnd() == false) && (!abortState.get()));
-        file.close();
+        } while ((currLine < lineCount) && (!abortState.get()));
 
         if (aggressive)
         {
@@ -1161,6 +1283,7 @@ void GCodeGrbl::sendFile(QString path)
         if (!abortState.get())
         {
             setProgress(100);
+            jobProgress = 1;
             if (errorCount > 0)
             {
                 msg = QString(tr("Code sent successfully with %1 error(s):")).arg(QString::number(errorCount));
@@ -1180,6 +1303,15 @@ void GCodeGrbl::sendFile(QString path)
                 emit addList(msg);
             }
 
+            if (controlParams.compactLines && lineEncoder.bytesIn() > 0)
+            {
+                msg = tr("Compacted lines: %1 of %2 bytes sent, %3 bytes saved")
+                        .arg(lineEncoder.bytesOut()).arg(lineEncoder.bytesIn())
+                        .arg(lineEncoder.bytesIn() - lineEncoder.bytesOut());
+                emit sendMsg(msg);
+                emit addList(msg);
+            }
+
             if (grblFilteredCmds.size() > 0)
             {
                 msg = QString(tr("Filtered %1 commands:")).arg(QString::number(grblFilteredCmds.size()));
@@ -1201,6 +1333,10 @@ void GCodeGrbl::sendFile(QString path)
         }
     }
 
+    dumpStreamStats();
+    publishMetrics(true);
+    emit sendFileEnded(!abortState.get(), errorCount);
+
     pollPosWaitForIdle(true);
 
     if (!resetState.get())
@@ -1213,6 +1349,39 @@ void GCodeGrbl::sendFile(QString path)
 
 
 
+// As after connecting to a Grbl that reports its settings with $$
+void GCodeGrbl::prepareLineSteps(const ControlParams& params, InterpolatorPtr interpolatorIn)
+{
+    GCodeController::prepareLineSteps(params, interpolatorIn);
+    doubleDollarFormat = true;
+    numaxis = controlParams.useFourAxis ? MAX_AXIS_COUNT : DEFAULT_AXIS_COUNT;
+    lineStepsXyRateSet = false;
+}
+
+QString GCodeGrbl::filterLine(const QString& line)
+{
+    QString result = removeUnsupportedCommands(line);
+    grblFilteredCmds.clear();
+    return result;
+}
+
+QString GCodeGrbl::reduceLinePrecision(const QString& line)
+{
+    return reducePrecision(line);
+}
+
+QStringList GCodeGrbl::limitLineZRate(const QString& line)
+{
+    QString msg;
+    return doZRateLimit(line, msg, lineStepsXyRateSet);
+}
+
+Coord3D GCodeGrbl::readStatusReport(const QString& report)
+{
+    parseCoordinates(report, false);
+    return workCoord;
+}
+
 QString GCodeGrbl::removeUnsupportedCommands(QString line)
 {
     QStringList components = line.split(" ", QString::SkipEmptyParts);
@@ -1284,6 +1453,7 @@ QString GCodeGrbl::removeUnsupportedCommands(QString line)
 
 QString GCodeGrbl::reducePrecision(QString line)
 {
+    TRACE_SCOPE("GCodeGrbl::reducePrecision");
     // first remove all spaces to determine what are line length is
     QStringList components = line.split(" ", QString::SkipEmptyParts);
     QString result;
@@ -1470,6 +1640,7 @@ bool GCodeGrbl::isMCommandValid(float value)
 
 QStringList GCodeGrbl::doZRateLimit(QString inputLine, QString& msg, bool& xyRateSet)
 {
+    TRACE_SCOPE("GCodeGrbl::doZRateLimit");
     // i.e.
     //G00 Z1 => G01 Z1 F100
     //G01 Z1 F260 => G01 Z1 F100
@@ -1787,6 +1958,7 @@ void GCodeGrbl::setResponseWait(ControlParams controlParamsIn)
     controlParams.useMm = oldMm;
 
     port.setCharSendDelayMs(controlParams.charSendDelayMs);
+    port.setWireTrace(controlParams.wireTraceMode, controlParams.wireTraceDir);
 
     if ((oldMm != controlParamsIn.useMm) && isPortOpen() && doubleDollarFormat)
     {
@@ -1901,24 +2073,293 @@ int GCodeGrbl::getNumaxis()
 	return numaxis;
 }
 
-void GCodeGrbl::performZLeveling(int levelingAlgorithm, QRect rect, int xSteps, int ySteps, double zStarting, double speed, double zSafe, double offset)
+// Words of a line in upper case, without comments or spaces
+static QStringList levelingWords(const QString& line)
 {
-    Q_UNUSED(levelingAlgorithm) Q_UNUSED(rect) Q_UNUSED(ySteps) Q_UNUSED(zStarting) Q_UNUSED(speed) Q_UNUSED(zSafe) Q_UNUSED(offset)
-    QString msg("Grbl gcode implementation does not support ZLeveling yet");
-    emit addList(msg);
-    emit sendMsg(msg);
+    QStringList words;
+    QString upper = line.toUpper();
+    int n = upper.size();
+    for (int i = 0; i < n; i++)
+    {
+        QChar c = upper.at(i);
+        if (c == '(')
+        {
+            while (i < n && upper.at(i) != ')')
+                i++;
+        }
+        else if (c == ';')
+        {
+            break;
+        }
+        else if (c.isLetter())
+        {
+            QString word(c);
+            while (i + 1 < n && (upper.at(i + 1).isDigit() || upper.at(i + 1) == '.'
+                                 || upper.at(i + 1) == '-' || upper.at(i + 1) == '+'))
+            {
+                word.append(upper.at(++i));
+            }
+            words.append(word);
+        }
+    }
+    return words;
+}
+
+static int levelingAxisBit(char letter)
+{
+    switch (letter)
+    {
+    case 'X':
+        return LEVEL_AXIS_X;
+    case 'Y':
+        return LEVEL_AXIS_Y;
+    case 'Z':
+        return LEVEL_AXIS_Z;
+    default:
+        return 0;
+    }
+}
+
+// Split a file line in leveled segments. Grbl accepts modal commands, so the motion mode,
+// the distance mode, the plane and the position are followed on every line, leveled or not,
+// to know what the next line means and where its move starts. A line whose start isn't
+// known is sent as it is, until absolute moves set the position again.
+QStringList GCodeGrbl::levelGcodeLine(const QString& line)
+{
+    TRACE_SCOPE("GCodeGrbl::levelGcodeLine");
+
+    QStringList words = levelingWords(line);
+
+    int motion = MOTION_MODE_UNKNOWN;   // motion word of this line
+    bool axesAreTarget = true;          // false when X Y Z are offsets or an intermediate point
+    int unknownAfter = 0;               // axes lost by this line
+    bool setsPosition = false;          // G92, the axes given become the position
+    bool machineCoords = false;         // G53, the axes given are lost
+
+    foreach (QString word, words)
+    {
+        if (word.at(0) != 'G')
+            continue;
+
+        double value = word.mid(1).toDouble();
+        int code = (int)value;
+        if (value != code)
+        {
+            // G28.1, G38.x, G43.1, G92.1 and the like, the position can't be followed
+            axesAreTarget = false;
+            unknownAfter = LEVEL_AXES_ALL;
+            // A probe is a motion mode, the next lines without G word probe too
+            if (code == 38)
+                motion = -1;
+        }
+        else if (code >= 0 && code <= 3)
+            motion = code;
+        else if (code == 80)
+            motion = -1;
+        else if (code == 90)
+            absoluteMode = true;
+        else if (code == 91)
+            absoluteMode = false;
+        else if (code == 17)
+            levelingXYPlane = true;
+        else if (code == 18 || code == 19)
+            levelingXYPlane = false;
+        else if (code == 92)
+        {
+            axesAreTarget = false;
+            setsPosition = true;
+        }
+        else if (code == 10 || code == 28 || code == 30 || (code >= 54 && code <= 59))
+        {
+            axesAreTarget = false;
+            unknownAfter = LEVEL_AXES_ALL;
+        }
+        else if (code == 53)
+            machineCoords = true;
+        else if (code == 49)
+            unknownAfter |= LEVEL_AXIS_Z;
+    }
+
+    if (motion != MOTION_MODE_UNKNOWN)
+        lastMotionMode = motion;
+
+    // The axis words of a move, with the arc words, and the ones of the line that stay as they are
+    QStringList params, head, tail, stops;
+    int axesGiven = 0;
+    bool hasRadius = false;
+    foreach (QString word, words)
+    {
+        char letter = word.at(0).toLatin1();
+        int code = (int)word.mid(1).toDouble();
+        bool motionWord = letter == 'G' && word.mid(1).toDouble() == code && code >= 0 && code <= 3;
+        if (axesAreTarget && (levelingAxisBit(letter) || letter == controlParams.fourthAxisType
+                              || letter == 'I' || letter == 'J' || letter == 'K' || letter == 'R'))
+        {
+            params.append(word);
+            axesGiven |= levelingAxisBit(letter);
+            hasRadius |= letter == 'R';
+        }
+        else if (motionWord)
+        {
+            continue;
+        }
+        else if (letter == 'M' && (code == 2 || code == 5 || code == 9 || code == 30))
+        {
+            // Grbl stops the spindle and coolant after the motion of the line
+            stops.append(word);
+        }
+        else if (params.isEmpty())
+            head.append(word);
+        else
+            tail.append(word);
+    }
+
+    if (machineCoords)
+        unknownAfter |= axesGiven;
+
+    bool move = axesAreTarget && axesGiven != 0 && lastMotionMode >= 0;
+    bool canLevel = move && absoluteMode && (lastMotionMode <= 1 || (levelingXYPlane && !hasRadius));
+
+    if (canLevel && (levelingUnknownAxes != 0 || unknownAfter != 0))
+    {
+        canLevel = false;
+        if (!levelingWarned)
+        {
+            levelingWarned = true;
+            QString msg = QString(tr("Position unknown at '%1', lines are sent without leveling until X, Y and Z are set again"))
+                    .arg(line.trimmed());
+            warn("%s", qPrintable(msg));
+            emit addList(msg);
+        }
+    }
+
+    if (!canLevel)
+    {
+        QString sent = line;
+        // The file counts on its modal motion, Grbl may be in another one after a leveled arc
+        if (move && motion == MOTION_MODE_UNKNOWN && sentMotionMode != lastMotionMode)
+            sent = QString("G%1 ").arg(lastMotionMode) + line.trimmed();
+        if (motion != MOTION_MODE_UNKNOWN || move)
+            sentMotionMode = lastMotionMode;
+
+        foreach (QString word, words)
+        {
+            char letter = word.at(0).toLatin1();
+            int bit = levelingAxisBit(letter);
+            if (bit == 0)
+                continue;
+
+            double value = word.mid(1).toDouble();
+            double *axis = bit == LEVEL_AXIS_X ? &lastLevelingPoint.x
+                                               : bit == LEVEL_AXIS_Y ? &lastLevelingPoint.y : &lastLevelingPoint.z;
+            if (setsPosition || (move && absoluteMode))
+            {
+                *axis = value;
+                levelingUnknownAxes &= ~bit;
+            }
+            else if (move)
+            {
+                *axis += value;
+            }
+        }
+        levelingUnknownAxes |= unknownAfter;
+        return QStringList(sent);
+    }
+
+    GCodeCommand *command = new GCodeCommand(lastMotionMode, params.join(" "), controlParams.fourthAxisType);
+    QList<CodeCommand*> levelingList = levelLine(command, controlParams.zLevelingOffset);
+
+    // The other words stay on the line of the first segment, the stops go on the last one
+    QStringList result;
+    for (int n = 0; n < levelingList.size(); n++)
+    {
+        QStringList out;
+        if (n == 0)
+            out << head;
+        out << levelingList.at(n)->toString().trimmed();
+        if (n == 0)
+            out << tail;
+        if (n == levelingList.size() - 1)
+            out << stops;
+        result.append(out.join(" "));
+        delete levelingList.at(n);
+    }
+
+    // Arcs are sent as G1 segments
+    sentMotionMode = lastMotionMode <= 1 ? lastMotionMode : 1;
+    return result;
 }
 
-bool GCodeGrbl::isZInterpolatorReady()
+// Parse the [PRB:x,y,z] or [PRB:x,y,z:1] report. The values are machine coordinates, zCoord is returned
+// in work coordinates.
+bool GCodeGrbl::probeResultToValue(const QString& result, double &zCoord)
 {
-    //TODO implement this when supporting z leveling.
+    if (result.contains("ALARM"))
+    {
+        return false;
+    }
+
+    QRegExp rx("\\[PRB:([^\\]:]+)(:(\\d))?\\]");
+    if (rx.indexIn(result) != -1)
+    {
+        if (rx.cap(3) == "0")
+        {
+            return false;
+        }
+
+        QStringList coords = rx.cap(1).split(",");
+        if (coords.size() >= 3)
+        {
+            bool ok = false;
+            zCoord = coords.at(2).toDouble(&ok) - probeWcoZ;
+            return ok;
+        }
+    }
     return false;
 }
 
-void GCodeGrbl::clearLevelingData()
+bool GCodeGrbl::sendProbeCommand(const QString& line, QString& result)
+{
+    return sendGcodeInternal(line, result, false, -1, false);
+}
+
+bool GCodeGrbl::prepareProbing(double zStarting, double speed)
+{
+    if (positionUpdate(true) != POS_REQ_RESULT_OK)
+    {
+        QString msg = tr("Position requests must be enabled to probe with Grbl");
+        emit addList(msg);
+        emit sendMsg(msg);
+        return false;
+    }
+    // The probe reports machine coordinates, the height map is kept in work coordinates.
+    probeWcoZ = machineCoord.z - workCoord.z;
+
+    //As in Marlin, X0 Y0 is assumed to be the starting point of the leveling. Grbl can't home Z alone, so
+    //we go up to the starting height before moving there.
+    ZProbe probe(ZProbe::FIRMWARE_GRBL, controlParams, 0);
+    sendGcodeLocal("G90");
+    sendGcodeLocal(probe.moveZCommand(zStarting));
+    sendGcodeLocal(QString("G0 X0 Y0 F").append(QString::number(speed)));
+    return true;
+}
+
+void GCodeGrbl::finishProbing(double zStarting, double speed, bool failed)
+{
+    //A failed G38.2 leaves Grbl in alarm, don't try to move it.
+    if (!failed)
+    {
+        ZProbe probe(ZProbe::FIRMWARE_GRBL, controlParams, 0);
+        sendGcodeLocal(probe.moveZCommand(zStarting));
+        sendGcodeLocal(QString("G0 X0 Y0 F").append(QString::number(speed)));
+    }
+    pollPosWaitForIdle(false);
+}
+
+void GCodeGrbl::updateProbePosition(double x, double y, double z)
 {
-    //TODO implement this when supporting z leveling.
-    return;
+    Q_UNUSED(x) Q_UNUSED(y) Q_UNUSED(z)
+    positionUpdate();
 }
 
 GCodeGrbl::PosReqStatus GCodeGrbl::positionUpdate(bool forceIfEnabled /* = false */)
@@ -20,6 +20,7 @@
 #include "rs232.h"
 #include "coord3d.h"
 #include "controlparams.h"
+#include "lineencoder.h"
 
 #define BUF_SIZE 300
 
@@ -36,6 +37,14 @@
 #define DEFAULT_AXIS_COUNT      3
 #define MAX_AXIS_COUNT          4
 
+// Axes of the leveling position, as bits of levelingUnknownAxes
+#define LEVEL_AXIS_X            1
+#define LEVEL_AXIS_Y            2
+#define LEVEL_AXIS_Z            4
+#define LEVEL_AXES_ALL          7
+
+#define MOTION_MODE_UNKNOWN     -2
+
 
 
 class GCodeGrbl : public GCodeController
@@ -52,26 +61,34 @@ public slots:
     void openPort(QString commPortStr, QString baudRate);
     void sendGcode(QString line);
     void sendGcodeAndGetResult(int id, QString line);
-    void sendFile(QString path);
+    void sendFile(ParsedProgramPtr program);
     void gotoXYZFourth(QString line);
     void axisAdj(char axis, float coord, bool inv, bool absoluteAfterAxisAdj, int sliderZCount);
     void setResponseWait(ControlParams controlParams);
     void controllerSetHome();
     void sendControllerReset();
     void sendControllerUnlock();
-    void performZLeveling(int levelingAlgorithm, QRect rect, int xSteps, int ySteps, double zStarting, double speed, double zSafe, double offset);
     void goToHome();
-    bool isZInterpolatorReady();
-    void clearLevelingData();
-    const Interpolator * getInterpolator(){ return NULL;} //TODO implement
-    void changeInterpolator(int index) {Q_UNUSED(index)}//TODO implement
-    void recomputeOffset(double speed, double zStarting) {Q_UNUSED(speed) Q_UNUSED(zStarting)}
 
 protected:
     void timerEvent(QTimerEvent *event);
     QString removeUnsupportedCommands(QString line);
+    ZProbe::Firmware probeFirmware() const { return ZProbe::FIRMWARE_GRBL; }
+    bool sendProbeCommand(const QString& line, QString& result);
+    bool probeResultToValue(const QString& result, double &zCoord);
+    bool prepareProbing(double zStarting, double speed);
+    void finishProbing(double zStarting, double speed, bool failed);
+    void updateProbePosition(double x, double y, double z);
+    void fillMetrics(MachineMetrics& metrics);
 
 private:
+    // LineSteps
+    void prepareLineSteps(const ControlParams& params, InterpolatorPtr interpolator);
+    QString filterLine(const QString& line);
+    QString reduceLinePrecision(const QString& line);
+    QStringList limitLineZRate(const QString& line);
+    Coord3D readStatusReport(const QString& report);
+
     bool sendGcodeLocal(QString line, bool recordResponseOnFail = false, int waitSec = -1, bool aggressive = false, int currLine = 0);
     bool waitForOk(QString& result, int waitCount, bool sentReqForLocation, bool sentReqForParserState, bool aggressive, bool finalize);
     bool waitForStartupBanner(QString& result, int waitSec, bool failOnNoFound);
@@ -96,14 +113,15 @@ private:
     PosReqStatus positionUpdate(bool forceIfEnabled = false);
     bool checkForGetPosStr(QString& line);
     void setLivenessState(bool valid);
+    QStringList levelGcodeLine(const QString& line);
 
 private:
 
 
-    ControlParams controlParams;
     int errorCount;
     QString currComPort;
     bool doubleDollarFormat;
+    bool numberedAxisSettings;  // 0.9 and later, $110 to $122 and $11 the junction deviation
     AtomicIntBool settingsItemCount;
     QString lastState;
     bool incorrectMeasurementUnits;
@@ -123,6 +141,16 @@ private:
     int sentI;
     int rcvdI;
     int numaxis;
+
+    int lastMotionMode;
+    int sentMotionMode;         // the one Grbl is in, leveled arcs leave it in G1
+    bool absoluteMode;
+    bool levelingXYPlane;
+    int levelingUnknownAxes;
+    bool levelingWarned;
+    double probeWcoZ;
+    LineEncoder lineEncoder;
+    bool lineStepsXyRateSet;
 };
 
 #endif // GCODE_H
@@ -10,12 +10,11 @@
  ****************************************************************/
 
 #include "gcodemarlin.h"
+#include "trace.h"
 
-#include "SpilineInterpolate3D.h"
-#include "LinearInterpolate3D.h"
-#include "SingleInterpolate.h"
 #include "basicgeometry.h"
 #include "gcommands.h"
+#include "zprobe.h"
 
 #include <QObject>
 #include <iostream>
@@ -23,21 +22,16 @@
 
 
 
-//The minimal grid size will be divided by this number to get the max segment size.
-#define SEGMENT_SIZE_DIVIDER 3
-
 #define debug(format, ...) diag("%s - " format, __FUNCTION__, ##__VA_ARGS__)
 
 GCodeMarlin::GCodeMarlin()
     : errorCount(0), doubleDollarFormat(false),
       incorrectMeasurementUnits(false), incorrectLcdDisplayUnits(false),
       sliderZCount(0),
-      interpolator(NULL),
       manualFeedSetted(false),
       numaxis(DEFAULT_AXIS_COUNT)
 {
     // use base class's timer - use it to capture random text from the controller
-    lastLevelingPoint = Point(0, 0, 0);
     startTimer(1000);
 }
 
@@ -48,9 +42,11 @@ void GCodeMarlin::openPort(QString commPortStr, QString baudRate)
     currComPort = commPortStr;
 
     port.setCharSendDelayMs(controlParams.charSendDelayMs);
+    port.setWireTrace(controlParams.wireTraceMode, controlParams.wireTraceDir);
 
     if (port.OpenComport(commPortStr, baudRate))
     {
+        publishMetrics(true);
         emit portIsOpen(true);
     }
     else
@@ -241,6 +237,7 @@ bool GCodeMarlin::checkMarlin(const QString& result)
 // Wrapped method. Should only be called from above method.
 bool GCodeMarlin::sendGcodeInternal(QString line, QString& result, bool recordResponseOnFail, int waitSec, int currLine /* = 0 */)
 {
+    TRACE_SCOPE("GCodeMarlin::sendGcodeInternal");
     if (!port.isPortOpen())
     {
         QString msg = tr("Port not available yet")  ;
@@ -283,6 +280,9 @@ bool GCodeMarlin::sendGcodeInternal(QString line, QString& result, bool recordRe
 
     int waitSecActual = waitSec == -1 ? controlParams.waitTime : waitSec;
 
+    if (sentReqForLocation)
+        streamStats.statusRequested();
+
     if (!port.SendBuf(buf, line.length()))
     {
         QString msg = tr("Sending to port failed")  ;
@@ -293,9 +293,16 @@ bool GCodeMarlin::sendGcodeInternal(QString line, QString& result, bool recordRe
     }
     else
     {
+        // One line at a time, what is in flight is this line
+        qint64 sentAt = streamStats.now();
+        if (!sentReqForLocation)
+            streamStats.lineSent(line.length(), line.length());
+
         if (!waitForOk(result, waitSecActual, sentReqForLocation, false))
         {
             diag(qPrintable(tr("WAITFOROK FAILED\n")));
+            streamStats.timeout();
+            port.wireError("Wait for ok failed");
             if (shutdownState.get())
                 return false;
 
@@ -308,12 +315,16 @@ bool GCodeMarlin::sendGcodeInternal(QString line, QString& result, bool recordRe
 
             return false;
         }
+
+        if (!sentReqForLocation)
+            streamStats.lineAcked(sentAt, result.contains(RESPONSE_ERROR), 0);
     }
     return true;
 }
 
 bool GCodeMarlin::waitForOk(QString& result, int waitSec, bool sentReqForLocation, bool finalize)
 {
+    TRACE_SCOPE("GCodeMarlin::waitForOk");
     Q_UNUSED(waitSec)
     Q_UNUSED(finalize)
 
@@ -328,6 +339,7 @@ bool GCodeMarlin::waitForOk(QString& result, int waitSec, bool sentReqForLocatio
         {
             QString Mes(tr("Error reading data from COM port\n"))  ;
             err(qPrintable(Mes));
+            streamStats.readRetry();
         }
         else if (n > 0)
         {
@@ -509,13 +521,31 @@ bool GCodeMarlin::waitForStartupBanner(QString& result, int waitSec, bool failOn
     return status;
 }
 
+// Marlin has no state in its position report and one line in flight at most
+void GCodeMarlin::fillMetrics(MachineMetrics& metrics)
+{
+    metrics.axisCount = numaxis;
+    metrics.machinePos[0] = machineCoord.x;
+    metrics.machinePos[1] = machineCoord.y;
+    metrics.machinePos[2] = machineCoord.z;
+    metrics.machinePos[3] = machineCoord.fourth;
+    metrics.workPos[0] = workCoord.x;
+    metrics.workPos[1] = workCoord.y;
+    metrics.workPos[2] = workCoord.z;
+    metrics.workPos[3] = workCoord.fourth;
+}
+
 void GCodeMarlin::parseCoordinates(const QString& received)
 {
+    TRACE_SCOPE("GCodeMarlin::parseCoordinates");
     QString format(".*X:(-*\\d+\\.\\d+) *Y:(-*\\d+\\.\\d+) *Z:(-*\\d+\\.\\d+).*");
     QRegExp rx = QRegExp(format);
 
     if (rx.indexIn(received) != -1 && rx.captureCount() > 0)
     {
+        // Marlin doesn't report its receive buffer
+        streamStats.statusReceived(-1);
+
         QStringList list = rx.capturedTexts();
 
         machineCoord.x = list.at(1).toFloat();
@@ -542,6 +572,7 @@ void GCodeMarlin::parseCoordinates(const QString& received)
 
         emit updateCoordinates(machineCoord, workCoord);
         emit setLivePoint(workCoord.x, workCoord.y, controlParams.useMm, true);//TODO revise the true. See grbl implementation.
+        publishMetrics();
     }
 }
 
@@ -594,9 +625,16 @@ void GCodeMarlin::timerEvent(QTimerEvent *event)
     }
 }
 
-void GCodeMarlin::sendFile(QString path)
+void GCodeMarlin::sendFile(ParsedProgramPtr program)
 {
-    addList(QString(tr("Sending file '%1'")).arg(path));
+    TRACE_SCOPE("GCodeMarlin::sendFile");
+    if (program.isNull())
+    {
+        emit stopSending();
+        return;
+    }
+
+    addList(QString(tr("Sending file '%1'")).arg(program->path()));
 
     //Set absolute coordinates
     sendGcodeLocal("G90\r");
@@ -609,24 +647,19 @@ void GCodeMarlin::sendFile(QString path)
     grblFilteredCmds.clear();
     errorCount = 0;
     abortState.set(false);
-    QFile file(path);
-    if (file.open(QFile::ReadOnly))
+    streamStats.start();
+    jobProgress = 0;
+    publishMetrics(true);
+
+    // The file was parsed when it was opened, the lines come from there
+    int lineCount = program->lineCount();
+    if (lineCount > 0)
     {
 
         QTime totalTime(0,0,0);
         totalTime.start();
 
-        float totalLineCount = 0;
-        QTextStream code(&file);
-        while ((code.atEnd() == false))
-        {
-            totalLineCount++;
-            code.readLine();
-        }
-        if (totalLineCount == 0)
-            totalLineCount = 1;
-
-        code.seek(0);
+        float totalLineCount = lineCount;
 
         rcvdI = 0;
         emit resetTimer(true);
@@ -636,27 +669,16 @@ void GCodeMarlin::sendFile(QString path)
 
         do
         {
-            QString strline = code.readLine();
+            //Filtered lines are already without comments, in upper case and with an space between parameters.
+            QString strline = controlParams.filterFileCommands ? program->words(currLine) : program->text(currLine);
             debug("Input line: %s", strline.toStdString().c_str());
 
             emit setVisCurrLine(currLine + 1);
 
-            if (controlParams.filterFileCommands)
-            {
-                trimToEnd(strline, '(');
-                trimToEnd(strline, ';');
-                trimToEnd(strline, '%');
-            }
-
-            strline = strline.trimmed();
-
             if (strline.size() > 0)
             {
                 if (controlParams.filterFileCommands)
                 {
-                    strline = strline.toUpper();
-                    //Add an space between parameters.
-                    strline.replace(QRegExp("([A-Z])"), " \\1");
                     strline = removeUnsupportedCommands(strline);
                 }
 
@@ -666,10 +688,10 @@ void GCodeMarlin::sendFile(QString path)
                 {
 
                     QList<CodeCommand*> levelingList;
-                    if (controlParams.useZLevelingData && interpolator != NULL)
+                    if (controlParams.useZLevelingData && !interpolator.isNull())
                     {
                         //We need to change the Z value using the interpolator
-                        levelingList = levelLine(currentCommand);
+                        levelingList = levelLine(currentCommand, controlParams.zLevelingOffset);
                     } else {
                         levelingList.append(currentCommand);
                     }
@@ -721,11 +743,11 @@ void GCodeMarlin::sendFile(QString path)
 
             float percentComplete = (currLine * 100.0) / totalLineCount;
             setProgress((int)percentComplete);
+            jobProgress = percentComplete / 100.0;
+            publishMetrics();
 
             currLine++;
-        } while ((code.atEnd() == false) && (!abortState.get()));
-
-        file.close();
+        } while ((currLine < lineCount) && (!abortState.get()));
 
         sendGcodeLocal(REQUEST_CURRENT_POS);
         emit resetTimer(false);
@@ -739,6 +761,7 @@ void GCodeMarlin::sendFile(QString path)
         if (!abortState.get())
         {
             setProgress(100);
+            jobProgress = 1;
             if (errorCount > 0)
             {
                 msg = QString(tr("Code sent successfully with %1 error(s):")).arg(QString::number(errorCount));
@@ -791,6 +814,10 @@ void GCodeMarlin::sendFile(QString path)
 
     }
 
+    dumpStreamStats();
+    publishMetrics(true);
+    emit sendFileEnded(!abortState.get(), errorCount);
+
     pollPosWaitForIdle();
 
     if (!resetState.get())
@@ -803,6 +830,7 @@ void GCodeMarlin::sendFile(QString path)
 
 CodeCommand * GCodeMarlin::makeLineMarlinFriendly(const QString &line)
 {
+    TRACE_SCOPE("GCodeMarlin::makeLineMarlinFriendly");
 
     debug("Input line: %s", line.toStdString().c_str());
 
@@ -928,223 +956,6 @@ CodeCommand * GCodeMarlin::makeLineMarlinFriendly(const QString &line)
     return m;
 }
 
-QList<CodeCommand *> GCodeMarlin::levelLine(CodeCommand* command)
-{
-    QList<CodeCommand*> resultList;
-
-    if (command->getType() == CodeCommand::G_COMMAND && (command->getCommand() == 0 || command->getCommand() == 1))
-    {
-        GCodeCommand* gCommand = static_cast<GCodeCommand*>(command);
-        Point lastPoint(lastLevelingPoint);
-
-        bool hasX, hasY, hasZ;
-        hasX = gCommand->getX(lastLevelingPoint.x);
-        hasY = gCommand->getY(lastLevelingPoint.y);
-        hasZ = gCommand->getZ(lastLevelingPoint.z);
-
-        //TODO think about what to do with the fourth axis.
-        if (!(hasX | hasY | hasZ))
-        {
-            //The command has only F or F and Fourth
-            resultList.append(command);
-            return resultList;
-        }
-
-        Point newPoint(lastLevelingPoint);
-
-        //Clear the Z component to calculate the distance between points in the XY plane only.
-        Point lastPointNoZ = lastPoint;
-        lastPointNoZ.z = 0;
-        Point newPointNoZ = newPoint;
-        newPointNoZ.z = 0;
-        double lenght = Distance(lastPointNoZ, newPointNoZ);
-
-        debug("Old point: (%.2f,%.2f,%.2f) - New Point: (%.2f,%.2f,%.2f)", lastPoint.x, lastPoint.y, lastPoint.z,
-              newPoint.x, newPoint.y, newPoint.z);
-
-        QList<Point> pointList;
-
-        double maxSegmentSize = fmin(interpolator->xGridSize(), interpolator->yGridSize()) * (1.0/SEGMENT_SIZE_DIVIDER);
-        debug("Segment size: %.3f Max segment size: %.3f", lenght, maxSegmentSize);
-        //If the distance between the old point and the new one is bigger than the threshold, split the segment.
-        if (lenght > maxSegmentSize)
-        {
-            int segmentCount = ceil(lenght / maxSegmentSize);
-            debug("Splitting segment in %d", segmentCount);
-            double segmentSize = lenght / segmentCount;
-
-            Vector d = newPoint - lastPoint;
-            d = normalize(d);
-            double delta = 0;
-
-            for(int i = 1; i<segmentCount; i++)
-            {
-                Point dst = lastPoint + d * (segmentSize*i);
-                interpolator->interpolate(dst.x, dst.y, delta);
-                dst.z += delta;
-                dst.z -= controlParams.zLevelingOffset;
-                pointList.append(dst);
-                debug("Segment intermediate point: (%.2f,%.2f,%.2f)", dst.x, dst.y, dst.z);
-            }
-        }
-
-        double delta = 0;
-        interpolator->interpolate(newPoint.x, newPoint.y, delta);
-        newPoint.z += delta;
-        newPoint.z -= controlParams.zLevelingOffset;
-
-        debug("Segment last point: (%.2f,%.2f,%.2f)",newPoint.x, newPoint.y, newPoint.z);
-
-        //Create a new command for every intermediate point.
-        Point tmpPoint;
-        foreach(tmpPoint, pointList){
-            GCodeCommand *c = new GCodeCommand(*gCommand);
-            c->setPoint(tmpPoint);
-            debug("Generated intermediate command: %s", c->toString().toStdString().c_str());
-            resultList.append(c);
-        }
-        //Lastly modify the original command with the Z and add it to the list.
-        gCommand->setPoint(newPoint);
-        debug("Generated last command: %s", gCommand->toString().toStdString().c_str());
-        resultList.append(gCommand);
-
-        debug("Generated: %d new lines", resultList.size());
-
-        return resultList;
-    } else if ((command->getType() == CodeCommand::G_COMMAND && (command->getCommand() == 2 || command->getCommand() == 3)))
-    {
-        //Algorithm extracted from Marlin firmwares
-        bool is_clockwise = false;
-        if (command->getCommand() == 2)
-        {
-            is_clockwise = true;
-        }
-
-        debug("Generating segments for an arc: Clockwise: %d", is_clockwise);
-        //Generate leveled segments for G3 and G4 arc commands.
-        GCodeCommand* gCommand = static_cast<GCodeCommand*>(command);
-        Point originPoint(lastLevelingPoint);
-
-        double origin_z = lastLevelingPoint.z;
-        originPoint.z = 0;
-
-        bool hasX, hasY, hasZ;
-        hasX = gCommand->getX(lastLevelingPoint.x);
-        hasY = gCommand->getY(lastLevelingPoint.y);
-        hasZ = gCommand->getZ(lastLevelingPoint.z);
-
-        //TODO think about what to do with the fourth axis.
-        if (!(hasX | hasY | hasZ))
-        {
-            //The command has only F or F and Fourth
-            resultList.append(command);
-            return resultList;
-        }
-        Point targetPoint(lastLevelingPoint);
-
-        targetPoint.z = 0;
-
-        double linear_travel = targetPoint.z - originPoint.z;
-
-        //Get the I and J parameters.
-        double offsetx,offsety;
-        if (!gCommand->getParameter('I', offsetx))
-            offsetx = 0.0;
-        if (!gCommand->getParameter('J', offsety))
-            offsety = 0.0;
-
-        debug("Offsets: %.3f, %.3f", offsetx, offsety);
-
-        //Calculate the arc radious from origin to center.
-        double radius = hypot(offsetx, offsety);
-        debug("Arc radius: %.3f", radius);
-
-        //We don't need to take into account the z coord.
-        Point center_point(originPoint.x + offsetx, originPoint.y + offsety, 0.0);
-
-        //Vector from center to origin
-        Vector r(-offsetx, -offsety, 0);
-//        //Vector from center to target
-        Vector rt(targetPoint - center_point);
-
-        //Angle between both previous vectors (arctan between cross and dot product(sen/cos))
-        double angular_travel = atan2(r.x*rt.y - r.y*rt.x, r.x*rt.x + r.y*rt.y);
-        if (angular_travel < 0){angular_travel += 2*M_PI;}
-        if (is_clockwise) { angular_travel -= 2*M_PI;}
-
-        debug("Arc angular travel: %.3f", angular_travel);
-
-        double millimeters_of_travel = hypot(angular_travel*radius, fabs(linear_travel));
-        debug("Linear travel: %.3f  -  Millimeters of travel: %.3f", linear_travel, millimeters_of_travel);
-
-        unsigned int segments = floor(millimeters_of_travel/MM_PER_ARC_SEGMENT);
-        debug("Segments: %d", segments);
-
-        double theta_per_segment = angular_travel/segments;
-        double linear_per_segment = linear_travel/segments;
-
-        Point arc_point;
-        double sin_Ti;
-        double cos_Ti;
-        double f;
-        bool hasf = gCommand->getF(f);
-        double delta = 0;
-        unsigned int i;
-        double z = origin_z;
-
-        //Calculate all segments but last one, as we will use the target point directly.
-        for (i = 1; i<segments; i++)
-        {
-            cos_Ti = cos(i*theta_per_segment);
-            sin_Ti = sin(i*theta_per_segment);
-            r.x = -offsetx*cos_Ti + offsety*sin_Ti;
-            r.y = -offsetx*sin_Ti - offsety*cos_Ti;
-
-            arc_point.x = center_point.x + r.x;
-            arc_point.y = center_point.y + r.y;
-            z += linear_per_segment;
-
-            interpolator->interpolate(arc_point.x, arc_point.y, delta);
-            arc_point.z = z;
-            arc_point.z += delta;
-            arc_point.z -= controlParams.zLevelingOffset;
-
-            GCodeCommand *c = new GCodeCommand(1,"");
-            c->setPoint(arc_point);
-            //Set F for the first segment.
-            if (hasf)
-            {
-                c->setF(f);
-                hasf = false;
-            }
-            debug("Generated intermediate command: %s", c->toString().toStdString().c_str());
-            resultList.append(c);
-        }
-
-        delta = 0;
-        targetPoint.z = lastLevelingPoint.z;
-        interpolator->interpolate(targetPoint.x, targetPoint.y, delta);
-        targetPoint.z += delta;
-        targetPoint.z -= controlParams.zLevelingOffset;
-
-        GCodeCommand *lastCommand = new GCodeCommand(1, "");
-        lastCommand->setPoint(targetPoint);
-        gCommand->setPoint(targetPoint);
-        if (hasf)
-        {
-            lastCommand->setF(f);
-        }
-        debug("Generated last command: %s", lastCommand->toString().toStdString().c_str());
-        resultList.append(lastCommand);
-        delete gCommand;
-        debug("Generated: %d new lines", resultList.size());
-        return resultList;
-    }
-
-    resultList.append(command);
-    return resultList;
-}
-
 void GCodeMarlin::computeCoordinates(const CodeCommand &command)
 {
     if (command.getType() == CodeCommand::G_COMMAND
@@ -1168,6 +979,24 @@ void GCodeMarlin::computeCoordinates(const CodeCommand &command)
 
 
 
+// The line as makeLineMarlinFriendly rewrites it, empty when nothing is left to send
+QString GCodeMarlin::filterLine(const QString& line)
+{
+    CodeCommand *command = makeLineMarlinFriendly(line);
+    if (command == NULL)
+        return QString();
+
+    QString result = command->toString();
+    delete command;
+    return result;
+}
+
+Coord3D GCodeMarlin::readStatusReport(const QString& report)
+{
+    parseCoordinates(report);
+    return workCoord;
+}
+
 QString GCodeMarlin::removeUnsupportedCommands(QString line)
 {
     return line;
@@ -1241,6 +1070,7 @@ QString GCodeMarlin::removeUnsupportedCommands(QString line)
 
 QString GCodeMarlin::reducePrecision(QString line)
 {
+    TRACE_SCOPE("GCodeMarlin::reducePrecision");
     // first remove all spaces to determine what are line length is
     QStringList components = line.split(" ", QString::SkipEmptyParts);
     QString result;
@@ -1423,6 +1253,7 @@ bool GCodeMarlin::isMCommandValid(float value)
 
 QStringList GCodeMarlin::doZRateLimit(QString inputLine, QString& msg, bool& xyRateSet)
 {
+    TRACE_SCOPE("GCodeMarlin::doZRateLimit");
     // i.e.
     //G00 Z1 => G01 Z1 F100
     //G01 Z1 F260 => G01 Z1 F100
@@ -1701,6 +1532,7 @@ void GCodeMarlin::setResponseWait(ControlParams controlParamsIn)
     controlParams.useMm = oldMm;
 
     port.setCharSendDelayMs(controlParams.charSendDelayMs);
+    port.setWireTrace(controlParams.wireTraceMode, controlParams.wireTraceDir);
 
     if ((oldMm != controlParamsIn.useMm) && isPortOpen() && doubleDollarFormat)
     {
@@ -1789,196 +1621,31 @@ bool GCodeMarlin::probeResultToValue(const QString & result, double &zCoord)
 }
 
 
-void GCodeMarlin::recomputeOffset(double speed, double zStarting)
+bool GCodeMarlin::sendProbeCommand(const QString& line, QString& result)
 {
-    debug("Recalculating offset");
-    if (interpolator == NULL)
-    {
-        return;
-    }
-    sendGcodeLocal("G28 Z0\r");
-    sendGcodeLocal(QString("G0 X0 Y0 F").append(QString::number(speed)).append("\r"));
-
-    //Get the first ZDepth in the 0,0 coordinate.
-    QString res;
-    double zCoord = 0.0d;
-    //Goto to Z starting point
-    sendGcodeInternal(QString("G0 Z").append(QString::number(zStarting)).append(" F200"), res, false, 0);
-
-
-    sendGcodeInternal("G30", res, false, 0);
-    debug("Result: %s", res.toStdString().c_str());
-
-    if (!probeResultToValue(res, zCoord))
-    {
-        debug("ERROR CONVERTING ZCOORDINATE");
-        return;
-    }
-
-    emit recomputeOffsetEnded(interpolator->calculateOffset(zCoord));
-    sendGcodeLocal("G28 Z0\r");
+    return sendGcodeInternal(line, result, false, 0);
 }
 
-void GCodeMarlin::performZLeveling(int levelingAlgorithm, QRect extent, int xSteps, int ySteps, double zStarting, double speed, double zSafe, double offset)
+bool GCodeMarlin::prepareProbing(double zStarting, double speed)
 {
-    debug("Starting Z Leveling procedure");
-    abortState.set(false);
-    if (interpolator != NULL)
-    {
-        delete interpolator;
-        interpolator = NULL;
-    }
-
-    double * xValues = new double[xSteps];
-    double * yValues = new double[ySteps];
-    double * zValues = new double[xSteps * ySteps];
-
-    debug("right: %d left: %d", extent.right(), extent.left());
-    debug("Bottom: %d top: %d", extent.bottom(), extent.top());
-
-    double xLenght = extent.right() - extent.left();
-    double yLenght = extent.top() - extent.bottom();
-
-    debug("xLength: %.3f yLen: %.3f", xLenght, yLenght);
-
-    double xInterval = xLenght;
-    double yInterval = yLenght;
-    if (xSteps > 1){
-        xInterval = xLenght / (xSteps - 1);
-    }
-    if (ySteps > 1){
-        yInterval = yLenght / (ySteps - 1);
-    }
-
-    debug("xInterval: %.3f yInterval: %.3f", xInterval, yInterval);
-
-    for (int i = 0; i<xSteps; i++)
-    {
-        xValues[i] = i*xInterval;
-    }
-
-    for (int j = 0; j<ySteps; j++)
-    {
-        yValues[j] = j*yInterval;
-    }
-
     //We do not have to home XY here, and we assume that the coordinates X0 and Y0 are already setted as the good starting point for the leveling.
     sendGcodeLocal("G90\r");
     sendGcodeLocal("G28 Z0\r");
     sendGcodeLocal(QString("G0 X0 Y0 F").append(QString::number(speed)).append("\r"));
-    //Get the first ZDepth in the 0,0 coordinate.
-    QString res;
-    double zCoord = 0.0d;
-    int progress = 0;
 
     //Goto to Z starting point
-    sendGcodeInternal(QString("G0 Z").append(QString::number(zStarting)).append(" F200"), res, false, 0);
-
-    double zSafeCoord = 0;
+    QString res;
+    ZProbe probe(ZProbe::FIRMWARE_MARLIN, controlParams, 0);
+    sendGcodeInternal(probe.moveZCommand(zStarting), res, false, 0);
 
     pollPosWaitForIdle();
     emit updateCoordinates(machineCoord, workCoord);
+    return true;
+}
 
-    for (int i = 0; i < xSteps; i++)
-    {
-        if (abortState.get())
-        {
-            break;
-        }
-        for (int j = 0; j < ySteps; j++)
-        {
-            if (abortState.get())
-            {
-                break;
-            }
-            debug("Probing in: %.2f-%.2f", xValues[i], yValues[j]);
-            sendGcodeInternal(QString("G1 X").
-                              append(QString::number(xValues[i])).
-                              append(" Y").
-                              append(QString::number(yValues[j])).append(" F").append(QString::number(speed)), res, false, 0);
-            machineCoord.x = xValues[i];
-            machineCoord.y = yValues[j];
-            workCoord.x = machineCoord.x;
-            workCoord.y = machineCoord.y;
-            emit updateCoordinates(machineCoord, workCoord);
-            sendGcodeInternal("G30", res, false, 0);
-            if (!probeResultToValue(res, zCoord))
-            {
-                debug("ERROR CONVERTING ZCOORDINATE AT %.2f-%.2f", xValues[i], yValues[j]);
-                return;
-            }
-            zValues[j*xSteps + i] = zCoord;
-            zSafeCoord = zCoord + zSafe;
-            machineCoord.z = zCoord;
-            workCoord.z = zCoord;
-            emit updateCoordinates(machineCoord, workCoord);
-            debug("Probe: %.2f-%.2f-%.2f", xValues[i], yValues[j], zValues[j*xSteps+i]);
-            sendGcodeInternal(QString("G1 Z").append(QString::number(zSafeCoord)).append(" F100"), res, false, 0);
-            progress++;
-            levelingProgress(progress);
-        }
-
-        i++;
-        if (i >= xSteps)
-        {
-            break;
-        }
-
-        for (int j = ySteps - 1; j >= 0; j--)
-        {
-            if (abortState.get())
-            {
-                break;
-            }
-            debug("Probing in: %.2f-%.2f", xValues[i], yValues[j]);
-            sendGcodeInternal(QString("G1 X").
-                              append(QString::number(xValues[i])).
-                              append(" Y").
-                              append(QString::number(yValues[j])).append(" F").append(QString::number(speed)), res, false, 0);
-            machineCoord.x = xValues[i];
-            machineCoord.y = yValues[j];
-            workCoord.x = machineCoord.x;
-            workCoord.y = machineCoord.y;
-            emit updateCoordinates(machineCoord, workCoord);
-            sendGcodeInternal("G30", res, false, 0);
-            if (!probeResultToValue(res, zCoord))
-            {
-                debug("ERROR CONVERTING ZCOORDINATE AT %f-%f", xValues[i], yValues[j]);
-                return;
-            }
-            zValues[j*xSteps + i] = zCoord;
-            zSafeCoord = zCoord + zSafe;
-            machineCoord.z = zCoord;
-            workCoord.z = zCoord;
-            emit updateCoordinates(machineCoord, workCoord);
-            debug("Probe: %.2f-%.2f-%.2f", xValues[i], yValues[j], zValues[j*xSteps+i]);
-            sendGcodeInternal(QString("G1 Z").append(QString::number(zSafeCoord)).append(" F100"), res, false, 0);
-            progress++;
-            levelingProgress(progress);
-        }
-    }
-
-    if (!abortState.get())
-    {
-        if (levelingAlgorithm == Interpolator::SPILINE){
-            debug("Creating spiline interpolator");
-            interpolator = new SpilineInterpolate3D(xValues, xSteps, yValues, ySteps, zValues, offset);
-        }  else if (levelingAlgorithm == Interpolator::LINEAR){
-            debug("Creating linear interpolator");
-            interpolator = new LinearInterpolate3D(xValues, xSteps, yValues, ySteps, zValues, offset);
-        } else if (levelingAlgorithm == Interpolator::SINGLE){
-            debug("Creating single touch interpolator");
-            interpolator = new SingleInterpolate(xValues[0], yValues[0], zValues[0], offset);
-        } else {
-            //TODO, Wrong interpolator selected.
-        }
-    }
-
-    delete [] xValues;
-    delete [] yValues;
-    delete [] zValues;
-
-    emit levelingEnded();
+void GCodeMarlin::finishProbing(double zStarting, double speed, bool failed)
+{
+    Q_UNUSED(zStarting) Q_UNUSED(failed)
     //Return to 0.0
     sendGcodeLocal("G28 Z0\r");
     sendGcodeLocal(QString("G0 X0 Y0 F").append(QString::number(speed)).append("\r"));
@@ -1987,49 +1654,14 @@ void GCodeMarlin::performZLeveling(int levelingAlgorithm, QRect extent, int xSte
     emit updateCoordinates(machineCoord, workCoord);
 }
 
-bool GCodeMarlin::isZInterpolatorReady()
+void GCodeMarlin::updateProbePosition(double x, double y, double z)
 {
-    return interpolator != NULL;
-}
-
-void GCodeMarlin::clearLevelingData()
-{
-    if (interpolator != NULL)
-    {
-        delete interpolator;
-        interpolator = NULL;
-    }
-}
-
-const Interpolator *GCodeMarlin::getInterpolator()
-{
-    return interpolator;
-}
-
-void GCodeMarlin::changeInterpolator(int index)
-{
-    if (interpolator == NULL) {
-        return;
-    }
-
-    if (interpolator->getType() == index)
-    {
-        return;
-    }
-
-    if (index == Interpolator::SPILINE && interpolator->getType() == Interpolator::LINEAR)
-    {
-        Interpolator * t = new SpilineInterpolate3D(interpolator);
-        delete interpolator;
-        interpolator = t;
-    } else if (index == Interpolator::LINEAR && interpolator->getType() == Interpolator::SPILINE)
-    {
-        Interpolator * t = new LinearInterpolate3D(interpolator);
-        delete interpolator;
-        interpolator = t;
-    } else {
-        debug("Interpolator change not supported. Leaving the original intact");
-    }
-
-    emit levelingEnded();
+    //Marlin does not report the position while probing, show what we know.
+    machineCoord.x = x;
+    machineCoord.y = y;
+    machineCoord.z = z;
+    workCoord.x = machineCoord.x;
+    workCoord.y = machineCoord.y;
+    workCoord.z = machineCoord.z;
+    emit updateCoordinates(machineCoord, workCoord);
 }
@@ -29,8 +29,6 @@
 #define DEFAULT_AXIS_COUNT      3
 #define MAX_AXIS_COUNT          4
 
-#define MM_PER_ARC_SEGMENT 0.5
-
 
 
 class GCodeMarlin : public GCodeController
@@ -47,26 +45,33 @@ public slots:
     void openPort(QString commPortStr, QString baudRate);
     void sendGcode(QString line);
     void sendGcodeAndGetResult(int id, QString line);
-    void sendFile(QString path);
+    void sendFile(ParsedProgramPtr program);
     void gotoXYZFourth(QString line);
     void axisAdj(char axis, float coord, bool inv, bool absoluteAfterAxisAdj, int sliderZCount);
     void setResponseWait(ControlParams controlParams);
     void controllerSetHome();
     void sendControllerReset();
     void sendControllerUnlock();
-    void performZLeveling(int levelingAlgorithm, QRect extent, int xSteps, int ySteps, double zStarting, double speed, double zSafe, double offset);
     void goToHome();
-    bool isZInterpolatorReady();
-    void clearLevelingData();
-    const Interpolator * getInterpolator();
-    void changeInterpolator(int index);
-    void recomputeOffset(double speed, double zStarting);
 
 protected:
     void timerEvent(QTimerEvent *event);
     QString removeUnsupportedCommands(QString line);
+    ZProbe::Firmware probeFirmware() const { return ZProbe::FIRMWARE_MARLIN; }
+    bool sendProbeCommand(const QString& line, QString& result);
+    bool probeResultToValue(const QString& result, double &zCoord);
+    bool prepareProbing(double zStarting, double speed);
+    void finishProbing(double zStarting, double speed, bool failed);
+    void updateProbePosition(double x, double y, double z);
+    void fillMetrics(MachineMetrics& metrics);
 
 private:
+    // LineSteps, Marlin sends the lines without reducing their precision or the Z rate
+    QString filterLine(const QString& line);
+    QString reduceLinePrecision(const QString& line) { return line; }
+    QStringList limitLineZRate(const QString& line) { return QStringList(line); }
+    Coord3D readStatusReport(const QString& report);
+
     bool sendGcodeLocal(QString line, bool recordResponseOnFail = false, int waitSec = -1, int currLine = 0);
     bool waitForOk(QString& result, int waitCount, bool sentReqForLocation, bool finalize);
     bool waitForStartupBanner(QString& result, int waitSec, bool failOnNoFound);
@@ -75,7 +80,6 @@ private:
     bool isGCommandValid(float value, bool& toEndOfLine);
     bool isMCommandValid(float value);
     CodeCommand *makeLineMarlinFriendly(const QString& line);
-    QList<CodeCommand *> levelLine(CodeCommand *line);
 
     bool SendJog(QString strline, bool absoluteAfterAxisAdj);
     void parseCoordinates(const QString& received);
@@ -89,12 +93,9 @@ private:
     bool checkMarlin(const QString& result);
     void computeCoordinates(const CodeCommand &command);
 
-    bool probeResultToValue(const QString & result, double &zCoord);
-
 private:
 
 
-    ControlParams controlParams;
     int errorCount;
     QString currComPort;
     bool doubleDollarFormat;
@@ -104,14 +105,11 @@ private:
     Coord3D machineCoord, workCoord;
     Coord3D machineCoordLastIdlePos, workCoordLastIdlePos;
     QList<CmdResponse> sendCount;
-    Point lastLevelingPoint;
 
     int sliderZCount;
     QStringList grblCmdErrors;
     QStringList grblFilteredCmds;
 
-    Interpolator * interpolator;
-
     float lastExplicitFeed;
     bool manualFeedSetted;
     int lastGCommand;
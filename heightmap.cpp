@@ -0,0 +1,48 @@
+/****************************************************************
+ * heightmap.cpp
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#include "heightmap.h"
+
+HeightMap::HeightMap(const double * xIn, unsigned int xCount, const double * yIn, unsigned int yCount, const double * zIn, double offset)
+    : nValuesX(xCount), nValuesY(yCount), initialOffset(offset)
+{
+    // One buffer for the three arrays, laid out like the height map file.
+    storage.resize(nValuesX + nValuesY + nValuesX * nValuesY);
+    double *data = storage.data();
+
+    for (unsigned int i = 0; i < nValuesX; i++)
+        data[i] = xIn[i];
+    for (unsigned int j = 0; j < nValuesY; j++)
+        data[nValuesX + j] = yIn[j];
+    for (unsigned int k = 0; k < nValuesX * nValuesY; k++)
+        data[nValuesX + nValuesY + k] = zIn[k];
+
+    xValues = data;
+    yValues = xValues + nValuesX;
+    xyValues = yValues + nValuesY;
+
+    computeStats();
+}
+
+void HeightMap::computeStats()
+{
+    unsigned int count = nValuesX * nValuesY;
+
+    zMin = xyValues[0];
+    zMax = xyValues[0];
+    median = 0;
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        if (xyValues[i] < zMin) zMin = xyValues[i];
+        if (xyValues[i] > zMax) zMax = xyValues[i];
+        median += xyValues[i];
+    }
+
+    median /= count;
+}
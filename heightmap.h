@@ -0,0 +1,64 @@
+/****************************************************************
+ * heightmap.h
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#ifndef HEIGHTMAP_H
+#define HEIGHTMAP_H
+
+#include <QSharedPointer>
+#include <QVector>
+
+/**
+ * @brief Probed Z data of a leveling grid.
+ *
+ * The object is immutable once built, so it is shared through HeightMapPtr by
+ * the interpolators, the render thread and the controller thread without any
+ * locking. A new probe or a correction builds a new map, whoever still holds
+ * the old one keeps using it until it releases the pointer.
+ */
+class HeightMap
+{
+public:
+    /**
+     * @brief Builds a map with a copy of the given arrays.
+     * The Z values are rows first, xCount * yCount values.
+     */
+    HeightMap(const double * xValues, unsigned int xCount, const double * yValues, unsigned int yCount, const double * zValues, double offset);
+
+    unsigned int getXSteps() const { return nValuesX; }
+    unsigned int getYSteps() const { return nValuesY; }
+
+    const double * getXValues() const { return xValues; }
+    const double * getYValues() const { return yValues; }
+    const double * getXYValues() const { return xyValues; }
+
+    double getInitialOffset() const { return initialOffset; }
+    double getMinZValue() const { return zMin; }
+    double getMaxZValue() const { return zMax; }
+    double getMedian() const { return median; }
+
+private:
+    Q_DISABLE_COPY(HeightMap)
+
+    void computeStats();
+
+    QVector<double> storage;
+
+    const double * xValues;
+    const double * yValues;
+    const double * xyValues;
+    unsigned int nValuesX;
+    unsigned int nValuesY;
+    double initialOffset;
+    double zMin;
+    double zMax;
+    double median;
+};
+
+typedef QSharedPointer<const HeightMap> HeightMapPtr;
+
+#endif // HEIGHTMAP_H
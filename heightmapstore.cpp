@@ -0,0 +1,157 @@
+/****************************************************************
+ * heightmapstore.cpp
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#include "heightmapstore.h"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QDir>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QObject>
+
+bool HeightMapStore::save(const QString& path, const Interpolator *interpolator, QString& error)
+{
+    if (interpolator == NULL)
+    {
+        error = QObject::tr("There is no height map to save");
+        return false;
+    }
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    // Written aside and renamed over the old file, so a map saved over itself, or a
+    // write that fails half way, never leaves a truncated file behind
+    QSaveFile file(path);
+    if (!file.open(QFile::WriteOnly))
+    {
+        error = file.errorString();
+        return false;
+    }
+
+    HeightMapHeader header;
+    header.magic = HEIGHTMAP_MAGIC;
+    header.version = HEIGHTMAP_VERSION;
+    header.type = interpolator->getType();
+    header.xSteps = interpolator->getXSteps();
+    header.ySteps = interpolator->getYSteps();
+    header.reserved = 0;
+    header.offset = interpolator->getInitialOffset();
+    header.timestamp = QDateTime::currentMSecsSinceEpoch();
+
+    qint64 xSize = header.xSteps * sizeof(double);
+    qint64 ySize = header.ySteps * sizeof(double);
+    qint64 zSize = header.xSteps * header.ySteps * sizeof(double);
+
+    bool ok = file.write((const char *)&header, sizeof(header)) == sizeof(header)
+            && file.write((const char *)interpolator->getXValues(), xSize) == xSize
+            && file.write((const char *)interpolator->getYValues(), ySize) == ySize
+            && file.write((const char *)interpolator->getXYValues(), zSize) == zSize;
+
+    if (!ok || !file.commit())
+    {
+        error = file.errorString();
+        file.cancelWriting();
+        return false;
+    }
+    return true;
+}
+
+HeightMapPtr HeightMapStore::load(const QString& path, int& type, QDateTime& timestamp, QString& error)
+{
+    QFile file(path);
+    if (!file.open(QFile::ReadOnly))
+    {
+        error = file.errorString();
+        return HeightMapPtr();
+    }
+
+    qint64 size = file.size();
+    if (size < (qint64)sizeof(HeightMapHeader))
+    {
+        error = QObject::tr("Not a height map file");
+        return HeightMapPtr();
+    }
+
+    // Mapped only while the values are copied out, the file may be saved over while the map is in use
+    uchar *data = file.map(0, size);
+    if (data == NULL)
+    {
+        error = file.errorString();
+        return HeightMapPtr();
+    }
+
+    HeightMapPtr map;
+    const HeightMapHeader *header = reinterpret_cast<const HeightMapHeader *>(data);
+    qint64 expected = sizeof(HeightMapHeader)
+            + (header->xSteps + header->ySteps + (qint64)header->xSteps * header->ySteps) * sizeof(double);
+    if (header->magic != HEIGHTMAP_MAGIC || header->version != HEIGHTMAP_VERSION)
+    {
+        error = QObject::tr("Not a height map file or unsupported version");
+    }
+    else if (header->xSteps == 0 || header->ySteps == 0 || size != expected)
+    {
+        error = QObject::tr("Height map file is truncated");
+    }
+    else if (header->type != Interpolator::SPILINE && header->type != Interpolator::LINEAR && header->type != Interpolator::SINGLE)
+    {
+        error = QObject::tr("Unknown interpolator in height map file");
+    }
+    else
+    {
+        type = header->type;
+        timestamp = QDateTime::fromMSecsSinceEpoch(header->timestamp);
+
+        const double *xValues = reinterpret_cast<const double *>(data + sizeof(HeightMapHeader));
+        const double *yValues = xValues + header->xSteps;
+        const double *zValues = yValues + header->ySteps;
+        map = HeightMapPtr(new HeightMap(xValues, header->xSteps, yValues, header->ySteps, zValues, header->offset));
+    }
+
+    file.unmap(data);
+    return map;
+}
+
+QString HeightMapStore::libraryPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::DataLocation)
+            + QDir::separator() + HEIGHTMAP_LIBRARY_DIR;
+}
+
+QStringList HeightMapStore::fixtures()
+{
+    QStringList list;
+    QDir dir(libraryPath());
+    QFileInfoList files = dir.entryInfoList(QStringList(QString("*") + HEIGHTMAP_EXTENSION), QDir::Files, QDir::Name);
+    foreach (QFileInfo info, files)
+    {
+        list.append(info.completeBaseName());
+    }
+    return list;
+}
+
+bool HeightMapStore::isValidFixtureName(const QString& fixture)
+{
+    if (fixture.isEmpty() || fixture.startsWith('.'))
+        return false;
+
+    foreach (QChar c, fixture)
+    {
+        if (c == '/' || c == '\\' || c == ':' || c.category() == QChar::Other_Control)
+            return false;
+    }
+    return true;
+}
+
+QString HeightMapStore::fixturePath(const QString& fixture)
+{
+    if (!isValidFixtureName(fixture))
+        return QString();
+
+    return libraryPath() + QDir::separator() + fixture + HEIGHTMAP_EXTENSION;
+}
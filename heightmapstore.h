@@ -0,0 +1,63 @@
+/****************************************************************
+ * heightmapstore.h
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#ifndef HEIGHTMAPSTORE_H
+#define HEIGHTMAPSTORE_H
+
+#include <QString>
+#include <QStringList>
+#include <QDateTime>
+#include "interpolator.h"
+
+#define HEIGHTMAP_MAGIC         0x50414d48 // "HMAP" read as little endian
+#define HEIGHTMAP_VERSION       1
+#define HEIGHTMAP_EXTENSION     ".hmap"
+#define HEIGHTMAP_LIBRARY_DIR   "heightmaps"
+
+/**
+ * @brief On disk header of a height map. It is followed by xSteps X values,
+ * ySteps Y values and xSteps*ySteps Z values (rows first), all as doubles, the
+ * same layout as the storage of HeightMap.
+ */
+struct HeightMapHeader
+{
+    quint32 magic;
+    quint32 version;
+    quint32 type;
+    quint32 xSteps;
+    quint32 ySteps;
+    quint32 reserved;
+    double offset;
+    qint64 timestamp; // msecs since epoch, UTC
+};
+
+/**
+ * @brief Saves and loads probed height maps, and keeps a library of them, one
+ * per fixture, in the application data directory.
+ */
+class HeightMapStore
+{
+public:
+    static bool save(const QString& path, const Interpolator *interpolator, QString& error);
+
+    /**
+     * @brief Loads the height map in path, the values are copied so the file is free again.
+     * @param type Set to the interpolator the map was saved with.
+     * @return The map, or a null pointer on failure.
+     */
+    static HeightMapPtr load(const QString& path, int& type, QDateTime& timestamp, QString& error);
+
+    static QString libraryPath();
+    static QStringList fixtures();
+    // A fixture name is a file name in the library, without path separators or a leading dot
+    static bool isValidFixtureName(const QString& fixture);
+    // Empty for an invalid fixture name
+    static QString fixturePath(const QString& fixture);
+};
+
+#endif // HEIGHTMAPSTORE_H
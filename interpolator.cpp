@@ -7,6 +7,20 @@
  *
  */
 
+Interpolator::Interpolator(HeightMapPtr heightMap)
+    : map(heightMap)
+{
+    xValues = map->getXValues();
+    yValues = map->getYValues();
+    xyValues = map->getXYValues();
+    nValuesX = map->getXSteps();
+    nValuesY = map->getYSteps();
+    initialOffset = map->getInitialOffset();
+    zMin = map->getMinZValue();
+    zMax = map->getMaxZValue();
+    median = map->getMedian();
+}
+
 double Interpolator::normaliceValue(double min, double max, double value) const
 {
     return (value - min) / (max - min);
@@ -30,20 +44,20 @@ double Interpolator::getYValue(int index) const
     return 0;
 }
 
-double Interpolator::calculateOffset(double newZValue)
+double Interpolator::calculateOffset(double newZValue) const
 {
     double initialValue = xyValues[0]; //Original Z value at (0,0);
     return initialValue - newZValue + initialOffset;
 }
 
-double Interpolator::yGridSize()
+double Interpolator::yGridSize() const
 {
     if (nValuesY > 1)
         return yValues[1] - yValues[0];
     return 0;
 }
 
-double Interpolator::xGridSize()
+double Interpolator::xGridSize() const
 {
     if (nValuesX > 1)
         return xValues[1] - xValues[0];
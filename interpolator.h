@@ -8,6 +8,15 @@
  *
  */
 
+#include "heightmap.h"
+
+#include <QMetaType>
+
+/**
+ * Interpolators are views over a shared HeightMap, they don't own or copy the
+ * probed data, so changing the algorithm only creates a new view. They are
+ * never modified after construction and can be sampled from any thread.
+ */
 class Interpolator
 {
 
@@ -97,30 +106,39 @@ public:
      */
     const double * getXYValues() const {return xyValues; }
 
+    /**
+     * @brief getHeightMap Returns the probed data this interpolator works on.
+     * @return
+     */
+    HeightMapPtr getHeightMap() const { return map; }
+
     /**
      * @brief xGridSize Size between probing points in the X axis.
      * @return
      */
-    double xGridSize();
+    double xGridSize() const;
 
     /**
      * @brief yGridSize Size between probing points in the Y axis.
      * @return
      */
-    double yGridSize();
+    double yGridSize() const;
 
     /**
      * @brief calculateOffset Calculate a new offset using the original Z data in the (0,0), the original offset and the new Z value in the (0,0).
      * @param newZValue New Z value in the (0,0) coordinate.
      * @return
      */
-    double calculateOffset(double newZValue);
+    double calculateOffset(double newZValue) const;
 
 protected:
+    Interpolator(HeightMapPtr map);
+
     double normaliceValue(double min, double max, double value) const;
-    double * xValues;
-    double * yValues;
-    double *  xyValues;
+    HeightMapPtr map;
+    const double * xValues;
+    const double * yValues;
+    const double * xyValues;
     double initialOffset;
     double zMin;
     double zMax;
@@ -129,4 +147,8 @@ protected:
     unsigned int nValuesY;
 };
 
+typedef QSharedPointer<const Interpolator> InterpolatorPtr;
+
+Q_DECLARE_METATYPE(InterpolatorPtr)
+
 #endif // INTERPOLATOR_H
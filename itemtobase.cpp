@@ -26,3 +26,19 @@ double ItemToBase::screenY(double fy)
 {
     return height - ((fy * scale) + offsety);
 }
+
+double ItemToBase::segmentDistance(double x, double y, double x1, double y1, double x2, double y2)
+{
+    double dx = x2 - x1;
+    double dy = y2 - y1;
+    double len2 = dx * dx + dy * dy;
+    double t = 0;
+    if (len2 > 0)
+    {
+        t = ((x - x1) * dx + (y - y1) * dy) / len2;
+        t = qBound(0.0, t, 1.0);
+    }
+    double px = x1 + t * dx - x;
+    double py = y1 + t * dy - y;
+    return qSqrt(px * px + py * py);
+}
@@ -1,6 +1,7 @@
 #ifndef ITEMTOBASE_H
 #define ITEMTOBASE_H
 #include <QPainter>
+#include <QtCore>
 #include "stdio.h"
 #include "positem.h"
 
@@ -19,11 +20,16 @@ public:
     virtual double getXRaw() = 0;
     virtual double getYRaw() = 0;
 
+    // Distance from (x,y) to the drawn item, fromX/fromY is where the previous item ended
+    virtual double distanceTo(double x, double y, double fromX, double fromY) = 0;
+
     void setParams(double scale, double height, double offsetx, double offsety);
 
     double screenX(double x);
     double screenY(double y);
 
+    static double segmentDistance(double x, double y, double x1, double y1, double x2, double y2);
+
     int getIndex() { return index; }
 
 protected:
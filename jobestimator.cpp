@@ -0,0 +1,352 @@
+/****************************************************************
+ * jobestimator.cpp
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#include "jobestimator.h"
+#include "definitions.h"
+#include "trace.h"
+
+#include <math.h>
+
+#define PLANNER_EPSILON     1e-9
+#define ARC_ANGULAR_EPSILON 5e-7    // rad, as in Grbl
+
+JobEstimate::JobEstimate(const QVector<double>& lineTimes)
+{
+    lineEnds.resize(lineTimes.size());
+    double total = 0;
+    for (int n = 0; n < lineTimes.size(); n++)
+    {
+        total += lineTimes.at(n);
+        lineEnds[n] = total;
+    }
+}
+
+double JobEstimate::elapsedAt(int lines) const
+{
+    if (lines <= 0)
+        return 0;
+    if (lines > lineEnds.size())
+        return totalTime();
+    return lineEnds.at(lines - 1);
+}
+
+double JobEstimate::remaining(int lines, double elapsed) const
+{
+    double predicted = elapsedAt(lines);
+    double left = totalTime() - predicted;
+
+    // Early on the start up and the sender buffering weigh too much to trust the ratio
+    if (predicted >= ESTIMATE_MIN_CORRECTION && elapsed > 0)
+    {
+        double ratio = elapsed / predicted;
+        if (ratio > ESTIMATE_MAX_CORRECTION)
+            ratio = ESTIMATE_MAX_CORRECTION;
+        else if (ratio < 1.0 / ESTIMATE_MAX_CORRECTION)
+            ratio = 1.0 / ESTIMATE_MAX_CORRECTION;
+        left *= ratio;
+    }
+
+    return left > 0 ? left : 0;
+}
+
+JobEstimator::JobEstimator()
+{
+}
+
+void JobEstimator::estimateProgram(ParsedProgramPtr program, MachineLimits limits, int generation)
+{
+    TRACE_SCOPE("JobEstimator::estimateProgram");
+    if (program.isNull())
+        return;
+
+    emit estimateReady(JobEstimatePtr(estimate(*program, limits)), generation);
+}
+
+JobEstimate *JobEstimator::estimate(const ParsedProgram& program, const MachineLimits& limits)
+{
+    int lines = program.lineCount();
+    Planner planner(limits, lines);
+    for (int n = 0; n < lines; n++)
+    {
+        if (program.hasWords(n))
+            planner.parseLine(program.wordsRef(n), n);
+    }
+
+    QVector<double> lineTimes(lines, 0.0);
+    planner.plan(lineTimes);
+    return new JobEstimate(lineTimes);
+}
+
+JobEstimator::Planner::Planner(const MachineLimits& limitsIn, int lines)
+    : limits(limitsIn), hasPrev(false)
+{
+    blocks.reserve(lines);
+    for (int i = 0; i < LIMITS_AXIS_COUNT; i++)
+    {
+        position[i] = 0;
+        prevUnit[i] = 0;
+    }
+}
+
+void JobEstimator::Planner::parseLine(const QLatin1String& words, int line)
+{
+    ModalWalker::Line parsed;
+    walker.read(words, parsed);
+
+    if (parsed.hasCode(40))
+        addDwell(parsed.p, line);
+
+    // Probing stops wherever it touches, the others go to places the file does not give
+    bool noMove = parsed.hasCode(280) || parsed.hasCode(300) || parsed.hasCode(530)
+            || parsed.hasCode(100) || parsed.hasCode(920);
+    if (!parsed.hasAxes() || noMove || walker.motion == MODAL_MOTION_OTHER)
+        return;
+
+    double target[LIMITS_AXIS_COUNT];
+    double offset[LIMITS_AXIS_COUNT];
+    double scale = walker.mm ? 1.0 : MM_IN_AN_INCH;
+    for (int i = 0; i < LIMITS_AXIS_COUNT; i++)
+    {
+        if (!parsed.hasAxis[i])
+            target[i] = position[i];
+        else if (walker.absolute)
+            target[i] = parsed.target[i] * scale;
+        else
+            target[i] = position[i] + parsed.target[i] * scale;
+        offset[i] = parsed.offset[i] * scale;
+    }
+
+    // Arcs out of the XY plane are timed as the straight move
+    if ((walker.motion == 2 || walker.motion == 3) && walker.plane == 170)
+        addArc(target, offset, parsed.hasRadius, parsed.radius * scale, line);
+    else
+        addMove(target, line);
+}
+
+void JobEstimator::Planner::addMove(const double *target, int line)
+{
+    double length = 0;
+    for (int i = 0; i < LIMITS_AXIS_COUNT; i++)
+        length += (target[i] - position[i]) * (target[i] - position[i]);
+    length = sqrt(length);
+
+    addSegment(target, segmentFeed(length), walker.motion == 0, line);
+}
+
+// Same geometry as Grbl's mc_arc(), only in the XY plane
+void JobEstimator::Planner::addArc(const double *target, const double *offset, bool hasRadius, double radius, int line)
+{
+    bool clockwise = walker.motion == 2;
+    double centerOffset[2] = { offset[0], offset[1] };
+
+    if (hasRadius)
+    {
+        double x = target[0] - position[0];
+        double y = target[1] - position[1];
+        double h = 4.0 * radius * radius - x * x - y * y;
+        if (h < 0 || (x == 0 && y == 0))
+        {
+            addMove(target, line);
+            return;
+        }
+        h = -sqrt(h) / sqrt(x * x + y * y);
+        if (!clockwise)
+            h = -h;
+        if (radius < 0)
+        {
+            h = -h;
+            radius = -radius;
+        }
+        centerOffset[0] = 0.5 * (x - y * h);
+        centerOffset[1] = 0.5 * (y + x * h);
+    }
+
+    double center[2] = { position[0] + centerOffset[0], position[1] + centerOffset[1] };
+    double r0 = -centerOffset[0];
+    double r1 = -centerOffset[1];
+    double rt0 = target[0] - center[0];
+    double rt1 = target[1] - center[1];
+    double arcRadius = sqrt(r0 * r0 + r1 * r1);
+
+    double travel = atan2(r0 * rt1 - r1 * rt0, r0 * rt0 + r1 * rt1);
+    if (clockwise)
+    {
+        if (travel >= -ARC_ANGULAR_EPSILON)
+            travel -= 2 * M_PI;
+    }
+    else
+    {
+        if (travel <= ARC_ANGULAR_EPSILON)
+            travel += 2 * M_PI;
+    }
+
+    double height = target[2] - position[2];
+    double planar = travel * arcRadius;
+    double length = sqrt(planar * planar + height * height);
+    double arcFeed = segmentFeed(length);
+
+    int segments = 0;
+    if (arcRadius > ESTIMATE_ARC_TOLERANCE)
+        segments = (int)floor(fabs(0.5 * planar) / sqrt(ESTIMATE_ARC_TOLERANCE * (2 * arcRadius - ESTIMATE_ARC_TOLERANCE)));
+
+    double start[LIMITS_AXIS_COUNT] = { position[0], position[1], position[2] };
+    for (int s = 1; s < segments; s++)
+    {
+        double angle = travel * s / segments;
+        double point[LIMITS_AXIS_COUNT];
+        point[0] = center[0] + r0 * cos(angle) - r1 * sin(angle);
+        point[1] = center[1] + r0 * sin(angle) + r1 * cos(angle);
+        point[2] = start[2] + height * s / segments;
+        addSegment(point, arcFeed, false, line);
+    }
+
+    addSegment(target, arcFeed, false, line);
+}
+
+// Feed in mm/sec for a move of the given length, 0 when there is none
+double JobEstimator::Planner::segmentFeed(double length) const
+{
+    double scale = walker.mm ? 1.0 : MM_IN_AN_INCH;
+
+    // In G93 F is how many times per minute the whole move could be done
+    if (walker.inverseTime)
+        return walker.feed * length / 60.0;
+    return walker.feed * scale / 60.0;
+}
+
+void JobEstimator::Planner::addSegment(const double *target, double feedRate, bool rapid, int line)
+{
+    double delta[LIMITS_AXIS_COUNT];
+    double length = 0;
+    for (int i = 0; i < LIMITS_AXIS_COUNT; i++)
+    {
+        delta[i] = target[i] - position[i];
+        length += delta[i] * delta[i];
+        position[i] = target[i];
+    }
+    length = sqrt(length);
+    if (length < PLANNER_EPSILON)
+        return;
+
+    // Like Grbl, the speed and acceleration along the move are capped so no axis goes over its own
+    double unit[LIMITS_AXIS_COUNT];
+    double speed = (rapid || feedRate <= 0) ? HUGE_VAL : feedRate;
+    double accel = HUGE_VAL;
+    for (int i = 0; i < LIMITS_AXIS_COUNT; i++)
+    {
+        unit[i] = delta[i] / length;
+        double component = fabs(unit[i]);
+        if (component > PLANNER_EPSILON)
+        {
+            speed = qMin(speed, limits.maxRate[i] / 60.0 / component);
+            accel = qMin(accel, limits.acceleration[i] / component);
+        }
+    }
+
+    Block block;
+    block.length = length;
+    block.nominal2 = speed * speed;
+    block.accel = accel;
+    block.dwell = 0;
+    block.line = line;
+    block.junction2 = 0;
+
+    if (hasPrev)
+    {
+        double cosTheta = 0;
+        for (int i = 0; i < LIMITS_AXIS_COUNT; i++)
+            cosTheta -= prevUnit[i] * unit[i];
+
+        // A full reversal stops, otherwise the speed that keeps the path within the junction deviation
+        if (cosTheta < 0.999999)
+        {
+            if (cosTheta < -0.999999)
+                block.junction2 = HUGE_VAL;
+            else
+            {
+                double sinHalf = sqrt(0.5 * (1.0 - cosTheta));
+                block.junction2 = accel * limits.junctionDeviation * sinHalf / (1.0 - sinHalf);
+            }
+            block.junction2 = qMin(block.junction2, qMin(block.nominal2, blocks.last().nominal2));
+        }
+    }
+
+    for (int i = 0; i < LIMITS_AXIS_COUNT; i++)
+        prevUnit[i] = unit[i];
+    hasPrev = true;
+
+    blocks.append(block);
+}
+
+// G4 waits for the buffer to empty, so it also stops the machine
+void JobEstimator::Planner::addDwell(double secs, int line)
+{
+    Block block;
+    block.length = 0;
+    block.nominal2 = 0;
+    block.junction2 = 0;
+    block.accel = 0;
+    block.dwell = secs;
+    block.line = line;
+    blocks.append(block);
+
+    hasPrev = false;
+}
+
+void JobEstimator::Planner::plan(QVector<double>& lineTimes) const
+{
+    int count = blocks.size();
+    double entry2 = 0;
+
+    for (int k = 0; k < count; k++)
+    {
+        const Block& block = blocks.at(k);
+        if (block.length == 0)
+        {
+            lineTimes[block.line] += block.dwell;
+            entry2 = 0;
+            continue;
+        }
+
+        // Highest exit speed with only the next blocks in the buffer and a stop after the last one
+        double exit2 = 0;
+        int last = qMin(k + ESTIMATE_PLANNER_BLOCKS - 1, count - 1);
+        for (int j = last; j > k; j--)
+        {
+            const Block& next = blocks.at(j);
+            exit2 = qMin(next.junction2, exit2 + 2 * next.accel * next.length);
+        }
+
+        entry2 = qMin(entry2, block.junction2);
+        exit2 = qMin(exit2, entry2 + 2 * block.accel * block.length);
+
+        lineTimes[block.line] += blockTime(block, entry2, exit2);
+        entry2 = exit2;
+    }
+}
+
+double JobEstimator::blockTime(const Block& block, double entry2, double exit2)
+{
+    double a = block.accel;
+    double d = block.length;
+    double entry = sqrt(entry2);
+    double exit = sqrt(exit2);
+
+    double accelDistance = (block.nominal2 - entry2) / (2 * a);
+    double decelDistance = (block.nominal2 - exit2) / (2 * a);
+    if (accelDistance + decelDistance <= d)
+    {
+        double nominal = sqrt(block.nominal2);
+        return (nominal - entry) / a + (nominal - exit) / a + (d - accelDistance - decelDistance) / nominal;
+    }
+
+    // Never reaches the nominal speed, accelerates up to a peak and brakes right away
+    double peak = sqrt((2 * a * d + entry2 + exit2) / 2);
+    peak = qMax(peak, qMax(entry, exit));
+    return (peak - entry) / a + (peak - exit) / a;
+}
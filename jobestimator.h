@@ -0,0 +1,120 @@
+/****************************************************************
+ * jobestimator.h
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#ifndef JOBESTIMATOR_H
+#define JOBESTIMATOR_H
+
+#include <QObject>
+#include <QVector>
+#include <QSharedPointer>
+#include <QMetaType>
+#include "parsedprogram.h"
+#include "machinelimits.h"
+#include "modalwalker.h"
+
+#define ESTIMATE_PLANNER_BLOCKS     15      // Grbl plans 16 blocks, one of them is the one running
+#define ESTIMATE_ARC_TOLERANCE      0.002   // mm, Grbl $12 default
+#define ESTIMATE_MIN_CORRECTION     30.0    // secs of predicted run before the ETA is corrected with the real one
+#define ESTIMATE_MAX_CORRECTION     3.0
+
+/**
+ * @brief Predicted run time of a program, line by line.
+ */
+class JobEstimate
+{
+public:
+    JobEstimate(const QVector<double>& lineTimes);
+
+    double totalTime() const { return lineEnds.isEmpty() ? 0 : lineEnds.last(); }
+    int lineCount() const { return lineEnds.size(); }
+
+    // Time spent in the line, 0 based
+    double lineTime(int n) const { return elapsedAt(n + 1) - elapsedAt(n); }
+
+    // Predicted time once the first lines are done
+    double elapsedAt(int lines) const;
+
+    /**
+     * @brief Time left once the first lines are done. After a while the prediction
+     * is scaled by how far the real run is from it so far.
+     */
+    double remaining(int lines, double elapsed) const;
+
+private:
+    QVector<double> lineEnds;
+};
+
+typedef QSharedPointer<const JobEstimate> JobEstimatePtr;
+
+Q_DECLARE_METATYPE(JobEstimatePtr)
+
+/**
+ * @brief Simulates Grbl's planner over a parsed program to tell how long it runs.
+ *
+ * Every move becomes a block limited by the feed, the max rate and the
+ * acceleration of the axes it uses, arcs are split in segments the way
+ * Grbl does and corners slow down as set by the junction deviation. Like
+ * Grbl each block is planned only with the ones behind it in the planner
+ * buffer, with the machine stopping at the end of the buffer, so short
+ * segments run slower than their feed. Blocks are then timed as trapezoids.
+ */
+class JobEstimator : public QObject
+{
+    Q_OBJECT
+public:
+    JobEstimator();
+
+    static JobEstimate *estimate(const ParsedProgram& program, const MachineLimits& limits);
+
+signals:
+    void estimateReady(JobEstimatePtr estimate, int generation);
+
+public slots:
+    void estimateProgram(ParsedProgramPtr program, MachineLimits limits, int generation);
+
+private:
+    struct Block
+    {
+        double length;
+        double nominal2;    // squared speeds, mm/sec
+        double junction2;
+        double accel;
+        double dwell;
+        int line;
+    };
+
+    class Planner
+    {
+    public:
+        Planner(const MachineLimits& limits, int lines);
+
+        void parseLine(const QLatin1String& words, int line);
+        void plan(QVector<double>& lineTimes) const;
+
+    private:
+        void addMove(const double *target, int line);
+        void addArc(const double *target, const double *offset, bool hasRadius, double radius, int line);
+        void addSegment(const double *target, double feedRate, bool rapid, int line);
+        void addDwell(double secs, int line);
+        double segmentFeed(double length) const;
+
+    private:
+        MachineLimits limits;
+        QVector<Block> blocks;
+
+        double position[LIMITS_AXIS_COUNT];
+        double prevUnit[LIMITS_AXIS_COUNT];
+        bool hasPrev;
+
+        ModalWalker walker;
+    };
+
+    static double blockTime(const Block& block, double entry2, double exit2);
+};
+
+#endif // JOBESTIMATOR_H
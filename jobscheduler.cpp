@@ -0,0 +1,277 @@
+/****************************************************************
+ * jobscheduler.cpp
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#include "jobscheduler.h"
+#include "definitions.h"
+
+#include <QFileInfo>
+
+JobScheduler::JobScheduler(QObject *parent)
+    : QObject(parent), nextId(1), stopping(false), parseGeneration(0), parsing(false)
+{
+    fileParserThread.setObjectName("fileParser");
+    fileParser.moveToThread(&fileParserThread);
+    connect(this, SIGNAL(parseFile(QString,int)), &fileParser, SLOT(parseFile(QString,int)));
+    connect(&fileParser, SIGNAL(parseEnded(ParsedProgramPtr,int)), this, SLOT(parseEnded(ParsedProgramPtr,int)));
+    fileParserThread.start(QThread::LowPriority);
+}
+
+JobScheduler::~JobScheduler()
+{
+    fileParser.cancel();
+    fileParserThread.quit();
+    fileParserThread.wait();
+
+    qDeleteAll(sessions);
+    sessions.clear();
+}
+
+void JobScheduler::addMachine(const MachineConfig& config)
+{
+    MachineSession *session = new MachineSession(config);
+    connect(session, SIGNAL(stateChanged(MachineSession*)), this, SLOT(sessionStateChanged(MachineSession*)));
+    connect(session, SIGNAL(jobEnded(MachineSession*,int,bool,int)), this, SLOT(sessionJobEnded(MachineSession*,int,bool,int)));
+    connect(session, SIGNAL(message(MachineSession*,QString)), this, SLOT(sessionMessage(MachineSession*,QString)));
+    sessions.append(session);
+}
+
+int JobScheduler::enqueue(const QString& path, const QStringList& needs)
+{
+    FleetJob job;
+    job.id = nextId++;
+    job.path = path;
+    foreach (QString need, needs)
+        job.needs.append(need.trimmed().toLower());
+
+    toParse.append(job);
+    parseNext();
+    return job.id;
+}
+
+void JobScheduler::start()
+{
+    stopping = false;
+    foreach (MachineSession *session, sessions)
+        session->open();
+}
+
+void JobScheduler::stop()
+{
+    stopping = true;
+    foreach (MachineSession *session, sessions)
+        session->close();
+    sessionStateChanged(NULL);
+}
+
+int JobScheduler::runningJobs() const
+{
+    return running.size();
+}
+
+bool JobScheduler::isIdle() const
+{
+    if (waitingJobs() > 0 || !running.isEmpty())
+        return false;
+
+    foreach (MachineSession *session, sessions)
+    {
+        if (session->state() == MachineSession::CLOSING)
+            return false;
+    }
+    return true;
+}
+
+// One file at a time, a new parse would cancel the one in progress
+void JobScheduler::parseNext()
+{
+    if (parsing || toParse.isEmpty())
+        return;
+
+    parsing = true;
+    parseGeneration = fileParser.nextGeneration();
+    emit parseFile(toParse.first().path, parseGeneration);
+}
+
+void JobScheduler::parseEnded(ParsedProgramPtr program, int generation)
+{
+    if (generation != parseGeneration || toParse.isEmpty())
+        return;
+
+    parsing = false;
+    FleetJob job = toParse.takeFirst();
+    if (program.isNull())
+    {
+        emit jobRejected(job.id, job.path, "the file can't be read");
+        checkAllEnded();
+    }
+    else
+    {
+        job.program = program;
+        measure(job);
+        queue.append(job);
+        dispatch();
+    }
+    parseNext();
+}
+
+void JobScheduler::dispatch()
+{
+    if (stopping)
+        return;
+
+    for (int i = 0; i < queue.size(); )
+    {
+        const FleetJob& job = queue.at(i);
+
+        MachineSession *free = NULL;
+        bool possible = false;
+        QStringList reasons;
+        foreach (MachineSession *session, sessions)
+        {
+            QString reason = session->cannotRun(job);
+            if (!reason.isEmpty())
+            {
+                reasons.append(reason);
+                continue;
+            }
+            if (session->state() == MachineSession::FAILED)
+            {
+                reasons.append(QString("%1 failed").arg(session->name()));
+                continue;
+            }
+
+            possible = true;
+            if (session->state() == MachineSession::IDLE)
+            {
+                free = session;
+                break;
+            }
+        }
+
+        if (!possible)
+        {
+            FleetJob rejected = queue.takeAt(i);
+            emit jobRejected(rejected.id, rejected.path, reasons.join(", "));
+            continue;
+        }
+
+        // Later jobs may fit other machines, they don't wait behind this one
+        if (free == NULL || !free->startJob(job))
+        {
+            i++;
+            continue;
+        }
+
+        FleetJob started = queue.takeAt(i);
+        running.append(started);
+        emit jobStarted(started.id, started.path, free->name());
+    }
+
+    checkAllEnded();
+}
+
+void JobScheduler::checkAllEnded()
+{
+    if (!parsing && toParse.isEmpty() && queue.isEmpty() && running.isEmpty())
+        emit allJobsEnded();
+}
+
+void JobScheduler::sessionStateChanged(MachineSession *)
+{
+    if (!stopping)
+    {
+        dispatch();
+        return;
+    }
+
+    foreach (MachineSession *session, sessions)
+    {
+        if (session->state() == MachineSession::CLOSING)
+            return;
+    }
+    emit stopped();
+}
+
+void JobScheduler::sessionJobEnded(MachineSession *machine, int jobId, bool completed, int errors)
+{
+    for (int i = 0; i < running.size(); i++)
+    {
+        if (running.at(i).id == jobId)
+        {
+            FleetJob job = running.takeAt(i);
+            emit jobEnded(job.id, job.path, machine->name(), completed, errors);
+            break;
+        }
+    }
+
+    dispatch();
+}
+
+void JobScheduler::sessionMessage(MachineSession *machine, QString text)
+{
+    emit machineMessage(machine->name(), text);
+}
+
+// Extent of the toolpath in mm, the moves in inches are converted
+void JobScheduler::measure(FleetJob& job)
+{
+    ToolpathModelPtr toolpath = job.program->toolpath();
+    if (toolpath.isNull() || toolpath->isEmpty())
+        return;
+
+    double minX = 0, maxX = 0, minY = 0, maxY = 0;
+    for (int n = 0; n < toolpath->count(); n++)
+    {
+        double scale = toolpath->isMm(n) ? 1 : MM_IN_AN_INCH;
+        double x = toolpath->x(n) * scale;
+        double y = toolpath->y(n) * scale;
+        if (n == 0 || x < minX)
+            minX = x;
+        if (n == 0 || x > maxX)
+            maxX = x;
+        if (n == 0 || y < minY)
+            minY = y;
+        if (n == 0 || y > maxY)
+            maxY = y;
+    }
+    job.sizeX = maxX - minX;
+    job.sizeY = maxY - minY;
+}
+
+QStringList JobScheduler::overview()
+{
+    QStringList lines;
+    foreach (MachineSession *session, sessions)
+    {
+        MachineMetrics m = session->board()->snapshot();
+        QString line = QString("%1 %2").arg(session->name(), -12).arg(MachineSession::stateName(session->state()), -8);
+
+        QString state = QString::fromLatin1(m.state);
+        line += QString(" %1").arg(state.isEmpty() ? "-" : state, -6);
+
+        if (session->jobId() > 0)
+        {
+            QString path;
+            foreach (const FleetJob& job, running)
+            {
+                if (job.id == session->jobId())
+                    path = QFileInfo(job.path).fileName();
+            }
+            line += QString(" job=%1 %2 %3%").arg(session->jobId()).arg(path)
+                    .arg(m.progress * 100, 0, 'f', 0);
+            if (m.etaMs >= 0)
+                line += QString(" eta=%1s").arg(m.etaMs / 1000);
+            line += QString(" queue=%1 ack_p99=%2ms").arg(m.queueDepth).arg(m.ackP99Us / 1000.0, 0, 'f', 1);
+        }
+
+        line += QString(" x=%1 y=%2 z=%3").arg(m.workPos[0], 0, 'f', 3).arg(m.workPos[1], 0, 'f', 3)
+                .arg(m.workPos[2], 0, 'f', 3);
+        lines.append(line);
+    }
+    return lines;
+}
@@ -0,0 +1,95 @@
+/****************************************************************
+ * jobscheduler.h
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#ifndef JOBSCHEDULER_H
+#define JOBSCHEDULER_H
+
+#include <QObject>
+#include <QList>
+#include <QStringList>
+#include <QThread>
+#include "machinesession.h"
+#include "fileparser.h"
+
+/**
+ * @brief Runs a fleet of machines from one queue of jobs.
+ *
+ * Every machine gets its own MachineSession, so its own controller
+ * thread and port. Files are parsed one after the other on a low
+ * priority thread, then wait in the queue in the order they came. As soon
+ * as a machine is idle it takes the first job it can run, by its tags and
+ * travel; a job no machine of the fleet could ever run is rejected at once.
+ *
+ * Lives in one thread, the one that created it, which also reads the
+ * boards of the machines for overview().
+ */
+class JobScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    JobScheduler(QObject *parent = 0);
+    ~JobScheduler();
+
+    void addMachine(const MachineConfig& config);
+    const QList<MachineSession *>& machines() const { return sessions; }
+
+    // The id of the job, its file is parsed in the background
+    int enqueue(const QString& path, const QStringList& needs);
+
+    // Opens every port, jobs start as the machines come up
+    void start();
+    // Stops taking jobs, aborts the ones running and closes the ports
+    void stop();
+
+    int waitingJobs() const { return toParse.size() + queue.size(); }
+    int runningJobs() const;
+    // Nothing waiting or running, and every port closed after stop()
+    bool isIdle() const;
+
+    // One line per machine: state, job, progress, queue and ack latency
+    QStringList overview();
+
+signals:
+    void jobStarted(int id, QString path, QString machine);
+    void jobEnded(int id, QString path, QString machine, bool completed, int errors);
+    void jobRejected(int id, QString path, QString reason);
+    void machineMessage(QString machine, QString text);
+    // Everything queued was run or rejected
+    void allJobsEnded();
+    // After stop(), once every port is closed
+    void stopped();
+
+    void parseFile(QString path, int generation);
+
+private slots:
+    void parseEnded(ParsedProgramPtr program, int generation);
+    void sessionStateChanged(MachineSession *machine);
+    void sessionJobEnded(MachineSession *machine, int jobId, bool completed, int errors);
+    void sessionMessage(MachineSession *machine, QString text);
+
+private:
+    void parseNext();
+    void dispatch();
+    void checkAllEnded();
+    static void measure(FleetJob& job);
+
+private:
+    QList<MachineSession *> sessions;
+    QList<FleetJob> toParse;
+    QList<FleetJob> queue;
+    QList<FleetJob> running;
+    int nextId;
+    bool stopping;
+
+    FileParser fileParser;
+    QThread fileParserThread;
+    int parseGeneration;
+    bool parsing;
+};
+
+#endif // JOBSCHEDULER_H
@@ -0,0 +1,299 @@
+/****************************************************************
+ * lineencoder.cpp
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#include "lineencoder.h"
+#include "parsedprogram.h"
+#include "trace.h"
+
+LineEncoder::LineEncoder()
+{
+    reset();
+}
+
+void LineEncoder::reset()
+{
+    inBytes = 0;
+    outBytes = 0;
+    forgetState();
+}
+
+void LineEncoder::forgetState()
+{
+    motion = -1;
+    distance = -1;
+    units = -1;
+    feedMode = -1;
+    feed = 0;
+    feedKnown = false;
+    forgetPosition();
+}
+
+void LineEncoder::forgetPosition()
+{
+    for (int i = 0; i < ENCODER_AXIS_COUNT; i++)
+    {
+        position[i] = 0;
+        positionKnown[i] = false;
+    }
+}
+
+QString LineEncoder::encode(const QString& line)
+{
+    TRACE_SCOPE("LineEncoder::encode");
+    inBytes += line.size() + 1;
+
+    QList<Word> words;
+    if (!splitWords(line, words))
+    {
+        // $ commands and the like go as they are, who knows where they leave the machine
+        QString result = line.trimmed();
+        forgetPosition();
+        motion = -1;
+        outBytes += result.size() + 1;
+        return result;
+    }
+
+    int lineMotion = -1;
+    int lineDistance = -1;
+    int lineUnits = -1;
+    int lineFeedMode = -1;
+    bool lost = false;      // the line takes the machine somewhere the encoder can't follow
+    bool otherMotion = false;
+    bool programEnd = false;
+
+    foreach (const Word& word, words)
+    {
+        if (word.letter == 'M' && (word.value == 2 || word.value == 30))
+            programEnd = true;
+        if (word.letter != 'G')
+            continue;
+
+        int code = qRound(word.value * 10);
+        if (code == 0 || code == 10 || code == 20 || code == 30)
+            lineMotion = code / 10;
+        else if (code == 900 || code == 910)
+            lineDistance = code;
+        else if (code == 200 || code == 210)
+            lineUnits = code;
+        else if (code == 930 || code == 940)
+            lineFeedMode = code;
+        else if (code == 800)
+            otherMotion = true;
+        else if ((code >= 382 && code <= 385) || code == 100 || code == 280 || code == 281
+                 || code == 300 || code == 301 || code == 530 || (code >= 540 && code <= 593)
+                 || (code >= 920 && code <= 923) || code == 431 || code == 490)
+            lost = true;
+    }
+
+    if (lineUnits >= 0 && lineUnits != units)
+        forgetPosition();
+
+    int lineDist = lineDistance >= 0 ? lineDistance : distance;
+    int lineUnit = lineUnits >= 0 ? lineUnits : units;
+    int lineFeed = lineFeedMode >= 0 ? lineFeedMode : feedMode;
+    int moveMotion = lineMotion >= 0 ? lineMotion : (otherMotion ? -1 : motion);
+    bool linear = moveMotion == 0 || moveMotion == 1;
+    int decimals = lineUnit == 210 ? ENCODER_MM_DECIMALS : (lineUnit == 200 ? ENCODER_INCH_DECIMALS : -1);
+
+    QString result;
+    foreach (const Word& word, words)
+    {
+        char letter = word.letter.toLatin1();
+        if (lost)
+        {
+            if (letter != 'N')
+                result += word.letter + shortNumber(word.text);
+            continue;
+        }
+
+        switch (letter)
+        {
+        case 'N':
+            break;
+        case 'G':
+        {
+            int code = qRound(word.value * 10);
+            bool repeated = (code == lineMotion * 10 && lineMotion == motion)
+                    || (code == lineDistance && code == distance)
+                    || (code == lineUnits && code == units)
+                    || (code == lineFeedMode && code == feedMode);
+            if (!repeated)
+                result += word.letter + shortNumber(word.text);
+            break;
+        }
+        case 'X':
+        case 'Y':
+        case 'Z':
+        {
+            int axis = letter - 'X';
+            QString value = number(word, lineDist == 900 ? decimals : -1);
+            if (linear && lineDist == 900 && positionKnown[axis] && value.toDouble() == position[axis])
+                break;
+            if (linear && lineDist == 910 && word.value == 0)
+                break;
+            result += word.letter + value;
+            break;
+        }
+        case 'F':
+        {
+            QString value = number(word, decimals);
+            if (lineFeed == 940 && feedKnown && value.toDouble() == feed)
+                break;
+            result += word.letter + value;
+            break;
+        }
+        case 'I':
+        case 'J':
+        case 'K':
+        case 'R':
+            result += word.letter + number(word, decimals);
+            break;
+        default:
+            result += word.letter + shortNumber(word.text);
+            break;
+        }
+    }
+
+    // Follow the state the line leaves behind
+    distance = lineDist;
+    units = lineUnit;
+    feedMode = lineFeed;
+    motion = moveMotion;
+
+    foreach (const Word& word, words)
+    {
+        char letter = word.letter.toLatin1();
+        if (letter == 'F')
+        {
+            feed = number(word, decimals).toDouble();
+            feedKnown = true;
+        }
+        else if (letter >= 'X' && letter <= 'Z' && !lost)
+        {
+            int axis = letter - 'X';
+            if (lineDist == 900)
+            {
+                position[axis] = number(word, decimals).toDouble();
+                positionKnown[axis] = true;
+            }
+            else if (lineDist == 910 && positionKnown[axis])
+            {
+                position[axis] += word.value;
+            }
+            else
+            {
+                positionKnown[axis] = false;
+            }
+        }
+    }
+
+    if (lost)
+    {
+        forgetPosition();
+        if (lineMotion < 0)
+            motion = -1;
+    }
+
+    // The controller puts its modes back to the defaults at the end of a program
+    if (programEnd)
+        forgetState();
+
+    if (!result.isEmpty())
+        outBytes += result.size() + 1;
+    return result;
+}
+
+// Words are a letter and a number, anything else is not for the encoder
+bool LineEncoder::splitWords(const QString& line, QList<Word>& words)
+{
+    int size = line.size();
+    int i = 0;
+    while (i < size)
+    {
+        QChar c = line.at(i);
+        if (c.isSpace())
+        {
+            i++;
+        }
+        else if (c == '(')
+        {
+            int close = line.indexOf(')', i);
+            if (close < 0)
+                return false;
+            i = close + 1;
+        }
+        else if (c == ';')
+        {
+            break;
+        }
+        else if (c.isLetter() && c.unicode() < 128)
+        {
+            Word word;
+            word.letter = c.toUpper();
+            i++;
+            while (i < size && line.at(i).isSpace())
+                i++;
+
+            int start = i;
+            while (i < size && (line.at(i).isDigit() || line.at(i) == '.' || line.at(i) == '-' || line.at(i) == '+'))
+                i++;
+
+            word.text = line.mid(start, i - start);
+            bool ok;
+            word.value = word.text.toDouble(&ok);
+            if (!ok)
+                return false;
+            words.append(word);
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Same value, without the sign, zeros and point it does not need
+QString LineEncoder::shortNumber(const QString& text)
+{
+    QString s = text;
+    bool negative = false;
+    if (s.startsWith('+') || s.startsWith('-'))
+    {
+        negative = s.at(0) == '-';
+        s.remove(0, 1);
+    }
+
+    int point = s.indexOf('.');
+    if (point >= 0)
+    {
+        while (s.endsWith('0'))
+            s.chop(1);
+        if (s.endsWith('.'))
+            s.chop(1);
+    }
+
+    int zeros = 0;
+    while (zeros < s.size() - 1 && s.at(zeros) == '0' && s.at(zeros + 1) != '.')
+        zeros++;
+    if (zeros < s.size() && s.at(zeros) == '0' && zeros + 1 < s.size())
+        zeros++;
+    s.remove(0, zeros);
+
+    if (s.isEmpty() || s == "0")
+        return "0";
+    return negative ? "-" + s : s;
+}
+
+// Rounded to decimals, or as written when decimals is negative
+QString LineEncoder::number(const Word& word, int decimals)
+{
+    if (decimals < 0)
+        return shortNumber(word.text);
+    return shortNumber(QString(ParsedProgram::formatValue(word.value, decimals)));
+}
@@ -0,0 +1,76 @@
+/****************************************************************
+ * lineencoder.h
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#ifndef LINEENCODER_H
+#define LINEENCODER_H
+
+#include <QString>
+#include <QList>
+
+#define ENCODER_MM_DECIMALS     3   // 1 um, finer than the steps of the usual machine
+#define ENCODER_INCH_DECIMALS   4
+#define ENCODER_AXIS_COUNT      3
+
+/**
+ * @brief Writes the lines of a file with as few bytes as the controller needs.
+ *
+ * Follows the modal state the lines set and drops what does not change it:
+ * a repeated motion, distance, units or feed mode G word, an axis already
+ * at its value, a repeated feed and the line numbers. Spaces and comments
+ * are removed and values are written in their shortest form, rounded to
+ * the resolution of the machine in absolute mode only, so relative moves
+ * do not add up rounding. Until the file sets the distance mode and the
+ * units, and after anything that moves the machine somewhere it does not
+ * know (homing, probing, coordinate system changes), nothing is dropped.
+ * The end of a program (M2, M30) forgets the modes as well.
+ */
+class LineEncoder
+{
+public:
+    LineEncoder();
+
+    // Back to knowing nothing, before a file is sent
+    void reset();
+
+    /**
+     * @brief The line to send in place of line, empty if nothing is left to send.
+     */
+    QString encode(const QString& line);
+
+    qint64 bytesIn() const { return inBytes; }
+    qint64 bytesOut() const { return outBytes; }
+
+private:
+    struct Word
+    {
+        QChar letter;
+        QString text;
+        double value;
+    };
+
+    static bool splitWords(const QString& line, QList<Word>& words);
+    static QString shortNumber(const QString& text);
+    static QString number(const Word& word, int decimals);
+    void forgetState();
+    void forgetPosition();
+
+private:
+    qint64 inBytes;
+    qint64 outBytes;
+
+    int motion;             // -1 while unknown
+    int distance;           // 900, 910 or -1
+    int units;              // 200, 210 or -1
+    int feedMode;           // 930, 940 or -1
+    double feed;
+    bool feedKnown;
+    double position[ENCODER_AXIS_COUNT];
+    bool positionKnown[ENCODER_AXIS_COUNT];
+};
+
+#endif // LINEENCODER_H
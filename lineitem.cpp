@@ -59,3 +59,8 @@ void LineItem::drawTo(QPainterPath& path)
         path.lineTo(screenX(x) - length, screenY(y));
     }
 }
+
+double LineItem::distanceTo(double x1, double y1, double fromX, double fromY)
+{
+    return segmentDistance(x1, y1, fromX, fromY, x, y);
+}
@@ -0,0 +1,47 @@
+/****************************************************************
+ * linesteps.h
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#ifndef LINESTEPS_H
+#define LINESTEPS_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include "controlparams.h"
+#include "interpolator.h"
+#include "coord3d.h"
+
+class CodeCommand;
+
+/**
+ * @brief The per-line steps of a file send, one line at a time and without a port.
+ *
+ * The controllers implement it privately, it is only reached through this
+ * interface, which the benchmarks use to time the steps. A step the
+ * controller does not have leaves the line as it is.
+ */
+class LineSteps
+{
+public:
+    virtual ~LineSteps() {}
+
+    // As after connecting to the machine, with these settings and height map
+    virtual void prepareLineSteps(const ControlParams& params, InterpolatorPtr interpolator) = 0;
+
+    // The words the controller does not take, removed or rewritten
+    virtual QString filterLine(const QString& line) = 0;
+    virtual QString reduceLinePrecision(const QString& line) = 0;
+    virtual QStringList limitLineZRate(const QString& line) = 0;
+    // The segments of a leveled move, the caller deletes them
+    virtual QList<CodeCommand *> levelCommand(CodeCommand *command) = 0;
+
+    // A status report as it comes from the port, the work position it leaves
+    virtual Coord3D readStatusReport(const QString& report) = 0;
+};
+
+#endif // LINESTEPS_H
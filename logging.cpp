@@ -0,0 +1,161 @@
+/****************************************************************
+ * logging.cpp
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#include "definitions.h"
+#include "log4qtdef.h"
+
+#include <QString>
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+enum GC_LOG_TYPES
+{
+    LOG_DEBUG_TYPE = 1,
+    LOG_ERROR_TYPE,
+    LOG_WARN_TYPE,
+    LOG_INFO_TYPE,
+    LOG_STATUS_TYPE,
+};
+
+static void logit(GC_LOG_TYPES type, const char *str, va_list args);
+
+AtomicIntBool g_enableDebugLog;
+
+// For the command line tools: warnings and errors to stderr, stdout is left to
+// the records of the tool, and everything to logFile unless it is empty. With
+// threadNames the lines tell which thread, so which machine, wrote them
+void setupToolLogging(const QString& logFile, bool threadNames)
+{
+    Log4Qt::LogManager::rootLogger();
+    Log4Qt::PatternLayout *layout = new Log4Qt::PatternLayout(threadNames ? "%d %p [%t] (%c) - %m%n" : "%d %p (%c) - %m%n");
+    layout->setName(QLatin1String("GC Basic Layout"));
+    layout->activateOptions();
+
+    Log4Qt::ConsoleAppender *appender = new Log4Qt::ConsoleAppender(layout, Log4Qt::ConsoleAppender::STDERR_TARGET);
+    appender->setName(QLatin1String("GC Basic Console Appender"));
+    appender->setThreshold(Log4Qt::Level::WARN_INT);
+    appender->activateOptions();
+    Log4Qt::Logger::rootLogger()->addAppender(appender);
+
+    if (!logFile.isEmpty())
+    {
+        Log4Qt::FileAppender *fileAppender = new Log4Qt::FileAppender();
+        fileAppender->setLayout(layout);
+        fileAppender->setThreshold(Log4Qt::Level::TRACE_INT);
+        fileAppender->setFile(logFile);
+        fileAppender->setName(QLatin1String("GC Basic File Appender"));
+        fileAppender->activateOptions();
+        Log4Qt::Logger::rootLogger()->addAppender(fileAppender);
+    }
+}
+
+//------------------------------
+void status(const char *str, ...)
+{
+#ifndef QT_DEBUG
+    if (g_enableDebugLog.get()) {
+#endif
+    va_list args;
+
+    va_start(args, str );
+    logit(LOG_STATUS_TYPE, str, args);
+    va_end(args);
+#ifndef QT_DEBUG
+    }
+#endif
+}
+
+void err(const char *str, ...)
+{
+    va_list args;
+
+    va_start(args, str );
+    logit(LOG_ERROR_TYPE, str, args);
+    va_end(args);
+}
+
+void warn(const char *str, ...)
+{
+    va_list args;
+
+    va_start(args, str );
+    logit(LOG_WARN_TYPE, str, args);
+    va_end(args);
+}
+
+void info(const char *str, ...)
+{
+    va_list args;
+
+    va_start(args, str );
+    logit(LOG_INFO_TYPE, str, args);
+    va_end(args);
+}
+
+void diag(const char *str, ...)
+{
+#ifndef QT_DEBUG
+    if (g_enableDebugLog.get()) {
+#endif
+    va_list args;
+
+    va_start(args, str );
+    logit(LOG_DEBUG_TYPE, str, args);
+    va_end(args);
+#ifndef QT_DEBUG
+    }
+#endif
+}
+
+static void logit(GC_LOG_TYPES type, const char *str, va_list args)
+{
+#define PRNTBUFSIZE 500
+    char buf[PRNTBUFSIZE];
+    buf[PRNTBUFSIZE-1] = '\0';
+
+    vsnprintf(buf, sizeof(buf) - 1, str, args);
+
+    int len = strlen(buf);
+    if (len > 0)
+    {
+        if (len == 1 && (buf[0] == '\r' || buf[0] == '\n'))
+        {
+            buf[0] = '\0';
+        }
+        else if (len > 1)
+        {
+            if (buf[len - 2] == '\r' || buf[len - 2] == '\n')
+                buf[len - 2] = '\0';
+            else if (buf[len - 1] == '\r' || buf[len - 1] == '\n')
+                buf[len - 1] = '\0';
+        }
+    }
+    else if (len == 0)
+        return;
+
+    switch (type)
+    {
+        case LOG_STATUS_TYPE:
+            Log4Qt::Logger::logger(LOG_MSG_TYPE_STATUS)->info(buf);
+            break;
+        case LOG_DEBUG_TYPE:
+            Log4Qt::Logger::logger(LOG_MSG_TYPE_DIAG)->debug(buf);
+            break;
+        case LOG_ERROR_TYPE:
+            Log4Qt::Logger::logger(LOG_MSG_TYPE_DIAG)->error(buf);
+            break;
+        case LOG_WARN_TYPE:
+            Log4Qt::Logger::logger(LOG_MSG_TYPE_DIAG)->warn(buf);
+            break;
+        case LOG_INFO_TYPE:
+            Log4Qt::Logger::logger(LOG_MSG_TYPE_DIAG)->info(buf);
+            break;
+    }
+}
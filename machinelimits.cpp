@@ -0,0 +1,54 @@
+/****************************************************************
+ * machinelimits.cpp
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#include "machinelimits.h"
+
+MachineLimits::MachineLimits()
+    : junctionDeviation(DEFAULT_JUNCTION_DEVIATION)
+{
+    for (int i = 0; i < LIMITS_AXIS_COUNT; i++)
+    {
+        maxRate[i] = DEFAULT_MAX_RATE;
+        acceleration[i] = DEFAULT_ACCELERATION;
+    }
+}
+
+bool MachineLimits::setSetting(int number, double value)
+{
+    if (number == SETTING_JUNCTION_DEVIATION && value >= 0)
+        junctionDeviation = value;
+    // A zero rate would stop the machine, it can only be a bad reading
+    else if (number >= SETTING_MAX_RATE_X && number < SETTING_MAX_RATE_X + LIMITS_AXIS_COUNT && value > 0)
+        maxRate[number - SETTING_MAX_RATE_X] = value;
+    else if (number >= SETTING_ACCELERATION_X && number < SETTING_ACCELERATION_X + LIMITS_AXIS_COUNT && value > 0)
+        acceleration[number - SETTING_ACCELERATION_X] = value;
+    else
+        return false;
+
+    return true;
+}
+
+bool MachineLimits::setLegacySetting(int number, double value)
+{
+    if (number == SETTING_08_JUNCTION_DEVIATION && value >= 0)
+        junctionDeviation = value;
+    else if ((number == SETTING_08_SEEK_RATE || number == SETTING_08_ACCELERATION) && value > 0)
+    {
+        for (int i = 0; i < LIMITS_AXIS_COUNT; i++)
+        {
+            if (number == SETTING_08_SEEK_RATE)
+                maxRate[i] = value;
+            else
+                acceleration[i] = value;
+        }
+    }
+    else
+        return false;
+
+    return true;
+}
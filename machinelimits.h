@@ -0,0 +1,58 @@
+/****************************************************************
+ * machinelimits.h
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#ifndef MACHINELIMITS_H
+#define MACHINELIMITS_H
+
+#include <QMetaType>
+
+// Grbl defaults, used until the controller reports its settings
+#define DEFAULT_MAX_RATE            500.0   // mm/min
+#define DEFAULT_ACCELERATION        10.0    // mm/sec^2
+#define DEFAULT_JUNCTION_DEVIATION  0.01    // mm
+
+#define SETTING_JUNCTION_DEVIATION  11
+#define SETTING_MAX_RATE_X          110
+#define SETTING_ACCELERATION_X      120
+
+// Grbl 0.8 numbers its settings differently, one rate and acceleration for all axes
+#define SETTING_08_SEEK_RATE        5
+#define SETTING_08_ACCELERATION     8
+#define SETTING_08_JUNCTION_DEVIATION 9
+
+#define LIMITS_AXIS_COUNT           3
+
+/**
+ * @brief Kinematic settings of the machine, as read from Grbl's $$ report.
+ *
+ * The numbers are those of Grbl 0.9 and later. Grbl 0.8 has a single seek
+ * rate and acceleration, taken for every axis, and the junction deviation
+ * at $9.
+ */
+class MachineLimits
+{
+public:
+    MachineLimits();
+
+    /**
+     * @brief Takes the value of a $ setting.
+     * @return false if the setting is not one of the limits.
+     */
+    bool setSetting(int number, double value);
+    // The same for Grbl 0.8, where $11 is the n-arc correction
+    bool setLegacySetting(int number, double value);
+
+public:
+    double maxRate[LIMITS_AXIS_COUNT];      // mm/min, $110 to $112
+    double acceleration[LIMITS_AXIS_COUNT]; // mm/sec^2, $120 to $122
+    double junctionDeviation;               // mm, $11
+};
+
+Q_DECLARE_METATYPE(MachineLimits)
+
+#endif // MACHINELIMITS_H
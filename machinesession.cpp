@@ -0,0 +1,234 @@
+/****************************************************************
+ * machinesession.cpp
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#include "machinesession.h"
+#include "settingskeys.h"
+#include "gcodegrbl.h"
+#include "gcodemarlin.h"
+
+#include <QSettings>
+
+MachineConfig::MachineConfig()
+    : baud(QString::number(BAUD115200)), controller(SETTINGS_CONTROLLER_GRBL), travelX(0), travelY(0)
+{
+}
+
+QList<MachineConfig> MachineConfig::readFleet(QSettings& settings, QString& errorMsg)
+{
+    QList<MachineConfig> machines;
+    foreach (QString group, settings.childGroups())
+    {
+        settings.beginGroup(group);
+
+        MachineConfig config;
+        config.name = group;
+        config.port = settings.value("port").value<QString>();
+        config.baud = settings.value("baud", config.baud).value<QString>();
+        config.tags = settings.value("tags").toStringList();
+        config.travelX = settings.value("travelX", 0).value<double>();
+        config.travelY = settings.value("travelY", 0).value<double>();
+        config.params.readSettings(settings);
+
+        QString controller = settings.value("controller", "grbl").value<QString>().toLower();
+        settings.endGroup();
+
+        if (config.port.isEmpty())
+        {
+            errorMsg = QString("Machine %1 has no port").arg(group);
+            return QList<MachineConfig>();
+        }
+        if (controller == "grbl")
+            config.controller = SETTINGS_CONTROLLER_GRBL;
+        else if (controller == "marlin")
+            config.controller = SETTINGS_CONTROLLER_MARLIN;
+        else
+        {
+            errorMsg = QString("Machine %1 has an unknown controller %2").arg(group).arg(controller);
+            return QList<MachineConfig>();
+        }
+
+        for (int i = 0; i < config.tags.size(); i++)
+            config.tags[i] = config.tags.at(i).trimmed().toLower();
+        machines.append(config);
+    }
+
+    if (machines.isEmpty())
+        errorMsg = "No machine in the fleet file";
+    return machines;
+}
+
+MachineSession::MachineSession(const MachineConfig& config, QObject *parent)
+    : QObject(parent), machineConfig(config), currentState(OFFLINE), currentJob(0), gcode(NULL),
+      metricsBoard(config.name)
+{
+    if (config.controller == SETTINGS_CONTROLLER_MARLIN)
+        gcode = new GCodeMarlin();
+    else
+        gcode = new GCodeGrbl();
+    gcode->setMetricsBoard(&metricsBoard);
+    gcodeThread.setObjectName("gcode " + config.name);
+    gcode->moveToThread(&gcodeThread);
+
+    connect(this, SIGNAL(setResponseWait(ControlParams)), gcode, SLOT(setResponseWait(ControlParams)));
+    connect(this, SIGNAL(openPort(QString,QString)), gcode, SLOT(openPort(QString,QString)));
+    connect(this, SIGNAL(closePort(bool)), gcode, SLOT(closePort(bool)));
+    connect(this, SIGNAL(sendGcode(QString)), gcode, SLOT(sendGcode(QString)));
+    connect(this, SIGNAL(sendFile(ParsedProgramPtr)), gcode, SLOT(sendFile(ParsedProgramPtr)));
+
+    connect(gcode, SIGNAL(portIsOpen(bool)), this, SLOT(portIsOpen(bool)));
+    connect(gcode, SIGNAL(portIsClosed(bool)), this, SLOT(portIsClosed(bool)));
+    connect(gcode, SIGNAL(sendFileEnded(bool,int)), this, SLOT(sendFileEnded(bool,int)));
+    connect(gcode, SIGNAL(addList(QString)), this, SLOT(receiveList(QString)));
+    connect(gcode, SIGNAL(addListFull(QStringList)), this, SLOT(receiveListFull(QStringList)));
+
+    // The port is polled in a busy loop, ahead of the parsing and the overview
+    gcodeThread.start(QThread::HighPriority);
+}
+
+MachineSession::~MachineSession()
+{
+    gcode->setShutdown();
+    gcodeThread.quit();
+    gcodeThread.wait();
+    delete gcode;
+}
+
+bool MachineSession::canRun(const FleetJob& job) const
+{
+    return cannotRun(job).isEmpty();
+}
+
+QString MachineSession::cannotRun(const FleetJob& job) const
+{
+    foreach (QString need, job.needs)
+    {
+        if (!machineConfig.tags.contains(need))
+            return QString("%1 has no %2").arg(name()).arg(need);
+    }
+
+    // Either way round on the table
+    double longSide = qMax(job.sizeX, job.sizeY);
+    double shortSide = qMin(job.sizeX, job.sizeY);
+    double travelLong = qMax(machineConfig.travelX, machineConfig.travelY);
+    double travelShort = qMin(machineConfig.travelX, machineConfig.travelY);
+    if (travelShort > 0 && (longSide > travelLong || shortSide > travelShort))
+    {
+        return QString("%1 travels %2 x %3 mm, the job is %4 x %5 mm").arg(name())
+                .arg(machineConfig.travelX).arg(machineConfig.travelY)
+                .arg(job.sizeX, 0, 'f', 1).arg(job.sizeY, 0, 'f', 1);
+    }
+    return QString();
+}
+
+void MachineSession::open()
+{
+    if (currentState != OFFLINE && currentState != FAILED)
+        return;
+
+    setState(OPENING);
+    emit setResponseWait(machineConfig.params);
+    emit openPort(machineConfig.port, machineConfig.baud);
+}
+
+bool MachineSession::startJob(const FleetJob& job)
+{
+    if (currentState != IDLE || job.program.isNull())
+        return false;
+
+    currentJob = job.id;
+    setState(SENDING);
+    emit sendFile(job.program);
+    return true;
+}
+
+void MachineSession::close()
+{
+    if (currentState == OFFLINE || currentState == FAILED)
+        return;
+
+    gcode->setAbort();
+    setState(CLOSING);
+    emit closePort(false);
+}
+
+void MachineSession::abort()
+{
+    gcode->setAbort();
+}
+
+void MachineSession::portIsOpen(bool sendCode)
+{
+    if (currentState != OPENING)
+        return;
+
+    // As the GUI does, wait for the startup banner before anything else is sent
+    if (sendCode)
+        emit sendGcode("");
+    setState(IDLE);
+}
+
+void MachineSession::portIsClosed(bool)
+{
+    switch (currentState)
+    {
+    case OPENING:
+        emit message(this, QString("Can't open %1").arg(machineConfig.port));
+        setState(FAILED);
+        break;
+    case CLOSING:
+        setState(OFFLINE);
+        break;
+    case OFFLINE:
+        break;
+    default:
+        // The file send ends on its own and reports the job
+        emit message(this, QString("Lost %1").arg(machineConfig.port));
+        setState(FAILED);
+        break;
+    }
+}
+
+void MachineSession::sendFileEnded(bool completed, int errors)
+{
+    int job = currentJob;
+    currentJob = 0;
+    if (currentState == SENDING)
+        setState(IDLE);
+
+    emit jobEnded(this, job, completed && currentState != FAILED, errors);
+}
+
+void MachineSession::receiveList(QString msg)
+{
+    msg = msg.trimmed();
+    if (!msg.isEmpty())
+        emit message(this, msg);
+}
+
+void MachineSession::receiveListFull(QStringList list)
+{
+    foreach (QString msg, list)
+    {
+        receiveList(msg);
+    }
+}
+
+void MachineSession::setState(State state)
+{
+    if (state == currentState)
+        return;
+
+    currentState = state;
+    emit stateChanged(this);
+}
+
+const char *MachineSession::stateName(State state)
+{
+    static const char *names[] = { "offline", "opening", "idle", "sending", "closing", "failed" };
+    return names[state];
+}
@@ -0,0 +1,141 @@
+/****************************************************************
+ * machinesession.h
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#ifndef MACHINESESSION_H
+#define MACHINESESSION_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+#include <QList>
+#include "controlparams.h"
+#include "parsedprogram.h"
+#include "metricsboard.h"
+
+class QSettings;
+class GCodeController;
+
+/**
+ * @brief One machine of a fleet: its port, firmware, options and what it can cut.
+ */
+struct MachineConfig
+{
+    MachineConfig();
+
+    QString name;
+    QString port;
+    QString baud;
+    int controller;         // SETTINGS_CONTROLLER_GRBL or SETTINGS_CONTROLLER_MARLIN
+    ControlParams params;
+    QStringList tags;       // what the machine has, as "laser" or "4axis"
+    double travelX;         // mm, 0 if any size goes
+    double travelY;
+
+    /**
+     * @brief Reads one machine per group of a fleet file.
+     *
+     * The group name is the machine name, its keys are port, baud,
+     * controller (grbl or marlin), tags (comma separated), travelX and
+     * travelY, and any option key of the GUI settings.
+     */
+    static QList<MachineConfig> readFleet(QSettings& settings, QString& errorMsg);
+};
+
+/**
+ * @brief What a job needs from a machine, and the file it sends.
+ */
+struct FleetJob
+{
+    FleetJob() : id(0), sizeX(0), sizeY(0) {}
+
+    int id;
+    QString path;
+    ParsedProgramPtr program;
+    QStringList needs;      // tags the machine must have
+    double sizeX;           // mm, extent of the toolpath
+    double sizeY;
+};
+
+/**
+ * @brief Runs one machine: a controller on its own thread with its own port.
+ *
+ * Lives in the scheduler thread and only talks to the controller through
+ * queued signals, so a slow or stuck machine never holds up another one.
+ * Only the signals needed to follow jobs are connected, the per-line
+ * ones the GUI uses stay unconnected and cost nothing. Position, progress
+ * and stream figures are read from the machine's MetricsBoard.
+ */
+class MachineSession : public QObject
+{
+    Q_OBJECT
+public:
+    enum State
+    {
+        OFFLINE,
+        OPENING,
+        IDLE,           // open and waiting for a job
+        SENDING,
+        CLOSING,
+        FAILED          // the port didn't open or was lost
+    };
+
+    MachineSession(const MachineConfig& config, QObject *parent = 0);
+    ~MachineSession();
+
+    const MachineConfig& config() const { return machineConfig; }
+    QString name() const { return machineConfig.name; }
+    State state() const { return currentState; }
+    int jobId() const { return currentJob; }
+    MetricsBoard *board() { return &metricsBoard; }
+
+    bool canRun(const FleetJob& job) const;
+    // Why canRun is false, for the job rejections
+    QString cannotRun(const FleetJob& job) const;
+
+    void open();
+    bool startJob(const FleetJob& job);
+    void close();
+    // From any thread, stops the file in progress after its current line
+    void abort();
+
+    static const char *stateName(State state);
+
+signals:
+    void stateChanged(MachineSession *machine);
+    void jobEnded(MachineSession *machine, int jobId, bool completed, int errors);
+    void message(MachineSession *machine, QString text);
+
+    // To the controller
+    void setResponseWait(ControlParams controlParams);
+    void openPort(QString commPortStr, QString baudRate);
+    void closePort(bool reopen);
+    void sendGcode(QString line);
+    void sendFile(ParsedProgramPtr program);
+
+private slots:
+    void portIsOpen(bool sendCode);
+    void portIsClosed(bool reopen);
+    void sendFileEnded(bool completed, int errors);
+    void receiveList(QString msg);
+    void receiveListFull(QStringList list);
+
+private:
+    void setState(State state);
+
+private:
+    MachineConfig machineConfig;
+    State currentState;
+    int currentJob;
+
+    GCodeController *gcode;
+    QThread gcodeThread;
+    MetricsBoard metricsBoard;
+};
+
+#endif // MACHINESESSION_H
@@ -7,25 +7,14 @@
  * Software is provided AS-IS
  ****************************************************************/
 #include "mainwindow.h"
+#include "trace.h"
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
 #include <QtGui/QApplication>
 #else
 #include <QtWidgets/QApplication>
 #endif
 
-enum GC_LOG_TYPES
-{
-    LOG_DEBUG_TYPE = 1,
-    LOG_ERROR_TYPE,
-    LOG_WARN_TYPE,
-    LOG_INFO_TYPE,
-    LOG_STATUS_TYPE,
-};
-
-void logit(GC_LOG_TYPES type, const char *str, va_list args);
-
 FILE *pDebugLogFile = NULL;
-AtomicIntBool g_enableDebugLog;
 Log4Qt::PatternLayout *p_layout;
 Log4Qt::FileAppender *p_fappender;
 
@@ -85,120 +74,30 @@ int main(int argc, char *argv[])
     }
     a.installTranslator(&qtTranslator);
 
+#ifdef GRBL_TRACE
+    // Built with CONFIG+=trace, the whole session is traced when GRBL_TRACE_FILE names a file
+    QString traceFile = QString::fromLocal8Bit(qgetenv("GRBL_TRACE_FILE"));
+    if (!traceFile.isEmpty())
+        Trace::start();
+#endif
+
     MainWindow w;
     w.show();
 
     int result = a.exec();
 
-    if (pDebugLogFile != NULL)
+#ifdef GRBL_TRACE
+    if (!traceFile.isEmpty())
     {
-        fclose(pDebugLogFile);
-        pDebugLogFile = NULL;
-    }
-    return result;
-}
-
-
-//------------------------------
-void status(const char *str, ...)
-{
-#ifndef QT_DEBUG
-    if (g_enableDebugLog.get()) {
-#endif
-    va_list args;
-
-    va_start(args, str );
-    logit(LOG_STATUS_TYPE, str, args);
-    va_end(args);
-#ifndef QT_DEBUG
-    }
-#endif
-}
-
-void err(const char *str, ...)
-{
-    va_list args;
-
-    va_start(args, str );
-    logit(LOG_ERROR_TYPE, str, args);
-    va_end(args);
-}
-
-void warn(const char *str, ...)
-{
-    va_list args;
-
-    va_start(args, str );
-    logit(LOG_WARN_TYPE, str, args);
-    va_end(args);
-}
-
-void info(const char *str, ...)
-{
-    va_list args;
-
-    va_start(args, str );
-    logit(LOG_INFO_TYPE, str, args);
-    va_end(args);
-}
-
-void diag(const char *str, ...)
-{
-#ifndef QT_DEBUG
-    if (g_enableDebugLog.get()) {
-#endif
-    va_list args;
-
-    va_start(args, str );
-    logit(LOG_DEBUG_TYPE, str, args);
-    va_end(args);
-#ifndef QT_DEBUG
+        Trace::stop();
+        Trace::save(traceFile);
     }
 #endif
-}
-
-void logit(GC_LOG_TYPES type, const char *str, va_list args)
-{
-#define PRNTBUFSIZE 500
-    char buf[PRNTBUFSIZE];
-    buf[PRNTBUFSIZE-1] = '\0';
 
-    vsnprintf(buf, sizeof(buf) - 1, str, args);
-
-    int len = strlen(buf);
-    if (len > 0)
-    {
-        if (len == 1 && (buf[0] == '\r' || buf[0] == '\n'))
-        {
-            buf[0] = '\0';
-        }
-        else if (len > 1)
-        {
-            if (buf[len - 2] == '\r' || buf[len - 2] == '\n')
-                buf[len - 2] = '\0';
-            else if (buf[len - 1] == '\r' || buf[len - 1] == '\n')
-                buf[len - 1] = '\0';
-        }
-    }
-    else if (len == 0)
-        return;
-
-    switch (type)
+    if (pDebugLogFile != NULL)
     {
-        case LOG_STATUS_TYPE:
-            Log4Qt::Logger::logger(LOG_MSG_TYPE_STATUS)->info(buf);
-            break;
-        case LOG_DEBUG_TYPE:
-            Log4Qt::Logger::logger(LOG_MSG_TYPE_DIAG)->debug(buf);
-            break;
-        case LOG_ERROR_TYPE:
-            Log4Qt::Logger::logger(LOG_MSG_TYPE_DIAG)->error(buf);
-            break;
-        case LOG_WARN_TYPE:
-            Log4Qt::Logger::logger(LOG_MSG_TYPE_DIAG)->warn(buf);
-            break;
-        case LOG_INFO_TYPE:
-            Log4Qt::Logger::logger(LOG_MSG_TYPE_DIAG)->info(buf);
-            break;
+        fclose(pDebugLogFile);
+        pDebugLogFile = NULL;
     }
+    return result;
 }
@@ -12,6 +12,10 @@
 #include "ui_mainwindow.h"
 #include "gcodegrbl.h"
 #include "gcodemarlin.h"
+#include "heightmapstore.h"
+#include "trace.h"
+
+#include <QHostInfo>
 
 //TODO remove when removing the test button.
 #include "SpilineInterpolate3D.h"
@@ -32,7 +36,7 @@ MainWindow::MainWindow(QWidget *parent) :
     sliderZCount(0),
     scrollRequireMove(true), scrollPressed(false),
     queuedCommandsStarved(false), lastQueueCount(0), queuedCommandState(QCS_OK), gcode(NULL),
-    currentController(-1),
+    parseGeneration(0), metricsBoard(QHostInfo::localHostName()), currentController(-1),
 //queuedCommandsStarved(false), lastQueueCount(0), queuedCommandState(QCS_OK),
     lastLcdStateValid(true)
 {
@@ -45,10 +49,19 @@ MainWindow::MainWindow(QWidget *parent) :
     qRegisterMetaType<Coord3D>("Coord3D");
     qRegisterMetaType<PosItem>("PosItem");
     qRegisterMetaType<ControlParams>("ControlParams");
+    qRegisterMetaType<InterpolatorPtr>("InterpolatorPtr");
+    qRegisterMetaType<ToolpathModelPtr>("ToolpathModelPtr");
+    qRegisterMetaType<ParsedProgramPtr>("ParsedProgramPtr");
+    qRegisterMetaType<MachineLimits>("MachineLimits");
+    qRegisterMetaType<JobEstimatePtr>("JobEstimatePtr");
+    qRegisterMetaType<StreamStats>("StreamStats");
 
 
     ui->setupUi(this);
 
+    // Before readSettings, which creates the controller that fills the board
+    metricsServer.addBoard(&metricsBoard);
+
     readSettings();
 
     info("%s has started", GRBL_CONTROLLER_NAME_AND_VERSION);
@@ -62,7 +75,16 @@ MainWindow::MainWindow(QWidget *parent) :
     //gcode = new GCodeMarlin();
 
     //gcode->moveToThread(&gcodeThread);
+    // Shown in traces and debuggers
+    gcodeThread.setObjectName("gcode");
+    runtimeTimerThread.setObjectName("runtimeTimer");
+    fileParserThread.setObjectName("fileParser");
     runtimeTimer.moveToThread(&runtimeTimerThread);
+    fileParser.moveToThread(&fileParserThread);
+    jobEstimator.moveToThread(&fileParserThread);
+    rapidOptimizer.moveToThread(&fileParserThread);
+    arcFitter.moveToThread(&fileParserThread);
+    pathSimplifier.moveToThread(&fileParserThread);
 
     ui->lcdWorkNumberX->setDigitCount(8);
     ui->lcdMachNumberX->setDigitCount(8);
@@ -81,6 +103,9 @@ MainWindow::MainWindow(QWidget *parent) :
     ui->btnCancelLeveling->setEnabled(false);
     ui->btnClearLeveling->setEnabled(false);
     ui->btnRecomputeOffset->setEnabled(false);
+    ui->btnSaveLeveling->setEnabled(false);
+    ui->btnReprobeLeveling->setEnabled(false);
+    ui->levelingFixtureCombo->addItems(HeightMapStore::fixtures());
 
     ui->levelingComboBox->addItem(QString("Bicubic Spiline"), Interpolator::SPILINE);
     ui->levelingComboBox->addItem(QString("Linear"), Interpolator::LINEAR);
@@ -118,6 +143,9 @@ MainWindow::MainWindow(QWidget *parent) :
     connect(ui->SpindleOn,SIGNAL(toggled(bool)),this,SLOT(toggleSpindle()));
     connect(ui->chkRestoreAbsolute,SIGNAL(toggled(bool)),this,SLOT(toggleRestoreAbsolute()));
     connect(ui->actionOptions,SIGNAL(triggered()),this,SLOT(getOptions()));
+    connect(ui->actionOptimizeRapids,SIGNAL(triggered()),this,SLOT(optimizeRapidMoves()));
+    connect(ui->actionFitArcs,SIGNAL(triggered()),this,SLOT(fitArcsToProgram()));
+    connect(ui->actionSimplifyMoves,SIGNAL(triggered()),this,SLOT(simplifyMoves()));
     connect(ui->actionExit,SIGNAL(triggered()),this,SLOT(close()));
     connect(ui->actionAbout,SIGNAL(triggered()),this,SLOT(showAbout()));
     connect(ui->btnResetGrbl,SIGNAL(clicked()),this,SLOT(grblReset()));
@@ -127,6 +155,9 @@ MainWindow::MainWindow(QWidget *parent) :
     connect(ui->btnCancelLeveling, SIGNAL(clicked()), this, SLOT(stopLeveling()));
     connect(ui->btnClearLeveling, SIGNAL(clicked()), this, SLOT(clearLevelingData()));
     connect(ui->btnRecomputeOffset, SIGNAL(clicked()), this, SLOT(recomputeOffset()));
+    connect(ui->btnReprobeLeveling, SIGNAL(clicked()), this, SLOT(reprobeLeveling()));
+    connect(ui->btnSaveLeveling, SIGNAL(clicked()), this, SLOT(saveLeveling()));
+    connect(ui->btnLoadLeveling, SIGNAL(clicked()), this, SLOT(loadLeveling()));
     connect(ui->btnClearStatusList, SIGNAL(clicked()), ui->statusList, SLOT(clear()));
     connect(ui->verticalSliderZJog,SIGNAL(valueChanged(int)),this,SLOT(zJogSliderDisplay(int)));
     connect(ui->verticalSliderZJog,SIGNAL(sliderPressed()),this,SLOT(zJogSliderPressed()));
@@ -134,12 +165,27 @@ MainWindow::MainWindow(QWidget *parent) :
     connect(ui->pushButtonRefreshPos,SIGNAL(clicked()),this,SLOT(refreshPosition()));
     connect(ui->comboStep,SIGNAL(currentIndexChanged(QString)),this,SLOT(comboStepChanged(QString)));
     connect(ui->levelingUseData, SIGNAL(toggled(bool)), this, SLOT(useZLevelingDataToggle(bool)));
-    connect(this, SIGNAL(setItems(QList<PosItem>)), ui->wgtVisualizer, SLOT(setItems(QList<PosItem>)));
+    connect(this, SIGNAL(setItems(ToolpathModelPtr)), ui->wgtVisualizer, SLOT(setItems(ToolpathModelPtr)));
 
     connect(ui->levelingComboBox, SIGNAL(activated(int)), this, SLOT(levelingAlgorithmChanged(int)));
 
     connect(&runtimeTimer, SIGNAL(setRuntime(QString)), ui->outputRuntime, SLOT(setText(QString)));
 
+    connect(this, SIGNAL(parseFile(QString,int)), &fileParser, SLOT(parseFile(QString,int)));
+    connect(this, SIGNAL(parseSource(QString,QByteArray,int)), &fileParser, SLOT(parseSource(QString,QByteArray,int)));
+    connect(&fileParser, SIGNAL(parseProgress(int,int)), this, SLOT(setParseProgress(int,int)));
+    connect(&fileParser, SIGNAL(parsedChunk(ToolpathModelPtr,int)), this, SLOT(receiveParsedChunk(ToolpathModelPtr,int)));
+    connect(&fileParser, SIGNAL(parseEnded(ParsedProgramPtr,int)), this, SLOT(parseEnded(ParsedProgramPtr,int)));
+    connect(this, SIGNAL(estimateJob(ParsedProgramPtr,MachineLimits,int)), &jobEstimator, SLOT(estimateProgram(ParsedProgramPtr,MachineLimits,int)));
+    connect(&jobEstimator, SIGNAL(estimateReady(JobEstimatePtr,int)), this, SLOT(estimateReady(JobEstimatePtr,int)));
+    connect(this, SIGNAL(setEstimate(JobEstimatePtr)), &runtimeTimer, SLOT(setEstimate(JobEstimatePtr)));
+    connect(this, SIGNAL(optimizeRapids(ParsedProgramPtr,MachineLimits,int)), &rapidOptimizer, SLOT(optimizeProgram(ParsedProgramPtr,MachineLimits,int)));
+    connect(&rapidOptimizer, SIGNAL(optimizeEnded(QByteArray,QString,int)), this, SLOT(programTransformed(QByteArray,QString,int)));
+    connect(this, SIGNAL(fitArcs(ParsedProgramPtr,double,int)), &arcFitter, SLOT(fitProgram(ParsedProgramPtr,double,int)));
+    connect(&arcFitter, SIGNAL(fitEnded(QByteArray,QString,int)), this, SLOT(programTransformed(QByteArray,QString,int)));
+    connect(this, SIGNAL(simplifyPath(ParsedProgramPtr,double,double,int)), &pathSimplifier, SLOT(simplifyProgram(ParsedProgramPtr,double,double,int)));
+    connect(&pathSimplifier, SIGNAL(simplifyEnded(QByteArray,QString,int)), this, SLOT(programTransformed(QByteArray,QString,int)));
+
     // This code generates too many messages and chokes operation on raspberry pi. Do not use.
     //connect(ui->statusList->model(), SIGNAL(rowsInserted(const QModelIndex&, int, int)), ui->statusList, SLOT(scrollToBottom()));
 
@@ -152,6 +198,7 @@ MainWindow::MainWindow(QWidget *parent) :
 
     runtimeTimerThread.start();
     gcodeThread.start();
+    fileParserThread.start(QThread::LowPriority);
 
 	// Don't use - it will not show horizontal scrollbar for small app size
     //ui->statusList->setUniformItemSizes(true);
@@ -280,13 +327,17 @@ MainWindow::MainWindow(QWidget *parent) :
 
 MainWindow::~MainWindow()
 {
+    fileParser.cancel();
+    fileParserThread.quit();
+    fileParserThread.wait();
+
     delete ui;
 }
 
 void MainWindow::createGcodeConnects()
 {
 
-    connect(this, SIGNAL(sendFile(QString)), gcode, SLOT(sendFile(QString)));
+    connect(this, SIGNAL(sendFile(ParsedProgramPtr)), gcode, SLOT(sendFile(ParsedProgramPtr)));
     connect(this, SIGNAL(openPort(QString,QString)), gcode, SLOT(openPort(QString,QString)));
     connect(this, SIGNAL(closePort(bool)), gcode, SLOT(closePort(bool)));
     connect(this, SIGNAL(sendGcode(QString)), gcode, SLOT(sendGcode(QString)));
@@ -302,10 +353,13 @@ void MainWindow::createGcodeConnects()
     connect(this, SIGNAL(sendGrblUnlock()), gcode, SLOT(sendControllerUnlock()));
     connect(this, SIGNAL(goToHome()), gcode, SLOT(goToHome()));
     connect(this, SIGNAL(doTestLeveling(int, QRect, int, int, double, double, double, double)), gcode, SLOT(performZLeveling(int, QRect,int,int,double, double, double, double)));
-    connect(this, SIGNAL(setItems(QList<PosItem>)), ui->wgtVisualizer, SLOT(setItems(QList<PosItem>)));
+    connect(this, SIGNAL(setItems(ToolpathModelPtr)), ui->wgtVisualizer, SLOT(setItems(ToolpathModelPtr)));
     connect(ui->btnClearLeveling, SIGNAL(clicked()), gcode, SLOT(clearLevelingData()));
     connect(this, SIGNAL(changeInterpolator(int)), gcode, SLOT(changeInterpolator(int)));
     connect(this, SIGNAL(doRecomputeOffset(double,double)), gcode, SLOT(recomputeOffset(double,double)));
+    connect(this, SIGNAL(doReprobeLeveling(int,double,double,double)), gcode, SLOT(reprobeLeveling(int,double,double,double)));
+    connect(this, SIGNAL(saveLevelingData(QString)), gcode, SLOT(saveLevelingData(QString)));
+    connect(this, SIGNAL(loadLevelingData(QString)), gcode, SLOT(loadLevelingData(QString)));
 
     connect(gcode, SIGNAL(sendMsg(QString)),this,SLOT(receiveMsg(QString)));
     connect(gcode, SIGNAL(portIsClosed(bool)), this, SLOT(portIsClosed(bool)));
@@ -331,6 +385,9 @@ void MainWindow::createGcodeConnects()
     connect(gcode, SIGNAL(levelingProgress(int)), this, SLOT(setLevelingProgress(int)));
     connect(gcode, SIGNAL(levelingEnded()), this, SLOT(setLevelingEnded()));
     connect(gcode, SIGNAL(recomputeOffsetEnded(double)), this, SLOT(recomputeOffsetEnded(double)));
+    connect(gcode, SIGNAL(interpolatorChanged(InterpolatorPtr)), this, SLOT(setLevelingInterpolator(InterpolatorPtr)));
+    connect(gcode, SIGNAL(machineLimitsChanged(MachineLimits)), this, SLOT(setMachineLimits(MachineLimits)));
+    connect(gcode, SIGNAL(setVisCurrLine(int)), &runtimeTimer, SLOT(setCurrLine(int)));
 
 
 }
@@ -338,7 +395,7 @@ void MainWindow::createGcodeConnects()
 void MainWindow::deleteGcodeConnects()
 {
 
-    disconnect(this, SIGNAL(sendFile(QString)), gcode, SLOT(sendFile(QString)));
+    disconnect(this, SIGNAL(sendFile(ParsedProgramPtr)), gcode, SLOT(sendFile(ParsedProgramPtr)));
     disconnect(this, SIGNAL(openPort(QString,QString)), gcode, SLOT(openPort(QString,QString)));
     disconnect(this, SIGNAL(closePort(bool)), gcode, SLOT(closePort(bool)));
     disconnect(this, SIGNAL(sendGcode(QString)), gcode, SLOT(sendGcode(QString)));
@@ -354,10 +411,13 @@ void MainWindow::deleteGcodeConnects()
     disconnect(this, SIGNAL(sendGrblUnlock()), gcode, SLOT(sendControllerUnlock()));
     disconnect(this, SIGNAL(goToHome()), gcode, SLOT(goToHome()));
     disconnect(this, SIGNAL(doTestLeveling(QRect, int, int, double, double, double, double)), gcode, SLOT(performZLeveling(QRect,int,int,double, double, double, double)));
-    disconnect(this, SIGNAL(setItems(QList<PosItem>)), ui->wgtVisualizer, SLOT(setItems(QList<PosItem>)));
+    disconnect(this, SIGNAL(setItems(ToolpathModelPtr)), ui->wgtVisualizer, SLOT(setItems(ToolpathModelPtr)));
     disconnect(ui->btnClearLeveling, SIGNAL(clicked()), gcode, SLOT(clearLevelingData()));
     disconnect(this, SIGNAL(changeInterpolator(int)), gcode, SLOT(changeInterpolator(int)));
     disconnect(this, SIGNAL(doRecomputeOffset(double,double)), gcode, SLOT(recomputeOffset(double,double)));
+    disconnect(this, SIGNAL(doReprobeLeveling(int,double,double,double)), gcode, SLOT(reprobeLeveling(int,double,double,double)));
+    disconnect(this, SIGNAL(saveLevelingData(QString)), gcode, SLOT(saveLevelingData(QString)));
+    disconnect(this, SIGNAL(loadLevelingData(QString)), gcode, SLOT(loadLevelingData(QString)));
 
     disconnect(gcode, SIGNAL(sendMsg(QString)),this,SLOT(receiveMsg(QString)));
     disconnect(gcode, SIGNAL(portIsClosed(bool)), this, SLOT(portIsClosed(bool)));
@@ -383,6 +443,9 @@ void MainWindow::deleteGcodeConnects()
     disconnect(gcode, SIGNAL(levelingProgress(int)), this, SLOT(setLevelingProgress(int)));
     disconnect(gcode, SIGNAL(levelingEnded()), this, SLOT(setLevelingEnded()));
     disconnect(gcode, SIGNAL(recomputeOffsetEnded(double)), this, SLOT(recomputeOffsetEnded(double)));
+    disconnect(gcode, SIGNAL(interpolatorChanged(InterpolatorPtr)), this, SLOT(setLevelingInterpolator(InterpolatorPtr)));
+    disconnect(gcode, SIGNAL(machineLimitsChanged(MachineLimits)), this, SLOT(setMachineLimits(MachineLimits)));
+    disconnect(gcode, SIGNAL(setVisCurrLine(int)), &runtimeTimer, SLOT(setCurrLine(int)));
 
 }
 
@@ -406,6 +469,13 @@ void MainWindow::closeEvent(QCloseEvent *event)
 
 void MainWindow::begin()
 {
+    // The senders stream what was parsed when the file was opened
+    if (program.isNull())
+    {
+        ui->statusBar->showMessage(tr("The file is not loaded yet"), STATUS_MSG_TIMEOUT);
+        return;
+    }
+
     if (ui->tabAxisVisualizer->currentIndex() != TAB_VISUALIZER_INDEX)
     {
         emit ui->tabAxisVisualizer->setCurrentIndex(TAB_VISUALIZER_INDEX);
@@ -450,7 +520,7 @@ void MainWindow::begin()
         //TODO check for OK
         controlParams.zLevelingOffset = offset;
         emit setResponseWait(controlParams);
-        emit sendFile(ui->filePath->text());
+        emit sendFile(program);
     }
 }
 
@@ -497,16 +567,18 @@ void MainWindow::setLevelingEnded()
     ui->btnTestLeveling->setEnabled(true);
     ui->btnCancelLeveling->setEnabled(false);
     ui->levelingProgressBar->setVisible(false);
-    if (gcode->isZInterpolatorReady())
+    if (!levelingInterpolator.isNull())
     {
         ui->btnClearLeveling->setEnabled(true);
         ui->btnRecomputeOffset->setEnabled(true);
+        ui->btnSaveLeveling->setEnabled(true);
+        ui->btnReprobeLeveling->setEnabled(true);
         ui->levelingUseData->setChecked(true);
         ui->levelingUseData->setEnabled(true);
         controlParams.useZLevelingData = true;
-        ui->levelingRenderArea->setInterpolator(gcode->getInterpolator());
+        ui->levelingRenderArea->setInterpolator(levelingInterpolator);
 
-        int levelingAlgorithm = gcode->getInterpolator()->getType();
+        int levelingAlgorithm = levelingInterpolator->getType();
         if (levelingAlgorithm == Interpolator::SINGLE)
         {
             ui->levelingComboBox->setDisabled(true);
@@ -515,6 +587,12 @@ void MainWindow::setLevelingEnded()
             int index = ui->levelingComboBox->findData(Interpolator::SINGLE);
             ui->levelingComboBox->removeItem(index);
         }
+        //A loaded map may use another algorithm than the selected one.
+        int current = ui->levelingComboBox->findData(levelingAlgorithm);
+        if (current >= 0)
+        {
+            ui->levelingComboBox->setCurrentIndex(current);
+        }
     } else {
         //Recreate the combo and populate it.
         int levelingAlgorithm = ui->levelingComboBox->itemData(ui->levelingComboBox->currentIndex()).toInt();
@@ -536,10 +614,12 @@ void MainWindow::setLevelingEnded()
 
         ui->btnClearLeveling->setEnabled(false);
         ui->btnRecomputeOffset->setEnabled(false);
+        ui->btnSaveLeveling->setEnabled(false);
+        ui->btnReprobeLeveling->setEnabled(false);
         ui->levelingUseData->setChecked(false);
         ui->levelingUseData->setEnabled(false);
         controlParams.useZLevelingData = false;
-        ui->levelingRenderArea->setInterpolator(NULL);
+        ui->levelingRenderArea->setInterpolator(InterpolatorPtr());
         ui->levelingComboBox->clear();
         ui->levelingComboBox->addItem(QString("Bicubic Spiline"), Interpolator::SPILINE);
         ui->levelingComboBox->addItem(QString("Linear"), Interpolator::LINEAR);
@@ -549,6 +629,14 @@ void MainWindow::setLevelingEnded()
     emit setResponseWait(controlParams);
 }
 
+// The controller hands out its interpolator every time it changes. It arrives before
+// levelingEnded, so setLevelingEnded always sees the current one.
+void MainWindow::setLevelingInterpolator(InterpolatorPtr interpolator)
+{
+    TRACE_SCOPE("MainWindow::setLevelingInterpolator");
+    levelingInterpolator = interpolator;
+}
+
 void MainWindow::setLevelingProgress(int progress)
 {
     ui->levelingProgressBar->setValue(progress);
@@ -584,9 +672,9 @@ void MainWindow::levelingAlgorithmChanged(int index)
     }
 
     //TODO show a message asking for confirmation.
-    if (gcode->isZInterpolatorReady() && gcode->getInterpolator()->getType() != inter)
+    if (!levelingInterpolator.isNull() && levelingInterpolator->getType() != inter)
     {
-        ui->levelingRenderArea->setInterpolator(NULL);
+        ui->levelingRenderArea->setInterpolator(InterpolatorPtr());
         emit changeInterpolator(inter);
     }
 }
@@ -598,8 +686,10 @@ void MainWindow::clearLevelingData()
     ui->levelingUseData->setChecked(false);
     ui->levelingUseData->setEnabled(false);
     ui->btnRecomputeOffset->setEnabled(false);
+    ui->btnSaveLeveling->setEnabled(false);
+    ui->btnReprobeLeveling->setEnabled(false);
     controlParams.useZLevelingData = false;
-    ui->levelingRenderArea->setInterpolator(NULL);
+    ui->levelingRenderArea->setInterpolator(InterpolatorPtr());
     ui->levelingComboBox->setEnabled(true);
     ui->levelingComboBox->clear();
     ui->levelingComboBox->addItem(QString("Bicubic Spiline"), Interpolator::SPILINE);
@@ -616,12 +706,14 @@ void MainWindow::clearLevelingData()
 
 void MainWindow::testLeveling()
 {
-    ui->levelingRenderArea->setInterpolator(NULL);
+    ui->levelingRenderArea->setInterpolator(InterpolatorPtr());
     ui->btnTestLeveling->setEnabled(false);
     ui->levelingUseData->setEnabled(false);
     ui->btnClearLeveling->setEnabled(false);
     ui->btnCancelLeveling->setEnabled(true);
     ui->btnRecomputeOffset->setEnabled(false);
+    ui->btnSaveLeveling->setEnabled(false);
+    ui->btnReprobeLeveling->setEnabled(false);
     ui->levelingComboBox->setEnabled(false);
 
     int levelingAlgorithm = ui->levelingComboBox->itemData(ui->levelingComboBox->currentIndex()).toInt();
@@ -693,9 +785,79 @@ void MainWindow::recomputeOffset()
     emit doRecomputeOffset(speed, zStarting);
 }
 
+void MainWindow::reprobeLeveling()
+{
+    bool ok, everythingOk = true;
+    int points = ui->levelingRefPointsIn->text().toInt(&ok);
+    everythingOk &= ok;
+    double zStarting = ui->levelingZStartIn->text().toDouble(&ok);
+    everythingOk &= ok;
+    double zSafe = ui->levelingZSafeIn->text().toDouble(&ok);
+    everythingOk &= ok;
+    double speed = ui->levelingSpeedIn->text().toDouble(&ok);
+    everythingOk &= ok;
+
+    if (!everythingOk || points < 1)
+    {
+        QMessageBox::warning(this, tr("Re-probe"), tr("Please check the leveling values."));
+        return;
+    }
+
+    ui->levelingRenderArea->setInterpolator(InterpolatorPtr());
+    ui->btnTestLeveling->setEnabled(false);
+    ui->btnClearLeveling->setEnabled(false);
+    ui->btnCancelLeveling->setEnabled(true);
+    ui->btnRecomputeOffset->setEnabled(false);
+    ui->btnSaveLeveling->setEnabled(false);
+    ui->btnReprobeLeveling->setEnabled(false);
+    ui->levelingComboBox->setEnabled(false);
+
+    ui->levelingProgressBar->setMinimum(0);
+    ui->levelingProgressBar->setMaximum(points);
+    ui->levelingProgressBar->setValue(0);
+    ui->levelingProgressBar->setVisible(true);
+
+    emit doReprobeLeveling(points, zStarting, speed, zSafe);
+}
+
+void MainWindow::saveLeveling()
+{
+    QString fixture = ui->levelingFixtureCombo->currentText().trimmed();
+    if (fixture.isEmpty())
+    {
+        QMessageBox::warning(this, tr("Save height map"), tr("Please enter a fixture name."));
+        return;
+    }
+    if (!HeightMapStore::isValidFixtureName(fixture))
+    {
+        QMessageBox::warning(this, tr("Save height map"),
+                             tr("A fixture name can't contain / \\ or : nor start with a dot."));
+        return;
+    }
+
+    if (ui->levelingFixtureCombo->findText(fixture) < 0)
+    {
+        ui->levelingFixtureCombo->addItem(fixture);
+    }
+    emit saveLevelingData(HeightMapStore::fixturePath(fixture));
+}
+
+void MainWindow::loadLeveling()
+{
+    QString fixture = ui->levelingFixtureCombo->currentText().trimmed();
+    if (!HeightMapStore::isValidFixtureName(fixture))
+    {
+        return;
+    }
+
+    ui->levelingRenderArea->setInterpolator(InterpolatorPtr());
+    emit loadLevelingData(HeightMapStore::fixturePath(fixture));
+}
+
 // slot called from GCode class to update our state
 void MainWindow::stopSending()
 {
+    TRACE_SCOPE("MainWindow::stopSending");
     ui->tabAxisVisualizer->setEnabled(true);
     ui->lcdWorkNumberFourth->setEnabled(controlParams.useFourAxis);
     ui->lcdMachNumberFourth->setEnabled(controlParams.useFourAxis);
@@ -804,6 +966,7 @@ void MainWindow::openPortCtl(bool reopen)
 // so we reset the controller
 void MainWindow::portIsClosed(bool reopen)
 {
+    TRACE_SCOPE("MainWindow::portIsClosed");
     SLEEP(100);
 
     ui->tabAxisVisualizer->setEnabled(false);
@@ -832,6 +995,7 @@ void MainWindow::portIsClosed(bool reopen)
 // slot that tells us the gcode thread successfully opened the port
 void MainWindow::portIsOpen(bool sendCode)
 {
+    TRACE_SCOPE("MainWindow::portIsOpen");
     // Comm port successfully opened
     if (sendCode)
         sendGcode("");
@@ -1075,176 +1239,147 @@ void MainWindow::openFile()
     }
 }
 
+// The file is parsed in fileParserThread, the visualizer gets the toolpath in chunks
+// as it is read. Opening another file drops whatever is still being parsed.
 void MainWindow::preProcessFile(QString filepath)
 {
-    QFile file(filepath);
-    if (file.open(QFile::ReadOnly))
-    {
-        posList.clear();
+    parseGeneration = fileParser.nextGeneration();
 
-        float totalLineCount = 0;
-        QTextStream code(&file);
-        while ((code.atEnd() == false))
-        {
-            totalLineCount++;
-            code.readLine();
-        }
-        if (totalLineCount == 0)
-            totalLineCount = 1;
-
-        code.seek(0);
-
-        double x = 0;
-        double y = 0;
-        double i = 0;
-        double j = 0;
-        bool arc = false;
-        bool cw = false;
-        bool mm = true;
-        int index = 0;
-        int g = 0;
-
-        bool zeroInsert = false;
-        do
-        {
-            QString strline = code.readLine();
+    program.clear();
+    emit setItems(ToolpathModelPtr());
+    emit setEstimate(JobEstimatePtr());
 
-            index++;
+    ui->statusBar->showMessage(tr("Loading file..."));
+    emit parseFile(filepath, parseGeneration);
+}
 
-            GCodeController::trimToEnd(strline, '(');
-            GCodeController::trimToEnd(strline, ';');
-            GCodeController::trimToEnd(strline, '%');
+// Same as preProcessFile for a program built in memory, like the optimized one
+void MainWindow::preProcessSource(QString path, QByteArray source)
+{
+    parseGeneration = fileParser.nextGeneration();
 
-            strline = strline.trimmed();
+    program.clear();
+    emit setItems(ToolpathModelPtr());
+    emit setEstimate(JobEstimatePtr());
 
-            if (strline.size() == 0)
-            {}//ignore comments
-            else
-            {
-                strline = strline.toUpper();
-                strline.replace("M6", "M06");
-                strline.replace(QRegExp("([A-Z])"), " \\1");
-                strline.replace(QRegExp("\\s+"), " ");
-                //if (strline.contains("G", Qt::CaseInsensitive))
-                {
-                    if (processGCode(strline, x, y, i, j, arc, cw, mm, g))
-                    {
-                        if (!zeroInsert)
-                        {
-                            // insert 0,0 position
-                            posList.append(PosItem(0, 0, 0, 0, false, false, mm, 0));
-                            zeroInsert = true;
-                        }
-                        posList.append(PosItem(x, y, i, j, arc, cw, mm, index));
+    ui->statusBar->showMessage(tr("Loading file..."));
+    emit parseSource(path, source, parseGeneration);
+}
 
-                        //printf("Got G command:%s (%f,%f)\n", strline.toLocal8Bit().constData(), x, y);
-                    }
-                }
-            }
-        } while (code.atEnd() == false);
+void MainWindow::setParseProgress(int percent, int generation)
+{
+    if (generation != parseGeneration)
+        return;
 
-        file.close();
+    ui->statusBar->showMessage(tr("Loading file... %1%").arg(percent));
+}
 
-        emit setItems(posList);
-    }
-    else
-        printf("Can't open file\n");
+void MainWindow::receiveParsedChunk(ToolpathModelPtr model, int generation)
+{
+    if (generation != parseGeneration)
+        return;
+
+    emit setItems(model);
 }
 
-bool MainWindow::processGCode(QString inputLine, double& x, double& y, double& i, double& j, bool& arc, bool& cw, bool& mm, int& g)
+void MainWindow::parseEnded(ParsedProgramPtr parsed, int generation)
 {
-    QString line = inputLine.toUpper();
+    TRACE_SCOPE("MainWindow::parseEnded");
+    if (generation != parseGeneration)
+        return;
 
-    QStringList components = line.split(" ", QString::SkipEmptyParts);
-    QString s;
-    arc = false;
-    bool valid = false;
-    int nextIsValue = NO_ITEM;
-    foreach (s, components)
+    program = parsed;
+
+    if (program.isNull())
     {
-        if (s.at(0) == 'G')
-        {
-            int value = s.mid(1,-1).toInt();
-            if (value >= 0 && value <= 3)
-            {
-                g = value;
-                if (value == 2)
-                    cw = true;
-                else if (value == 3)
-                    cw = false;
-            }
-            else if (value == 20)
-                mm = false;
-            else if (value == 21)
-                mm = true;
-        }
-        else if (g >= 0 && g <= 3 && s.at(0) == 'X')
-        {
-            x = decodeLineItem(s, X_ITEM, valid, nextIsValue);
-        }
-        else if (g >= 0 && g <= 3 && s.at(0) == 'Y')
-        {
-            y = decodeLineItem(s, Y_ITEM, valid, nextIsValue);
-        }
-        else if ((g == 2 || g == 3) && s.at(0) == 'I')
-        {
-            i = decodeLineItem(s, I_ITEM, arc, nextIsValue);
-        }
-        else if ((g == 2 || g == 3) && s.at(0) == 'J')
-        {
-            j = decodeLineItem(s, J_ITEM, arc, nextIsValue);
-        }
-        else if (nextIsValue != NO_ITEM)
-        {
-            switch (nextIsValue)
-            {
-            case X_ITEM:
-                x = decodeDouble(s, valid);
-                break;
-            case Y_ITEM:
-                y = decodeDouble(s, valid);
-                break;
-            case I_ITEM:
-                i = decodeDouble(s, arc);
-                break;
-            case J_ITEM:
-                j = decodeDouble(s, arc);
-                break;
-            };
-            nextIsValue = NO_ITEM;
-        }
+        emit setItems(ToolpathModelPtr());
+        ui->statusBar->showMessage(tr("Can't open file"), STATUS_MSG_TIMEOUT);
+    }
+    else
+    {
+        emit setItems(program->toolpath());
+        ui->statusBar->showMessage(tr("File loaded, %1 moves").arg(program->toolpath()->count()), STATUS_MSG_TIMEOUT);
+        emit estimateJob(program, machineLimits, parseGeneration);
     }
+}
+
+void MainWindow::estimateReady(JobEstimatePtr estimate, int generation)
+{
+    if (generation != parseGeneration)
+        return;
 
-    return valid;
+    emit setEstimate(estimate);
+
+    ui->statusBar->showMessage(tr("File loaded, %1 moves, estimated run time %2")
+                               .arg(program->toolpath()->count()).arg(Timer::formatTime((int)estimate->totalTime())),
+                               STATUS_MSG_TIMEOUT);
+}
+
+// Grbl reported its settings, the estimate of the loaded file is redone with them
+void MainWindow::setMachineLimits(MachineLimits limits)
+{
+    machineLimits = limits;
+
+    if (!program.isNull())
+        emit estimateJob(program, machineLimits, parseGeneration);
 }
 
-double MainWindow::decodeLineItem(const QString& item, const int next, bool& valid, int& nextIsValue)
+// The transforms of the Tools menu run in fileParserThread, their result
+// replaces the loaded program. The file on disk is left as it is.
+bool MainWindow::canTransformProgram()
 {
-    if (item.size() == 1)
+    if (program.isNull())
     {
-        nextIsValue = next;
-        return 0;
+        ui->statusBar->showMessage(tr("The file is not loaded yet"), STATUS_MSG_TIMEOUT);
+        return false;
     }
-    else
+
+    if (!ui->openFile->isEnabled())
     {
-        nextIsValue = NO_ITEM;
-        return decodeDouble(item.mid(1,-1), valid);
+        ui->statusBar->showMessage(tr("The file can't be changed while it is being sent"), STATUS_MSG_TIMEOUT);
+        return false;
     }
+
+    return true;
+}
+
+void MainWindow::optimizeRapidMoves()
+{
+    if (!canTransformProgram())
+        return;
+
+    ui->statusBar->showMessage(tr("Optimizing rapid moves..."));
+    emit optimizeRapids(program, machineLimits, parseGeneration);
+}
+
+void MainWindow::fitArcsToProgram()
+{
+    if (!canTransformProgram())
+        return;
+
+    ui->statusBar->showMessage(tr("Fitting arcs..."));
+    emit fitArcs(program, controlParams.arcFitTolerance, parseGeneration);
 }
 
-double MainWindow::decodeDouble(QString value, bool& valid)
+void MainWindow::simplifyMoves()
 {
-    /*
-    QDoubleValidator v;
-    int pos = 0;
-    QValidator::State s = v.validate(value, pos);
-    if (s == QValidator::Invalid)
-        return 0;
-    */
-    if (value.indexOf(QRegExp("^[+-]?[0-9]*\\.?[0-9]*$")) == -1)
-        return 0;
-    valid = true;
-    return value.toDouble();
+    if (!canTransformProgram())
+        return;
+
+    ui->statusBar->showMessage(tr("Simplifying moves..."));
+    emit simplifyPath(program, controlParams.simplifyXYTolerance, controlParams.simplifyZTolerance, parseGeneration);
+}
+
+void MainWindow::programTransformed(QByteArray source, QString report, int generation)
+{
+    if (generation != parseGeneration)
+        return;
+
+    receiveList(report);
+    ui->statusBar->showMessage(report, STATUS_MSG_TIMEOUT);
+
+    if (!source.isEmpty())
+        preProcessSource(program->path(), source);
 }
 
 void MainWindow::readSettings()
@@ -1315,11 +1450,13 @@ void MainWindow::updateSettingsFromOptionDlg(QSettings& settings)
             if (gcode != NULL)
             {
                 deleteGcodeConnects();
+                gcode->setMetricsBoard(NULL);
                 gcode->closePort(false);
                 portIsClosed(false);
                 delete gcode;
             }
             gcode = new GCodeGrbl();
+            gcode->setMetricsBoard(&metricsBoard);
             gcode->moveToThread(&gcodeThread);
             createGcodeConnects();
             break;
@@ -1328,11 +1465,13 @@ void MainWindow::updateSettingsFromOptionDlg(QSettings& settings)
             if (gcode != NULL)
             {
                 deleteGcodeConnects();
+                gcode->setMetricsBoard(NULL);
                 gcode->closePort(false);
                 portIsClosed(false);
                 delete gcode;
             }
             gcode = new GCodeMarlin();
+            gcode->setMetricsBoard(&metricsBoard);
             gcode->moveToThread(&gcodeThread);
             createGcodeConnects();
             break;
@@ -1340,11 +1479,17 @@ void MainWindow::updateSettingsFromOptionDlg(QSettings& settings)
             break;
         }
 
+        // The new controller starts without leveling data
+        levelingInterpolator.clear();
         ui->statusList->clear();
         currentController = controller;
 
     }
 
+    int metricsPort = settings.value(SETTINGS_METRICS_PORT, 0).value<int>();
+    if (!metricsServer.listen(metricsPort))
+        receiveList(tr("Can't serve metrics on port %1: %2").arg(metricsPort).arg(metricsServer.errorString()));
+
     QString sinvX = settings.value(SETTINGS_INVERSE_X, "false").value<QString>();
     QString sinvY = settings.value(SETTINGS_INVERSE_Y, "false").value<QString>();
     QString sinvZ = settings.value(SETTINGS_INVERSE_Z, "false").value<QString>();
@@ -1372,22 +1517,7 @@ void MainWindow::updateSettingsFromOptionDlg(QSettings& settings)
     invZ = sinvZ == "true";
     invFourth = sinvFourth == "true";
 
-    controlParams.waitTime = settings.value(SETTINGS_RESPONSE_WAIT_TIME, DEFAULT_WAIT_TIME_SEC).value<int>();
-    controlParams.zJogRate = settings.value(SETTINGS_Z_JOG_RATE, DEFAULT_Z_JOG_RATE).value<double>();
-    QString useMmManualCmds = settings.value(SETTINGS_USE_MM_FOR_MANUAL_CMDS, "true").value<QString>();
-    controlParams.useMm = useMmManualCmds == "true";
-    QString useAggrPreload = settings.value(SETTINGS_USE_AGGRESSIVE_PRELOAD, "true").value<QString>();
-    controlParams.useAggressivePreload = useAggrPreload == "true";
-    QString waitForJogToComplete = settings.value(SETTINGS_WAIT_FOR_JOG_TO_COMPLETE, "true").value<QString>();
-    controlParams.waitForJogToComplete = waitForJogToComplete == "true";
-
-    QString useFourAxis = settings.value(SETTINGS_FOUR_AXIS_USE, "false").value<QString>();
-    controlParams.useFourAxis = useFourAxis == "true";
-    if (controlParams.useFourAxis)
-    {
-        char type = settings.value(SETTINGS_FOUR_AXIS_TYPE, FOURTH_AXIS_A).value<char>();
-        controlParams.fourthAxisType = type;
-    }
+    controlParams.readSettings(settings);
 
     ui->lcdWorkNumberFourth->setEnabled(controlParams.useFourAxis);
     ui->lcdMachNumberFourth->setEnabled(controlParams.useFourAxis);
@@ -1438,25 +1568,6 @@ void MainWindow::updateSettingsFromOptionDlg(QSettings& settings)
         ui->lblFourthJog->setText(axisJog);
     }
 
-    QString zRateLimit = settings.value(SETTINGS_Z_RATE_LIMIT, "false").value<QString>();
-    controlParams.zRateLimit = zRateLimit == "true";
-
-    QString ffCommands = settings.value(SETTINGS_FILTER_FILE_COMMANDS, "false").value<QString>();
-    controlParams.filterFileCommands = ffCommands == "true";
-    QString rPrecision = settings.value(SETTINGS_REDUCE_PREC_FOR_LONG_LINES, "false").value<QString>();
-    controlParams.reducePrecision = rPrecision == "true";
-    controlParams.grblLineBufferLen = settings.value(SETTINGS_GRBL_LINE_BUFFER_LEN, DEFAULT_GRBL_LINE_BUFFER_LEN).value<int>();
-    controlParams.charSendDelayMs = settings.value(SETTINGS_CHAR_SEND_DELAY_MS, DEFAULT_CHAR_SEND_DELAY_MS).value<int>();
-
-    controlParams.zRateLimitAmount = settings.value(SETTINGS_Z_RATE_LIMIT_AMOUNT, DEFAULT_Z_LIMIT_RATE).value<double>();
-    controlParams.xyRateAmount = settings.value(SETTINGS_XY_RATE_AMOUNT, DEFAULT_XY_RATE).value<double>();
-
-    QString enPosReq = settings.value(SETTINGS_ENABLE_POS_REQ, "true").value<QString>();
-    controlParams.usePositionRequest = enPosReq == "true";
-    controlParams.positionRequestType = settings.value(SETTINGS_TYPE_POS_REQ, PREQ_ALWAYS_NO_IDLE_CHK).value<QString>();
-    double posReqFreq = settings.value(SETTINGS_POS_REQ_FREQ_SEC, DEFAULT_POS_REQ_FREQ_SEC).value<double>();
-    controlParams.postionRequestTimeMilliSec = static_cast<int>(posReqFreq) * 1000;
-
     setLcdState(controlParams.usePositionRequest);
 }
 
@@ -1491,16 +1602,19 @@ void MainWindow::writeSettings()
 
 void MainWindow::receiveList(QString msg)
 {
+    TRACE_SCOPE("MainWindow::receiveList");
     addToStatusList(true, msg);
 }
 
 void MainWindow::receiveListFull(QStringList list)
 {
+    TRACE_SCOPE("MainWindow::receiveListFull");
     addToStatusList(list);
 }
 
 void MainWindow::receiveListOut(QString msg)
 {
+    TRACE_SCOPE("MainWindow::receiveListOut");
     addToStatusList(false, msg);
 }
 
@@ -1634,6 +1748,7 @@ int MainWindow::computeListViewMinimumWidth(QAbstractItemView* view)
 
 void MainWindow::receiveMsg(QString msg)
 {
+    TRACE_SCOPE("MainWindow::receiveMsg");
     ui->centralWidget->setStatusTip(msg);
 }
 
@@ -1672,6 +1787,7 @@ void MainWindow::toggleRestoreAbsolute()
 
 void MainWindow::updateCoordinates(Coord3D machineCoord, Coord3D workCoord)
 {
+    TRACE_SCOPE("MainWindow::updateCoordinates");
     ui->lcdWorkNumberFourth->setEnabled(controlParams.useFourAxis);
     ui->lcdMachNumberFourth->setEnabled(controlParams.useFourAxis);
     ui->IncFourthBtn->setEnabled(controlParams.useFourAxis);
@@ -1853,6 +1969,7 @@ void MainWindow::zJogSliderReleased()
 
 void MainWindow::setQueuedCommands(int commandCount, bool running)
 {
+    TRACE_SCOPE("MainWindow::setQueuedCommands");
     if (running)
     {
         switch (queuedCommandState)
@@ -1915,6 +2032,7 @@ void MainWindow::setQueuedCommands(int commandCount, bool running)
 
 void MainWindow::setLcdState(bool valid)
 {
+    TRACE_SCOPE("MainWindow::setLcdState");
     if (lastLcdStateValid != valid)
     {
         QString ss = "";
@@ -26,14 +26,18 @@
 //#include "filesender.h"
 #include "timer.h"
 #include "positem.h"
+#include "toolpathmodel.h"
+#include "fileparser.h"
+#include "jobestimator.h"
+#include "rapidoptimizer.h"
+#include "arcfitter.h"
+#include "pathsimplifier.h"
 #include "gcodecontroller.h"
+#include "metricsboard.h"
+#include "metricsserver.h"
 #include "renderarea.h"
 #include "log4qtdef.h"
 
-#define COMPANY_NAME "zapmaker"
-#define APPLICATION_NAME "GrblController"
-#define DOMAIN_NAME "org.zapmaker"
-
 #define TAB_AXIS_INDEX          0
 #define TAB_VISUALIZER_INDEX    1
 #define TAB_ADVANCED_INDEX      2
@@ -43,6 +47,8 @@
 
 #define MAX_STATUS_LINES_WHEN_ACTIVE        200
 
+#define STATUS_MSG_TIMEOUT                  5000
+
 /* testing optimizing scrollbar, doesn't work right
 class MyItemDelegate : public QItemDelegate
 {
@@ -101,7 +107,7 @@ signals:
     void closePort(bool reopen);
     void shutdown();
     void sendGcode(QString line, bool recordResponseOnFail = false, int waitCount = SHORT_WAIT_SEC);
-    void sendFile(QString path);
+    void sendFile(ParsedProgramPtr program);
     void gotoXYZFourth(QString line);
     void axisAdj(char axis, float coord, bool inv, bool absoluteAfterAxisAdj, int sliderZCount);
     void setResponseWait(ControlParams controlParams);
@@ -111,10 +117,20 @@ signals:
     void sendGrblReset();
     void sendGrblUnlock();
     void goToHome();
-    void setItems(QList<PosItem>);
+    void setItems(ToolpathModelPtr items);
     void doTestLeveling(int levelingAlgorithm, QRect rect, int xSteps, int ySteps, double zStarting, double speed, double zHeight, double offset);
     void changeInterpolator(int index);
     void doRecomputeOffset(double speed, double zStarting);
+    void doReprobeLeveling(int points, double zStarting, double speed, double zSafe);
+    void saveLevelingData(QString path);
+    void loadLevelingData(QString path);
+    void parseFile(QString path, int generation);
+    void estimateJob(ParsedProgramPtr program, MachineLimits limits, int generation);
+    void setEstimate(JobEstimatePtr estimate);
+    void parseSource(QString path, QByteArray source, int generation);
+    void optimizeRapids(ParsedProgramPtr program, MachineLimits limits, int generation);
+    void fitArcs(ParsedProgramPtr program, double tolerance, int generation);
+    void simplifyPath(ParsedProgramPtr program, double xyTolerance, double zTolerance, int generation);
 
 private slots:
     //buttons
@@ -176,23 +192,28 @@ private slots:
     void comboStepChanged(const QString& text);
     void setLevelingProgress(int progress);
     void setLevelingEnded();
+    void setLevelingInterpolator(InterpolatorPtr interpolator);
     void useZLevelingDataToggle(bool checked);
     void clearLevelingData();
     void levelingAlgorithmChanged(int);
     void recomputeOffset();
     void recomputeOffsetEnded(double newOffset);
+    void reprobeLeveling();
+    void saveLeveling();
+    void loadLeveling();
+    void setParseProgress(int percent, int generation);
+    void receiveParsedChunk(ToolpathModelPtr model, int generation);
+    void parseEnded(ParsedProgramPtr parsed, int generation);
+    void estimateReady(JobEstimatePtr estimate, int generation);
+    void setMachineLimits(MachineLimits limits);
+    void optimizeRapidMoves();
+    void fitArcsToProgram();
+    void simplifyMoves();
+    void programTransformed(QByteArray source, QString report, int generation);
 
 private:
     // enums
     enum
-    {
-        NO_ITEM = 0,
-        X_ITEM,
-        Y_ITEM,
-        I_ITEM,
-        J_ITEM,
-    };
-    enum
     {
         QCS_OK = 0,
         QCS_WAITING_FOR_ITEMS
@@ -207,6 +228,17 @@ private:
     Timer runtimeTimer;
     QThread runtimeTimerThread;
 
+    FileParser fileParser;
+    QThread fileParserThread;
+    int parseGeneration;
+    JobEstimator jobEstimator;
+    RapidOptimizer rapidOptimizer;
+    ArcFitter arcFitter;
+    PathSimplifier pathSimplifier;
+    MachineLimits machineLimits;
+    MetricsBoard metricsBoard;
+    MetricsServer metricsServer;
+
     int currentController;
 
     //variables
@@ -231,7 +263,7 @@ private:
     QTime scrollStatusTimer;
     QTime queuedCommandsEmptyTimer;
     QTime queuedCommandsRefreshTimer;
-    QList<PosItem> posList;
+    ParsedProgramPtr program;
     bool sliderPressed;
     double sliderTo;
     int sliderZCount;
@@ -247,6 +279,7 @@ private:
     bool lastLcdStateValid;
     float jogStep;
     QString jogStepStr;
+    InterpolatorPtr levelingInterpolator;
 
     //methods
     int SendJog(QString strline);
@@ -262,9 +295,8 @@ private:
     void updateSettingsFromOptionDlg(QSettings& settings);
     int computeListViewMinimumWidth(QAbstractItemView* view);
     void preProcessFile(QString filepath);
-    bool processGCode(QString inputLine, double& x, double& y, double& i, double& j, bool& arc, bool& cw, bool& mm, int& g);
-    double decodeLineItem(const QString& item, const int next, bool& valid, int& nextIsValue);
-    double decodeDouble(QString value, bool& valid);
+    void preProcessSource(QString path, QByteArray source);
+    bool canTransformProgram();
 
     void createGcodeConnects();
     void deleteGcodeConnects();
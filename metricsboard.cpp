@@ -0,0 +1,49 @@
+/****************************************************************
+ * metricsboard.cpp
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#include "metricsboard.h"
+
+#include <string.h>
+
+MachineMetrics::MachineMetrics()
+    : portOpen(false), mm(true), axisCount(3), jobRunning(false),
+      linesSent(0), linesAcked(0), errors(0), bytesSent(0), bytesPerSec(0),
+      ackP50Us(0), ackP90Us(0), ackP99Us(0), ackCount(0), ackSumUs(0),
+      queueDepth(0), progress(0), elapsedMs(0), etaMs(-1)
+{
+    memset(state, 0, sizeof(state));
+    for (int i = 0; i < METRICS_AXIS_COUNT; i++)
+    {
+        machinePos[i] = 0;
+        workPos[i] = 0;
+    }
+}
+
+MetricsBoard::MetricsBoard(const QString& name)
+    : machineName(name), middle(1), writeIndex(0), readIndex(2)
+{
+}
+
+void MetricsBoard::publish(const MachineMetrics& metrics)
+{
+    buffers[writeIndex] = metrics;
+
+    // The ordered exchange makes the copy visible before the index
+    int previous = middle.fetchAndStoreOrdered(writeIndex | FRESH);
+    writeIndex = previous & ~FRESH;
+}
+
+MachineMetrics MetricsBoard::snapshot()
+{
+    if (middle.loadAcquire() & FRESH)
+    {
+        int previous = middle.fetchAndStoreOrdered(readIndex);
+        readIndex = previous & ~FRESH;
+    }
+    return buffers[readIndex];
+}
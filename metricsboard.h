@@ -0,0 +1,83 @@
+/****************************************************************
+ * metricsboard.h
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#ifndef METRICSBOARD_H
+#define METRICSBOARD_H
+
+#include <QString>
+#include <QAtomicInt>
+
+#define METRICS_STATE_SIZE      16
+#define METRICS_AXIS_COUNT      4
+
+/**
+ * @brief What a machine shows on a dashboard, plain values only so it copies as a block.
+ */
+struct MachineMetrics
+{
+    MachineMetrics();
+
+    char state[METRICS_STATE_SIZE];         // as in the last status report, empty if unknown
+    bool portOpen;
+    bool mm;                                // units of the coordinates
+    double machinePos[METRICS_AXIS_COUNT];
+    double workPos[METRICS_AXIS_COUNT];
+    int axisCount;
+
+    // Current file send, or the last one once it ended
+    bool jobRunning;
+    qint64 linesSent;
+    qint64 linesAcked;
+    qint64 errors;
+    qint64 bytesSent;
+    double bytesPerSec;
+    qint64 ackP50Us;
+    qint64 ackP90Us;
+    qint64 ackP99Us;
+    qint64 ackCount;
+    qint64 ackSumUs;
+    int queueDepth;
+    double progress;                        // 0 to 1
+    qint64 elapsedMs;
+    qint64 etaMs;                           // -1 until something was sent
+};
+
+/**
+ * @brief Hands the metrics of one controller to one reader without locks.
+ *
+ * A triple buffer: the controller thread fills a spare copy and swaps it
+ * in with one atomic exchange, the reader swaps the newest copy out the
+ * same way. Neither side ever waits for the other, so a scrape can't
+ * slow the stream, and the reader always gets a whole snapshot.
+ *
+ * Only one thread may publish and only one thread may take snapshots.
+ */
+class MetricsBoard
+{
+public:
+    MetricsBoard(const QString& name);
+
+    QString name() const { return machineName; }
+
+    // Controller thread
+    void publish(const MachineMetrics& metrics);
+
+    // Reader thread, the newest published metrics
+    MachineMetrics snapshot();
+
+private:
+    enum { FRESH = 4 };
+
+    QString machineName;
+    MachineMetrics buffers[3];
+    QAtomicInt middle;          // index of the buffer between the two sides, FRESH if not read yet
+    int writeIndex;
+    int readIndex;
+};
+
+#endif // METRICSBOARD_H
@@ -0,0 +1,223 @@
+/****************************************************************
+ * metricsserver.cpp
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#include "metricsserver.h"
+#include "definitions.h"
+
+#include <QHostAddress>
+#include <QTextStream>
+
+static QString labelValue(const QString& value)
+{
+    QString escaped = value;
+    escaped.replace('\\', "\\\\").replace('"', "\\\"").replace('\n', "\\n");
+    return escaped;
+}
+
+static void header(QTextStream& out, const char *name, const char *type, const char *help)
+{
+    out << "# HELP " << name << " " << help << "\n";
+    out << "# TYPE " << name << " " << type << "\n";
+}
+
+MetricsServer::MetricsServer(QObject *parent)
+    : QObject(parent)
+{
+    connect(&server, SIGNAL(newConnection()), this, SLOT(newConnection()));
+}
+
+void MetricsServer::addBoard(MetricsBoard *board)
+{
+    if (!boards.contains(board))
+        boards.append(board);
+}
+
+void MetricsServer::removeBoard(MetricsBoard *board)
+{
+    boards.removeAll(board);
+}
+
+bool MetricsServer::listen(quint16 port)
+{
+    if (server.isListening())
+    {
+        if (server.serverPort() == port)
+            return true;
+        server.close();
+    }
+
+    if (port == 0)
+        return true;
+
+    if (!server.listen(QHostAddress::LocalHost, port))
+    {
+        warn("Can't serve metrics on port %d: %s", port, qPrintable(server.errorString()));
+        return false;
+    }
+
+    info("Serving metrics on http://localhost:%d/metrics", port);
+    return true;
+}
+
+void MetricsServer::newConnection()
+{
+    while (server.hasPendingConnections())
+    {
+        QTcpSocket *socket = server.nextPendingConnection();
+        connect(socket, SIGNAL(readyRead()), this, SLOT(readRequest()));
+        connect(socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()));
+    }
+}
+
+// One request per connection, answered once its headers are in
+void MetricsServer::readRequest()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+    if (socket == NULL)
+        return;
+
+    QByteArray request = socket->peek(METRICS_MAX_REQUEST);
+    if (!request.contains("\r\n\r\n") && !request.contains("\n\n"))
+    {
+        if (request.size() >= METRICS_MAX_REQUEST)
+            socket->abort();
+        return;
+    }
+    socket->readAll();
+    disconnect(socket, SIGNAL(readyRead()), this, SLOT(readRequest()));
+
+    QList<QByteArray> requestLine = request.left(request.indexOf('\n')).trimmed().split(' ');
+    QByteArray method = requestLine.value(0);
+    QByteArray path = requestLine.value(1);
+
+    QByteArray status;
+    QByteArray body;
+    if (method != "GET")
+    {
+        status = "405 Method Not Allowed";
+        body = "Only GET is supported\n";
+    }
+    else if (path == "/metrics" || path.startsWith("/metrics?"))
+    {
+        status = "200 OK";
+        body = render();
+    }
+    else
+    {
+        status = "404 Not Found";
+        body = "Metrics are at /metrics\n";
+    }
+
+    QByteArray response;
+    response.append("HTTP/1.0 ").append(status).append("\r\n");
+    response.append("Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n");
+    response.append("Content-Length: ").append(QByteArray::number(body.size())).append("\r\n");
+    response.append("Connection: close\r\n\r\n");
+    response.append(body);
+
+    socket->write(response);
+    socket->disconnectFromHost();
+}
+
+QByteArray MetricsServer::render()
+{
+    QList<MachineMetrics> snapshots;
+    QStringList names;
+    foreach (MetricsBoard *board, boards)
+    {
+        snapshots.append(board->snapshot());
+        names.append(labelValue(board->name()));
+    }
+
+    QString text;
+    QTextStream out(&text);
+    out.setRealNumberPrecision(10);
+
+    header(out, "grbl_port_open", "gauge", "1 when the serial port of the machine is open.");
+    for (int i = 0; i < snapshots.size(); i++)
+        out << "grbl_port_open{machine=\"" << names.at(i) << "\"} " << (snapshots.at(i).portOpen ? 1 : 0) << "\n";
+
+    header(out, "grbl_machine_state", "gauge", "State from the last status report, the current one is 1.");
+    for (int i = 0; i < snapshots.size(); i++)
+    {
+        QString state = QString::fromLatin1(snapshots.at(i).state);
+        if (!state.isEmpty())
+            out << "grbl_machine_state{machine=\"" << names.at(i) << "\",state=\"" << labelValue(state) << "\"} 1\n";
+    }
+
+    const char *axes[METRICS_AXIS_COUNT] = { "x", "y", "z", "fourth" };
+    header(out, "grbl_machine_position", "gauge", "Machine coordinates, in the units of the unit label.");
+    for (int i = 0; i < snapshots.size(); i++)
+    {
+        const MachineMetrics& m = snapshots.at(i);
+        for (int axis = 0; axis < m.axisCount && axis < METRICS_AXIS_COUNT; axis++)
+            out << "grbl_machine_position{machine=\"" << names.at(i) << "\",axis=\"" << axes[axis]
+                << "\",unit=\"" << (m.mm ? "mm" : "inch") << "\"} " << m.machinePos[axis] << "\n";
+    }
+    header(out, "grbl_work_position", "gauge", "Work coordinates, in the units of the unit label.");
+    for (int i = 0; i < snapshots.size(); i++)
+    {
+        const MachineMetrics& m = snapshots.at(i);
+        for (int axis = 0; axis < m.axisCount && axis < METRICS_AXIS_COUNT; axis++)
+            out << "grbl_work_position{machine=\"" << names.at(i) << "\",axis=\"" << axes[axis]
+                << "\",unit=\"" << (m.mm ? "mm" : "inch") << "\"} " << m.workPos[axis] << "\n";
+    }
+
+    header(out, "grbl_job_running", "gauge", "1 while a file is being sent.");
+    for (int i = 0; i < snapshots.size(); i++)
+        out << "grbl_job_running{machine=\"" << names.at(i) << "\"} " << (snapshots.at(i).jobRunning ? 1 : 0) << "\n";
+
+    // Per job, they start again from 0 with every file
+    header(out, "grbl_job_lines_sent", "gauge", "Lines written to the port in the current or last file.");
+    for (int i = 0; i < snapshots.size(); i++)
+        out << "grbl_job_lines_sent{machine=\"" << names.at(i) << "\"} " << snapshots.at(i).linesSent << "\n";
+    header(out, "grbl_job_lines_acked", "gauge", "Lines answered with ok in the current or last file.");
+    for (int i = 0; i < snapshots.size(); i++)
+        out << "grbl_job_lines_acked{machine=\"" << names.at(i) << "\"} " << snapshots.at(i).linesAcked << "\n";
+    header(out, "grbl_job_errors", "gauge", "Lines answered with error in the current or last file.");
+    for (int i = 0; i < snapshots.size(); i++)
+        out << "grbl_job_errors{machine=\"" << names.at(i) << "\"} " << snapshots.at(i).errors << "\n";
+    header(out, "grbl_job_bytes_sent", "gauge", "Bytes written to the port in the current or last file.");
+    for (int i = 0; i < snapshots.size(); i++)
+        out << "grbl_job_bytes_sent{machine=\"" << names.at(i) << "\"} " << snapshots.at(i).bytesSent << "\n";
+    header(out, "grbl_job_bytes_per_second", "gauge", "Average rate of the current or last file.");
+    for (int i = 0; i < snapshots.size(); i++)
+        out << "grbl_job_bytes_per_second{machine=\"" << names.at(i) << "\"} " << snapshots.at(i).bytesPerSec << "\n";
+
+    header(out, "grbl_ack_latency_seconds", "summary", "Line written to its ok or error, in the current or last file.");
+    for (int i = 0; i < snapshots.size(); i++)
+    {
+        const MachineMetrics& m = snapshots.at(i);
+        out << "grbl_ack_latency_seconds{machine=\"" << names.at(i) << "\",quantile=\"0.5\"} " << m.ackP50Us / 1e6 << "\n";
+        out << "grbl_ack_latency_seconds{machine=\"" << names.at(i) << "\",quantile=\"0.9\"} " << m.ackP90Us / 1e6 << "\n";
+        out << "grbl_ack_latency_seconds{machine=\"" << names.at(i) << "\",quantile=\"0.99\"} " << m.ackP99Us / 1e6 << "\n";
+        out << "grbl_ack_latency_seconds_sum{machine=\"" << names.at(i) << "\"} " << m.ackSumUs / 1e6 << "\n";
+        out << "grbl_ack_latency_seconds_count{machine=\"" << names.at(i) << "\"} " << m.ackCount << "\n";
+    }
+
+    header(out, "grbl_queue_depth", "gauge", "Lines written and waiting for their ok.");
+    for (int i = 0; i < snapshots.size(); i++)
+        out << "grbl_queue_depth{machine=\"" << names.at(i) << "\"} " << snapshots.at(i).queueDepth << "\n";
+
+    header(out, "grbl_job_progress_ratio", "gauge", "Part of the current or last file sent, 0 to 1.");
+    for (int i = 0; i < snapshots.size(); i++)
+        out << "grbl_job_progress_ratio{machine=\"" << names.at(i) << "\"} " << snapshots.at(i).progress << "\n";
+    header(out, "grbl_job_elapsed_seconds", "gauge", "Time spent on the current or last file.");
+    for (int i = 0; i < snapshots.size(); i++)
+        out << "grbl_job_elapsed_seconds{machine=\"" << names.at(i) << "\"} " << snapshots.at(i).elapsedMs / 1000.0 << "\n";
+    header(out, "grbl_job_eta_seconds", "gauge", "Time left on the current file at the rate so far, 0 when not sending.");
+    for (int i = 0; i < snapshots.size(); i++)
+    {
+        const MachineMetrics& m = snapshots.at(i);
+        out << "grbl_job_eta_seconds{machine=\"" << names.at(i) << "\"} "
+            << (m.jobRunning && m.etaMs >= 0 ? m.etaMs / 1000.0 : 0) << "\n";
+    }
+
+    out.flush();
+    return text.toUtf8();
+}
@@ -0,0 +1,56 @@
+/****************************************************************
+ * metricsserver.h
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#ifndef METRICSSERVER_H
+#define METRICSSERVER_H
+
+#include <QObject>
+#include <QList>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include "metricsboard.h"
+
+#define METRICS_MAX_REQUEST     8192    // bytes of request headers read before giving up
+
+/**
+ * @brief Serves the metrics of the machines in the Prometheus text format.
+ *
+ * Listens on the loopback only. GET /metrics answers with one sample per
+ * metric and machine, labelled with the machine name, anything else gets
+ * a 404. Each answer takes a snapshot of every board, the controllers
+ * are never waited for.
+ *
+ * Lives on the thread that created it, which is then the only reader of
+ * the boards.
+ */
+class MetricsServer : public QObject
+{
+    Q_OBJECT
+public:
+    MetricsServer(QObject *parent = 0);
+
+    void addBoard(MetricsBoard *board);
+    void removeBoard(MetricsBoard *board);
+
+    // 0 stops serving, returns false if the port can't be listened on
+    bool listen(quint16 port);
+    quint16 port() const { return server.isListening() ? server.serverPort() : 0; }
+    QString errorString() const { return server.errorString(); }
+
+    QByteArray render();
+
+private slots:
+    void newConnection();
+    void readRequest();
+
+private:
+    QTcpServer server;
+    QList<MetricsBoard *> boards;
+};
+
+#endif // METRICSSERVER_H
@@ -0,0 +1,150 @@
+/****************************************************************
+ * modalwalker.cpp
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#include "modalwalker.h"
+#include "parsedprogram.h"
+
+#include <math.h>
+
+ModalWalker::ModalWalker()
+{
+    reset();
+}
+
+void ModalWalker::reset()
+{
+    motion = 0;
+    plane = 170;
+    mm = true;
+    absolute = true;
+    inverseTime = false;
+    feed = 0;
+    for (int i = 0; i < MODAL_AXIS_COUNT; i++)
+        position[i] = 0;
+}
+
+void ModalWalker::read(const QLatin1String& words, Line& line)
+{
+    const char *p = words.data();
+    const char *end = p + words.size();
+
+    for (int i = 0; i < MODAL_AXIS_COUNT; i++)
+    {
+        line.target[i] = 0;
+        line.hasAxis[i] = false;
+        line.offset[i] = 0;
+    }
+    line.radius = 0;
+    line.hasRadius = false;
+    line.feed = -1;
+    line.p = 0;
+    line.setsMotion = false;
+    line.letters = 0;
+    line.codeCount = 0;
+    line.moreCodes = false;
+
+    while (p < end)
+    {
+        char letter = *p;
+        p++;
+        if (letter < 'A' || letter > 'Z')
+            continue;
+
+        double value = ParsedProgram::readValue(p, end);
+        line.letters |= 1u << (letter - 'A');
+        switch (letter)
+        {
+        case 'G':
+        {
+            int code = (int)floor(value * 10 + 0.5);
+            if (line.codeCount < MODAL_MAX_CODES)
+                line.codes[line.codeCount++] = code;
+            else
+                line.moreCodes = true;
+
+            if (code == 0 || code == 10 || code == 20 || code == 30)
+            {
+                motion = code / 10;
+                line.setsMotion = true;
+            }
+            else if (code == 800 || (code >= 382 && code <= 385))
+            {
+                motion = MODAL_MOTION_OTHER;
+                line.setsMotion = true;
+            }
+            else if (code == 170 || code == 180 || code == 190)
+                plane = code;
+            else if (code == 200 || code == 210)
+                mm = code == 210;
+            else if (code == 900 || code == 910)
+                absolute = code == 900;
+            else if (code == 930 || code == 940)
+                inverseTime = code == 930;
+            break;
+        }
+        case 'X':
+        case 'Y':
+        case 'Z':
+            line.target[letter - 'X'] = value;
+            line.hasAxis[letter - 'X'] = true;
+            break;
+        case 'I':
+        case 'J':
+        case 'K':
+            line.offset[letter - 'I'] = value;
+            break;
+        case 'R':
+            line.radius = value;
+            line.hasRadius = true;
+            break;
+        case 'F':
+            line.feed = value;
+            feed = value;
+            break;
+        case 'P':
+            line.p = value;
+            break;
+        }
+    }
+
+    for (int i = 0; i < MODAL_AXIS_COUNT; i++)
+    {
+        if (line.hasAxis[i])
+            position[i] = absolute ? line.target[i] : position[i] + line.target[i];
+    }
+}
+
+bool ModalWalker::Line::hasCode(int code) const
+{
+    for (int i = 0; i < codeCount; i++)
+    {
+        if (codes[i] == code)
+            return true;
+    }
+    return false;
+}
+
+bool ModalWalker::Line::onlyCode(int code) const
+{
+    if (moreCodes)
+        return false;
+    for (int i = 0; i < codeCount; i++)
+    {
+        if (codes[i] != code)
+            return false;
+    }
+    return true;
+}
+
+bool ModalWalker::Line::onlyLetters(const char *allowed) const
+{
+    quint32 mask = 0;
+    for (const char *c = allowed; *c; c++)
+        mask |= 1u << (*c - 'A');
+    return (letters & ~mask) == 0;
+}
@@ -0,0 +1,69 @@
+/****************************************************************
+ * modalwalker.h
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#ifndef MODALWALKER_H
+#define MODALWALKER_H
+
+#include <QLatin1String>
+
+#define MODAL_MOTION_OTHER      -1  // G38.x, G80, no move until the next motion word
+#define MODAL_MAX_CODES         8   // G words kept of a line, more are read but not kept
+#define MODAL_AXIS_COUNT        3
+
+/**
+ * @brief Follows the modal state through the words of a ParsedProgram.
+ *
+ * Reads one line at a time and leaves the state as the line leaves it:
+ * motion, plane, units, distance and feed mode, feed and the position in
+ * program units. What the line itself holds is returned in a Line, with
+ * its G words as ten times their number (G38.2 is 382), so every
+ * transform of the program reads the words the same way and only decides
+ * for itself what it leaves alone.
+ */
+class ModalWalker
+{
+public:
+    struct Line
+    {
+        double target[MODAL_AXIS_COUNT];    // axis words as written
+        bool hasAxis[MODAL_AXIS_COUNT];
+        double offset[MODAL_AXIS_COUNT];    // I, J and K, 0 when missing
+        double radius;
+        bool hasRadius;
+        double feed;                        // -1 without an F word
+        double p;                           // P word, 0 when missing
+        bool setsMotion;                    // a motion word, G38.x or G80
+        quint32 letters;                    // bit letter - 'A' of every word
+        int codes[MODAL_MAX_CODES];
+        int codeCount;
+        bool moreCodes;                     // codes has not all of them
+
+        bool hasAxes() const { return hasAxis[0] || hasAxis[1] || hasAxis[2]; }
+        bool hasCode(int code) const;
+        // Every G word of the line is code, true without any
+        bool onlyCode(int code) const;
+        // Every word letter of the line is one of letters
+        bool onlyLetters(const char *letters) const;
+    };
+
+    ModalWalker();
+
+    void reset();
+    void read(const QLatin1String& words, Line& line);
+
+public:
+    int motion;             // 0 to 3 or MODAL_MOTION_OTHER
+    int plane;              // 170, 180 or 190
+    bool mm;
+    bool absolute;
+    bool inverseTime;
+    double feed;
+    double position[MODAL_AXIS_COUNT];
+};
+
+#endif // MODALWALKER_H
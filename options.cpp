@@ -9,6 +9,7 @@
 
 #include "options.h"
 #include "ui_options.h"
+#include "wiretrace.h"
 
 Options::Options(QWidget *parent) :
     QDialog(parent),
@@ -19,6 +20,11 @@ Options::Options(QWidget *parent) :
     ui->controllerComboBox->addItem(QString("Grbl"));
     ui->controllerComboBox->addItem(QString("Marlin"));
 
+    // In the order of WIRE_TRACE_OFF, WIRE_TRACE_FILE and WIRE_TRACE_FLIGHT
+    ui->comboWireTrace->addItem(tr("Off"));
+    ui->comboWireTrace->addItem(tr("Everything"));
+    ui->comboWireTrace->addItem(tr("Last moments on error"));
+
 
     connect(ui->checkBoxUseMmManualCmds,SIGNAL(toggled(bool)),this,SLOT(toggleUseMm(bool)));
     connect(ui->chkLimitZRate,SIGNAL(toggled(bool)),this,SLOT(toggleLimitZRate(bool)));
@@ -101,6 +107,9 @@ Options::Options(QWidget *parent) :
     double zJogRate = settings.value(SETTINGS_Z_JOG_RATE, DEFAULT_Z_JOG_RATE).value<double>();
     ui->doubleSpinZJogRate->setValue(zJogRate);
 
+    int metricsPort = settings.value(SETTINGS_METRICS_PORT, 0).value<int>();
+    ui->spinMetricsPort->setValue(metricsPort);
+
     QString zRateLimit = settings.value(SETTINGS_Z_RATE_LIMIT, "false").value<QString>();
     ui->chkLimitZRate->setChecked(zRateLimit == "true");
 
@@ -119,8 +128,22 @@ Options::Options(QWidget *parent) :
     ui->chkFilterFileCommands->setChecked(ffCmd == "true");
     QString rPrecision = settings.value(SETTINGS_REDUCE_PREC_FOR_LONG_LINES, "false").value<QString>();
     ui->checkBoxReducePrecForLongLines->setChecked(rPrecision == "true");
+    QString compactLines = settings.value(SETTINGS_COMPACT_LINES, "false").value<QString>();
+    ui->checkBoxCompactLines->setChecked(compactLines == "true");
     ui->spinBoxGrblLineBufferSize->setValue(settings.value(SETTINGS_GRBL_LINE_BUFFER_LEN, DEFAULT_GRBL_LINE_BUFFER_LEN).value<int>());
     ui->spinBoxCharSendDelay->setValue(settings.value(SETTINGS_CHAR_SEND_DELAY_MS, DEFAULT_CHAR_SEND_DELAY_MS).value<int>());
+    ui->comboWireTrace->setCurrentIndex(settings.value(SETTINGS_WIRE_TRACE, WIRE_TRACE_OFF).value<int>());
+
+    ui->doubleSpinProbeSeekFeed->setValue(settings.value(SETTINGS_PROBE_SEEK_FEED, DEFAULT_PROBE_SEEK_FEED).value<double>());
+    ui->doubleSpinProbeTouchFeed->setValue(settings.value(SETTINGS_PROBE_TOUCH_FEED, DEFAULT_PROBE_TOUCH_FEED).value<double>());
+    ui->doubleSpinProbeBackoff->setValue(settings.value(SETTINGS_PROBE_BACKOFF, DEFAULT_PROBE_BACKOFF).value<double>());
+    ui->doubleSpinProbeClearance->setValue(settings.value(SETTINGS_PROBE_CLEARANCE, DEFAULT_PROBE_CLEARANCE).value<double>());
+    ui->doubleSpinProbeMaxTravel->setValue(settings.value(SETTINGS_PROBE_MAX_TRAVEL, DEFAULT_PROBE_MAX_TRAVEL).value<double>());
+    QString probeShortLift = settings.value(SETTINGS_PROBE_SHORT_LIFT, "false").value<QString>();
+    ui->checkBoxProbeShortLift->setChecked(probeShortLift == "true");
+    ui->doubleSpinArcFitTolerance->setValue(settings.value(SETTINGS_ARC_FIT_TOLERANCE, DEFAULT_ARC_FIT_TOLERANCE).value<double>());
+    ui->doubleSpinSimplifyXYTolerance->setValue(settings.value(SETTINGS_SIMPLIFY_XY_TOLERANCE, DEFAULT_SIMPLIFY_XY_TOLERANCE).value<double>());
+    ui->doubleSpinSimplifyZTolerance->setValue(settings.value(SETTINGS_SIMPLIFY_Z_TOLERANCE, DEFAULT_SIMPLIFY_Z_TOLERANCE).value<double>());
 
     QString enPosReq = settings.value(SETTINGS_ENABLE_POS_REQ, "true").value<QString>();
     QString posReqType = settings.value(SETTINGS_TYPE_POS_REQ, PREQ_NOT_WHEN_MANUAL).value<QString>();
@@ -186,6 +209,7 @@ void Options::accept()
 
     settings.setValue(SETTINGS_RESPONSE_WAIT_TIME, ui->spinResponseWaitSec->value());
     settings.setValue(SETTINGS_Z_JOG_RATE, ui->doubleSpinZJogRate->value());
+    settings.setValue(SETTINGS_METRICS_PORT, ui->spinMetricsPort->value());
 
     settings.setValue(SETTINGS_Z_RATE_LIMIT, ui->chkLimitZRate->isChecked());
     settings.setValue(SETTINGS_Z_RATE_LIMIT_AMOUNT, ui->doubleSpinZRateLimit->value());
@@ -193,8 +217,20 @@ void Options::accept()
 
     settings.setValue(SETTINGS_FILTER_FILE_COMMANDS, ui->chkFilterFileCommands->isChecked());
     settings.setValue(SETTINGS_REDUCE_PREC_FOR_LONG_LINES, ui->checkBoxReducePrecForLongLines->isChecked());
+    settings.setValue(SETTINGS_COMPACT_LINES, ui->checkBoxCompactLines->isChecked());
     settings.setValue(SETTINGS_GRBL_LINE_BUFFER_LEN, ui->spinBoxGrblLineBufferSize->value());
     settings.setValue(SETTINGS_CHAR_SEND_DELAY_MS, ui->spinBoxCharSendDelay->value());
+    settings.setValue(SETTINGS_WIRE_TRACE, ui->comboWireTrace->currentIndex());
+
+    settings.setValue(SETTINGS_PROBE_SEEK_FEED, ui->doubleSpinProbeSeekFeed->value());
+    settings.setValue(SETTINGS_PROBE_TOUCH_FEED, ui->doubleSpinProbeTouchFeed->value());
+    settings.setValue(SETTINGS_PROBE_BACKOFF, ui->doubleSpinProbeBackoff->value());
+    settings.setValue(SETTINGS_PROBE_CLEARANCE, ui->doubleSpinProbeClearance->value());
+    settings.setValue(SETTINGS_PROBE_MAX_TRAVEL, ui->doubleSpinProbeMaxTravel->value());
+    settings.setValue(SETTINGS_PROBE_SHORT_LIFT, ui->checkBoxProbeShortLift->isChecked());
+    settings.setValue(SETTINGS_ARC_FIT_TOLERANCE, ui->doubleSpinArcFitTolerance->value());
+    settings.setValue(SETTINGS_SIMPLIFY_XY_TOLERANCE, ui->doubleSpinSimplifyXYTolerance->value());
+    settings.setValue(SETTINGS_SIMPLIFY_Z_TOLERANCE, ui->doubleSpinSimplifyZTolerance->value());
 
     settings.setValue(SETTINGS_ENABLE_POS_REQ, ui->checkBoxPositionReportEnabled->isChecked());
     settings.setValue(SETTINGS_TYPE_POS_REQ, getPosReqType());
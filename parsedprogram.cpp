@@ -0,0 +1,99 @@
+/****************************************************************
+ * parsedprogram.cpp
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#include "parsedprogram.h"
+
+ParsedProgram::ParsedProgram(const QString& path, const QByteArray& src)
+    : filePath(path), source(src)
+{
+    wordStarts.append(0);
+}
+
+void ParsedProgram::reserve(int lines)
+{
+    offsets.reserve(lines);
+    wordStarts.reserve(lines + 1);
+}
+
+void ParsedProgram::appendLine(qint64 offset, const QString& words)
+{
+    offsets.append(offset);
+    allWords.append(words.toLatin1());
+    wordStarts.append(allWords.size());
+}
+
+void ParsedProgram::append(const ParsedProgram& other)
+{
+    int base = allWords.size();
+    offsets += other.offsets;
+    allWords.append(other.allWords);
+    for (int n = 1; n < other.wordStarts.size(); n++)
+        wordStarts.append(base + other.wordStarts.at(n));
+}
+
+void ParsedProgram::squeeze()
+{
+    offsets.squeeze();
+    wordStarts.squeeze();
+    allWords.squeeze();
+}
+
+double ParsedProgram::readValue(const char *&p, const char *end)
+{
+    while (p < end && *p == ' ')
+        p++;
+
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+    {
+        negative = *p == '-';
+        p++;
+    }
+
+    double value = 0;
+    while (p < end && *p >= '0' && *p <= '9')
+    {
+        value = value * 10 + (*p - '0');
+        p++;
+    }
+
+    if (p < end && *p == '.')
+    {
+        p++;
+        double scale = 0.1;
+        while (p < end && *p >= '0' && *p <= '9')
+        {
+            value += (*p - '0') * scale;
+            scale *= 0.1;
+            p++;
+        }
+    }
+
+    return negative ? -value : value;
+}
+
+QByteArray ParsedProgram::formatValue(double value, int decimals)
+{
+    QByteArray s = QByteArray::number(value, 'f', decimals);
+    if (s.contains('.'))
+    {
+        while (s.endsWith('0'))
+            s.chop(1);
+        if (s.endsWith('.'))
+            s.chop(1);
+    }
+    if (s == "-0")
+        s = "0";
+    return s;
+}
+
+QString ParsedProgram::text(int n) const
+{
+    qint64 end = n + 1 < offsets.size() ? offsets.at(n + 1) : source.size();
+    return QString::fromLocal8Bit(source.constData() + offsets.at(n), end - offsets.at(n)).trimmed();
+}
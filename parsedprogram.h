@@ -0,0 +1,79 @@
+/****************************************************************
+ * parsedprogram.h
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#ifndef PARSEDPROGRAM_H
+#define PARSEDPROGRAM_H
+
+#include <QString>
+#include <QLatin1String>
+#include <QByteArray>
+#include <QVector>
+#include <QSharedPointer>
+#include <QMetaType>
+#include "toolpathmodel.h"
+
+/**
+ * @brief A loaded G-code file, parsed once and shared read only by the
+ * visualizer and the senders through ParsedProgramPtr.
+ *
+ * Keeps the file contents, where every line starts in it and the words of
+ * every line with the comments removed, in upper case and one space before
+ * each word, all of them in a single Latin-1 array: without the comments
+ * only ASCII is left, and one byte a character keeps the copy below the
+ * size of the file. The modal state of every move is in the toolpath.
+ */
+class ParsedProgram
+{
+public:
+    ParsedProgram(const QString& path = QString(), const QByteArray& source = QByteArray());
+
+    void reserve(int lines);
+    void appendLine(qint64 offset, const QString& words);
+    void append(const ParsedProgram& other);
+    void setToolpath(ToolpathModelPtr model) { toolpathModel = model; }
+    void squeeze();
+
+    QString path() const { return filePath; }
+    int lineCount() const { return offsets.size(); }
+    qint64 sourceSize() const { return source.size(); }
+
+    // Position of the line in the file
+    qint64 offset(int n) const { return offsets.at(n); }
+    // Line as it is in the file, trimmed
+    QString text(int n) const;
+    // Line without comments, ready for the command filter, empty if there is nothing to send
+    QString words(int n) const { return QString(wordsRef(n)); }
+    QLatin1String wordsRef(int n) const { return QLatin1String(allWords.constData() + wordStarts.at(n), wordStarts.at(n + 1) - wordStarts.at(n)); }
+    bool hasWords(int n) const { return wordStarts.at(n + 1) > wordStarts.at(n); }
+
+    ToolpathModelPtr toolpath() const { return toolpathModel; }
+
+    /**
+     * @brief Reads the value after a word letter, as in " X-1.5", and moves p past it.
+     */
+    static double readValue(const char *&p, const char *end);
+
+    /**
+     * @brief Shortest text for a word value, at most decimals after the point.
+     */
+    static QByteArray formatValue(double value, int decimals = 4);
+
+private:
+    QString filePath;
+    QByteArray source;
+    QVector<qint64> offsets;
+    QVector<int> wordStarts;    // one more than the lines, the end of the last one
+    QByteArray allWords;
+    ToolpathModelPtr toolpathModel;
+};
+
+typedef QSharedPointer<const ParsedProgram> ParsedProgramPtr;
+
+Q_DECLARE_METATYPE(ParsedProgramPtr)
+
+#endif // PARSEDPROGRAM_H
@@ -0,0 +1,78 @@
+/****************************************************************
+ * pathlayers.cpp
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#include "pathlayers.h"
+
+PathLayers::PathLayers()
+    : penProposedPath(QPen(Qt::blue)), penAxes(QPen(QColor(193,97,0))),
+      penCoveredPath(QPen(QColor(60,196,70), 2)), penMeasure(QPen(QColor(151,111,26))),
+      coveredLine(-1)
+{
+}
+
+void PathLayers::invalidate()
+{
+    pathLayer = QPixmap();
+    coveredLayer = QPixmap();
+    coveredLine = -1;
+}
+
+void PathLayers::build(RenderItemList& list, const QSize& size)
+{
+    list.rescale(size);
+
+    pathLayer = QPixmap(size);
+    pathLayer.fill(Qt::transparent);
+
+    QPainter painter(&pathLayer);
+    painter.setRenderHint(QPainter::Antialiasing, true);
+
+    painter.setPen(penProposedPath);
+    list.writePath(painter, false);
+
+    painter.setPen(penAxes);
+    list.drawAxes(painter);
+
+    painter.setPen(penMeasure);
+    list.drawMeasurements(painter);
+
+    coveredLayer = QPixmap(size);
+    coveredLayer.fill(Qt::transparent);
+
+    // Redraw what is already covered through the index, only new lines are added one by one
+    QPainter coveredPainter(&coveredLayer);
+    coveredPainter.setRenderHint(QPainter::Antialiasing, true);
+    coveredPainter.setPen(penCoveredPath);
+    list.writePath(coveredPainter, true);
+    coveredLine = list.getCurrFileLine();
+}
+
+QRect PathLayers::extendCovered(RenderItemList& list)
+{
+    int currLine = list.getCurrFileLine();
+    if (currLine <= coveredLine)
+        return QRect();
+
+    QPainter painter(&coveredLayer);
+    painter.setRenderHint(QPainter::Antialiasing, true);
+    painter.setPen(penCoveredPath);
+    QRectF area = list.writePath(painter, coveredLine, currLine);
+    coveredLine = currLine;
+
+    if (area.isNull())
+        return QRect();
+
+    int margin = penCoveredPath.width() + 1;
+    return area.toAlignedRect().adjusted(-margin, -margin, margin, margin);
+}
+
+void PathLayers::draw(QPainter& painter) const
+{
+    painter.drawPixmap(0, 0, pathLayer);
+    painter.drawPixmap(0, 0, coveredLayer);
+}
@@ -0,0 +1,50 @@
+/****************************************************************
+ * pathlayers.h
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#ifndef PATHLAYERS_H
+#define PATHLAYERS_H
+
+#include <QPen>
+#include <QPainter>
+#include <QPixmap>
+#include <QRect>
+#include <QSize>
+
+#include "renderitemlist.h"
+
+/**
+ * @brief The drawn layers of the file view, kept between repaints.
+ *
+ * The proposed path, axes and measurements only change with the file or
+ * the size, the covered path grows as lines are sent. RenderArea paints
+ * them under the live point, the render benchmark times their building.
+ */
+class PathLayers
+{
+public:
+    PathLayers();
+
+    void invalidate();
+    bool isNull() const { return pathLayer.isNull(); }
+
+    // Both layers redrawn at size, the list rescaled to it
+    void build(RenderItemList& list, const QSize& size);
+    // Draw the lines completed since the last call, returns the area that changed
+    QRect extendCovered(RenderItemList& list);
+    void draw(QPainter& painter) const;
+
+    int getCoveredLine() const { return coveredLine; }
+
+private:
+    QPen penProposedPath, penAxes, penCoveredPath, penMeasure;
+    QPixmap pathLayer;
+    QPixmap coveredLayer;
+    int coveredLine;
+};
+
+#endif // PATHLAYERS_H
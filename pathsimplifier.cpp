@@ -0,0 +1,210 @@
+/****************************************************************
+ * pathsimplifier.cpp
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#include "pathsimplifier.h"
+#include "modalwalker.h"
+#include "definitions.h"
+#include "trace.h"
+
+#include <QPair>
+#include <math.h>
+
+PathSimplifier::PathSimplifier()
+{
+}
+
+void PathSimplifier::simplifyProgram(ParsedProgramPtr program, double xyTolerance, double zTolerance, int generation)
+{
+    TRACE_SCOPE("PathSimplifier::simplifyProgram");
+    if (program.isNull())
+        return;
+
+    int moves = 0;
+    int dropped = 0;
+    QByteArray source = simplify(*program, xyTolerance, zTolerance, moves, dropped);
+
+    QString report;
+    if (source.isEmpty())
+    {
+        report = tr("No moves to drop within %1 mm in XY and %2 mm in Z").arg(xyTolerance).arg(zTolerance);
+    }
+    else
+    {
+        report = tr("%1 of %2 straight moves dropped, %3 lines and %4 bytes less")
+                .arg(dropped).arg(moves).arg(program->lineCount() - source.count('\n'))
+                .arg(program->sourceSize() - source.size());
+    }
+
+    emit simplifyEnded(source, report, generation);
+}
+
+QByteArray PathSimplifier::simplify(const ParsedProgram& program, double xyTolerance, double zTolerance,
+                                    int& moves, int& dropped)
+{
+    moves = 0;
+    dropped = 0;
+    if (xyTolerance <= 0 || zTolerance <= 0)
+        return QByteArray();
+
+    QByteArray out;
+    out.reserve(program.sourceSize());
+
+    ModalWalker walker;
+    ModalWalker::Line line;
+
+    QVector<Point> run;
+    double runFeed = -1;
+    double zScale = xyTolerance / zTolerance;
+
+    int lines = program.lineCount();
+    for (int n = 0; n < lines; n++)
+    {
+        double tolerance = walker.mm ? xyTolerance : xyTolerance / MM_IN_AN_INCH;
+
+        if (!program.hasWords(n))
+        {
+            simplifyRun(program, run, runFeed, tolerance, zScale, out, moves, dropped);
+            run.clear();
+            out += program.text(n).toLocal8Bit() + '\n';
+            continue;
+        }
+
+        double x = walker.position[0];
+        double y = walker.position[1];
+        double z = walker.position[2];
+        double feed = walker.feed;
+        walker.read(program.wordsRef(n), line);
+
+        QString text = program.text(n);
+        bool straight = line.onlyCode(10) && line.onlyLetters("GXYZFN")
+                && walker.absolute && !walker.inverseTime && walker.motion == 1 && line.hasAxes()
+                && !text.contains('(') && !text.contains(';');
+
+        if (!straight || (line.feed >= 0 && line.feed != feed && !run.isEmpty()) || run.size() > SIMPLIFY_MAX_RUN)
+        {
+            simplifyRun(program, run, runFeed, tolerance, zScale, out, moves, dropped);
+            run.clear();
+        }
+
+        if (straight)
+        {
+            if (run.isEmpty())
+            {
+                Point start = { x, y, z, -1 };
+                run.append(start);
+                runFeed = line.feed;
+            }
+            Point point = { walker.position[0], walker.position[1], walker.position[2], n };
+            run.append(point);
+        }
+        else
+        {
+            out += text.toLocal8Bit() + '\n';
+        }
+    }
+
+    simplifyRun(program, run, runFeed, walker.mm ? xyTolerance : xyTolerance / MM_IN_AN_INCH, zScale, out, moves, dropped);
+
+    if (dropped == 0)
+        return QByteArray();
+    return out;
+}
+
+// Kept moves that follow a kept one go out as they were, the others are written
+// with every axis that changed, and the feed of the first move if it was dropped
+void PathSimplifier::simplifyRun(const ParsedProgram& program, const QVector<Point>& points, double runFeed,
+                                 double tolerance, double zScale, QByteArray& out, int& moves, int& dropped)
+{
+    int last = points.size() - 1;
+    if (last < 1)
+        return;
+
+    QVector<bool> keep(points.size(), false);
+    keep[0] = true;
+    keep[last] = true;
+
+    QVector<QPair<int, int> > spans;
+    spans.append(qMakePair(0, last));
+    while (!spans.isEmpty())
+    {
+        QPair<int, int> span = spans.takeLast();
+        int farthest = -1;
+        double farthestDistance = tolerance;
+        for (int i = span.first + 1; i < span.second; i++)
+        {
+            double d = deviation(points.at(i), points.at(span.first), points.at(span.second), zScale);
+            if (d > farthestDistance)
+            {
+                farthest = i;
+                farthestDistance = d;
+            }
+        }
+
+        if (farthest >= 0)
+        {
+            keep[farthest] = true;
+            spans.append(qMakePair(span.first, farthest));
+            spans.append(qMakePair(farthest, span.second));
+        }
+    }
+
+    moves += last;
+    int previous = 0;
+    bool feedPending = false;
+    for (int i = 1; i <= last; i++)
+    {
+        if (!keep.at(i))
+        {
+            dropped++;
+            feedPending = feedPending || (i == 1 && runFeed >= 0);
+            continue;
+        }
+
+        if (previous == i - 1)
+        {
+            out += program.text(points.at(i).line).toLocal8Bit() + '\n';
+        }
+        else
+        {
+            const Point& from = points.at(previous);
+            const Point& to = points.at(i);
+            out += "G1";
+            if (to.x != from.x)
+                out += " X" + ParsedProgram::formatValue(to.x);
+            if (to.y != from.y)
+                out += " Y" + ParsedProgram::formatValue(to.y);
+            if (to.z != from.z)
+                out += " Z" + ParsedProgram::formatValue(to.z);
+            if (feedPending)
+                out += " F" + ParsedProgram::formatValue(runFeed);
+            out += '\n';
+            feedPending = false;
+        }
+        previous = i;
+    }
+}
+
+// Distance from p to the segment a-b, with Z scaled so the XY tolerance applies to it
+double PathSimplifier::deviation(const Point& p, const Point& a, const Point& b, double zScale)
+{
+    double dx = b.x - a.x;
+    double dy = b.y - a.y;
+    double dz = (b.z - a.z) * zScale;
+    double px = p.x - a.x;
+    double py = p.y - a.y;
+    double pz = (p.z - a.z) * zScale;
+
+    double length2 = dx * dx + dy * dy + dz * dz;
+    double t = length2 > 0 ? (px * dx + py * dy + pz * dz) / length2 : 0;
+    t = qBound(0.0, t, 1.0);
+
+    double ex = px - t * dx;
+    double ey = py - t * dy;
+    double ez = pz - t * dz;
+    return sqrt(ex * ex + ey * ey + ez * ez);
+}
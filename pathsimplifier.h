@@ -0,0 +1,67 @@
+/****************************************************************
+ * pathsimplifier.h
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#ifndef PATHSIMPLIFIER_H
+#define PATHSIMPLIFIER_H
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include "parsedprogram.h"
+
+#define SIMPLIFY_MAX_RUN    10000   // moves simplified at once, bounds the worst case
+
+/**
+ * @brief Drops the G1 moves that add nothing at machine resolution.
+ *
+ * Runs of consecutive G1 moves in absolute mode, with no comments and no
+ * other words than the axes and the feed, are simplified Douglas-Peucker
+ * style. Z is scaled by the ratio of the tolerances so a single distance
+ * check keeps every dropped point within the XY tolerance in the plane and
+ * the Z tolerance in height of the path left. A feed change starts a new
+ * run and any other word ends it, so nothing is merged across feed, spindle
+ * or modal changes.
+ */
+class PathSimplifier : public QObject
+{
+    Q_OBJECT
+public:
+    PathSimplifier();
+
+    /**
+     * @brief Builds the simplified program.
+     * @param xyTolerance, zTolerance Largest distance of a dropped point from the path, mm.
+     * @param moves, dropped Number of moves in the runs and how many were dropped.
+     * @return The new source, or an empty array if nothing was dropped.
+     */
+    static QByteArray simplify(const ParsedProgram& program, double xyTolerance, double zTolerance,
+                               int& moves, int& dropped);
+
+signals:
+    void simplifyEnded(QByteArray source, QString report, int generation);
+
+public slots:
+    void simplifyProgram(ParsedProgramPtr program, double xyTolerance, double zTolerance, int generation);
+
+private:
+    // End of a move of the run, the first one is where the run starts
+    struct Point
+    {
+        double x;
+        double y;
+        double z;
+        int line;
+    };
+
+    static void simplifyRun(const ParsedProgram& program, const QVector<Point>& points, double runFeed,
+                            double tolerance, double zScale, QByteArray& out, int& moves, int& dropped);
+    static double deviation(const Point& p, const Point& a, const Point& b, double zScale);
+};
+
+#endif // PATHSIMPLIFIER_H
@@ -39,3 +39,10 @@ double PointItem::getYRaw()
 {
     return y;
 }
+
+double PointItem::distanceTo(double x1, double y1, double fromX, double fromY)
+{
+    Q_UNUSED(fromX);
+    Q_UNUSED(fromY);
+    return qSqrt((x1 - x) * (x1 - x) + (y1 - y) * (y1 - y));
+}
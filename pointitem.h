@@ -14,6 +14,7 @@ public:
     double getYScr();
     double getXRaw();
     double getYRaw();
+    double distanceTo(double x, double y, double fromX, double fromY);
 
 private:
     double x;
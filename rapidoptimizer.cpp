@@ -0,0 +1,803 @@
+/****************************************************************
+ * rapidoptimizer.cpp
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#include "rapidoptimizer.h"
+#include "modalwalker.h"
+#include "definitions.h"
+#include "trace.h"
+
+#include <math.h>
+
+#define TOUR_EPSILON    1e-9
+
+/**
+ * @brief Uniform grid over a set of points for nearest point queries.
+ * Points can be removed, the ring search skips whatever is left empty.
+ */
+class TravelGrid
+{
+public:
+    TravelGrid(const QVector<double>& xs, const QVector<double>& ys, int first, int last);
+
+    void remove(int id);
+    int nearest(double x, double y) const;
+
+    // Up to count points closest to (x, y), nearest first, skip left out
+    void nearest(double x, double y, int count, int skip, QVector<int>& found) const;
+
+private:
+    int column(double x) const;
+    int row(double y) const;
+
+private:
+    const QVector<double>& xs;
+    const QVector<double>& ys;
+    double minX;
+    double minY;
+    double cellSize;
+    int columns;
+    int rows;
+    QVector<QVector<int> > cells;
+    QVector<int> cellOf;
+};
+
+TravelGrid::TravelGrid(const QVector<double>& xs, const QVector<double>& ys, int first, int last)
+    : xs(xs), ys(ys), minX(0), minY(0), cellSize(1), columns(1), rows(1)
+{
+    int count = last - first + 1;
+    if (count <= 0)
+    {
+        cells.resize(1);
+        return;
+    }
+
+    minX = xs.at(first);
+    minY = ys.at(first);
+    double maxX = minX;
+    double maxY = minY;
+    for (int i = first + 1; i <= last; i++)
+    {
+        minX = qMin(minX, xs.at(i));
+        minY = qMin(minY, ys.at(i));
+        maxX = qMax(maxX, xs.at(i));
+        maxY = qMax(maxY, ys.at(i));
+    }
+
+    // About two points a cell, points along a line get cells along it
+    double width = maxX - minX;
+    double height = maxY - minY;
+    cellSize = sqrt(width * height * 2 / count);
+    cellSize = qMax(cellSize, qMax(width, height) * 2 / count);
+    if (cellSize <= 0)
+        cellSize = 1;
+
+    columns = qMin((int)(width / cellSize) + 1, 2048);
+    rows = qMin((int)(height / cellSize) + 1, 2048);
+    cells.resize(columns * rows);
+    cellOf.fill(-1, xs.size());
+
+    for (int i = first; i <= last; i++)
+    {
+        int cell = row(ys.at(i)) * columns + column(xs.at(i));
+        cells[cell].append(i);
+        cellOf[i] = cell;
+    }
+}
+
+int TravelGrid::column(double x) const
+{
+    return qBound(0, (int)((x - minX) / cellSize), columns - 1);
+}
+
+int TravelGrid::row(double y) const
+{
+    return qBound(0, (int)((y - minY) / cellSize), rows - 1);
+}
+
+void TravelGrid::remove(int id)
+{
+    QVector<int>& cell = cells[cellOf.at(id)];
+    int i = cell.indexOf(id);
+    cell[i] = cell.last();
+    cell.removeLast();
+    cellOf[id] = -1;
+}
+
+int TravelGrid::nearest(double x, double y) const
+{
+    QVector<int> found;
+    nearest(x, y, 1, -1, found);
+    return found.isEmpty() ? -1 : found.first();
+}
+
+void TravelGrid::nearest(double x, double y, int count, int skip, QVector<int>& found) const
+{
+    found.clear();
+    QVector<double> dist2;
+
+    int c0 = column(x);
+    int r0 = row(y);
+    int maxRing = qMax(columns, rows);
+
+    for (int ring = 0; ring <= maxRing; ring++)
+    {
+        // Whatever is in this ring is at least ring - 1 cells away
+        if (found.size() == count)
+        {
+            double bound = (ring - 1) * cellSize;
+            if (bound > 0 && dist2.last() <= bound * bound)
+                break;
+        }
+
+        for (int r = r0 - ring; r <= r0 + ring; r++)
+        {
+            if (r < 0 || r >= rows)
+                continue;
+
+            bool edgeRow = r == r0 - ring || r == r0 + ring;
+            int step = edgeRow ? 1 : 2 * ring;
+            for (int c = c0 - ring; c <= c0 + ring; c += (step > 0 ? step : 1))
+            {
+                if (c < 0 || c >= columns)
+                    continue;
+
+                const QVector<int>& cell = cells.at(r * columns + c);
+                for (int k = 0; k < cell.size(); k++)
+                {
+                    int id = cell.at(k);
+                    if (id == skip)
+                        continue;
+
+                    double dx = xs.at(id) - x;
+                    double dy = ys.at(id) - y;
+                    double d2 = dx * dx + dy * dy;
+                    if (found.size() == count && d2 >= dist2.last())
+                        continue;
+
+                    int at = found.size();
+                    while (at > 0 && dist2.at(at - 1) > d2)
+                        at--;
+                    found.insert(at, id);
+                    dist2.insert(at, d2);
+                    if (found.size() > count)
+                    {
+                        found.removeLast();
+                        dist2.removeLast();
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Open tour through the cut groups of a run. Node 0 is where the
+ * machine is before the run, nodes 1 to groups are the groups and, if the
+ * run is followed by a fixed group, the last node is where that one starts.
+ * Both ends stay in place. Going from a to b costs the distance from the
+ * exit of a to the entry of b.
+ */
+class TravelTour
+{
+public:
+    TravelTour(int groups, bool hasEnd);
+
+    void setNode(int node, double entryX, double entryY, double exitX, double exitY);
+    void solve();
+
+    // Node at the given position of the tour
+    int at(int n) const { return tour.at(n); }
+
+private:
+    double cost(int a, int b) const;
+    int next(int n) const { return n + 1 < tour.size() ? tour.at(n + 1) : -1; }
+
+    void nearestNeighbour();
+    void findNeighbours();
+    bool twoOpt();
+    bool orOpt();
+    void reverse(int from, int to);
+    void moveSegment(int from, int length, int after);
+
+private:
+    int groups;
+    int lastMovable;
+    QVector<double> entryX;
+    QVector<double> entryY;
+    QVector<double> exitX;
+    QVector<double> exitY;
+    QVector<int> tour;
+    QVector<int> pos;
+    QVector<QVector<int> > neighbours;  // nodes that end closest to where the node starts
+};
+
+TravelTour::TravelTour(int groups, bool hasEnd)
+    : groups(groups), lastMovable(groups)
+{
+    int nodes = groups + (hasEnd ? 2 : 1);
+    entryX.resize(nodes);
+    entryY.resize(nodes);
+    exitX.resize(nodes);
+    exitY.resize(nodes);
+}
+
+void TravelTour::setNode(int node, double entryX, double entryY, double exitX, double exitY)
+{
+    this->entryX[node] = entryX;
+    this->entryY[node] = entryY;
+    this->exitX[node] = exitX;
+    this->exitY[node] = exitY;
+}
+
+double TravelTour::cost(int a, int b) const
+{
+    if (a < 0 || b < 0)
+        return 0;
+
+    double dx = exitX.at(a) - entryX.at(b);
+    double dy = exitY.at(a) - entryY.at(b);
+    return sqrt(dx * dx + dy * dy);
+}
+
+void TravelTour::solve()
+{
+    nearestNeighbour();
+    if (groups < 2)
+        return;
+
+    findNeighbours();
+
+    // 2-opt turns parts of the tour around, only safe when groups start where they end
+    bool symmetric = true;
+    for (int n = 1; n <= groups && symmetric; n++)
+    {
+        symmetric = fabs(entryX.at(n) - exitX.at(n)) < TOUR_EPSILON
+                && fabs(entryY.at(n) - exitY.at(n)) < TOUR_EPSILON;
+    }
+
+    for (int pass = 0; pass < RAPID_MAX_PASSES; pass++)
+    {
+        bool improved = symmetric && twoOpt();
+        if (orOpt())
+            improved = true;
+        if (!improved)
+            break;
+    }
+}
+
+void TravelTour::nearestNeighbour()
+{
+    tour.resize(entryX.size());
+    pos.resize(entryX.size());
+    tour[0] = 0;
+
+    TravelGrid grid(entryX, entryY, 1, groups);
+    int current = 0;
+    for (int n = 1; n <= groups; n++)
+    {
+        current = grid.nearest(exitX.at(current), exitY.at(current));
+        grid.remove(current);
+        tour[n] = current;
+    }
+
+    if (tour.size() > groups + 1)
+        tour[groups + 1] = groups + 1;
+
+    for (int n = 0; n < tour.size(); n++)
+        pos[tour.at(n)] = n;
+}
+
+void TravelTour::findNeighbours()
+{
+    neighbours.resize(groups + 1);
+
+    TravelGrid grid(exitX, exitY, 0, groups);
+    for (int n = 1; n <= groups; n++)
+        grid.nearest(entryX.at(n), entryY.at(n), RAPID_NEIGHBOURS, n, neighbours[n]);
+}
+
+// Neighbour list 2-opt with a work list of the nodes whose edges changed. Both
+// edges of a node are tried, the one to the next node and the one from the
+// previous, and the tour between the two removed edges is turned around.
+bool TravelTour::twoOpt()
+{
+    QVector<int> work;
+    QVector<bool> queued(groups + 1, true);
+    for (int n = groups; n >= 1; n--)
+        work.append(n);
+
+    bool improvedAny = false;
+    while (!work.isEmpty())
+    {
+        int a = work.takeLast();
+        queued[a] = false;
+
+        int i = pos.at(a);
+        bool improved = false;
+        double toNext = cost(a, next(i));
+        double fromPrev = cost(tour.at(i - 1), a);
+
+        const QVector<int>& near = neighbours.at(a);
+        for (int k = 0; k < near.size() && !improved; k++)
+        {
+            int c = near.at(k);
+            double ac = cost(c, a);
+            if (ac >= toNext && ac >= fromPrev)
+                break;
+
+            int j = pos.at(c);
+            int lo = qMin(i, j);
+            int hi = qMax(i, j);
+            if (lo == hi)
+                continue;
+
+            // a -> c replaces the edge after a
+            if (ac < toNext && hi <= lastMovable)
+            {
+                int p = tour.at(lo), q = tour.at(lo + 1), r = tour.at(hi), s = next(hi);
+                double delta = cost(p, r) + cost(q, s) - cost(p, q) - cost(r, s);
+                if (delta < -TOUR_EPSILON)
+                {
+                    reverse(lo + 1, hi);
+                    improved = true;
+                    int touched[4] = { p, q, r, s };
+                    for (int t = 0; t < 4; t++)
+                    {
+                        if (touched[t] >= 1 && touched[t] <= groups && !queued.at(touched[t]))
+                        {
+                            queued[touched[t]] = true;
+                            work.append(touched[t]);
+                        }
+                    }
+                    continue;
+                }
+            }
+
+            // c -> a replaces the edge before a
+            if (ac < fromPrev && lo >= 1 && hi - 1 <= lastMovable)
+            {
+                int p = tour.at(lo - 1), q = tour.at(lo), r = tour.at(hi - 1), s = tour.at(hi);
+                double delta = cost(p, r) + cost(q, s) - cost(p, q) - cost(r, s);
+                if (delta < -TOUR_EPSILON)
+                {
+                    reverse(lo, hi - 1);
+                    improved = true;
+                    int touched[4] = { p, q, r, s };
+                    for (int t = 0; t < 4; t++)
+                    {
+                        if (touched[t] >= 1 && touched[t] <= groups && !queued.at(touched[t]))
+                        {
+                            queued[touched[t]] = true;
+                            work.append(touched[t]);
+                        }
+                    }
+                }
+            }
+        }
+
+        if (improved)
+        {
+            improvedAny = true;
+            if (!queued.at(a))
+            {
+                queued[a] = true;
+                work.append(a);
+            }
+        }
+    }
+
+    return improvedAny;
+}
+
+// Moves runs of one to RAPID_OR_OPT_LENGTH groups, as they are, after a node
+// that ends close to where the run starts
+bool TravelTour::orOpt()
+{
+    bool improvedAny = false;
+
+    for (int length = 1; length <= RAPID_OR_OPT_LENGTH; length++)
+    {
+        for (int i = 1; i + length - 1 <= lastMovable; i++)
+        {
+            int first = tour.at(i);
+            int last = tour.at(i + length - 1);
+            int prev = tour.at(i - 1);
+            int after = next(i + length - 1);
+
+            double removeGain = cost(prev, first) + cost(last, after) - cost(prev, after);
+            if (removeGain <= TOUR_EPSILON)
+                continue;
+
+            const QVector<int>& near = neighbours.at(first);
+            for (int k = 0; k < near.size(); k++)
+            {
+                int c = near.at(k);
+                int j = pos.at(c);
+                if (j >= i - 1 && j <= i + length - 1)
+                    continue;
+                if (j > lastMovable)
+                    continue;
+
+                int e = next(j);
+                double addCost = cost(c, first) + cost(last, e) - cost(c, e);
+                if (addCost < removeGain - TOUR_EPSILON)
+                {
+                    moveSegment(i, length, j);
+                    improvedAny = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    return improvedAny;
+}
+
+void TravelTour::reverse(int from, int to)
+{
+    while (from < to)
+    {
+        int a = tour.at(from);
+        int b = tour.at(to);
+        tour[from] = b;
+        tour[to] = a;
+        pos[b] = from;
+        pos[a] = to;
+        from++;
+        to--;
+    }
+}
+
+void TravelTour::moveSegment(int from, int length, int after)
+{
+    QVector<int> segment = tour.mid(from, length);
+
+    int start;
+    int end;
+    if (after < from)
+    {
+        for (int n = from - 1; n > after; n--)
+            tour[n + length] = tour.at(n);
+        for (int n = 0; n < length; n++)
+            tour[after + 1 + n] = segment.at(n);
+        start = after + 1;
+        end = from + length - 1;
+    }
+    else
+    {
+        for (int n = from + length; n <= after; n++)
+            tour[n - length] = tour.at(n);
+        for (int n = 0; n < length; n++)
+            tour[after - length + 1 + n] = segment.at(n);
+        start = from;
+        end = after;
+    }
+
+    for (int n = start; n <= end; n++)
+        pos[tour.at(n)] = n;
+}
+
+RapidOptimizer::RapidOptimizer()
+{
+}
+
+void RapidOptimizer::optimizeProgram(ParsedProgramPtr program, MachineLimits limits, int generation)
+{
+    TRACE_SCOPE("RapidOptimizer::optimizeProgram");
+    if (program.isNull())
+        return;
+
+    int groups = 0;
+    double before = 0, after = 0, secsSaved = 0;
+    QByteArray source = optimize(*program, limits, groups, before, after, secsSaved);
+
+    QString report;
+    if (source.isEmpty())
+    {
+        report = tr("The rapid moves of the file can't be shortened (%1 cut groups can be reordered)").arg(groups);
+    }
+    else
+    {
+        report = tr("Rapid travel of %1 cut groups shortened from %2 to %3 mm, about %4 secs less")
+                .arg(groups).arg(before, 0, 'f', 1).arg(after, 0, 'f', 1).arg(secsSaved, 0, 'f', 1);
+    }
+
+    emit optimizeEnded(source, report, generation);
+}
+
+QByteArray RapidOptimizer::optimize(const ParsedProgram& program, const MachineLimits& limits,
+                                    int& groupCount, double& before, double& after, double& secsSaved)
+{
+    QVector<CutGroup> groups;
+    QVector<bool> travelLines;
+    bool mm = true;
+    splitGroups(program, groups, travelLines, mm);
+
+    double scale = mm ? 1.0 : MM_IN_AN_INCH;
+    groupCount = 0;
+    before = 0;
+    after = 0;
+    secsSaved = 0;
+
+    // The fixed groups stay in place, the runs of groups between them are reordered
+    QVector<int> sequence;
+    int g = 0;
+    while (g < groups.size())
+    {
+        if (groups.at(g).fixed)
+        {
+            sequence.append(g);
+            g++;
+            continue;
+        }
+
+        int from = g;
+        while (g < groups.size() && !groups.at(g).fixed)
+            g++;
+        int to = g;
+        groupCount += to - from;
+
+        const CutGroup& prev = groups.at(sequence.last());
+        bool hasEnd = to < groups.size();
+        double endX = hasEnd ? groups.at(to).entryX : 0;
+        double endY = hasEnd ? groups.at(to).entryY : 0;
+
+        QVector<int> order;
+        orderRun(groups, from, to, prev.exitX, prev.exitY, hasEnd, endX, endY, order);
+
+        double runBefore = 0, runAfter = 0, timeBefore = 0, timeAfter = 0;
+        for (int pass = 0; pass < 2; pass++)
+        {
+            double x = prev.exitX;
+            double y = prev.exitY;
+            double& length = pass == 0 ? runBefore : runAfter;
+            double& time = pass == 0 ? timeBefore : timeAfter;
+            for (int n = 0; n <= to - from; n++)
+            {
+                double nextX, nextY;
+                if (n < to - from)
+                {
+                    const CutGroup& group = groups.at(pass == 0 ? from + n : order.at(n));
+                    nextX = group.entryX;
+                    nextY = group.entryY;
+                }
+                else if (hasEnd)
+                {
+                    nextX = endX;
+                    nextY = endY;
+                }
+                else
+                {
+                    break;
+                }
+
+                double d = sqrt((nextX - x) * (nextX - x) + (nextY - y) * (nextY - y)) * scale;
+                length += d;
+                time += travelTime(d, limits);
+
+                if (n < to - from)
+                {
+                    const CutGroup& group = groups.at(pass == 0 ? from + n : order.at(n));
+                    x = group.exitX;
+                    y = group.exitY;
+                }
+            }
+        }
+
+        if (runAfter < runBefore)
+        {
+            sequence += order;
+            before += runBefore;
+            after += runAfter;
+            secsSaved += timeBefore - timeAfter;
+        }
+        else
+        {
+            for (int n = from; n < to; n++)
+                sequence.append(n);
+            before += runBefore;
+            after += runBefore;
+        }
+    }
+
+    if ((before - after) / scale < RAPID_MIN_SAVING)
+        return QByteArray();
+
+    // Groups that follow the one they followed in the file go out as they were,
+    // the others get a new travel to them
+    QByteArray out;
+    out.reserve(program.lineCount() * 24);
+    double z = 0;
+    double feed = 0;
+    for (int k = 0; k < sequence.size(); k++)
+    {
+        int index = sequence.at(k);
+        const CutGroup& group = groups.at(index);
+        bool moved = k > 0 && sequence.at(k - 1) != index - 1;
+
+        if (group.travelFirst >= 0)
+        {
+            if (moved)
+            {
+                for (int n = group.travelFirst; n < group.first; n++)
+                {
+                    if (!travelLines.at(n))
+                        out += program.text(n).toLocal8Bit() + '\n';
+                }
+
+                if (z < group.travelZ)
+                    out += "G0 Z" + ParsedProgram::formatValue(group.travelZ) + '\n';
+                out += "G0 X" + ParsedProgram::formatValue(group.entryX)
+                        + " Y" + ParsedProgram::formatValue(group.entryY) + '\n';
+                if (group.feed > 0 && group.feed != feed)
+                    out += "F" + ParsedProgram::formatValue(group.feed) + '\n';
+            }
+            else
+            {
+                for (int n = group.travelFirst; n < group.first; n++)
+                    out += program.text(n).toLocal8Bit() + '\n';
+            }
+        }
+
+        for (int n = group.first; n < group.last; n++)
+            out += program.text(n).toLocal8Bit() + '\n';
+
+        z = group.exitZ;
+        feed = group.exitFeed;
+    }
+
+    return out;
+}
+
+// A travel is a line with only G0, X, Y and F words, made in absolute mode above Z0.
+// Anything the optimizer is not sure it can move around fixes its group.
+void RapidOptimizer::splitGroups(const ParsedProgram& program, QVector<CutGroup>& groups, QVector<bool>& travelLines, bool& mm)
+{
+    int lines = program.lineCount();
+    travelLines.fill(false, lines);
+
+    ModalWalker walker;
+    ModalWalker::Line line;
+    bool inTravel = false;
+
+    CutGroup group;
+    group.travelFirst = -1;
+    group.first = 0;
+    group.entryX = group.entryY = 0;
+    group.travelZ = 0;
+    group.feed = 0;
+    group.fixed = true;
+
+    for (int n = 0; n < lines; n++)
+    {
+        if (!program.hasWords(n))
+            continue;
+
+        double x = walker.position[0];
+        double y = walker.position[1];
+        double z = walker.position[2];
+        double feed = walker.feed;
+        int plane = walker.plane;
+        bool wasMm = walker.mm;
+        bool wasInverseTime = walker.inverseTime;
+        walker.read(program.wordsRef(n), line);
+
+        // M, T, S and axes the optimizer does not track
+        bool barrier = !line.onlyLetters("GXYZFNIJKRP") || line.moreCodes;
+        for (int i = 0; i < line.codeCount; i++)
+        {
+            int code = line.codes[i];
+            if (code == 0 || code == 10 || code == 20 || code == 30)
+                ;
+            else if (code == 40 || code == 400 || code == 490 || code == 610 || code == 900)
+                ;
+            else if (code == 170 || code == 180 || code == 190)
+                barrier = barrier || code != plane;
+            else if (code == 200 || code == 210)
+                barrier = barrier || (code == 210) != wasMm;
+            else if (code == 940 && !wasInverseTime)
+                ;
+            else
+                barrier = true;
+        }
+
+        bool pure = line.onlyCode(0) && line.onlyLetters("GXYZFN");
+        bool travel = !barrier && pure && walker.absolute && walker.motion == 0
+                && (line.hasAxis[0] || line.hasAxis[1]) && !line.hasAxis[2] && z > 0;
+
+        if (travel)
+        {
+            if (!inTravel)
+            {
+                group.last = n;
+                group.exitX = x;
+                group.exitY = y;
+                group.exitZ = z;
+                group.exitFeed = feed;
+                group.fixed = group.fixed || group.first >= group.last;
+                groups.append(group);
+
+                group.travelFirst = n;
+                group.fixed = false;
+                inTravel = true;
+            }
+            travelLines[n] = true;
+        }
+        else
+        {
+            if (inTravel)
+            {
+                group.first = n;
+                group.entryX = x;
+                group.entryY = y;
+                group.travelZ = z;
+                group.feed = feed;
+                inTravel = false;
+            }
+            if (barrier)
+                group.fixed = true;
+        }
+    }
+
+    double x = walker.position[0];
+    double y = walker.position[1];
+    double z = walker.position[2];
+    double feed = walker.feed;
+    mm = walker.mm;
+
+    if (inTravel)
+    {
+        group.first = lines;
+        group.entryX = x;
+        group.entryY = y;
+        group.travelZ = z;
+        group.feed = feed;
+    }
+    group.last = lines;
+    group.exitX = x;
+    group.exitY = y;
+    group.exitZ = z;
+    group.exitFeed = feed;
+    group.fixed = group.fixed || group.first >= group.last;
+    groups.append(group);
+}
+
+void RapidOptimizer::orderRun(const QVector<CutGroup>& groups, int from, int to, double startX, double startY,
+                              bool hasEnd, double endX, double endY, QVector<int>& order)
+{
+    int count = to - from;
+    TravelTour tour(count, hasEnd);
+
+    tour.setNode(0, startX, startY, startX, startY);
+    for (int n = 0; n < count; n++)
+    {
+        const CutGroup& group = groups.at(from + n);
+        tour.setNode(n + 1, group.entryX, group.entryY, group.exitX, group.exitY);
+    }
+    if (hasEnd)
+        tour.setNode(count + 1, endX, endY, endX, endY);
+
+    tour.solve();
+
+    order.clear();
+    for (int n = 1; n <= count; n++)
+        order.append(from + tour.at(n) - 1);
+}
+
+// Rapid along X and Y together, at the rate and acceleration of the slowest of them
+double RapidOptimizer::travelTime(double length, const MachineLimits& limits)
+{
+    double rate = qMin(limits.maxRate[0], limits.maxRate[1]) / 60.0;
+    double accel = qMin(limits.acceleration[0], limits.acceleration[1]);
+    if (length <= 0 || rate <= 0 || accel <= 0)
+        return 0;
+
+    if (length <= rate * rate / accel)
+        return 2 * sqrt(length / accel);
+    return length / rate + rate / accel;
+}
@@ -0,0 +1,85 @@
+/****************************************************************
+ * rapidoptimizer.h
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#ifndef RAPIDOPTIMIZER_H
+#define RAPIDOPTIMIZER_H
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include "parsedprogram.h"
+#include "machinelimits.h"
+
+#define RAPID_NEIGHBOURS        8       // candidates looked at by 2-opt and Or-opt
+#define RAPID_OR_OPT_LENGTH     3       // longest run of groups Or-opt moves
+#define RAPID_MAX_PASSES        8
+#define RAPID_MIN_SAVING        0.001   // program units, less than that is not worth a new program
+
+/**
+ * @brief Reorders the cuts of a program to shorten the rapid travel between them.
+ *
+ * The program is split in cut groups at every rapid XY move made above Z0:
+ * a group is the plunge, the cutting and the retract up to the next travel.
+ * Lines that change the tool, spindle, coolant, coordinate system, units,
+ * distance mode, or that the optimizer does not know, keep their group in
+ * place, so tool changes and the modal state around them stay as written.
+ * The groups between two of those are free to move and are ordered with a
+ * nearest neighbour tour, improved with 2-opt when every group starts and
+ * ends at the same spot (drilling) and with Or-opt, which never turns a
+ * group around. Candidates come from a grid of the group ends, so tens of
+ * thousands of holes take a few seconds.
+ *
+ * Moved groups get a new travel, as high as the original one, and the feed
+ * they started with.
+ */
+class RapidOptimizer : public QObject
+{
+    Q_OBJECT
+public:
+    RapidOptimizer();
+
+    /**
+     * @brief Builds the reordered program.
+     * @param before, after Rapid travel of the reorderable groups, mm.
+     * @param secsSaved Travel time saved, at the machine rapid rate.
+     * @return The new source, or an empty array if nothing could be shortened.
+     */
+    static QByteArray optimize(const ParsedProgram& program, const MachineLimits& limits,
+                               int& groups, double& before, double& after, double& secsSaved);
+
+signals:
+    void optimizeEnded(QByteArray source, QString report, int generation);
+
+public slots:
+    void optimizeProgram(ParsedProgramPtr program, MachineLimits limits, int generation);
+
+private:
+    struct CutGroup
+    {
+        int travelFirst;    // first line of the travel to the group, -1 for the program start
+        int first;          // first line after the travel
+        int last;           // one past the last line
+        double entryX;
+        double entryY;
+        double exitX;
+        double exitY;
+        double travelZ;
+        double exitZ;
+        double feed;        // at the start of the group, 0 if not set yet
+        double exitFeed;
+        bool fixed;
+    };
+
+    static void splitGroups(const ParsedProgram& program, QVector<CutGroup>& groups, QVector<bool>& travelLines, bool& mm);
+    static void orderRun(const QVector<CutGroup>& groups, int from, int to, double startX, double startY,
+                         bool hasEnd, double endX, double endY, QVector<int>& order);
+    static double travelTime(double length, const MachineLimits& limits);
+};
+
+#endif // RAPIDOPTIMIZER_H
@@ -1,33 +1,51 @@
 #include "renderarea.h"
+#include "trace.h"
+#include <QWheelEvent>
+#include <QMouseEvent>
+#include <QToolTip>
+#include <qmath.h>
+
+#define DRAG_START_PIXELS   3
 
 RenderArea::RenderArea(QWidget *parent)
     : QWidget(parent),
-      penProposedPath(QPen(Qt::blue)), penAxes(QPen(QColor(193,97,0))),
-      penCoveredPath(QPen(QColor(60,196,70), 2)),
       penCurrPosActive(QPen(Qt::red, 6)), penCurrPosInactive(QPen(QColor(60,196,70), 6)),
-      penMeasure(QPen(QColor(151,111,26))), isLiveCurrPos(false)
+      isLiveCurrPos(false), dragging(false)
 {
     penCurrPosActive.setCapStyle(Qt::RoundCap);
     penCurrPosInactive.setCapStyle(Qt::RoundCap);
 }
 
-void RenderArea::setItems(QList<PosItem> itemsRcvd)
+void RenderArea::setItems(ToolpathModelPtr itemsRcvd)
 {
     items = itemsRcvd;
 
     listToRender.setCurrFileLine(0);
     listToRender.convertList(items);
     listToRender.updateLivePoint();
+    invalidateLayers();
     update();
 }
 
 void RenderArea::setLivePoint(double x, double y, bool mm, bool isLiveCP)
 {
+    TRACE_SCOPE("RenderArea::setLivePoint");
     isLiveCurrPos = isLiveCP;
     livePoint.setCoords(x, y, mm);
     listToRender.setLivePoint(livePoint);
-    update();
 
+    if (!hasItems())
+        return;
+
+    // A point outside the drawing changes the scale, everything has to be redrawn
+    if (layers.isNull() || listToRender.rescale(size()))
+    {
+        invalidateLayers();
+        update();
+        return;
+    }
+
+    update(lastLivePointRect.united(livePointRect()));
 }
 
 void RenderArea::setVisualLivenessCurrPos(bool isLiveCP)
@@ -37,33 +55,121 @@ void RenderArea::setVisualLivenessCurrPos(bool isLiveCP)
 
 void RenderArea::setVisCurrLine(int currLine)
 {
-    if (listToRender.setCurrFileLine(currLine))
+    TRACE_SCOPE("RenderArea::setVisCurrLine");
+    bool found = listToRender.setCurrFileLine(currLine);
+
+    if (layers.isNull())
+    {
+        if (found)
+            update();
+        return;
+    }
+
+    if (currLine < layers.getCoveredLine())
+    {
+        // Sending again from the start
+        invalidateLayers();
         update();
+        return;
+    }
+
+    QRect dirty = layers.extendCovered(listToRender);
+    if (!dirty.isEmpty())
+        update(dirty);
 }
 
-void RenderArea::paintEvent(QPaintEvent * /* event */)
+void RenderArea::resizeEvent(QResizeEvent * /* event */)
 {
-    if (!items.size())
+    invalidateLayers();
+}
+
+void RenderArea::wheelEvent(QWheelEvent *event)
+{
+    if (!hasItems())
         return;
 
-    QSize size = this->size();
+    // One wheel step (120) zooms 20%, around the cursor
+    listToRender.zoomAt(event->pos(), qPow(1.2, event->delta() / 120.0));
+    invalidateLayers();
+    update();
+}
 
-    listToRender.rescale(size);
+void RenderArea::mousePressEvent(QMouseEvent *event)
+{
+    if (event->button() != Qt::LeftButton)
+        return;
 
-    QPainter painter(this);
-    painter.setRenderHint(QPainter::Antialiasing, true);
+    pressPos = event->pos();
+    lastDragPos = event->pos();
+    dragging = false;
+}
+
+void RenderArea::mouseMoveEvent(QMouseEvent *event)
+{
+    if (!(event->buttons() & Qt::LeftButton) || !hasItems())
+        return;
+
+    if (!dragging && (event->pos() - pressPos).manhattanLength() < DRAG_START_PIXELS)
+        return;
+
+    dragging = true;
+    QPoint delta = event->pos() - lastDragPos;
+    lastDragPos = event->pos();
+
+    listToRender.pan(delta.x(), delta.y());
+    invalidateLayers();
+    update();
+}
+
+void RenderArea::mouseReleaseEvent(QMouseEvent *event)
+{
+    if (event->button() != Qt::LeftButton || !hasItems())
+        return;
+
+    if (!dragging)
+    {
+        int line = listToRender.lineAt(event->pos());
+        if (line >= 0)
+        {
+            QToolTip::showText(event->globalPos(), tr("Line %1").arg(line), this);
+            emit lineClicked(line);
+        }
+    }
+    dragging = false;
+}
 
-    painter.setPen(penProposedPath);
-    listToRender.writePath(painter, false);
+void RenderArea::mouseDoubleClickEvent(QMouseEvent * /* event */)
+{
+    listToRender.resetView();
+    invalidateLayers();
+    update();
+}
 
-    painter.setPen(penAxes);
-    listToRender.drawAxes(painter);
+void RenderArea::invalidateLayers()
+{
+    layers.invalidate();
+}
 
-    painter.setPen(penMeasure);
-    listToRender.drawMeasurements(painter);
+QRect RenderArea::livePointRect()
+{
+    QPointF p = listToRender.screenPoint(livePoint);
+    int margin = penCurrPosActive.width() + 1;
+    return QRect(int(p.x()) - margin, int(p.y()) - margin, margin * 2, margin * 2);
+}
 
-    painter.setPen(penCoveredPath);
-    listToRender.writePath(painter, true);
+void RenderArea::paintEvent(QPaintEvent * /* event */)
+{
+    TRACE_SCOPE("RenderArea::paintEvent");
+    if (!hasItems())
+        return;
+
+    if (listToRender.rescale(this->size()) || layers.isNull())
+        layers.build(listToRender, this->size());
+
+    QPainter painter(this);
+    layers.draw(painter);
+
+    painter.setRenderHint(QPainter::Antialiasing, true);
 
     //if (!livePoint.isNull()) FIX isNull
     {
@@ -72,5 +178,6 @@ void RenderArea::paintEvent(QPaintEvent * /* event */)
         else
             painter.setPen(penCurrPosInactive);
         listToRender.drawPoint(painter, livePoint);
+        lastLivePointRect = livePointRect();
     }
 }
@@ -4,11 +4,13 @@
 #include <QWidget>
 #include <QPen>
 #include <QPainter>
+#include <QPixmap>
 
 #include "positem.h"
 #include "renderitemlist.h"
 #include "arcitem.h"
 #include "lineitem.h"
+#include "pathlayers.h"
 
 class RenderArea : public QWidget
 {
@@ -17,22 +19,42 @@ public:
     explicit RenderArea(QWidget *parent = 0);
 
 signals:
+    void lineClicked(int line);
 
 public slots:
-    void setItems(QList<PosItem>);
+    void setItems(ToolpathModelPtr items);
     void setLivePoint(double x, double y, bool isMM, bool isLiveCP);
     void setVisualLivenessCurrPos(bool isLiveCP);
     void setVisCurrLine(int currLine);
 
 protected:
     void paintEvent(QPaintEvent *event);
+    void resizeEvent(QResizeEvent *event);
+    void wheelEvent(QWheelEvent *event);
+    void mousePressEvent(QMouseEvent *event);
+    void mouseMoveEvent(QMouseEvent *event);
+    void mouseReleaseEvent(QMouseEvent *event);
+    void mouseDoubleClickEvent(QMouseEvent *event);
 
 private:
-    QList<PosItem> items;
+    bool hasItems() const { return !items.isNull() && !items->isEmpty(); }
+    void invalidateLayers();
+    QRect livePointRect();
+
+private:
+    ToolpathModelPtr items;
     RenderItemList listToRender;
-    QPen penProposedPath, penAxes, penCoveredPath, penCurrPosActive, penCurrPosInactive, penMeasure;
+    QPen penCurrPosActive, penCurrPosInactive;
     PosItem livePoint;
     bool isLiveCurrPos;
+
+    PathLayers layers;
+    QRect lastLivePointRect;
+
+    // Mouse panning, a press released without moving is a click on a line
+    QPoint pressPos;
+    QPoint lastDragPos;
+    bool dragging;
 };
 
 #endif // RENDERAREA_H
@@ -1,8 +1,9 @@
 #include "renderitemlist.h"
 #include <QObject>
+#include <algorithm>
 
 RenderItemList::RenderItemList()
-    : scale(1), offsetx(50), offsety(50), mm(true), currFileLine(0)
+    : scale(1), offsetx(50), offsety(50), zoom(1), panx(0), pany(0), mm(true), currFileLine(0)
 {
     font.setStyleHint(QFont::Courier);
     font.setPointSize(10);
@@ -15,101 +16,246 @@ RenderItemList::~RenderItemList()
 
 void RenderItemList::clearList()
 {
-    while (!list.isEmpty())
-        delete list.takeFirst();
+    model.clear();
+    itemBounds.clear();
+    segmentIndex.clear();
 }
 
-void RenderItemList::convertList(const QList<PosItem>& items)
+// Position in the model of the first item of a line after the given one, the item count if none.
+int RenderItemList::firstItemAfter(int line) const
 {
-    clearList();
+    const QVector<int>& lineIndex = model->lineIndex();
+    return std::upper_bound(lineIndex.constBegin(), lineIndex.constEnd(), line) - lineIndex.constBegin();
+}
 
-    if (items.size() == 0)
-        return;
+// Arcs start where the previous item ended, the center is relative to that point
+ArcItem RenderItemList::arcAt(int n) const
+{
+    int prev = n > 0 ? n - 1 : 0;
+    double sx = model->x(prev);
+    double sy = model->y(prev);
+
+    ArcItem arc(sx, sy, model->x(n), model->y(n), sx + model->i(n), sy + model->j(n),
+                model->isCw(n), model->line(n));
+    arc.computeExtents();
+    arc.setParams(scale, windowSize.height(), offsetx, offsety);
+    return arc;
+}
 
-    double lastx = items.at(0).x, lasty = items.at(0).y;
-    mm = items.at(0).mm;
-    foreach (PosItem item, items)
-    {
-        if (item.arc)
-        {
-            double px = lastx + item.i;
-            double py = lasty + item.j;
-            double sx = lastx;
-            double sy = lasty;
-            double ex = item.x;
-            double ey = item.y;
-
-            list.append(new ArcItem(
-                               sx, sy, ex, ey, px, py, item.cw, item.index));
-        }
-        else
-        {
-            double sx = item.x;
-            double sy = item.y;
+void RenderItemList::convertList(ToolpathModelPtr items)
+{
+    clearList();
 
-            list.append(new LineItem(sx, sy, item.index));
-        }
+    if (items.isNull() || items->isEmpty())
+        return;
 
-        lastx = item.x;
-        lasty = item.y;
-    }
+    model = items;
+    mm = model->isMm(0);
 
     extents.setCoords(0,0,0,0);
-    foreach (ItemToBase *item, list)
+    itemBounds.reserve(model->count());
+    for (int n = 0; n < model->count(); n++)
     {
-        PosItem e = item->computeExtents();
+        PosItem e(model->x(n), model->y(n), model->x(n), model->y(n));
+        if (model->isArc(n))
+            e = arcAt(n).computeExtents();
 
         // can't use QRectF because it reverses the y axis in anticipation of screendraws, which we don't want
         //extents = extents.united(e);
 
         extents.expand(e);
+
+        // For the index a line also covers where it comes from. Here the QRectF is only
+        // used as a box, top is the lowest Y.
+        int prev = n > 0 ? n - 1 : 0;
+        e.expand(PosItem(model->x(prev), model->y(prev), model->x(prev), model->y(prev)));
+        itemBounds.append(QRectF(QPointF(e.x, e.y), QPointF(e.i, e.j)));
     }
+
+    segmentIndex.build(itemBounds);
+    resetView();
 }
 
-void RenderItemList::rescale(const QSize& size)
+// Returns true if the scale or the offsets changed, anything drawn before is then misplaced
+bool RenderItemList::rescale(const QSize& size)
 {
+    double oldScale = scale, oldOffsetx = offsetx, oldOffsety = offsety;
+    QSize oldSize = windowSize;
+
     PosItem liveExtents(extents);
     liveExtents.expand(livePoint);
 
     double scalex = SCREEN_SCALE_FILE * (size.width() / (liveExtents.width()));
     double scaley = SCREEN_SCALE_FILE * (size.height() / (liveExtents.height()));
 
-    scale = qMin(scalex, scaley);
+    scale = qMin(scalex, scaley) * zoom;
 
-    offsetx = size.width() / 2 - ((liveExtents.x + liveExtents.i) / 2) * scale;
-    offsety = size.height() / 2 - ((liveExtents.y + liveExtents.j) / 2) * scale;
+    offsetx = size.width() / 2 - ((liveExtents.x + liveExtents.i) / 2) * scale + panx;
+    offsety = size.height() / 2 - ((liveExtents.y + liveExtents.j) / 2) * scale + pany;
 
     windowSize = size;
+
+    return scale != oldScale || offsetx != oldOffsetx || offsety != oldOffsety || size != oldSize;
 }
 
 void RenderItemList::writePath(QPainter& painter, bool updatedFromFile)
 {
+    // Only what is on screen, with everything smaller than a pixel merged
+    QVector<int> visible;
+    segmentIndex.query(viewArea(), LOD_PIXELS / scale, visible);
+
+    int end = updatedFromFile ? firstItemAfter(currFileLine) : model->count();
     QPainterPath path;
-    ItemToBase *item = list.at(0);
-    item->setParams(scale, windowSize.height(), offsetx, offsety);
-    item->moveToFirst(path);
-    foreach (item, list)
+    int last = -2;
+    QPointF lastPoint;
+    foreach (int n, visible)
     {
-        if (updatedFromFile)
-        {
-            if (item->getIndex() > currFileLine)
-                break;
-        }
+        if (n >= end)
+            break;
+        appendItem(path, n, last, lastPoint);
+    }
+
+    painter.drawPath(path);
+}
 
-        item->setParams(scale, windowSize.height(), offsetx, offsety);
-        item->addToPath(path);
+// Draw the items of lines fromLine+1 to toLine, starting where line fromLine ended, so a path
+// can be extended as the file is sent. Returns the area touched, in screen coordinates.
+QRectF RenderItemList::writePath(QPainter& painter, int fromLine, int toLine)
+{
+    int begin = firstItemAfter(fromLine);
+    int end = firstItemAfter(toLine);
+    if (begin >= end)
+        return QRectF();
+
+    QRectF view = viewArea();
+    QPainterPath path;
+    int last = begin - 2;
+    QPointF lastPoint;
+    for (int n = begin; n < end; n++)
+    {
+        if (SegmentIndex::overlaps(itemBounds.at(n), view))
+            appendItem(path, n, last, lastPoint);
     }
 
+    if (path.isEmpty())
+        return QRectF();
+
     painter.drawPath(path);
+    return path.controlPointRect();
+}
+
+// Add item n to the path, moving to where it starts if the previous item was not drawn.
+// Tiny items that end less than a pixel away from the last drawn point are skipped, the
+// next line then starts from that point.
+void RenderItemList::appendItem(QPainterPath& path, int n, int& last, QPointF& lastPoint)
+{
+    QPointF end = endPoint(n);
+
+    const QRectF& b = itemBounds.at(n);
+    if (n == last + 1 && b.width() * scale < LOD_PIXELS && b.height() * scale < LOD_PIXELS)
+    {
+        QPointF d = end - lastPoint;
+        if (qAbs(d.x()) < LOD_PIXELS && qAbs(d.y()) < LOD_PIXELS)
+        {
+            last = n;
+            return;
+        }
+    }
+
+    if (n != last + 1)
+        path.moveTo(endPoint(n > 0 ? n - 1 : 0));
+
+    if (model->isArc(n))
+        arcAt(n).addToPath(path);
+    else
+        path.lineTo(end);
+
+    lastPoint = end;
+    last = n;
+}
+
+// The part of the drawing on screen, as a machine coordinates box (top is the lowest Y)
+QRectF RenderItemList::viewArea() const
+{
+    QPointF topLeft = toMachine(QPointF(0, 0));
+    QPointF bottomRight = toMachine(QPointF(windowSize.width(), windowSize.height()));
+    return QRectF(QPointF(topLeft.x(), bottomRight.y()), QPointF(bottomRight.x(), topLeft.y()));
+}
+
+QPointF RenderItemList::toMachine(const QPointF& screenPos) const
+{
+    return QPointF((screenPos.x() - offsetx) / scale,
+                   (windowSize.height() - screenPos.y() - offsety) / scale);
+}
+
+void RenderItemList::zoomAt(const QPointF& screenPos, double factor)
+{
+    // Keep the point under the cursor where it is
+    QPointF m = toMachine(screenPos);
+
+    zoom *= factor;
+    panx = 0;
+    pany = 0;
+    rescale(windowSize);
+
+    panx = screenPos.x() - m.x() * scale - offsetx;
+    pany = windowSize.height() - screenPos.y() - m.y() * scale - offsety;
+    offsetx += panx;
+    offsety += pany;
+}
+
+void RenderItemList::pan(double dx, double dy)
+{
+    panx += dx;
+    pany -= dy; // screen Y goes down
+    rescale(windowSize);
+}
+
+void RenderItemList::resetView()
+{
+    zoom = 1;
+    panx = 0;
+    pany = 0;
+}
+
+// Source line of the item drawn under screenPos, -1 if there is none close enough
+int RenderItemList::lineAt(const QPointF& screenPos)
+{
+    if (model.isNull())
+        return -1;
+
+    QPointF m = toMachine(screenPos);
+    double tolerance = HIT_PIXELS / scale;
+    QRectF area(m.x() - tolerance, m.y() - tolerance, tolerance * 2, tolerance * 2);
+
+    QVector<int> candidates;
+    segmentIndex.query(area, 0, candidates);
+
+    int line = -1;
+    double best = tolerance;
+    foreach (int n, candidates)
+    {
+        int prev = n > 0 ? n - 1 : 0;
+        double d;
+        if (model->isArc(n))
+            d = arcAt(n).distanceTo(m.x(), m.y(), model->x(prev), model->y(prev));
+        else
+            d = ItemToBase::segmentDistance(m.x(), m.y(), model->x(prev), model->y(prev), model->x(n), model->y(n));
+        if (d <= best)
+        {
+            best = d;
+            line = model->line(n);
+        }
+    }
+    return line;
 }
 
 void RenderItemList::drawAxes(QPainter& painter)
 {
     QPainterPath path;
 
-    ItemToBase *item = list.at(0);
-    double x = item->getXScr();
-    double y = item->getYScr();
+    double x = screenX(model->x(0));
+    double y = screenY(model->y(0));
 
     path.moveTo(x, 0);
     path.lineTo(x, windowSize.height() - 1);
@@ -123,11 +269,10 @@ void RenderItemList::drawMeasurements(QPainter& painter)
 {
     QPainterPath path;
 
-    ItemToBase *item = list.at(0);
-    double x = item->getXScr();
-    double y = item->getYScr();
-    double xr = item->getXRaw();
-    double yr = item->getYRaw();
+    double xr = model->x(0);
+    double yr = model->y(0);
+    double x = screenX(xr);
+    double y = screenY(yr);
 
     const int length = 6;
     LineItem x1(extents.x, yr, true, length);
@@ -195,6 +340,11 @@ void RenderItemList::writeText(QPainter& painter, QString text, double x, double
 }
 
 void RenderItemList::drawPoint(QPainter& painter, const PosItem& point)
+{
+    painter.drawPoint(screenPoint(point));
+}
+
+QPointF RenderItemList::screenPoint(const PosItem& point)
 {
     double divisor = 1;
     if ((mm && !point.mm) || (!mm && point.mm))
@@ -204,21 +354,18 @@ void RenderItemList::drawPoint(QPainter& painter, const PosItem& point)
 
     p.setParams(scale, windowSize.height(), offsetx, offsety);
 
-    painter.drawPoint(p.getXScr(), p.getYScr());
-
+    return QPointF(p.getXScr(), p.getYScr());
 }
 
 bool RenderItemList::setCurrFileLine(const int currLine)
 {
     currFileLine = currLine;
-    foreach (ItemToBase *item, list)
-    {
-        if (item->getIndex() == currLine)
-            return true;
-        else if (item->getIndex() > currLine)
-            return false;
-    }
-    return false;
+    if (model.isNull())
+        return false;
+
+    const QVector<int>& lineIndex = model->lineIndex();
+    QVector<int>::const_iterator it = std::lower_bound(lineIndex.constBegin(), lineIndex.constEnd(), currLine);
+    return it != lineIndex.constEnd() && *it == currLine;
 }
 
 void RenderItemList::setLivePoint(const PosItem& livePoint1)
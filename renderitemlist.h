@@ -3,8 +3,13 @@
 #include "arcitem.h"
 #include "lineitem.h"
 #include "pointitem.h"
+#include "segmentindex.h"
+#include "toolpathmodel.h"
+#include <QVector>
 
 #define SCREEN_SCALE_FILE   0.85
+#define LOD_PIXELS          1.0     // items smaller than this on screen are merged
+#define HIT_PIXELS          4       // how close a click must be to a line to select it
 
 class RenderItemList
 {
@@ -12,25 +17,47 @@ public:
     RenderItemList();
     virtual ~RenderItemList();
 
-    void convertList(const QList<PosItem>& items);
-    void rescale(const QSize& size);
+    void convertList(ToolpathModelPtr items);
+    bool rescale(const QSize& size);
     void writePath(QPainter& painter, bool updatedFromFile);
+    QRectF writePath(QPainter& painter, int fromLine, int toLine);
     void drawAxes(QPainter& painter);
     void drawMeasurements(QPainter& painter);
     void drawPoint(QPainter& painter, const PosItem& point);
+    QPointF screenPoint(const PosItem& point);
     bool setCurrFileLine(const int currLine);
+    int getCurrFileLine() const { return currFileLine; }
     void setLivePoint(const PosItem& livePoint);
     void updateLivePoint();
 
+    void zoomAt(const QPointF& screenPos, double factor);
+    void pan(double dx, double dy);
+    void resetView();
+    int lineAt(const QPointF& screenPos);
+
 private:
     void clearList();
+    int firstItemAfter(int line) const;
+    QRectF viewArea() const;
+    QPointF toMachine(const QPointF& screenPos) const;
+    void appendItem(QPainterPath& path, int n, int& last, QPointF& lastPoint);
+    ArcItem arcAt(int n) const;
+    double screenX(double x) const { return (x * scale) + offsetx; }
+    double screenY(double y) const { return windowSize.height() - ((y * scale) + offsety); }
+    QPointF endPoint(int n) const { return QPointF(screenX(model->x(n)), screenY(model->y(n))); }
     void writeText(QPainter& painter, QString text, double x, double y, int avgCharWd);
 
 private:
-    QList<ItemToBase *> list;
+    // Items are drawn straight from the model, only arcs get a temporary ArcItem
+    ToolpathModelPtr model;
+    QVector<QRectF> itemBounds; // machine coordinates, including where the item starts
+    SegmentIndex segmentIndex;
     double scale;
     double offsetx;
     double offsety;
+    double zoom;
+    double panx;
+    double pany;
     PosItem extents;
     QSize windowSize;
     bool mm;
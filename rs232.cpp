@@ -8,6 +8,8 @@
  ****************************************************************/
 
 #include "rs232.h"
+#include "trace.h"
+#include "wirereplay.h"
 #include <QObject>
 
 RS232::RS232()
@@ -44,12 +46,27 @@ bool RS232::OpenComport(QString commPortStr, QString baudRate)
             baud = BAUD9600;
     }
 
+    portName = commPortStr;
+
+    // A replay stands in for the controller, it isn't recorded again
+    QString replayPath;
+    double timeScale;
+    if (WireReplayDevice::parsePortName(commPortStr, replayPath, timeScale))
+    {
+        port = new WireReplayDevice(replayPath, timeScale);
+        port->open(QIODevice::ReadWrite);
+        return port->isOpen();
+    }
+
     PortSettings settings = {baud, DATA_8, PAR_NONE, STOP_1, FLOW_OFF, 10};
 
     port = new QextSerialPort(commPortStr, settings, QextSerialPort::Polling);
 
     port->open(QIODevice::ReadWrite);
 
+    if (port->isOpen())
+        wire.opened(commPortStr, QString::number(baud));
+
     return port->isOpen();
 }
 
@@ -64,6 +81,7 @@ int RS232::PollComport(char *buf, int size)
         return 0;
 
     n = port->read(buf, size);
+    wire.received(buf, n);
     return(n);
 }
 
@@ -71,6 +89,7 @@ int RS232::PollComport(char *buf, int size)
 // input buffer by peeking at the buffer. It never removes items unless it can remove a full line.
 int RS232::PollComportLine(char *buf, int size)
 {
+    TRACE_SCOPE("RS232::PollComportLine");
     if (port == NULL || !port->isOpen())
         return 0;
 
@@ -146,12 +165,14 @@ int RS232::PollComportLine(char *buf, int size)
     }
 
     n = port->read(buf, toRead);
+    wire.received(buf, n);
 
     return n;
 }
 
 int RS232::SendBuf(const char *buf, int size)
 {
+    TRACE_SCOPE("RS232::SendBuf");
     if (port == NULL || !port->isOpen())
         return 0;
 /// LETARTARE  for test
@@ -165,7 +186,7 @@ int RS232::SendBuf(const char *buf, int size)
     char b[300] = {0};
     memcpy(b, buf, size);
 #ifdef DIAG
-    printf("Sending to port %s [%s]:", port->portName().toLocal8Bit().constData(), b);
+    printf("Sending to port %s [%s]:", portName.toLocal8Bit().constData(), b);
     for (int x= 0; x < size; x++)
     {
         printf("%02X ", buf[x]);
@@ -181,6 +202,7 @@ int RS232::SendBuf(const char *buf, int size)
     // because grbl loses bytes due to its interrupt service routine (ISR) taking too many clock
     // cycles away from serial handling.
     int result = 0;
+    int written = 0;
     for (int i = 0; i < size; i++)
     {
         result = port->write(&buf[i], 1);
@@ -195,6 +217,7 @@ int RS232::SendBuf(const char *buf, int size)
             result = 0;
             break;
         }
+        written++;
 
         if (charSendDelayMs > 0)
         {
@@ -202,6 +225,10 @@ int RS232::SendBuf(const char *buf, int size)
         }
     }
 
+    wire.sent(buf, written);
+    if (written < size)
+        wire.error("Write to port failed");
+
 #else
     // DO NOT RUN THIS CODE
     int result = port->write(buf, size);
@@ -237,6 +264,7 @@ int RS232::SendBuf(const char *buf, int size)
 
 void RS232::CloseComport()
 {
+    wire.closed();
     if (port != NULL)
     {
         port->close();
@@ -283,3 +311,13 @@ void RS232::setCharSendDelayMs(int csd)
 {
     charSendDelayMs = csd;
 }
+
+void RS232::setWireTrace(int mode, const QString& dir)
+{
+    wire.setMode(mode, dir);
+}
+
+void RS232::wireError(const QString& reason)
+{
+    wire.error(reason);
+}
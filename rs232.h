@@ -11,7 +11,6 @@
 #define RS232_H
 
 #include <QtGlobal>
-#include <QMessageBox>
 
 #include <stdio.h>
 #include <string.h>
@@ -30,7 +29,6 @@
 #else
 // TODO - R - if I leave out Windows.h then Sleep is not found???
 #include <Windows.h>
-#include <QtGui/QWindow>
 #endif
 #endif
 
@@ -38,6 +36,7 @@
 #include <qextserialenumerator.h>
 
 #include "definitions.h"
+#include "wiretrace.h"
 
 
 #if defined(Q_OS_LINUX) || defined(Q_OS_MACX) || defined(Q_OS_ANDROID)
@@ -63,9 +62,16 @@ public:
     QString getDetectedLineFeed();
     int bytesAvailable();
     void setCharSendDelayMs(int charSendDelayMs);
+    // Recording of the bytes on the port, see WireTrace, from the next open
+    void setWireTrace(int mode, const QString& dir);
+    // Marks a failure in the recording, and saves the flight recorder
+    void wireError(const QString& reason);
 
 private:
-    QextSerialPort *port;
+    // A QextSerialPort, or a WireReplayDevice for replay: port names
+    QIODevice *port;
+    QString portName;
+    WireTrace wire;
     char detectedEOL;
     QString detectedLineFeed;
     int charSendDelayMs;
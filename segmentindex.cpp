@@ -0,0 +1,144 @@
+#include "segmentindex.h"
+#include <algorithm>
+
+SegmentIndex::SegmentIndex()
+    : root(NULL)
+{
+}
+
+SegmentIndex::~SegmentIndex()
+{
+    clear();
+}
+
+void SegmentIndex::clear()
+{
+    if (root != NULL)
+        deleteNode(root);
+    root = NULL;
+    itemBounds.clear();
+}
+
+SegmentIndex::Node *SegmentIndex::createNode(const QRectF& bounds)
+{
+    Node *node = new Node;
+    node->bounds = bounds;
+    for (int n = 0; n < 4; n++)
+        node->children[n] = NULL;
+    node->firstItem = -1;
+    return node;
+}
+
+void SegmentIndex::deleteNode(Node *node)
+{
+    for (int n = 0; n < 4; n++)
+    {
+        if (node->children[n] != NULL)
+            deleteNode(node->children[n]);
+    }
+    delete node;
+}
+
+void SegmentIndex::build(const QVector<QRectF>& bounds)
+{
+    clear();
+
+    if (bounds.isEmpty())
+        return;
+
+    itemBounds = bounds;
+
+    double left = bounds.at(0).left(), right = bounds.at(0).right();
+    double top = bounds.at(0).top(), bottom = bounds.at(0).bottom();
+    foreach (QRectF r, bounds)
+    {
+        left = qMin(left, r.left());
+        right = qMax(right, r.right());
+        top = qMin(top, r.top());
+        bottom = qMax(bottom, r.bottom());
+    }
+
+    root = createNode(QRectF(QPointF(left, top), QPointF(right, bottom)));
+    for (int n = 0; n < bounds.size(); n++)
+        insert(root, n, 0);
+}
+
+void SegmentIndex::insert(Node *node, int item, int depth)
+{
+    // Items are inserted in list order, the first one to reach a node is its first item
+    if (node->firstItem < 0)
+        node->firstItem = item;
+
+    if (depth < SEGMENT_INDEX_MAX_DEPTH)
+    {
+        QPointF c = node->bounds.center();
+        const QRectF& b = node->bounds;
+        QRectF quadrants[4] = {
+            QRectF(b.topLeft(), c),
+            QRectF(QPointF(c.x(), b.top()), QPointF(b.right(), c.y())),
+            QRectF(QPointF(b.left(), c.y()), QPointF(c.x(), b.bottom())),
+            QRectF(c, b.bottomRight())
+        };
+
+        for (int n = 0; n < 4; n++)
+        {
+            if (contains(quadrants[n], itemBounds.at(item)))
+            {
+                if (node->children[n] == NULL)
+                    node->children[n] = createNode(quadrants[n]);
+                insert(node->children[n], item, depth + 1);
+                return;
+            }
+        }
+    }
+
+    node->items.append(item);
+}
+
+void SegmentIndex::query(const QRectF& area, double minSize, QVector<int>& result) const
+{
+    result.clear();
+    if (root == NULL)
+        return;
+
+    queryNode(root, area, minSize, result);
+    std::sort(result.begin(), result.end());
+}
+
+void SegmentIndex::queryNode(const Node *node, const QRectF& area, double minSize, QVector<int>& result) const
+{
+    if (!overlaps(node->bounds, area))
+        return;
+
+    if (node->bounds.width() < minSize && node->bounds.height() < minSize)
+    {
+        result.append(node->firstItem);
+        return;
+    }
+
+    foreach (int item, node->items)
+    {
+        if (overlaps(itemBounds.at(item), area))
+            result.append(item);
+    }
+
+    for (int n = 0; n < 4; n++)
+    {
+        if (node->children[n] != NULL)
+            queryNode(node->children[n], area, minSize, result);
+    }
+}
+
+// QRectF::intersects() and contains() ignore empty rectangles, but a horizontal
+// or vertical move has a zero width or height and still has to be found.
+bool SegmentIndex::overlaps(const QRectF& a, const QRectF& b)
+{
+    return a.left() <= b.right() && b.left() <= a.right()
+            && a.top() <= b.bottom() && b.top() <= a.bottom();
+}
+
+bool SegmentIndex::contains(const QRectF& outer, const QRectF& inner)
+{
+    return outer.left() <= inner.left() && inner.right() <= outer.right()
+            && outer.top() <= inner.top() && inner.bottom() <= outer.bottom();
+}
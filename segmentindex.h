@@ -0,0 +1,51 @@
+#ifndef SEGMENTINDEX_H
+#define SEGMENTINDEX_H
+#include <QRectF>
+#include <QVector>
+
+#define SEGMENT_INDEX_MAX_DEPTH 12
+
+/*
+ * Quadtree over the bounding boxes of the visualizer items, in machine
+ * coordinates. Items are identified by their position in the item list and
+ * each one is stored in the deepest node that fully contains it.
+ */
+class SegmentIndex
+{
+public:
+    SegmentIndex();
+    ~SegmentIndex();
+
+    void build(const QVector<QRectF>& bounds);
+    void clear();
+
+    // Positions of the items touching area, in list order. A node smaller than
+    // minSize in both axes only contributes its first item, so the result is
+    // bounded by the screen resolution and not by the number of items.
+    void query(const QRectF& area, double minSize, QVector<int>& result) const;
+
+    static bool overlaps(const QRectF& a, const QRectF& b);
+
+private:
+    Q_DISABLE_COPY(SegmentIndex)
+
+    struct Node
+    {
+        QRectF bounds;
+        Node *children[4];
+        QVector<int> items;
+        int firstItem;
+    };
+
+    Node *createNode(const QRectF& bounds);
+    void deleteNode(Node *node);
+    void insert(Node *node, int item, int depth);
+    void queryNode(const Node *node, const QRectF& area, double minSize, QVector<int>& result) const;
+    static bool contains(const QRectF& outer, const QRectF& inner);
+
+private:
+    Node *root;
+    QVector<QRectF> itemBounds;
+};
+
+#endif // SEGMENTINDEX_H
@@ -0,0 +1,75 @@
+/****************************************************************
+ * settingskeys.h
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#ifndef SETTINGSKEYS_H
+#define SETTINGSKEYS_H
+
+// QSettings keys, shared by the GUI and the command line streamer
+
+// Where QSettings keeps them
+#define COMPANY_NAME "zapmaker"
+#define APPLICATION_NAME "GrblController"
+#define DOMAIN_NAME "org.zapmaker"
+
+#define SETTINGS_CONTROLLER_GRBL            0
+#define SETTINGS_CONTROLLER_MARLIN          1
+
+#define SETTINGS_CONTROLLER                 "controller"
+//#define SETTINGS_INVERSE_C                  "inverse.c"
+#define SETTINGS_INVERSE_FOURTH             "inverse.c"// leave as 'c' for backwards compat
+#define SETTINGS_INVERSE_X                  "inverse.x"
+#define SETTINGS_INVERSE_Y                  "inverse.y"
+#define SETTINGS_INVERSE_Z                  "inverse.z"
+#define SETTINGS_RESPONSE_WAIT_TIME         "responseWaitTime"
+#define SETTINGS_Z_JOG_RATE                 "zJogRate"
+#define SETTINGS_ENABLE_DEBUG_LOG           "debugLog"
+#define SETTINGS_USE_AGGRESSIVE_PRELOAD     "aggressivePreload"
+#define SETTINGS_WAIT_FOR_JOG_TO_COMPLETE   "waitForJogToComplete"
+#define SETTINGS_USE_MM_FOR_MANUAL_CMDS     "useMMForManualCommands"
+#define SETTINGS_ABSOLUTE_AFTER_AXIS_ADJ    "absCoordForManualAfterAxisAdj"
+#define SETTINGS_Z_RATE_LIMIT               "zRateLimit"
+#define SETTINGS_Z_RATE_LIMIT_AMOUNT        "zRateLimitAmount"
+#define SETTINGS_XY_RATE_AMOUNT             "xyRateAmount"
+#define SETTINGS_FOUR_AXIS_USE              "fourAxis"
+#define SETTINGS_FOUR_AXIS_TYPE             "fourAxisType"
+
+#define SETTINGS_FILE_OPEN_DIALOG_STATE     "fileopendialogstate"
+#define SETTINGS_NAME_FILTER                "namefilter"
+#define SETTINGS_DIRECTORY                  "directory"
+#define SETTINGS_PORT                       "port"
+#define SETTINGS_BAUD                       "baud"
+
+#define SETTINGS_PROMPTED_AGGR_PRELOAD      "promptedAggrPreload"
+
+#define SETTINGS_FILTER_FILE_COMMANDS       "filterFileCommands"
+#define SETTINGS_REDUCE_PREC_FOR_LONG_LINES "reducePrecisionForLongLines"
+#define SETTINGS_GRBL_LINE_BUFFER_LEN       "grblLineBufferLen"
+#define SETTINGS_COMPACT_LINES              "compactLines"
+#define SETTINGS_CHAR_SEND_DELAY_MS         "charSendDelayMs"
+#define SETTINGS_JOG_STEP                   "jogStep"
+
+#define SETTINGS_ENABLE_POS_REQ             "positionRequest"
+#define SETTINGS_TYPE_POS_REQ               "posRequestType"
+#define SETTINGS_POS_REQ_FREQ_SEC           "posReqFreqSec"
+
+#define SETTINGS_PROBE_SEEK_FEED            "probeSeekFeed"
+#define SETTINGS_PROBE_TOUCH_FEED           "probeTouchFeed"
+#define SETTINGS_PROBE_BACKOFF              "probeBackoff"
+#define SETTINGS_PROBE_CLEARANCE            "probeClearance"
+#define SETTINGS_PROBE_MAX_TRAVEL           "probeMaxTravel"
+#define SETTINGS_PROBE_SHORT_LIFT           "probeShortLift"
+
+#define SETTINGS_ARC_FIT_TOLERANCE          "arcFitTolerance"
+#define SETTINGS_SIMPLIFY_XY_TOLERANCE      "simplifyXYTolerance"
+#define SETTINGS_SIMPLIFY_Z_TOLERANCE       "simplifyZTolerance"
+
+#define SETTINGS_METRICS_PORT               "metricsPort"   // 0 when not served
+#define SETTINGS_WIRE_TRACE                 "wireTrace"     // WIRE_TRACE_OFF, _FILE or _FLIGHT
+#define SETTINGS_WIRE_TRACE_DIR             "wireTraceDir"
+
+#endif // SETTINGSKEYS_H
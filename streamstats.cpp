@@ -0,0 +1,214 @@
+/****************************************************************
+ * streamstats.cpp
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#include "streamstats.h"
+
+#include <string.h>
+
+#define SUB_BUCKETS     (1 << HISTOGRAM_SUB_BITS)
+
+StreamHistogram::StreamHistogram()
+{
+    reset();
+}
+
+void StreamHistogram::reset()
+{
+    memset(counts, 0, sizeof(counts));
+    total = 0;
+    sum = 0;
+    minValue = 0;
+    maxValue = 0;
+}
+
+// Below 2 * SUB_BUCKETS the bucket is the value, above it the top
+// HISTOGRAM_SUB_BITS + 1 bits of the value after its highest bit
+int StreamHistogram::bucketOf(qint64 value)
+{
+    if (value < 2 * SUB_BUCKETS)
+        return value < 0 ? 0 : int(value);
+
+    if (value >> HISTOGRAM_MAX_BITS)
+        return HISTOGRAM_BUCKETS - 1;
+
+    int high;
+#if defined(Q_CC_GNU)
+    high = 63 - __builtin_clzll(quint64(value));
+#else
+    high = 0;
+    for (quint64 v = value; v > 1; v >>= 1)
+        high++;
+#endif
+
+    int shift = high - HISTOGRAM_SUB_BITS;
+    return ((shift + 1) << HISTOGRAM_SUB_BITS) + int(value >> shift) - SUB_BUCKETS;
+}
+
+qint64 StreamHistogram::highestOf(int bucket)
+{
+    if (bucket < 2 * SUB_BUCKETS)
+        return bucket;
+
+    int shift = (bucket >> HISTOGRAM_SUB_BITS) - 1;
+    qint64 sub = (bucket & (SUB_BUCKETS - 1)) + SUB_BUCKETS;
+    return ((sub + 1) << shift) - 1;
+}
+
+void StreamHistogram::record(qint64 value)
+{
+    if (value < 0)
+        value = 0;
+
+    counts[bucketOf(value)]++;
+    if (total == 0 || value < minValue)
+        minValue = value;
+    if (value > maxValue)
+        maxValue = value;
+    sum += value;
+    total++;
+}
+
+qint64 StreamHistogram::percentile(double percent) const
+{
+    if (total == 0)
+        return 0;
+
+    qint64 wanted = qint64(percent / 100.0 * total + 0.5);
+    if (wanted < 1)
+        wanted = 1;
+
+    qint64 seen = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+    {
+        seen += counts[i];
+        if (seen >= wanted)
+            return qMin(highestOf(i), maxValue);
+    }
+    return maxValue;
+}
+
+QString StreamHistogram::summary(const QString& name) const
+{
+    return QString("%1 count=%2 min=%3 p50=%4 p90=%5 p99=%6 p999=%7 max=%8 mean=%9")
+            .arg(name).arg(total).arg(min())
+            .arg(percentile(50)).arg(percentile(90)).arg(percentile(99)).arg(percentile(99.9))
+            .arg(max()).arg(mean(), 0, 'f', 1);
+}
+
+StreamStats::StreamStats()
+    : running(false), elapsed(0), starvedSince(-1), statusSentAt(-1)
+{
+    for (int i = 0; i < COUNTER_COUNT; i++)
+        counters[i] = 0;
+}
+
+void StreamStats::start()
+{
+    for (int i = 0; i < HISTOGRAM_COUNT; i++)
+        histograms[i].reset();
+    for (int i = 0; i < COUNTER_COUNT; i++)
+        counters[i] = 0;
+
+    clock.start();
+    running = true;
+    elapsed = 0;
+    starvedSince = -1;
+    statusSentAt = -1;
+}
+
+void StreamStats::stop()
+{
+    if (!running)
+        return;
+
+    elapsed = clock.elapsed();
+    running = false;
+}
+
+void StreamStats::lineSent(int bytes, int bytesInFlight)
+{
+    if (!running)
+        return;
+
+    if (starvedSince >= 0)
+    {
+        histograms[STARVATION_US].record((now() - starvedSince) / 1000);
+        starvedSince = -1;
+    }
+
+    histograms[BYTES_IN_FLIGHT].record(bytesInFlight);
+    counters[LINES_SENT]++;
+    counters[BYTES_SENT] += bytes;
+}
+
+void StreamStats::lineAcked(qint64 sentAt, bool error, int stillQueued)
+{
+    if (!running)
+        return;
+
+    qint64 at = now();
+    if (sentAt >= 0)
+        histograms[ACK_LATENCY_US].record((at - sentAt) / 1000);
+
+    counters[error ? ERRORS : ACKS]++;
+
+    if (stillQueued == 0)
+        starvedSince = at;
+}
+
+void StreamStats::statusRequested()
+{
+    if (running && statusSentAt < 0)
+        statusSentAt = now();
+}
+
+void StreamStats::statusReceived(int rxFill)
+{
+    if (!running)
+        return;
+
+    counters[STATUS_REPORTS]++;
+    if (statusSentAt >= 0)
+    {
+        histograms[STATUS_RTT_US].record((now() - statusSentAt) / 1000);
+        statusSentAt = -1;
+    }
+    if (rxFill >= 0)
+        histograms[RX_FILL_BYTES].record(rxFill);
+}
+
+const char *StreamStats::histogramName(Histogram which)
+{
+    static const char *names[HISTOGRAM_COUNT] =
+    {
+        "ack_latency_us", "bytes_in_flight", "rx_fill_bytes", "starvation_us", "status_rtt_us"
+    };
+    return names[which];
+}
+
+const char *StreamStats::counterName(Counter which)
+{
+    static const char *names[COUNTER_COUNT] =
+    {
+        "lines_sent", "bytes_sent", "acks", "errors", "read_retries", "timeouts", "status_reports"
+    };
+    return names[which];
+}
+
+QStringList StreamStats::summary() const
+{
+    QStringList lines;
+    for (int i = 0; i < HISTOGRAM_COUNT; i++)
+        lines.append(histograms[i].summary(histogramName(Histogram(i))));
+
+    QString counts = QString("counters elapsed_ms=%1").arg(elapsedMs());
+    for (int i = 0; i < COUNTER_COUNT; i++)
+        counts.append(QString(" %1=%2").arg(counterName(Counter(i))).arg(counters[i]));
+    lines.append(counts);
+    return lines;
+}
@@ -0,0 +1,135 @@
+/****************************************************************
+ * streamstats.h
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#ifndef STREAMSTATS_H
+#define STREAMSTATS_H
+
+#include <QString>
+#include <QStringList>
+#include <QElapsedTimer>
+#include <QMetaType>
+
+// Values below 2^(HISTOGRAM_SUB_BITS + 1) are counted exactly, above that every
+// power of two is split in 2^HISTOGRAM_SUB_BITS buckets, about 3% wide
+#define HISTOGRAM_SUB_BITS      5
+#define HISTOGRAM_MAX_BITS      40      // larger values go to the last bucket, 12 days in us
+#define HISTOGRAM_BUCKETS       ((HISTOGRAM_MAX_BITS - HISTOGRAM_SUB_BITS + 1) << HISTOGRAM_SUB_BITS)
+
+/**
+ * @brief Counts of non negative values in log-linear buckets, as HdrHistogram does.
+ *
+ * Recording is a few shifts and an increment, the memory is fixed, and
+ * any percentile is read back within the bucket precision.
+ */
+class StreamHistogram
+{
+public:
+    StreamHistogram();
+
+    void reset();
+    void record(qint64 value);
+
+    qint64 count() const { return total; }
+    qint64 min() const { return total > 0 ? minValue : 0; }
+    qint64 max() const { return maxValue; }
+    double mean() const { return total > 0 ? double(sum) / total : 0; }
+    qint64 valueSum() const { return sum; }
+
+    // Highest value of the bucket holding the given percentile, 0 if empty
+    qint64 percentile(double percent) const;
+
+    QString summary(const QString& name) const;
+
+private:
+    static int bucketOf(qint64 value);
+    static qint64 highestOf(int bucket);
+
+private:
+    quint32 counts[HISTOGRAM_BUCKETS];
+    qint64 total;
+    qint64 sum;
+    qint64 minValue;
+    qint64 maxValue;
+};
+
+/**
+ * @brief Link and firmware health of a file send, as seen from the host.
+ *
+ * The controllers record every line as it is written to the port and as
+ * its ok or error comes back. The histograms tell a slow link (long ack
+ * latency with an empty receive buffer) apart from a busy firmware (a
+ * full buffer) and from the host not keeping up (starvation).
+ *
+ * Recorded on the controller thread only, other threads get copies
+ * through GCodeController::streamStatsReady.
+ */
+class StreamStats
+{
+public:
+    enum Histogram
+    {
+        ACK_LATENCY_US,     // line written to the port to its ok or error
+        BYTES_IN_FLIGHT,    // written and not acknowledged, sampled at each line written
+        RX_FILL_BYTES,      // receive buffer use reported by the firmware in its status
+        STARVATION_US,      // nothing left to acknowledge until the next line is written
+        STATUS_RTT_US,      // position request to its status report
+        HISTOGRAM_COUNT
+    };
+
+    enum Counter
+    {
+        LINES_SENT,
+        BYTES_SENT,
+        ACKS,
+        ERRORS,             // lines refused by the firmware
+        READ_RETRIES,       // port reads that failed and were tried again
+        TIMEOUTS,           // waits for an ok that gave up
+        STATUS_REPORTS,
+        COUNTER_COUNT
+    };
+
+    StreamStats();
+
+    // Clears everything and starts the clock, at the start of a file
+    void start();
+    bool isRunning() const { return running; }
+    void stop();
+
+    // Nanoseconds since start(), for the send times handed back to lineAcked
+    qint64 now() const { return clock.nsecsElapsed(); }
+
+    void lineSent(int bytes, int bytesInFlight);
+    void lineAcked(qint64 sentAt, bool error, int stillQueued);
+    void statusRequested();
+    void statusReceived(int rxFill);
+    void readRetry() { counters[READ_RETRIES]++; }
+    void timeout() { counters[TIMEOUTS]++; }
+
+    const StreamHistogram& histogram(Histogram which) const { return histograms[which]; }
+    qint64 counter(Counter which) const { return counters[which]; }
+    qint64 elapsedMs() const { return running ? clock.elapsed() : elapsed; }
+
+    static const char *histogramName(Histogram which);
+    static const char *counterName(Counter which);
+
+    // One line per histogram and one for the counters, as logged at the end of a file
+    QStringList summary() const;
+
+private:
+    StreamHistogram histograms[HISTOGRAM_COUNT];
+    qint64 counters[COUNTER_COUNT];
+    QElapsedTimer clock;
+    bool running;
+    qint64 elapsed;
+    qint64 starvedSince;    // -1 while lines are waiting for their ok
+    qint64 statusSentAt;    // -1 when no position request is pending
+};
+
+Q_DECLARE_METATYPE(StreamStats)
+
+#endif // STREAMSTATS_H
@@ -8,7 +8,7 @@
  ****************************************************************/
 #include "timer.h"
 Timer::Timer(QObject *parent) :
-    QObject(parent), timing(false)
+    QObject(parent), timing(false), currLine(0)
 {
     startTimer(500);
 }
@@ -17,7 +17,29 @@ void Timer::resetTimer(bool timeIt)
 {
     timing = timeIt;
     if (timeIt)
+    {
         timer.start();
+        currLine = 0;
+    }
+}
+
+void Timer::setEstimate(JobEstimatePtr newEstimate)
+{
+    estimate = newEstimate;
+}
+
+// Line being sent, 1 based
+void Timer::setCurrLine(int line)
+{
+    currLine = line;
+}
+
+QString Timer::formatTime(int secs)
+{
+    int mins = (secs / 60) % 60;
+    int hours = (secs / 3600);
+    secs = secs % 60;
+    return QString("%1:%2:%3").arg(hours, 2, 10, QLatin1Char('0')).arg(mins, 2, 10, QLatin1Char('0')).arg(secs, 2, 10, QLatin1Char('0'));
 }
 
 void Timer::timerEvent(QTimerEvent *event)
@@ -26,10 +48,15 @@ void Timer::timerEvent(QTimerEvent *event)
 
     if (timing)
     {
-        int secs = timer.elapsed() / 1000;
-        int mins = (secs / 60) % 60;
-        int hours = (secs / 3600);
-        secs = secs % 60;
-        emit setRuntime(QString("%1:%2:%3").arg(hours, 2, 10, QLatin1Char('0')).arg(mins, 2, 10, QLatin1Char('0')).arg(secs, 2, 10, QLatin1Char('0')));
+        double elapsed = timer.elapsed() / 1000.0;
+        QString runtime = formatTime((int)elapsed);
+
+        if (!estimate.isNull() && currLine > 0)
+        {
+            int left = (int)estimate->remaining(currLine - 1, elapsed);
+            runtime = tr("%1 (%2 left)").arg(runtime).arg(formatTime(left));
+        }
+
+        emit setRuntime(runtime);
     }
 }
@@ -12,6 +12,7 @@
 
 #include <QTime>
 #include <QObject>
+#include "jobestimator.h"
 
 class Timer : public QObject
 {
@@ -20,11 +21,16 @@ class Timer : public QObject
 public:
     explicit Timer(QObject *parent = 0);
 
+    // hh:mm:ss, hours go past 99 as needed
+    static QString formatTime(int secs);
+
 signals:
     void setRuntime(QString timestr);
 
 public slots:
     void resetTimer(bool timeIt);
+    void setEstimate(JobEstimatePtr estimate);
+    void setCurrLine(int line);
 
 protected:
     void timerEvent(QTimerEvent *event);
@@ -32,6 +38,8 @@ protected:
 private:
     QTime timer;
     bool timing;
+    JobEstimatePtr estimate;
+    int currLine;
 };
 
 #endif // TIMER_H
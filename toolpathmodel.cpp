@@ -0,0 +1,48 @@
+/****************************************************************
+ * toolpathmodel.cpp
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#include "toolpathmodel.h"
+
+ToolpathModel::ToolpathModel()
+{
+}
+
+void ToolpathModel::reserve(int count)
+{
+    xValues.reserve(count);
+    yValues.reserve(count);
+    iValues.reserve(count);
+    jValues.reserve(count);
+    flags.reserve(count);
+    lines.reserve(count);
+}
+
+void ToolpathModel::append(double x, double y, double i, double j, bool arc, bool cw, bool mm, int line)
+{
+    xValues.append(x);
+    yValues.append(y);
+    iValues.append(i);
+    jValues.append(j);
+    flags.append((arc ? FLAG_ARC : 0) | (cw ? FLAG_CW : 0) | (mm ? FLAG_MM : 0));
+    lines.append(line);
+}
+
+void ToolpathModel::squeeze()
+{
+    xValues.squeeze();
+    yValues.squeeze();
+    iValues.squeeze();
+    jValues.squeeze();
+    flags.squeeze();
+    lines.squeeze();
+}
+
+PosItem ToolpathModel::item(int n) const
+{
+    return PosItem(x(n), y(n), i(n), j(n), isArc(n), isCw(n), isMm(n), line(n));
+}
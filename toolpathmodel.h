@@ -0,0 +1,67 @@
+/****************************************************************
+ * toolpathmodel.h
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#ifndef TOOLPATHMODEL_H
+#define TOOLPATHMODEL_H
+
+#include <QVector>
+#include <QSharedPointer>
+#include <QMetaType>
+#include "positem.h"
+
+/**
+ * @brief XY moves of a loaded file, as drawn by the visualizer.
+ *
+ * Every move is stored in parallel arrays, floats for the coordinates, one
+ * byte of flags and the source line, so a move takes 21 bytes and a whole
+ * file is a handful of allocations. The model is filled once by the parser
+ * and then only shared read only through ToolpathModelPtr.
+ */
+class ToolpathModel
+{
+public:
+    enum Flags { FLAG_ARC = 1, FLAG_CW = 2, FLAG_MM = 4 };
+
+    ToolpathModel();
+
+    void reserve(int count);
+    void append(double x, double y, double i, double j, bool arc, bool cw, bool mm, int line);
+    void squeeze();
+
+    int count() const { return lines.size(); }
+    bool isEmpty() const { return lines.isEmpty(); }
+
+    double x(int n) const { return xValues.at(n); }
+    double y(int n) const { return yValues.at(n); }
+    // Arc center, relative to the start of the move
+    double i(int n) const { return iValues.at(n); }
+    double j(int n) const { return jValues.at(n); }
+    bool isArc(int n) const { return flags.at(n) & FLAG_ARC; }
+    bool isCw(int n) const { return flags.at(n) & FLAG_CW; }
+    bool isMm(int n) const { return flags.at(n) & FLAG_MM; }
+    int line(int n) const { return lines.at(n); }
+
+    // Source lines of all the moves, in file order
+    const QVector<int>& lineIndex() const { return lines; }
+
+    PosItem item(int n) const;
+
+private:
+    QVector<float> xValues;
+    QVector<float> yValues;
+    QVector<float> iValues;
+    QVector<float> jValues;
+    QVector<quint8> flags;
+    QVector<int> lines;
+};
+
+typedef QSharedPointer<const ToolpathModel> ToolpathModelPtr;
+
+Q_DECLARE_METATYPE(ToolpathModelPtr)
+
+#endif // TOOLPATHMODEL_H
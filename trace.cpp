@@ -0,0 +1,222 @@
+/****************************************************************
+ * trace.cpp
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#include "trace.h"
+
+#ifdef GRBL_TRACE
+
+#include "definitions.h"
+
+#include <QAtomicPointer>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadStorage>
+
+namespace
+{
+    struct TraceEvent
+    {
+        const char *name;
+        qint64 start;
+        qint64 duration;    // -1 for an instant
+    };
+
+    // Written by its thread only, read by save() up to count
+    struct TraceBuffer
+    {
+        char threadName[TRACE_THREAD_NAME_SIZE];
+        QAtomicInt session;
+        QAtomicInt count;
+        TraceEvent events[TRACE_BUFFER_EVENTS];
+    };
+
+    QAtomicPointer<TraceBuffer> buffers[TRACE_MAX_THREADS];
+    QAtomicInt bufferCount;
+
+    // Slot of the thread in buffers plus one, 0 before its first event, -1 once they ran out
+    QThreadStorage<int> threadSlot;
+
+    QElapsedTimer clock;
+    qint64 sessionStart = 0;
+
+    TraceBuffer *threadBuffer()
+    {
+        int slot = threadSlot.localData();
+        if (slot > 0)
+            return buffers[slot - 1].loadAcquire();
+        if (slot < 0)
+            return NULL;
+
+        int index = bufferCount.fetchAndAddOrdered(1);
+        if (index >= TRACE_MAX_THREADS)
+        {
+            threadSlot.setLocalData(-1);
+            return NULL;
+        }
+
+        TraceBuffer *buffer = new TraceBuffer;
+        QThread *thread = QThread::currentThread();
+        QString name = thread->objectName();
+        if (name.isEmpty())
+        {
+            if (QCoreApplication::instance() != NULL && thread == QCoreApplication::instance()->thread())
+                name = "main";
+            else
+                name = QString("thread %1").arg(index + 1);
+        }
+        qstrncpy(buffer->threadName, name.toUtf8().constData(), TRACE_THREAD_NAME_SIZE);
+
+        buffers[index].storeRelease(buffer);
+        threadSlot.setLocalData(index + 1);
+        return buffer;
+    }
+
+    void writeName(QTextStream& out, const char *name)
+    {
+        out << '"';
+        for (const char *c = name; *c; c++)
+        {
+            if (*c == '"' || *c == '\\')
+                out << '\\';
+            out << *c;
+        }
+        out << '"';
+    }
+}
+
+QAtomicInt Trace::recording(0);
+QAtomicInt Trace::session(0);
+QAtomicInt Trace::droppedEvents(0);
+
+void Trace::start()
+{
+    if (!clock.isValid())
+        clock.start();
+
+    // The buffers empty themselves on their next event once the session changed
+    sessionStart = clock.nsecsElapsed();
+    droppedEvents.storeRelease(0);
+    session.fetchAndAddOrdered(1);
+    recording.storeRelease(1);
+}
+
+void Trace::stop()
+{
+    recording.storeRelease(0);
+}
+
+qint64 Trace::now()
+{
+    return clock.nsecsElapsed();
+}
+
+void Trace::complete(const char *name, qint64 start, qint64 end)
+{
+    record(name, start, end - start);
+}
+
+void Trace::instant(const char *name)
+{
+    if (isRecording())
+        record(name, now(), -1);
+}
+
+void Trace::record(const char *name, qint64 start, qint64 duration)
+{
+    if (!isRecording())
+        return;
+
+    TraceBuffer *buffer = threadBuffer();
+    if (buffer == NULL)
+    {
+        droppedEvents.fetchAndAddRelaxed(1);
+        return;
+    }
+
+    int current = session.loadAcquire();
+    if (buffer->session.loadAcquire() != current)
+    {
+        buffer->count.storeRelease(0);
+        buffer->session.storeRelease(current);
+    }
+
+    int count = buffer->count.loadAcquire();
+    if (count >= TRACE_BUFFER_EVENTS)
+    {
+        droppedEvents.fetchAndAddRelaxed(1);
+        return;
+    }
+
+    TraceEvent& event = buffer->events[count];
+    event.name = name;
+    event.start = start;
+    event.duration = duration;
+    buffer->count.storeRelease(count + 1);
+}
+
+bool Trace::save(const QString& path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+    {
+        err("Can't write trace file %s: %s", qPrintable(path), qPrintable(file.errorString()));
+        return false;
+    }
+
+    qint64 pid = QCoreApplication::applicationPid();
+    int current = session.loadAcquire();
+    int threads = qMin(bufferCount.loadAcquire(), int(TRACE_MAX_THREADS));
+
+    QTextStream out(&file);
+    out.setRealNumberNotation(QTextStream::FixedNotation);
+    out.setRealNumberPrecision(3);
+
+    // Timestamps and durations are in microseconds
+    out << "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped\":" << dropped() << "},\"traceEvents\":[\n";
+    bool first = true;
+    for (int tid = 0; tid < threads; tid++)
+    {
+        TraceBuffer *buffer = buffers[tid].loadAcquire();
+        if (buffer == NULL || buffer->session.loadAcquire() != current)
+            continue;
+
+        if (!first)
+            out << ",\n";
+        first = false;
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << tid + 1
+            << ",\"args\":{\"name\":";
+        writeName(out, buffer->threadName);
+        out << "}}";
+
+        int count = buffer->count.loadAcquire();
+        for (int i = 0; i < count; i++)
+        {
+            const TraceEvent& event = buffer->events[i];
+            out << ",\n{\"name\":";
+            writeName(out, event.name);
+            out << ",\"cat\":\"grbl\",\"pid\":" << pid << ",\"tid\":" << tid + 1
+                << ",\"ts\":" << (event.start - sessionStart) / 1000.0;
+            if (event.duration >= 0)
+                out << ",\"ph\":\"X\",\"dur\":" << event.duration / 1000.0 << "}";
+            else
+                out << ",\"ph\":\"i\",\"s\":\"t\"}";
+        }
+    }
+    out << "\n]}\n";
+    out.flush();
+
+    if (dropped() > 0)
+        warn("Trace buffers full, %d events dropped", dropped());
+    info("Trace saved to %s", qPrintable(path));
+    return file.error() == QFile::NoError;
+}
+
+#endif // GRBL_TRACE
@@ -0,0 +1,93 @@
+/****************************************************************
+ * trace.h
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+// Trace points are only built with qmake CONFIG+=trace, which defines GRBL_TRACE.
+// Otherwise the macros expand to nothing and the Trace class doesn't exist.
+#ifdef GRBL_TRACE
+
+#include <QtGlobal>
+#include <QString>
+#include <QAtomicInt>
+
+#define TRACE_BUFFER_EVENTS     (1 << 16)   // per thread and recording, the later ones are dropped
+#define TRACE_MAX_THREADS       64          // threads seen in a run, the later ones aren't traced
+#define TRACE_THREAD_NAME_SIZE  32
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+// Times the rest of the enclosing block, name must be a string literal
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+// A point in time, name must be a string literal
+#define TRACE_INSTANT(name) Trace::instant(name)
+
+/**
+ * @brief Records timed blocks of every thread, saved as a Chrome trace.
+ *
+ * Each thread writes its own buffer, taken on its first event, so the
+ * recording never takes a lock: an event is a clock read and a store.
+ * The file opens in chrome://tracing or ui.perfetto.dev, with one track
+ * per thread named after its QThread object name.
+ *
+ * Buffers are kept until exit, at most TRACE_MAX_THREADS of them.
+ */
+class Trace
+{
+public:
+    // Drops what was recorded before
+    static void start();
+    static void stop();
+    static bool isRecording() { return recording.loadAcquire() != 0; }
+
+    // Nanoseconds on the trace clock
+    static qint64 now();
+
+    static void complete(const char *name, qint64 start, qint64 end);
+    static void instant(const char *name);
+
+    // Call after stop(), false if the file can't be written
+    static bool save(const QString& path);
+    static int dropped() { return droppedEvents.loadAcquire(); }
+
+private:
+    static void record(const char *name, qint64 start, qint64 duration);
+
+    static QAtomicInt recording;
+    static QAtomicInt session;
+    static QAtomicInt droppedEvents;
+};
+
+/**
+ * @brief Times its own lifetime, see TRACE_SCOPE.
+ */
+class TraceScope
+{
+public:
+    TraceScope(const char *name) : name(name), start(Trace::isRecording() ? Trace::now() : -1) {}
+    ~TraceScope()
+    {
+        if (start >= 0)
+            Trace::complete(name, start, Trace::now());
+    }
+
+private:
+    const char *name;
+    qint64 start;
+};
+
+#else
+
+#define TRACE_SCOPE(name) do {} while (0)
+#define TRACE_INSTANT(name) do {} while (0)
+
+#endif // GRBL_TRACE
+
+#endif // TRACE_H
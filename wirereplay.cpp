@@ -0,0 +1,246 @@
+/****************************************************************
+ * wirereplay.cpp
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#include "wirereplay.h"
+#include "definitions.h"
+
+#include <string.h>
+
+WireReplayDevice::WireReplayDevice(const QString& path, double timeScale, QObject *parent)
+    : QIODevice(parent), path(path), timeScale(timeScale), openUs(0), writesReached(0), hostSent(0), diverged(false),
+      nextAnswer(0)
+{
+}
+
+bool WireReplayDevice::open(OpenMode mode)
+{
+    QList<WireRecord> records;
+    QString errorMsg;
+    if (!WireTrace::load(path, records, errorMsg))
+    {
+        setErrorString(errorMsg);
+        err("Can't replay %s: %s", qPrintable(path), qPrintable(errorMsg));
+        return false;
+    }
+
+    recordedSent.clear();
+    writeEnds.clear();
+    writeTimesUs.clear();
+    writeReachedUs.clear();
+    answers.clear();
+    statusReports.clear();
+    openUs = records.isEmpty() ? 0 : records.first().timeUs;
+
+    int polls = 0;
+    QByteArray pending;         // received after the last line end
+    qint64 pendingUs = 0;
+    QList<bool> waitingOk;      // line ends sent and not answered yet, true for those of polls
+    foreach (const WireRecord& record, records)
+    {
+        if (record.type == WireRecord::SENT)
+        {
+            bool poll = isPoll(record.data);
+            for (int i = lineEnds(record.data); i > 0; i--)
+                waitingOk.append(poll);
+            if (poll)
+            {
+                polls++;
+                continue;
+            }
+
+            recordedSent.append(record.data);
+            writeEnds.append(recordedSent.size());
+            writeTimesUs.append(record.timeUs);
+            writeReachedUs.append(-1);
+        }
+        else if (record.type == WireRecord::RECEIVED)
+        {
+            pending.append(record.data);
+            pendingUs = record.timeUs;
+
+            int end;
+            while ((end = pending.indexOf('\n')) >= 0)
+            {
+                addAnswer(pending.left(end + 1), record.timeUs, waitingOk);
+                pending.remove(0, end + 1);
+            }
+        }
+    }
+    if (!pending.isEmpty())
+        addAnswer(pending, pendingUs, waitingOk);
+
+    info("Replaying %s: %d writes, %d polls, %d answers, %d status reports, time scale %g",
+         qPrintable(path), writeEnds.size(), polls, answers.size(), statusReports.size(), timeScale);
+
+    writesReached = 0;
+    hostSent = 0;
+    diverged = false;
+    nextAnswer = 0;
+    released.clear();
+    clock.start();
+    return QIODevice::open(mode);
+}
+
+// Status reports go with the polls, so does the ok of the line end of a poll,
+// found as the controller answers the line ends in the order they came
+void WireReplayDevice::addAnswer(const QByteArray& line, qint64 timeUs, QList<bool>& waitingOk)
+{
+    Answer answer;
+    answer.data = line;
+    answer.timeUs = timeUs;
+    answer.after = writeEnds.size() - 1;
+
+    QByteArray text = line.trimmed();
+    if (text.startsWith('<'))
+    {
+        statusReports.append(answer);
+        return;
+    }
+    if ((text.startsWith("ok") || text.startsWith("error")) && !waitingOk.isEmpty() && waitingOk.takeFirst())
+        return;
+
+    answers.append(answer);
+}
+
+void WireReplayDevice::answerPoll(const QByteArray& data)
+{
+    if (!statusReports.isEmpty())
+    {
+        // The last report recorded before the line the host got to
+        int n = 0;
+        while (n + 1 < statusReports.size() && statusReports.at(n + 1).after < writesReached)
+            n++;
+        released.append(statusReports.at(n).data);
+    }
+
+    for (int i = lineEnds(data); i > 0; i--)
+        released.append("ok\r\n");
+}
+
+qint64 WireReplayDevice::bytesAvailable() const
+{
+    release();
+    return released.size() + QIODevice::bytesAvailable();
+}
+
+void WireReplayDevice::release() const
+{
+    qint64 now = nowUs();
+    while (nextAnswer < answers.size())
+    {
+        const Answer& answer = answers.at(nextAnswer);
+
+        qint64 anchorUs = 0;
+        qint64 recordedAnchorUs = openUs;
+        if (answer.after >= 0)
+        {
+            anchorUs = writeReachedUs.at(answer.after);
+            if (anchorUs < 0)
+                break;
+            recordedAnchorUs = writeTimesUs.at(answer.after);
+        }
+
+        if (now < anchorUs + qint64((answer.timeUs - recordedAnchorUs) * timeScale))
+            break;
+
+        released.append(answer.data);
+        nextAnswer++;
+    }
+}
+
+qint64 WireReplayDevice::readData(char *data, qint64 maxSize)
+{
+    release();
+
+    int n = int(qMin(maxSize, qint64(released.size())));
+    memcpy(data, released.constData(), n);
+    released.remove(0, n);
+    return n;
+}
+
+qint64 WireReplayDevice::writeData(const char *data, qint64 size)
+{
+    QByteArray bytes = QByteArray::fromRawData(data, int(size));
+    if (isPoll(bytes))
+    {
+        answerPoll(bytes);
+        return size;
+    }
+
+    bool same = hostSent + size <= recordedSent.size()
+            && memcmp(recordedSent.constData() + hostSent, data, size_t(size)) == 0;
+    if (!diverged && !same)
+    {
+        diverged = true;
+        warn("Replay of %s diverged at byte %lld of the recorded writes, the answers may no longer match",
+             qPrintable(path), hostSent);
+    }
+    hostSent += size;
+
+    qint64 now = nowUs();
+    while (writesReached < writeEnds.size() && writeEnds.at(writesReached) <= hostSent)
+        writeReachedUs[writesReached++] = now;
+    return size;
+}
+
+bool WireReplayDevice::isPoll(const QByteArray& data)
+{
+    if (data.isEmpty() || data.at(0) != '?')
+        return false;
+    for (int i = 1; i < data.size(); i++)
+    {
+        if (data.at(i) != '\r' && data.at(i) != '\n')
+            return false;
+    }
+    return true;
+}
+
+// A \r\n pair is one line end
+int WireReplayDevice::lineEnds(const QByteArray& data)
+{
+    int count = 0;
+    for (int i = 0; i < data.size(); i++)
+    {
+        if (data.at(i) == '\n' || (data.at(i) == '\r' && (i + 1 == data.size() || data.at(i + 1) != '\n')))
+            count++;
+    }
+    return count;
+}
+
+bool WireReplayDevice::isReplayPort(const QString& portName)
+{
+    return portName.startsWith(WIRE_REPLAY_PREFIX);
+}
+
+bool WireReplayDevice::parsePortName(const QString& portName, QString& path, double& timeScale)
+{
+    if (!isReplayPort(portName))
+        return false;
+
+    path = portName.mid(QString(WIRE_REPLAY_PREFIX).size());
+    timeScale = 1;
+
+    // The scale is optional, an @ without a number after it is part of the path
+    int at = path.lastIndexOf('@');
+    if (at > 0)
+    {
+        bool ok;
+        double scale = path.mid(at + 1).toDouble(&ok);
+        if (ok && scale >= 0)
+        {
+            timeScale = scale;
+            path.truncate(at);
+        }
+    }
+    return !path.isEmpty();
+}
+
+QString WireReplayDevice::portName(const QString& path, double timeScale)
+{
+    return QString("%1%2@%3").arg(WIRE_REPLAY_PREFIX).arg(path).arg(timeScale);
+}
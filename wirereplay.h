@@ -0,0 +1,94 @@
+/****************************************************************
+ * wirereplay.h
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#ifndef WIREREPLAY_H
+#define WIREREPLAY_H
+
+#include <QIODevice>
+#include <QList>
+#include <QElapsedTimer>
+#include "wiretrace.h"
+
+// RS232 opens a replay instead of a port for names like replay:<trace>[@<time scale>]
+#define WIRE_REPLAY_PREFIX      "replay:"
+
+/**
+ * @brief Plays the controller side of a serial trace back to the host.
+ *
+ * The status polls (a ? alone on its write) come from a timer, they are
+ * matched apart from the lines. Each poll of the host is answered at once
+ * with the status report recorded last before the line the host reached,
+ * and with the ok of its line end if it has one.
+ *
+ * The other answers of the controller are released line by line in the
+ * recorded order, each once the host has written every line written
+ * before it in the recording, and once the recorded delay since that
+ * line has passed again, multiplied by the time scale. A scale of 0
+ * answers as soon as the lines allow it.
+ *
+ * The lines of the host are compared with the recorded ones, the first
+ * difference is logged as the replay can't be faithful past it.
+ */
+class WireReplayDevice : public QIODevice
+{
+    Q_OBJECT
+public:
+    WireReplayDevice(const QString& path, double timeScale, QObject *parent = 0);
+
+    bool open(OpenMode mode);
+    bool isSequential() const { return true; }
+    qint64 bytesAvailable() const;
+
+    // Whether the host wrote what was recorded so far
+    bool isFaithful() const { return !diverged; }
+
+    static bool isReplayPort(const QString& portName);
+    static bool parsePortName(const QString& portName, QString& path, double& timeScale);
+    static QString portName(const QString& path, double timeScale);
+
+protected:
+    qint64 readData(char *data, qint64 maxSize);
+    qint64 writeData(const char *data, qint64 size);
+
+private:
+    struct Answer
+    {
+        QByteArray data;
+        qint64 timeUs;
+        int after;      // last line write recorded before it, -1 for none
+    };
+
+    void addAnswer(const QByteArray& line, qint64 timeUs, QList<bool>& waitingOk);
+    void answerPoll(const QByteArray& data);
+    void release() const;
+    static bool isPoll(const QByteArray& data);
+    static int lineEnds(const QByteArray& data);
+    qint64 nowUs() const { return clock.nsecsElapsed() / 1000; }
+
+private:
+    QString path;
+    double timeScale;
+    QElapsedTimer clock;
+
+    qint64 openUs;
+    QByteArray recordedSent;        // the line writes, without the polls
+    QList<qint64> writeEnds;        // bytes recorded as sent up to the end of each line write
+    QList<qint64> writeTimesUs;
+    QList<Answer> answers;
+    QList<Answer> statusReports;
+
+    QList<qint64> writeReachedUs;   // when the host got as far as each recorded line write
+    int writesReached;
+    qint64 hostSent;
+    bool diverged;
+
+    mutable int nextAnswer;
+    mutable QByteArray released;
+};
+
+#endif // WIREREPLAY_H
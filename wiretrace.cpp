@@ -0,0 +1,241 @@
+/****************************************************************
+ * wiretrace.cpp
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#include "wiretrace.h"
+#include "definitions.h"
+
+#include <QDateTime>
+#include <QDir>
+
+static void writeVarint(QFile& out, quint64 value)
+{
+    char bytes[10];
+    int n = 0;
+    do
+    {
+        char b = value & 0x7f;
+        value >>= 7;
+        if (value)
+            b |= 0x80;
+        bytes[n++] = b;
+    } while (value);
+    out.write(bytes, n);
+}
+
+static bool readVarint(const QByteArray& in, int& pos, quint64& value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64 && pos < in.size(); shift += 7)
+    {
+        quint8 b = in.at(pos++);
+        value |= quint64(b & 0x7f) << shift;
+        if (!(b & 0x80))
+            return true;
+    }
+    return false;
+}
+
+WireTrace::WireTrace()
+    : mode(WIRE_TRACE_OFF), pendingMode(WIRE_TRACE_OFF), fileLastUs(0), flightBytes(0)
+{
+}
+
+WireTrace::~WireTrace()
+{
+    closed();
+}
+
+void WireTrace::setMode(int newMode, const QString& newDir)
+{
+    pendingMode = newMode;
+    dir = newDir;
+}
+
+void WireTrace::opened(const QString& portName, const QString& baudRate)
+{
+    closed();
+
+    mode = pendingMode;
+    if (mode == WIRE_TRACE_OFF)
+        return;
+
+    clock.start();
+    flight.clear();
+    flightBytes = 0;
+    openRecord = WireRecord(WireRecord::OPEN, 0, QString("%1 %2").arg(portName).arg(baudRate).toUtf8());
+
+    if (mode == WIRE_TRACE_FILE)
+    {
+        if (startFile(file, "trace"))
+        {
+            fileLastUs = 0;
+            writeRecord(file, openRecord, fileLastUs);
+        }
+        else
+            mode = WIRE_TRACE_OFF;
+    }
+}
+
+void WireTrace::sent(const char *buf, int size)
+{
+    if (mode != WIRE_TRACE_OFF && size > 0)
+        append(WireRecord::SENT, QByteArray(buf, size));
+}
+
+void WireTrace::received(const char *buf, int size)
+{
+    if (mode != WIRE_TRACE_OFF && size > 0)
+        append(WireRecord::RECEIVED, QByteArray(buf, size));
+}
+
+void WireTrace::note(const QString& text)
+{
+    if (mode != WIRE_TRACE_OFF)
+        append(WireRecord::NOTE, text.toUtf8());
+}
+
+void WireTrace::error(const QString& reason)
+{
+    if (mode == WIRE_TRACE_OFF)
+        return;
+
+    note(reason);
+    if (mode == WIRE_TRACE_FLIGHT)
+        dump(reason);
+    else
+        file.flush();
+}
+
+void WireTrace::closed()
+{
+    if (mode == WIRE_TRACE_FILE && file.isOpen())
+    {
+        append(WireRecord::CLOSE, QByteArray());
+        file.close();
+    }
+    mode = WIRE_TRACE_OFF;
+}
+
+void WireTrace::append(int type, const QByteArray& data)
+{
+    WireRecord record(type, clock.nsecsElapsed() / 1000, data);
+
+    if (mode == WIRE_TRACE_FILE)
+    {
+        writeRecord(file, record, fileLastUs);
+        return;
+    }
+
+    // Oldest out first, the open record is kept aside for the dumps
+    flight.append(record);
+    flightBytes += data.size() + 4;
+    while (flightBytes > WIRE_FLIGHT_BYTES && flight.size() > 1)
+        flightBytes -= flight.takeFirst().data.size() + 4;
+}
+
+bool WireTrace::startFile(QFile& out, const QString& what)
+{
+    QDir traceDir(dir);
+    if (!traceDir.exists() && !traceDir.mkpath("."))
+    {
+        err("Can't create serial trace folder %s", qPrintable(dir));
+        return false;
+    }
+
+    QString name = QString("%1-%2%3").arg(what)
+            .arg(QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss-zzz")).arg(WIRE_TRACE_SUFFIX);
+    out.setFileName(traceDir.filePath(name));
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        err("Can't write serial trace %s: %s", qPrintable(out.fileName()), qPrintable(out.errorString()));
+        return false;
+    }
+
+    out.write(WIRE_TRACE_MAGIC, sizeof(WIRE_TRACE_MAGIC) - 1);
+    char version = WIRE_TRACE_VERSION;
+    out.write(&version, 1);
+
+    lastPath = out.fileName();
+    info("Serial trace in %s", qPrintable(lastPath));
+    return true;
+}
+
+void WireTrace::writeRecord(QFile& out, const WireRecord& record, qint64& lastUs)
+{
+    char type = record.type;
+    out.write(&type, 1);
+    writeVarint(out, quint64(qMax(record.timeUs - lastUs, qint64(0))));
+    writeVarint(out, quint64(record.data.size()));
+    out.write(record.data);
+    lastUs = record.timeUs;
+}
+
+void WireTrace::dump(const QString& reason)
+{
+    if (flight.isEmpty())
+        return;
+
+    QFile out;
+    if (!startFile(out, "flight"))
+        return;
+
+    // The open record goes first, stamped as the oldest record kept
+    qint64 lastUs = flight.first().timeUs;
+    WireRecord open = openRecord;
+    open.timeUs = lastUs;
+    writeRecord(out, open, lastUs);
+    foreach (const WireRecord& record, flight)
+        writeRecord(out, record, lastUs);
+    out.close();
+
+    warn("Serial flight recorder saved after '%s'", qPrintable(reason));
+
+    // The next failure gets what follows this one
+    flight.clear();
+    flightBytes = 0;
+}
+
+bool WireTrace::load(const QString& path, QList<WireRecord>& records, QString& errorMsg)
+{
+    QFile in(path);
+    if (!in.open(QIODevice::ReadOnly))
+    {
+        errorMsg = in.errorString();
+        return false;
+    }
+    QByteArray bytes = in.readAll();
+
+    int magicSize = sizeof(WIRE_TRACE_MAGIC) - 1;
+    if (!bytes.startsWith(WIRE_TRACE_MAGIC) || bytes.size() <= magicSize)
+    {
+        errorMsg = "not a serial trace";
+        return false;
+    }
+    if (bytes.at(magicSize) != WIRE_TRACE_VERSION)
+    {
+        errorMsg = QString("unknown serial trace version %1").arg(int(bytes.at(magicSize)));
+        return false;
+    }
+
+    // A trace cut short by a crash keeps its whole records
+    records.clear();
+    qint64 timeUs = 0;
+    int pos = magicSize + 1;
+    while (pos < bytes.size())
+    {
+        int type = quint8(bytes.at(pos++));
+        quint64 delta, size;
+        if (!readVarint(bytes, pos, delta) || !readVarint(bytes, pos, size) || size > quint64(bytes.size() - pos))
+            break;
+
+        timeUs += delta;
+        records.append(WireRecord(type, timeUs, bytes.mid(pos, int(size))));
+        pos += int(size);
+    }
+    return true;
+}
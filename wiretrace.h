@@ -0,0 +1,102 @@
+/****************************************************************
+ * wiretrace.h
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#ifndef WIRETRACE_H
+#define WIRETRACE_H
+
+#include <QString>
+#include <QByteArray>
+#include <QList>
+#include <QFile>
+#include <QElapsedTimer>
+
+#define WIRE_TRACE_OFF          0
+#define WIRE_TRACE_FILE         1   // everything, to a new file each time the port opens
+#define WIRE_TRACE_FLIGHT       2   // the last WIRE_FLIGHT_BYTES in memory, saved when something fails
+
+#define WIRE_FLIGHT_BYTES       (512 * 1024)
+#define WIRE_TRACE_MAGIC        "GRBLWIRE"
+#define WIRE_TRACE_VERSION      1
+#define WIRE_TRACE_SUFFIX       ".wire"
+
+/**
+ * @brief One block of bytes on the port, or an event around them.
+ */
+struct WireRecord
+{
+    enum Type
+    {
+        OPEN = 1,   // data is the port name and the baud rate
+        SENT,
+        RECEIVED,
+        NOTE,       // text, such as the reason of a flight recorder dump
+        CLOSE
+    };
+
+    WireRecord() : type(NOTE), timeUs(0) {}
+    WireRecord(int type, qint64 timeUs, const QByteArray& data) : type(type), timeUs(timeUs), data(data) {}
+
+    int type;
+    qint64 timeUs;      // monotonic, from the start of the recording
+    QByteArray data;
+};
+
+/**
+ * @brief Records the bytes of a serial port, for the replay of WireReplayDevice.
+ *
+ * The file starts with WIRE_TRACE_MAGIC and a version byte, then holds
+ * one record after the other: its type byte, the microseconds since the
+ * previous record and the data size as base 128 varints, and the data.
+ * A typical line costs 4 bytes more than itself.
+ *
+ * Owned by RS232 and used from its thread only.
+ */
+class WireTrace
+{
+public:
+    WireTrace();
+    ~WireTrace();
+
+    // Takes effect at the next open of the port
+    void setMode(int mode, const QString& dir);
+    int getMode() const { return mode; }
+
+    void opened(const QString& portName, const QString& baudRate);
+    void sent(const char *buf, int size);
+    void received(const char *buf, int size);
+    void note(const QString& text);
+    // Noted, and in flight recorder mode saved with what led to it
+    void error(const QString& reason);
+    void closed();
+
+    // File written last, empty if none
+    QString lastFile() const { return lastPath; }
+
+    static bool load(const QString& path, QList<WireRecord>& records, QString& errorMsg);
+
+private:
+    void append(int type, const QByteArray& data);
+    bool startFile(QFile& out, const QString& what);
+    static void writeRecord(QFile& out, const WireRecord& record, qint64& lastUs);
+    void dump(const QString& reason);
+
+private:
+    int mode;
+    int pendingMode;
+    QString dir;
+    QFile file;
+    QElapsedTimer clock;
+    qint64 fileLastUs;
+    QString lastPath;
+
+    WireRecord openRecord;
+    QList<WireRecord> flight;
+    int flightBytes;
+};
+
+#endif // WIRETRACE_H
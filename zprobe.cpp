@@ -0,0 +1,137 @@
+/****************************************************************
+ * zprobe.cpp
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#include "zprobe.h"
+
+ZProbe::ZProbe(Firmware fw, const ControlParams &params, double zSafeIn)
+    : firmware(fw), seekFeed(params.probeSeekFeed), touchFeed(params.probeTouchFeed),
+      backoff(params.probeBackoff), clearance(params.probeClearance),
+      maxTravel(params.probeMaxTravel), shortLift(params.probeShortLift), zSafe(zSafeIn), xSteps(0), ySteps(0)
+{
+    // Never lift less than the clearance, even if the user asked for a smaller zSafe.
+    if (zSafe < clearance)
+        zSafe = clearance;
+}
+
+void ZProbe::setGrid(const double *xIn, int xStepsIn, const double *yIn, int yStepsIn)
+{
+    xSteps = xStepsIn;
+    ySteps = yStepsIn;
+
+    xValues.resize(xSteps);
+    for (int i = 0; i < xSteps; i++)
+        xValues[i] = xIn[i];
+
+    yValues.resize(ySteps);
+    for (int j = 0; j < ySteps; j++)
+        yValues[j] = yIn[j];
+
+    zValues.fill(0.0, xSteps * ySteps);
+    probed.fill(false, xSteps * ySteps);
+}
+
+void ZProbe::location(int n, int &i, int &j) const
+{
+    i = n / ySteps;
+    j = n % ySteps;
+    // Odd columns are walked backwards so consecutive points are always adjacent
+    if (i % 2)
+        j = ySteps - 1 - j;
+}
+
+void ZProbe::setProbed(int i, int j, double z)
+{
+    zValues[j * xSteps + i] = z;
+    probed[j * xSteps + i] = true;
+}
+
+bool ZProbe::isProbed(int i, int j) const
+{
+    if (i < 0 || j < 0 || i >= xSteps || j >= ySteps)
+        return false;
+    return probed.at(j * xSteps + i);
+}
+
+bool ZProbe::predict(int i, int j, double &z) const
+{
+    static const int dir[4][2] = { {0, -1}, {0, 1}, {-1, 0}, {1, 0} };
+
+    // Best guess: extend the slope of the previous column, (i, jn) is the point we
+    // just touched and the column beside it tells how the height changes from jn to j.
+    for (int d = 0; d < 2; d++)
+    {
+        int jn = j + dir[d][1];
+        if (!isProbed(i, jn))
+            continue;
+
+        for (int side = -1; side <= 1; side += 2)
+        {
+            if (isProbed(i + side, j) && isProbed(i + side, jn))
+            {
+                z = zAt(i, jn) + zAt(i + side, j) - zAt(i + side, jn);
+                return true;
+            }
+        }
+    }
+
+    // Otherwise the mean of whatever neighbours we have
+    double sum = 0;
+    int n = 0;
+    for (int d = 0; d < 4; d++)
+    {
+        int ni = i + dir[d][0];
+        int nj = j + dir[d][1];
+        if (isProbed(ni, nj))
+        {
+            sum += zAt(ni, nj);
+            n++;
+        }
+    }
+
+    if (n == 0)
+        return false;
+
+    z = sum / n;
+    return true;
+}
+
+double ZProbe::retractHeight(double zContact, int nextI, int nextJ) const
+{
+    double zPredicted;
+    if (!shortLift || nextI < 0 || !predict(nextI, nextJ, zPredicted))
+        return zContact + zSafe;
+
+    double zHighest = zPredicted > zContact ? zPredicted : zContact;
+    return zHighest + clearance;
+}
+
+QString ZProbe::travelCommand(double x, double y, double feed) const
+{
+    return QString("G1 X%1 Y%2 F%3").arg(x).arg(y).arg(feed);
+}
+
+QString ZProbe::moveZCommand(double z) const
+{
+    return QString("G1 Z%1 F%2").arg(z).arg(seekFeed);
+}
+
+QString ZProbe::seekCommand(double zFrom) const
+{
+    if (firmware == FIRMWARE_GRBL)
+        return QString("G38.2 Z%1 F%2").arg(zFrom - maxTravel).arg(seekFeed);
+
+    return QString("G30");
+}
+
+QString ZProbe::touchCommand(double zContact) const
+{
+    if (firmware == FIRMWARE_GRBL)
+        return QString("G38.2 Z%1 F%2").arg(zContact - backoff).arg(touchFeed);
+
+    return QString("G30");
+}
@@ -0,0 +1,104 @@
+/****************************************************************
+ * zprobe.h
+ * GrblHoming - zapmaker fork on github
+ *
+ * GPL License (see LICENSE file)
+ * Software is provided AS-IS
+ ****************************************************************/
+
+#ifndef ZPROBE_H
+#define ZPROBE_H
+
+#include <QString>
+#include <QVector>
+#include "controlparams.h"
+
+/**
+ * @brief Probing engine shared by the controllers.
+ *
+ * Plans the order in which a leveling grid is probed, predicts the height of
+ * the next point from the ones already touched and builds the commands for a
+ * two-stage probe: a fast seek until first contact, a short back off and a
+ * slow touch for the real measure. Every move down to the work is a probe
+ * move, so the tool stops on contact however wrong a prediction is.
+ *
+ * Between points the tool goes back to zSafe. Only if the user opts in with
+ * probeShortLift it is lifted just the clearance over the current and the
+ * predicted heights, which is faster but hits any bump between two points.
+ *
+ * The engine does not talk to the port, the controller sends the commands
+ * and feeds the results back with setProbed().
+ */
+class ZProbe
+{
+public:
+    enum Firmware { FIRMWARE_MARLIN = 0, FIRMWARE_GRBL };
+
+    ZProbe(Firmware firmware, const ControlParams &params, double zSafe);
+
+    void setGrid(const double *xValues, int xSteps, const double *yValues, int ySteps);
+
+    /**
+     * @brief Number of points in the grid.
+     */
+    int count() const { return xSteps * ySteps; }
+
+    /**
+     * @brief Grid indexes of the n-th point to probe (serpentine along Y).
+     */
+    void location(int n, int &i, int &j) const;
+
+    double xValue(int i) const { return xValues.at(i); }
+    double yValue(int j) const { return yValues.at(j); }
+
+    void setProbed(int i, int j, double z);
+
+    /**
+     * @brief Expected height of the given point, from the already probed neighbours.
+     * @return false if there are no probed neighbours to guess from.
+     */
+    bool predict(int i, int j, double &z) const;
+
+    /**
+     * @brief Height to travel at from the contact point to the next one.
+     */
+    double retractHeight(double zContact, int nextI, int nextJ) const;
+
+    /**
+     * @brief Height to go back to after the fast seek, before the slow touch.
+     */
+    double backoffHeight(double zContact) const { return zContact + backoff; }
+
+    /**
+     * @brief On Marlin G30 does the whole touch, there are no seek and back off stages.
+     */
+    bool isTwoStage() const { return firmware == FIRMWARE_GRBL; }
+
+    QString travelCommand(double x, double y, double feed) const;
+    QString moveZCommand(double z) const;
+    QString seekCommand(double zFrom) const;
+    QString touchCommand(double zContact) const;
+
+private:
+    bool isProbed(int i, int j) const;
+    double zAt(int i, int j) const { return zValues.at(j * xSteps + i); }
+
+private:
+    Firmware firmware;
+    double seekFeed;
+    double touchFeed;
+    double backoff;
+    double clearance;
+    double maxTravel;
+    bool shortLift;
+    double zSafe;
+
+    int xSteps;
+    int ySteps;
+    QVector<double> xValues;
+    QVector<double> yValues;
+    QVector<double> zValues;
+    QVector<bool> probed;
+};
+
+#endif // ZPROBE_H